@@ -0,0 +1,411 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_persist.c -- benchmark implementation for remote persist latency
+ *
+ * Both the client and the target side are set up in the benchmark process
+ * and connected over the loopback interface, so the results include the
+ * whole fabric stack except the network itself.
+ */
+#include <stdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+
+#include <libpmem.h>
+
+#include "benchmark.h"
+#include "rpmem_common.h"
+#include "rpmem_hist.h"
+#include "rpmem_fip.h"
+#include "rpmemd_fip.h"
+#include "rpmemd_log.h"
+
+#define RPMEM_BENCH_NODE "127.0.0.1"
+
+/*
+ * rpmem_args -- benchmark specific arguments
+ */
+struct rpmem_args
+{
+	char *method;		/* persist method - gpspm or apm */
+	char *provider;		/* libfabric provider - sockets or verbs */
+	bool stats;		/* print latency histograms */
+};
+
+/*
+ * rpmem_bench -- benchmark context
+ */
+struct rpmem_bench
+{
+	struct rpmem_args *pargs;	/* benchmark specific arguments */
+	void *laddr;			/* local pool */
+	void *raddr;			/* remote pool */
+	size_t size;			/* size of both pools */
+	struct rpmemd_fip *dfip;	/* target side */
+	struct rpmem_fip *fip;		/* client side */
+	pthread_t accept_thread;	/* target side accepting connection */
+	int accept_ret;			/* result of accepting connection */
+};
+
+/*
+ * parse_persist_method -- parses command line "--method" argument
+ */
+static int
+parse_persist_method(const char *arg, enum rpmem_persist_method *pm)
+{
+	if (strcmp(arg, "gpspm") == 0)
+		*pm = RPMEM_PM_GPSPM;
+	else if (strcmp(arg, "apm") == 0)
+		*pm = RPMEM_PM_APM;
+	else
+		return -1;
+
+	return 0;
+}
+
+/*
+ * print_hist -- print summary of a latency histogram
+ */
+static void
+print_hist(const char *side, const char *name, const struct rpmem_hist *hist)
+{
+	fprintf(stderr, "%s %s latency [ns]: count %" PRIu64
+			" mean %" PRIu64 " p50 %" PRIu64 " p99 %" PRIu64
+			" p99.9 %" PRIu64 " max %" PRIu64 "\n", side, name,
+			hist->count, rpmem_hist_mean(hist),
+			rpmem_hist_quantile(hist, 50, 100),
+			rpmem_hist_quantile(hist, 99, 100),
+			rpmem_hist_quantile(hist, 999, 1000),
+			hist->max);
+}
+
+/*
+ * print_stats -- print latency histograms of both sides
+ */
+static void
+print_stats(struct rpmem_bench *mb)
+{
+	struct rpmem_fip_stats stats;
+	rpmem_fip_stats(mb->fip, &stats);
+
+	print_hist("client", "post", &stats.post);
+	print_hist("client", "wait", &stats.wait);
+	print_hist("client", "total", &stats.total);
+
+	struct rpmemd_fip_stats dstats;
+	rpmemd_fip_stats(mb->dfip, &dstats);
+
+	if (!dstats.total.count)
+		return;
+
+	print_hist("target", "queue", &dstats.queue);
+	print_hist("target", "persist", &dstats.persist);
+	print_hist("target", "total", &dstats.total);
+}
+
+/*
+ * accept_thread -- accept connection on target side
+ */
+static void *
+accept_thread(void *arg)
+{
+	struct rpmem_bench *mb = arg;
+
+	mb->accept_ret = rpmemd_fip_accept(mb->dfip);
+
+	return NULL;
+}
+
+/*
+ * rpmem_init -- benchmark initialization function
+ */
+static int
+rpmem_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	assert(bench != NULL);
+	assert(args != NULL);
+	assert(args->opts != NULL);
+
+	struct rpmem_bench *mb = malloc(sizeof(*mb));
+	if (!mb) {
+		perror("malloc");
+		return -1;
+	}
+
+	mb->pargs = args->opts;
+
+	enum rpmem_persist_method pm;
+	if (parse_persist_method(mb->pargs->method, &pm)) {
+		fprintf(stderr, "wrong persist method: %s\n",
+				mb->pargs->method);
+		goto err_free_mb;
+	}
+
+	enum rpmem_provider provider =
+		rpmem_provider_from_str(mb->pargs->provider);
+	if (provider == RPMEM_PROV_UNKNOWN) {
+		fprintf(stderr, "wrong provider: %s\n", mb->pargs->provider);
+		goto err_free_mb;
+	}
+
+	if (rpmemd_log_init("pmembench", NULL, 0))
+		goto err_free_mb;
+	rpmemd_log_level = RPD_LOG_ERR;
+
+	size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+	mb->size = args->n_threads * args->n_ops_per_thread * args->dsize;
+	mb->size = (mb->size + pagesize - 1) & ~(pagesize - 1);
+
+	errno = posix_memalign(&mb->laddr, pagesize, mb->size);
+	if (errno) {
+		perror("posix_memalign");
+		goto err_log_close;
+	}
+
+	errno = posix_memalign(&mb->raddr, pagesize, mb->size);
+	if (errno) {
+		perror("posix_memalign");
+		goto err_free_laddr;
+	}
+
+	memset(mb->laddr, 0, mb->size);
+	memset(mb->raddr, 0, mb->size);
+
+	struct rpmemd_fip_attr dattr = {
+		.addr = mb->raddr,
+		.size = mb->size,
+		.nlanes = args->n_threads,
+		.nconns = 1,
+		.provider = provider,
+		.persist_method = pm,
+		.persist = pmem_persist,
+		.flush = pmem_flush,
+		.drain = pmem_drain,
+		.nthreads = 1,
+		.stats = mb->pargs->stats,
+	};
+
+	struct rpmem_resp_attr resp;
+	enum rpmem_err err;
+	mb->dfip = rpmemd_fip_init(RPMEM_BENCH_NODE, NULL, &dattr,
+			&resp, &err);
+	if (!mb->dfip) {
+		fprintf(stderr, "rpmemd_fip_init failed: %d\n", err);
+		goto err_free_raddr;
+	}
+
+	if (resp.nlanes < args->n_threads) {
+		fprintf(stderr, "too many threads, maximum is %u\n",
+				resp.nlanes);
+		goto err_dfip_fini;
+	}
+
+	struct rpmem_fip_attr attr = {
+		.provider = provider,
+		.persist_method = resp.persist_method,
+		.laddr = mb->laddr,
+		.size = mb->size,
+		.nlanes = resp.nlanes,
+		.raddr = (void *)resp.raddr,
+		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+		.stats = mb->pargs->stats,
+	};
+
+	char service[NI_MAXSERV];
+	snprintf(service, NI_MAXSERV, "%u", resp.port);
+
+	unsigned nlanes;
+	mb->fip = rpmem_fip_init(RPMEM_BENCH_NODE, service, &attr, &nlanes);
+	if (!mb->fip) {
+		fprintf(stderr, "rpmem_fip_init failed\n");
+		goto err_dfip_fini;
+	}
+
+	if (nlanes < args->n_threads) {
+		fprintf(stderr, "too many threads, maximum is %u\n", nlanes);
+		goto err_fip_fini;
+	}
+
+	errno = pthread_create(&mb->accept_thread, NULL, accept_thread, mb);
+	if (errno) {
+		perror("pthread_create");
+		goto err_fip_fini;
+	}
+
+	if (rpmem_fip_connect(mb->fip)) {
+		fprintf(stderr, "rpmem_fip_connect failed\n");
+		/* the target side waits for the connection infinitely */
+		pthread_cancel(mb->accept_thread);
+		pthread_join(mb->accept_thread, NULL);
+		goto err_fip_fini;
+	}
+
+	pthread_join(mb->accept_thread, NULL);
+	if (mb->accept_ret) {
+		fprintf(stderr, "rpmemd_fip_accept failed\n");
+		goto err_fip_close;
+	}
+
+	if (rpmemd_fip_process_start(mb->dfip)) {
+		fprintf(stderr, "rpmemd_fip_process_start failed\n");
+		goto err_fip_close;
+	}
+
+	if (rpmem_fip_process_start(mb->fip)) {
+		fprintf(stderr, "rpmem_fip_process_start failed\n");
+		goto err_process_stop;
+	}
+
+	pmembench_set_priv(bench, mb);
+
+	return 0;
+err_process_stop:
+	rpmemd_fip_process_stop(mb->dfip);
+err_fip_close:
+	rpmem_fip_close(mb->fip);
+	rpmemd_fip_wait_close(mb->dfip, -1);
+	rpmemd_fip_close(mb->dfip);
+err_fip_fini:
+	rpmem_fip_fini(mb->fip);
+err_dfip_fini:
+	rpmemd_fip_fini(mb->dfip);
+err_free_raddr:
+	free(mb->raddr);
+err_free_laddr:
+	free(mb->laddr);
+err_log_close:
+	rpmemd_log_close();
+err_free_mb:
+	free(mb);
+	return -1;
+}
+
+/*
+ * rpmem_exit -- benchmark cleanup function
+ */
+static int
+rpmem_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct rpmem_bench *mb = pmembench_get_priv(bench);
+	int ret = 0;
+
+	if (mb->pargs->stats)
+		print_stats(mb);
+
+	ret |= rpmem_fip_process_stop(mb->fip);
+	ret |= rpmemd_fip_process_stop(mb->dfip);
+	ret |= rpmem_fip_close(mb->fip);
+	ret |= rpmemd_fip_wait_close(mb->dfip, -1);
+	ret |= rpmemd_fip_close(mb->dfip);
+
+	rpmem_fip_fini(mb->fip);
+	rpmemd_fip_fini(mb->dfip);
+
+	free(mb->raddr);
+	free(mb->laddr);
+	rpmemd_log_close();
+	free(mb);
+
+	return ret ? -1 : 0;
+}
+
+/*
+ * rpmem_op -- actual benchmark operation, persist one chunk of data
+ * using lane of the worker
+ */
+static int
+rpmem_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct rpmem_bench *mb = pmembench_get_priv(bench);
+
+	size_t dsize = info->args->dsize;
+	size_t offset = (info->worker->index *
+			info->args->n_ops_per_thread + info->index) * dsize;
+
+	memset((char *)mb->laddr + offset, (int)info->index & 0xff, dsize);
+
+	return rpmem_fip_persist(mb->fip, offset, dsize, info->worker->index);
+}
+
+/* structure to define command line arguments */
+static struct benchmark_clo rpmem_clo[] = {
+	{
+		.opt_short	= 'm',
+		.opt_long	= "method",
+		.descr		= "Persist method - gpspm or apm",
+		.type		= CLO_TYPE_STR,
+		.off		= clo_field_offset(struct rpmem_args, method),
+		.def		= "gpspm",
+	},
+	{
+		.opt_short	= 'p',
+		.opt_long	= "provider",
+		.descr		= "Libfabric provider - sockets or verbs",
+		.type		= CLO_TYPE_STR,
+		.off		= clo_field_offset(struct rpmem_args, provider),
+		.def		= "sockets",
+	},
+	{
+		.opt_short	= 's',
+		.opt_long	= "stats",
+		.descr		= "Print persist latency histograms",
+		.type		= CLO_TYPE_FLAG,
+		.off		= clo_field_offset(struct rpmem_args, stats),
+	},
+};
+
+/* Stores information about benchmark. */
+static struct benchmark_info rpmem_bench = {
+	.name		= "rpmem_persist",
+	.brief		= "Benchmark for remote persist over loopback",
+	.init		= rpmem_init,
+	.exit		= rpmem_exit,
+	.multithread	= true,
+	.multiops	= true,
+	.operation	= rpmem_op,
+	.measure_time	= true,
+	.clos		= rpmem_clo,
+	.nclos		= ARRAY_SIZE(rpmem_clo),
+	.opts_size	= sizeof(struct rpmem_args),
+	.rm_file	= false,
+	.allow_poolset	= false,
+};
+
+REGISTER_BENCHMARK(rpmem_bench);
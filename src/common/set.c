@@ -51,6 +51,7 @@
 #include <stddef.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <linux/limits.h>
 
 #include "libpmem.h"
@@ -75,6 +76,9 @@ enum parser_codes {
 	PARSER_SET_NO_PARTS,
 	PARSER_REP_NO_PARTS,
 	PARSER_SIZE_MISMATCH,
+	PARSER_WRONG_ALIGNMENT,
+	PARSER_ALIGNMENT_MISPLACED,
+	PARSER_PART_NOT_ALIGNED,
 	PARSER_OUT_OF_MEMORY,
 	PARSER_FORMAT_OK,
 	PARSER_MAX_CODE
@@ -92,15 +96,39 @@ static const char *parser_errstr[PARSER_MAX_CODE] = {
 	"no pool set parts",
 	"no replica parts",
 	"sizes of pool set and replica mismatch",
+	"incorrect alignment (must be 4K, 2M or 1G)",
+	"'ALIGNMENT' must precede all the parts and be given once",
+	"incorrect part size for given alignment",
 	"allocating memory failed",
 	"" /* format correct */
 };
 
+/* page sizes the parts of a pool set may be aligned to, largest first */
+static const size_t Huge_pagesizes[] = {
+	(size_t)1 << 30,	/* 1GB */
+	(size_t)2 << 20,	/* 2MB */
+};
+
 struct suff {
 	const char *suff;
 	uint64_t mag;
 };
 
+/*
+ * util_poolset_data_off -- (internal) offset of the usable space in all
+ *                          but the first part of a replica
+ *
+ * By default the usable space follows the part header.  If the pool set
+ * defines an alignment, the usable space starts at the alignment, so the
+ * file offsets of the parts are congruent with their mapping addresses and
+ * the whole replica can be mapped with huge pages.
+ */
+static inline size_t
+util_poolset_data_off(struct pool_set *set)
+{
+	return set->alignment ? set->alignment : POOL_HDR_SIZE;
+}
+
 /*
  * util_map_part -- map a header of a pool set
  */
@@ -412,6 +440,41 @@ parser_read_replica(char *line, char **node_addr, char **pool_desc)
 	return PARSER_CONTINUE;
 }
 
+/*
+ * parser_read_alignment -- (internal) read and validate alignment of part
+ *                          boundaries from a pool set file
+ */
+static enum parser_codes
+parser_read_alignment(char *line, size_t *alignment)
+{
+	char *align_str;
+	char *saveptr;
+	size_t align;
+
+	align_str = strtok_r(line, " \t", &saveptr);
+	if (!align_str || strtok_r(NULL, " \t", &saveptr))
+		return PARSER_WRONG_ALIGNMENT;
+
+	LOG(10, "alignment '%s'", align_str);
+
+	if (util_parse_size(align_str, &align) != 0)
+		return PARSER_WRONG_ALIGNMENT;
+
+	if (align != Pagesize) {
+		unsigned i;
+		for (i = 0; i < ARRAY_SIZE(Huge_pagesizes); i++) {
+			if (align == Huge_pagesizes[i])
+				break;
+		}
+		if (i == ARRAY_SIZE(Huge_pagesizes))
+			return PARSER_WRONG_ALIGNMENT;
+	}
+
+	*alignment = align;
+
+	return PARSER_CONTINUE;
+}
+
 /*
  * util_parse_add_part -- (internal) add a new part file to the replica info
  */
@@ -487,14 +550,16 @@ util_parse_add_replica(struct pool_set **setp)
 static void
 util_poolset_set_size(struct pool_set *set)
 {
+	size_t data_off = util_poolset_data_off(set);
+
 	set->poolsize = SIZE_MAX;
 	for (unsigned r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
-		rep->repsize = sizeof(struct pool_hdr);
+		rep->repsize = data_off;
 		for (unsigned p = 0; p < rep->nparts; p++) {
 			rep->repsize +=
 				(rep->part[p].filesize & ~(Pagesize - 1)) -
-				sizeof(struct pool_hdr);
+				data_off;
 		}
 
 		/*
@@ -681,9 +746,28 @@ util_poolset_parse(const char *path, int fd, struct pool_set **setp)
 				else
 					result = PARSER_REP_NO_PARTS;
 			}
+		} else if (strncmp(line, POOLSET_ALIGNMENT_SIG,
+					POOLSET_ALIGNMENT_SIG_LEN) == 0) {
+			/* 'ALIGNMENT' must come before the first part */
+			if (set->alignment || set->nreplicas > 1 || nparts) {
+				result = PARSER_ALIGNMENT_MISPLACED;
+			} else if (!isblank(line[POOLSET_ALIGNMENT_SIG_LEN])) {
+				result = PARSER_WRONG_ALIGNMENT;
+			} else {
+				result = parser_read_alignment(
+					line + POOLSET_ALIGNMENT_SIG_LEN,
+					&set->alignment);
+				LOG(10, "ALIGNMENT %zu", set->alignment);
+			}
 		} else {
 			/* read size and path */
 			result = parser_read_line(line, &psize, &ppath);
+			if (result == PARSER_CONTINUE && set->alignment &&
+			    (psize % set->alignment ||
+			    (nparts && psize == set->alignment))) {
+				Free(ppath);
+				result = PARSER_PART_NOT_ALIGNED;
+			}
 			if (result == PARSER_CONTINUE) {
 				/* add a new pool's part to the list */
 				int ret = util_parse_add_part(set,
@@ -1063,12 +1147,18 @@ util_header_create(struct pool_set *set, unsigned repidx, unsigned partidx,
 	memset(descp, 0, POOL_HDR_SIZE - sizeof(*hdrp));
 	pmem_msync(descp, POOL_HDR_SIZE - sizeof(*hdrp));
 
+	/* the alignment moves the usable space of the parts */
+	incompat &= ~(uint32_t)POOL_FEAT_ALIGNMENT;
+	if (set->alignment)
+		incompat |= POOL_FEAT_ALIGNMENT;
+
 	/* create pool's header */
 	memcpy(hdrp->signature, sig, POOL_HDR_SIG_LEN);
 	hdrp->major = major;
 	hdrp->compat_features = compat;
 	hdrp->incompat_features = incompat;
 	hdrp->ro_compat_features = ro_compat;
+	hdrp->alignment = set->alignment;
 
 	memcpy(hdrp->poolset_uuid, set->uuid, POOL_HDR_UUID_LEN);
 
@@ -1168,6 +1258,16 @@ util_header_check(struct pool_set *set, unsigned repidx, unsigned partidx,
 		return -1;
 	}
 
+	/* the parts are laid out according to the alignment of the set */
+	size_t alignment = (hdr.incompat_features & POOL_FEAT_ALIGNMENT) ?
+		(size_t)hdr.alignment : 0;
+	if (alignment != set->alignment) {
+		ERR("pool created with alignment %zu, the pool set file "
+			"defines alignment %zu", alignment, set->alignment);
+		errno = EINVAL;
+		return -1;
+	}
+
 	/* check pool set UUID */
 	if (memcmp(HDR(REP(set, 0), 0)->poolset_uuid, hdr.poolset_uuid,
 						POOL_HDR_UUID_LEN)) {
@@ -1204,7 +1304,8 @@ util_header_check(struct pool_set *set, unsigned repidx, unsigned partidx,
 
 	rep->part[partidx].rdonly = 0;
 
-	int retval = util_feature_check(&hdr, incompat, ro_compat, compat);
+	int retval = util_feature_check(&hdr, incompat | POOL_FEAT_ALIGNMENT,
+			ro_compat, compat);
 	if (retval < 0)
 		return -1;
 	else if (retval == 0)
@@ -1313,6 +1414,60 @@ util_header_check_remote(struct pool_replica *rep, unsigned partidx)
 	return 0;
 }
 
+/*
+ * util_replica_check_align -- (internal) make sure the replica is mapped
+ *                             at the address aligned as requested
+ *
+ * The alignment given in the pool set file is a requirement, not a hint,
+ * so the mapping fails if it cannot be met.
+ */
+static int
+util_replica_check_align(struct pool_set *set, struct pool_replica *rep)
+{
+	if (!set->alignment ||
+	    (uintptr_t)rep->part[0].addr % set->alignment == 0)
+		return 0;
+
+	ERR("cannot map the pool at an address aligned to %zu",
+		set->alignment);
+	errno = ENOMEM;
+	return -1;
+}
+
+/*
+ * util_replica_pagesize -- (internal) the largest page size the replica
+ *                          mapping is aligned to
+ *
+ * A huge page may be used to map a range of the pool only if both the
+ * address and the file offset are aligned to it, so all the part
+ * boundaries and the usable space offsets are taken into account.
+ */
+static size_t
+util_replica_pagesize(struct pool_set *set, struct pool_replica *rep)
+{
+	size_t data_off = util_poolset_data_off(set);
+
+	for (unsigned i = 0; i < ARRAY_SIZE(Huge_pagesizes); i++) {
+		size_t pagesize = Huge_pagesizes[i];
+		if (rep->repsize < pagesize)
+			continue;
+
+		if (rep->nparts > 1 && data_off % pagesize)
+			continue;
+
+		unsigned p;
+		for (p = 0; p < rep->nparts; p++) {
+			if ((uintptr_t)rep->part[p].addr % pagesize)
+				break;
+		}
+
+		if (p == rep->nparts)
+			return pagesize;
+	}
+
+	return Pagesize;
+}
+
 /*
  * util_replica_create -- (internal) create a new memory pool replica
  */
@@ -1332,7 +1487,7 @@ util_replica_create(struct pool_set *set, unsigned repidx, int flags,
 	struct pool_replica *rep = set->replica[repidx];
 
 	/* determine a hint address for mmap() */
-	void *addr = util_map_hint(rep->repsize, 0);
+	void *addr = util_map_hint(rep->repsize, set->alignment);
 	if (addr == MAP_FAILED) {
 		ERR("cannot find a contiguous region of given size");
 		return -1;
@@ -1345,6 +1500,9 @@ util_replica_create(struct pool_set *set, unsigned repidx, int flags,
 		return -1;
 	}
 
+	if (util_replica_check_align(set, rep) != 0)
+		goto err;
+
 	VALGRIND_REGISTER_PMEM_MAPPING(rep->part[0].addr, rep->part[0].size);
 	VALGRIND_REGISTER_PMEM_FILE(rep->part[0].fd,
 				rep->part[0].addr, rep->part[0].size, 0);
@@ -1378,18 +1536,20 @@ util_replica_create(struct pool_set *set, unsigned repidx, int flags,
 	addr = (char *)rep->part[0].addr + mapsize;
 
 	/*
-	 * map the remaining parts of the usable pool space (4K-aligned)
+	 * map the remaining parts of the usable pool space (4K-aligned or
+	 * aligned as requested by the pool set)
 	 */
+	size_t data_off = util_poolset_data_off(set);
 	for (unsigned p = 1; p < rep->nparts; p++) {
 		/* map data part */
-		if (util_map_part(&rep->part[p], addr, 0, POOL_HDR_SIZE,
+		if (util_map_part(&rep->part[p], addr, 0, data_off,
 				flags | MAP_FIXED) != 0) {
 			LOG(2, "usable space mapping failed - part #%d", p);
 			goto err;
 		}
 
 		VALGRIND_REGISTER_PMEM_FILE(rep->part[p].fd,
-			rep->part[p].addr, rep->part[p].size, POOL_HDR_SIZE);
+			rep->part[p].addr, rep->part[p].size, data_off);
 
 		mapsize += rep->part[p].size;
 		set->zeroed &= rep->part[p].created;
@@ -1397,10 +1557,12 @@ util_replica_create(struct pool_set *set, unsigned repidx, int flags,
 	}
 
 	rep->is_pmem = pmem_is_pmem(rep->part[0].addr, rep->part[0].size);
+	rep->pagesize = util_replica_pagesize(set, rep);
 
 	ASSERTeq(mapsize, rep->repsize);
 
-	LOG(3, "replica addr %p", rep->part[0].addr);
+	LOG(3, "replica addr %p page size %zu", rep->part[0].addr,
+		rep->pagesize);
 
 	return 0;
 
@@ -1475,7 +1637,7 @@ util_uuid_to_string(uuid_t u, char *buf)
  * f81d4fae-7dec-11d0-a765-00a0c91e6bf6
  */
 int
-util_uuid_from_string(const char *uuid, struct uuid *ud)
+util_uuid_from_string(const char uuid[POOL_HDR_UUID_STR_LEN], struct uuid *ud)
 {
 	if (strlen(uuid) != 36) {
 		LOG(2, "invalid uuid string");
@@ -1504,6 +1666,193 @@ util_uuid_from_string(const char *uuid, struct uuid *ud)
 	return 0;
 }
 
+/* size of a range prefaulted at a time by a single thread */
+#define PREFAULT_CHUNK ((size_t)32 << 20)
+
+/* progress callback for prefaulting the pools */
+static util_prefault_cb Prefault_cb;
+static void *Prefault_arg;
+
+/*
+ * struct prefault_ctx -- state shared by the threads prefaulting a pool set
+ */
+struct prefault_ctx {
+	struct pool_set *set;
+	int write;		/* fault the pages in for writing */
+	size_t nchunks;		/* number of chunks in all the replicas */
+	size_t next;		/* next chunk to be prefaulted */
+	size_t done;		/* number of bytes prefaulted */
+};
+
+/*
+ * util_set_prefault -- set the number of threads prefaulting the pools
+ *                      at open and the progress callback
+ *
+ * Zero threads disables prefaulting.  The callback is called by the thread
+ * opening the pool, with the number of bytes prefaulted so far and the
+ * total number of bytes of all the local replicas.
+ */
+void
+util_set_prefault(unsigned nthreads, util_prefault_cb cb, void *arg)
+{
+	LOG(3, "nthreads %u cb %p arg %p", nthreads, cb, arg);
+
+	Prefault_nthreads = nthreads;
+	Prefault_cb = cb;
+	Prefault_arg = arg;
+}
+
+/*
+ * util_prefault_range -- (internal) populate the page tables of the range
+ */
+static void
+util_prefault_range(char *addr, size_t len, int write)
+{
+#ifdef MADV_POPULATE_WRITE
+	if (madvise(addr, len, write ?
+			MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0)
+		return;
+#endif
+	/*
+	 * Fall back to touching every page.  It faults the pages in for
+	 * reading only, as writing would dirty them.
+	 */
+	volatile char *p = addr;
+	for (size_t off = 0; off < len; off += Pagesize)
+		(void) p[off];
+}
+
+/*
+ * util_prefault_chunk -- (internal) prefault the next chunk of the pool set
+ *
+ * Returns the number of bytes prefaulted or 0 if there is nothing left.
+ */
+static size_t
+util_prefault_chunk(struct prefault_ctx *ctx)
+{
+	size_t chunk = __sync_fetch_and_add(&ctx->next, 1);
+	if (chunk >= ctx->nchunks)
+		return 0;
+
+	struct pool_set *set = ctx->set;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		if (rep->remote)
+			continue;
+
+		size_t nchunks = (rep->repsize + PREFAULT_CHUNK - 1) /
+			PREFAULT_CHUNK;
+		if (chunk >= nchunks) {
+			chunk -= nchunks;
+			continue;
+		}
+
+		size_t off = chunk * PREFAULT_CHUNK;
+		size_t len = rep->repsize - off;
+		if (len > PREFAULT_CHUNK)
+			len = PREFAULT_CHUNK;
+		util_prefault_range((char *)rep->part[0].addr + off, len,
+			ctx->write);
+		__sync_fetch_and_add(&ctx->done, len);
+
+		return len;
+	}
+
+	ASSERT(0);
+	return 0;
+}
+
+/*
+ * util_prefault_worker -- (internal) prefaulting thread
+ */
+static void *
+util_prefault_worker(void *arg)
+{
+	struct prefault_ctx *ctx = arg;
+
+	while (util_prefault_chunk(ctx))
+		;
+
+	return NULL;
+}
+
+/*
+ * util_poolset_prefault -- (internal) fault in all the pages of the local
+ *                          replicas, so the first accesses to the pool
+ *                          do not take page faults
+ *
+ * The calling thread takes part in prefaulting and reports the progress.
+ * Prefaulting is only an optimization, so failing to start the threads
+ * is not an error.
+ */
+static void
+util_poolset_prefault(struct pool_set *set, int write)
+{
+	if (!Prefault_nthreads)
+		return;
+
+	LOG(3, "set %p write %d nthreads %u", set, write, Prefault_nthreads);
+
+	struct prefault_ctx ctx = {
+		.set = set,
+		.write = write,
+		.nchunks = 0,
+		.next = 0,
+		.done = 0,
+	};
+
+	size_t total = 0;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		if (rep->remote)
+			continue;
+
+		total += rep->repsize;
+		ctx.nchunks += (rep->repsize + PREFAULT_CHUNK - 1) /
+			PREFAULT_CHUNK;
+	}
+
+	unsigned nthreads = Prefault_nthreads - 1;
+	if (nthreads > ctx.nchunks)
+		nthreads = (unsigned)ctx.nchunks;
+
+	pthread_t *threads = NULL;
+	if (nthreads) {
+		threads = Malloc(nthreads * sizeof(*threads));
+		if (threads == NULL) {
+			LOG(2, "!Malloc");
+			nthreads = 0;
+		}
+	}
+
+	unsigned started;
+	for (started = 0; started < nthreads; started++) {
+		errno = pthread_create(&threads[started], NULL,
+				util_prefault_worker, &ctx);
+		if (errno) {
+			LOG(2, "!pthread_create");
+			break;
+		}
+	}
+
+	while (util_prefault_chunk(&ctx)) {
+		if (Prefault_cb)
+			Prefault_cb(ctx.done, total, Prefault_arg);
+	}
+
+	for (unsigned i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	if (threads)
+		Free(threads);
+
+	ASSERTeq(ctx.done, total);
+	if (Prefault_cb)
+		Prefault_cb(total, total, Prefault_arg);
+
+	LOG(4, "prefaulted %zu bytes using %u threads", total, started + 1);
+}
+
 /*
  * util_pool_create_uuids -- create a new memory pool (set or a single file)
  *                           with given uuids
@@ -1594,6 +1943,8 @@ util_pool_create_uuids(struct pool_set **setp, const char *path,
 		}
 	}
 
+	util_poolset_prefault(set, 1);
+
 	return 0;
 
 err:
@@ -1639,7 +1990,7 @@ util_replica_open(struct pool_set *set, unsigned repidx, int flags)
 	struct pool_replica *rep = set->replica[repidx];
 
 	/* determine a hint address for mmap() */
-	void *addr = util_map_hint(rep->repsize, 0);
+	void *addr = util_map_hint(rep->repsize, set->alignment);
 	if (addr == MAP_FAILED) {
 		ERR("cannot find a contiguous region of given size");
 		return -1;
@@ -1651,6 +2002,9 @@ util_replica_open(struct pool_set *set, unsigned repidx, int flags)
 		return -1;
 	}
 
+	if (util_replica_check_align(set, rep) != 0)
+		goto err;
+
 	VALGRIND_REGISTER_PMEM_MAPPING(rep->part[0].addr, rep->part[0].size);
 	VALGRIND_REGISTER_PMEM_FILE(rep->part[0].fd,
 				rep->part[0].addr, rep->part[0].size, 0);
@@ -1668,24 +2022,26 @@ util_replica_open(struct pool_set *set, unsigned repidx, int flags)
 
 	/*
 	 * map the remaining parts of the usable pool space
-	 * (4K-aligned)
+	 * (4K-aligned or aligned as requested by the pool set)
 	 */
+	size_t data_off = util_poolset_data_off(set);
 	for (unsigned p = 1; p < rep->nparts; p++) {
 		/* map data part */
-		if (util_map_part(&rep->part[p], addr, 0, POOL_HDR_SIZE,
+		if (util_map_part(&rep->part[p], addr, 0, data_off,
 				flags | MAP_FIXED) != 0) {
 			LOG(2, "usable space mapping failed - part #%d", p);
 			goto err;
 		}
 
 		VALGRIND_REGISTER_PMEM_FILE(rep->part[p].fd,
-			rep->part[p].addr, rep->part[p].size, POOL_HDR_SIZE);
+			rep->part[p].addr, rep->part[p].size, data_off);
 
 		mapsize += rep->part[p].size;
 		addr = (char *)addr + rep->part[p].size;
 	}
 
 	rep->is_pmem = pmem_is_pmem(rep->part[0].addr, rep->part[0].size);
+	rep->pagesize = util_replica_pagesize(set, rep);
 
 	ASSERTeq(mapsize, rep->repsize);
 
@@ -1693,7 +2049,8 @@ util_replica_open(struct pool_set *set, unsigned repidx, int flags)
 	if (rep->repsize < set->poolsize)
 		set->poolsize = rep->repsize;
 
-	LOG(3, "replica addr %p", rep->part[0].addr);
+	LOG(3, "replica addr %p page size %zu", rep->part[0].addr,
+		rep->pagesize);
 
 	return 0;
 err:
@@ -1744,6 +2101,8 @@ util_pool_open_nocheck(struct pool_set **setp, const char *path, int rdonly)
 			util_unmap_hdr(&rep->part[p]);
 	}
 
+	util_poolset_prefault(set, !rdonly);
+
 	return 0;
 
 err:
@@ -1824,6 +2183,8 @@ util_pool_open(struct pool_set **setp, const char *path, int rdonly,
 			util_unmap_hdr(&rep->part[p]);
 	}
 
+	util_poolset_prefault(set, !rdonly);
+
 	return 0;
 
 err:
@@ -48,6 +48,7 @@
 #include <endian.h>
 #include <errno.h>
 #include <stddef.h>
+#include <limits.h>
 
 #include "util.h"
 #include "out.h"
@@ -59,6 +60,9 @@ unsigned long long Pagesize;
 int Mmap_no_random;
 void *Mmap_hint;
 
+/* number of threads prefaulting a pool at open, 0 if disabled */
+unsigned Prefault_nthreads;
+
 /*
  * our versions of malloc & friends start off pointing to the libc versions
  */
@@ -116,6 +120,24 @@ util_init(void)
 		}
 	}
 
+	/*
+	 * Allow prefaulting the pools at open without changing the
+	 * application, see util_set_prefault().
+	 */
+	e = getenv("PMEM_PREFAULT");
+	if (e) {
+		char *endp;
+		errno = 0;
+		unsigned long val = strtoul(e, &endp, 10);
+
+		if (errno || endp == e || val > UINT_MAX) {
+			LOG(2, "Invalid PMEM_PREFAULT");
+		} else {
+			Prefault_nthreads = (unsigned)val;
+			LOG(3, "PMEM_PREFAULT set to %u", Prefault_nthreads);
+		}
+	}
+
 #if defined(USE_VG_PMEMCHECK) || defined(USE_VG_HELGRIND) ||\
 	defined(USE_VG_MEMCHECK)
 	_On_valgrind = RUNNING_ON_VALGRIND;
@@ -234,6 +256,148 @@ err:
 	return NULL;
 }
 
+/*
+ * Fletcher64 checksum is computed over 32-bit words, keeping two running
+ * sums: lo32 (sum of the words) and hi32 (sum of the successive values of
+ * lo32).  Both are taken modulo 2^32, so the words may be summed in any
+ * order as long as every word is weighted in hi32 by the number of the
+ * words from it to the end of the range.  It lets the vector versions
+ * below keep the sums for each lane separately and combine them at the
+ * end, producing the same result as the sequential version.
+ */
+
+/*
+ * fletcher64_seq -- (internal) update Fletcher64 sums, one word at a time
+ */
+static void
+fletcher64_seq(const uint32_t *p32, size_t nwords, uint32_t *lo32p,
+	uint32_t *hi32p)
+{
+	uint32_t lo32 = *lo32p;
+	uint32_t hi32 = *hi32p;
+
+	for (size_t i = 0; i < nwords; i++) {
+		lo32 += le32toh(p32[i]);
+		hi32 += lo32;
+	}
+
+	*lo32p = lo32;
+	*hi32p = hi32;
+}
+
+/*
+ * fletcher64_combine -- (internal) fold per-lane sums of nblocks blocks of
+ *                       nlanes words into Fletcher64 sums
+ *
+ * a[j] is the sum of the words of lane j and b[j] the sum of the successive
+ * values of a[j], so a word of block k is counted (nblocks - k) times
+ * in b[j], while it should be weighted by nlanes * (nblocks - k) - j.
+ */
+static void
+fletcher64_combine(const uint32_t *a, const uint32_t *b, unsigned nlanes,
+	size_t nblocks, uint32_t *lo32p, uint32_t *hi32p)
+{
+	uint32_t lo32 = *lo32p;
+	uint32_t hi32 = *hi32p + (uint32_t)(nblocks * nlanes) * lo32;
+
+	for (unsigned j = 0; j < nlanes; j++) {
+		lo32 += a[j];
+		hi32 += nlanes * b[j] - j * a[j];
+	}
+
+	*lo32p = lo32;
+	*hi32p = hi32;
+}
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include <immintrin.h>
+
+/*
+ * fletcher64_sse2 -- (internal) update Fletcher64 sums, 4 words at a time
+ */
+static void
+fletcher64_sse2(const uint32_t *p32, size_t nwords, uint32_t *lo32p,
+	uint32_t *hi32p)
+{
+	size_t nblocks = nwords / 4;
+	__m128i a = _mm_setzero_si128();
+	__m128i b = _mm_setzero_si128();
+
+	for (size_t k = 0; k < nblocks; k++) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(p32 + 4 * k));
+		a = _mm_add_epi32(a, w);
+		b = _mm_add_epi32(b, a);
+	}
+
+	uint32_t av[4];
+	uint32_t bv[4];
+	_mm_storeu_si128((__m128i *)av, a);
+	_mm_storeu_si128((__m128i *)bv, b);
+
+	fletcher64_combine(av, bv, 4, nblocks, lo32p, hi32p);
+	fletcher64_seq(p32 + 4 * nblocks, nwords % 4, lo32p, hi32p);
+}
+
+/*
+ * fletcher64_avx2 -- (internal) update Fletcher64 sums, 8 words at a time
+ */
+__attribute__((target("avx2")))
+static void
+fletcher64_avx2(const uint32_t *p32, size_t nwords, uint32_t *lo32p,
+	uint32_t *hi32p)
+{
+	size_t nblocks = nwords / 8;
+	__m256i a = _mm256_setzero_si256();
+	__m256i b = _mm256_setzero_si256();
+
+	for (size_t k = 0; k < nblocks; k++) {
+		__m256i w = _mm256_loadu_si256((const __m256i *)(p32 + 8 * k));
+		a = _mm256_add_epi32(a, w);
+		b = _mm256_add_epi32(b, a);
+	}
+
+	uint32_t av[8];
+	uint32_t bv[8];
+	_mm256_storeu_si256((__m256i *)av, a);
+	_mm256_storeu_si256((__m256i *)bv, b);
+
+	fletcher64_combine(av, bv, 8, nblocks, lo32p, hi32p);
+	fletcher64_seq(p32 + 8 * nblocks, nwords % 8, lo32p, hi32p);
+}
+
+#endif
+
+/*
+ * fletcher64_select -- (internal) choose the fastest Fletcher64 version
+ *                      supported by the CPU
+ */
+static void
+fletcher64_select(const uint32_t *p32, size_t nwords, uint32_t *lo32p,
+	uint32_t *hi32p);
+
+static void (*Fletcher64)(const uint32_t *p32, size_t nwords,
+	uint32_t *lo32p, uint32_t *hi32p) = fletcher64_select;
+
+static void
+fletcher64_select(const uint32_t *p32, size_t nwords, uint32_t *lo32p,
+	uint32_t *hi32p)
+{
+	void (*func)(const uint32_t *, size_t, uint32_t *, uint32_t *) =
+		fletcher64_seq;
+
+#if defined(__x86_64__) || defined(__amd64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		func = fletcher64_avx2;
+	else
+		func = fletcher64_sse2;
+#endif
+
+	Fletcher64 = func;
+	func(p32, nwords, lo32p, hi32p);
+}
+
 /*
  * util_checksum -- compute Fletcher64 checksum
  *
@@ -249,25 +413,28 @@ int
 util_checksum(void *addr, size_t len, uint64_t *csump, int insert)
 {
 	ASSERTeq(len % 4, 0);
-	uint32_t *p32 = addr;
-	uint32_t *p32end = (uint32_t *)((char *)addr + len);
+	const uint32_t *p32 = addr;
+	size_t nwords = len / 4;
 	uint32_t lo32 = 0;
 	uint32_t hi32 = 0;
 	uint64_t csum;
 
-	while (p32 < p32end)
-		if (p32 == (uint32_t *)csump) {
-			/* lo32 += 0; treat first 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-			/* lo32 += 0; treat second 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-		} else {
-			lo32 += le32toh(*p32);
-			++p32;
-			hi32 += lo32;
-		}
+	/* the checksum counts only if it is within the range, word aligned */
+	uintptr_t csum_off = (uintptr_t)csump - (uintptr_t)addr;
+	if (csum_off < len && csum_off % 4 == 0) {
+		size_t csum_word = csum_off / 4;
+
+		Fletcher64(p32, csum_word, &lo32, &hi32);
+
+		/* treat both 32-bit halves of the checksum as zeros */
+		hi32 += 2 * lo32;
+
+		if (csum_word + 2 < nwords)
+			Fletcher64(p32 + csum_word + 2,
+				nwords - csum_word - 2, &lo32, &hi32);
+	} else {
+		Fletcher64(p32, nwords, &lo32, &hi32);
+	}
 
 	csum = (uint64_t)hi32 << 32 | lo32;
 
@@ -293,6 +460,7 @@ util_convert2le_hdr(struct pool_hdr *hdrp)
 		htole64(hdrp->arch_flags.alignment_desc);
 	hdrp->arch_flags.e_machine = htole16(hdrp->arch_flags.e_machine);
 	hdrp->crtime = htole64(hdrp->crtime);
+	hdrp->alignment = htole64(hdrp->alignment);
 	hdrp->checksum = htole64(hdrp->checksum);
 }
 
@@ -307,6 +475,7 @@ util_convert2h_hdr_nocheck(struct pool_hdr *hdrp)
 	hdrp->incompat_features = le32toh(hdrp->incompat_features);
 	hdrp->ro_compat_features = le32toh(hdrp->ro_compat_features);
 	hdrp->crtime = le64toh(hdrp->crtime);
+	hdrp->alignment = le64toh(hdrp->alignment);
 	hdrp->arch_flags.e_machine =
 		le16toh(hdrp->arch_flags.e_machine);
 	hdrp->arch_flags.alignment_desc =
@@ -38,6 +38,7 @@ extern unsigned long long Pagesize;
 
 extern int Mmap_no_random;
 extern void *Mmap_hint;
+extern unsigned Prefault_nthreads;
 
 /*
  * overridable names for malloc & friends used by this library
@@ -128,6 +129,12 @@ struct arch_flags {
 
 typedef unsigned char uuid_t[POOL_HDR_UUID_LEN]; /* 16 byte binary uuid value */
 
+/*
+ * incompat features common to all pool types, the bits are allocated from
+ * the top so they don't collide with the features of the pool types
+ */
+#define POOL_FEAT_ALIGNMENT 0x80000000	/* parts aligned, see alignment */
+
 struct pool_hdr {
 	char signature[POOL_HDR_SIG_LEN];
 	uint32_t major;			/* format major version number */
@@ -142,7 +149,8 @@ struct pool_hdr {
 	uuid_t next_repl_uuid; /* next replica */
 	uint64_t crtime;		/* when created (seconds since epoch) */
 	struct arch_flags arch_flags;	/* architecture identification flags */
-	unsigned char unused[3944];	/* must be zero */
+	uint64_t alignment;		/* alignment of the parts of the set */
+	unsigned char unused[3936];	/* must be zero */
 	uint64_t checksum;		/* checksum of above fields */
 };
 
@@ -183,6 +191,9 @@ int util_is_absolute_path(const char *path);
 #define POOLSET_REPLICA_SIG "REPLICA"
 #define POOLSET_REPLICA_SIG_LEN 7	/* does NOT include '\0' */
 
+#define POOLSET_ALIGNMENT_SIG "ALIGNMENT"
+#define POOLSET_ALIGNMENT_SIG_LEN 9	/* does NOT include '\0' */
+
 struct pool_set_part {
 	/* populated by a pool set file parser */
 	const char *path;
@@ -208,6 +219,7 @@ struct pool_replica {
 	unsigned nparts;
 	size_t repsize;		/* total size of all the parts (mappings) */
 	int is_pmem;		/* true if all the parts are in PMEM */
+	size_t pagesize;	/* largest page size of aligned mapping */
 	struct remote_replica *remote;	/* not NULL if the replica */
 					/* is a remote one */
 	struct pool_set_part part[];
@@ -220,6 +232,7 @@ struct pool_set {
 	int zeroed;		/* true if all the parts are new files */
 	size_t poolsize;	/* the smallest replica size */
 	int remote;		/* true if contains a remote replica */
+	size_t alignment;	/* alignment of part boundaries, 0 if default */
 	struct pool_replica *replica[];
 };
 
@@ -287,6 +300,13 @@ int util_pool_create_uuids(struct pool_set **setp, const char *path,
 	const unsigned char *next_repl_uuid,
 	const unsigned char *arch_flags);
 
+/*
+ * callback reporting progress of prefaulting a pool, see util_set_prefault()
+ */
+typedef void (*util_prefault_cb)(size_t done, size_t total, void *arg);
+
+void util_set_prefault(unsigned nthreads, util_prefault_cb cb, void *arg);
+
 int util_map_hdr(struct pool_set_part *part, int flags);
 int util_unmap_hdr(struct pool_set_part *part);
 
@@ -164,15 +164,16 @@ util_map_hint(size_t len, size_t req_align)
 	/*
 	 * Choose the desired alignment based on the requested length.
 	 * Use 2MB/1GB page alignment only if the mapping length is at least
-	 * twice as big as the page size.
+	 * twice as big as the page size.  The requested alignment is the
+	 * minimum, it never makes a large mapping less aligned.
 	 */
 	size_t align = Pagesize;
-	if (req_align)
-		align = req_align;
-	else if (len >= 2 * GIGABYTE)
+	if (len >= 2 * GIGABYTE)
 		align = GIGABYTE;
 	else if (len >= 4 * MEGABYTE)
 		align = 2 * MEGABYTE;
+	if (req_align > align)
+		align = req_align;
 
 	if (Mmap_no_random) {
 		LOG(4, "user-defined hint %p", (void *)Mmap_hint);
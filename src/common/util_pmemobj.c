@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * util_pmemobj.c -- examining the heap layout of the pmemobj pool
+ *
+ * Shared by the tools and libraries which have to tell the regions of the
+ * pool holding data from the ones which don't without opening the pool.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "libpmem.h"
+#include "libpmemobj.h"
+#include "out.h"
+#include "util.h"
+#include "lane.h"
+#include "obj.h"
+#include "redo.h"
+#include "memops.h"
+#include "pmalloc.h"
+#include "list.h"
+#include "heap_layout.h"
+#include "util_pmemobj.h"
+
+/*
+ * util_pmemobj_recovered -- (internal) check if there are no redo logs
+ *	pending recovery
+ *
+ * Recovery of the allocator and list redo logs may turn a free chunk into a
+ * used one, so the chunk headers of such a pool cannot be trusted.
+ */
+static int
+util_pmemobj_recovered(struct pmemobjpool *pop)
+{
+	if (pop->lanes_offset > pop->heap_offset || pop->nlanes >
+			(pop->heap_offset - pop->lanes_offset) /
+			sizeof(struct lane_layout))
+		return 0;
+
+	struct lane_layout *lanes = (struct lane_layout *)
+		((char *)pop + pop->lanes_offset);
+	for (uint64_t i = 0; i < pop->nlanes; ++i) {
+		struct lane_alloc_layout *alloc = (struct lane_alloc_layout *)
+			&lanes[i].sections[LANE_SECTION_ALLOCATOR];
+		struct lane_list_layout *list = (struct lane_list_layout *)
+			&lanes[i].sections[LANE_SECTION_LIST];
+
+		for (size_t j = 0; j < ALLOC_REDO_LOG_SIZE; ++j) {
+			if (alloc->redo[j].offset & REDO_FINISH_FLAG)
+				return 0;
+		}
+
+		for (size_t j = 0; j < REDO_NUM_ENTRIES; ++j) {
+			if (list->redo[j].offset & REDO_FINISH_FLAG)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * util_pmemobj_unused -- report free chunks and chunks of zones not
+ *	initialized yet of the mapped pmemobj pool
+ *
+ * Zone and chunk headers are never reported. The heap is trusted only if it
+ * passes basic validation and no redo log is pending recovery; otherwise, or
+ * if the callback fails, -1 is returned and the ranges already reported must
+ * be discarded by the caller.
+ */
+int
+util_pmemobj_unused(void *addr, uint64_t size, util_range_cb cb, void *arg)
+{
+	struct pmemobjpool *pop = addr;
+	if (size < sizeof(*pop))
+		return -1;
+
+	if (!util_checksum(&pop->hdr, sizeof(pop->hdr), &pop->hdr.checksum, 0))
+		return -1;
+
+	if (pop->heap_offset > size ||
+			pop->heap_size > size - pop->heap_offset ||
+			pop->heap_size < HEAP_MIN_SIZE)
+		return -1;
+
+	if (!util_pmemobj_recovered(pop))
+		return -1;
+
+	struct heap_header *hdr = (struct heap_header *)
+		((char *)pop + pop->heap_offset);
+	if (memcmp(hdr->signature, HEAP_SIGNATURE, HEAP_SIGNATURE_LEN) != 0 ||
+			!util_checksum(hdr, sizeof(*hdr), &hdr->checksum, 0))
+		return -1;
+
+	uint64_t heap_end = pop->heap_offset + pop->heap_size;
+	uint64_t zone_off = pop->heap_offset +
+		offsetof(struct heap_layout, zone0);
+	for (; zone_off < heap_end && heap_end - zone_off >= ZONE_MIN_SIZE;
+			zone_off += ZONE_MAX_SIZE) {
+		struct zone *zone = (struct zone *)((char *)pop + zone_off);
+		uint64_t chunks_off = zone_off + offsetof(struct zone, chunks);
+
+		/* zone is initialized on its first use */
+		if (zone->header.magic != ZONE_HEADER_MAGIC) {
+			if (cb(chunks_off, MIN(heap_end - chunks_off,
+					MAX_CHUNK * CHUNKSIZE), arg))
+				return -1;
+			continue;
+		}
+
+		uint32_t nchunks = zone->header.size_idx;
+		if (nchunks == 0 || nchunks > MAX_CHUNK ||
+				nchunks > (heap_end - chunks_off) / CHUNKSIZE)
+			return -1;
+
+		uint32_t i = 0;
+		while (i < nchunks) {
+			struct chunk_header *chdr = &zone->chunk_headers[i];
+			if (chdr->size_idx == 0 ||
+					chdr->size_idx > nchunks - i)
+				return -1;
+
+			switch (chdr->type) {
+			case CHUNK_TYPE_FREE:
+				if (cb(chunks_off + i * CHUNKSIZE,
+						chdr->size_idx * CHUNKSIZE,
+						arg))
+					return -1;
+				break;
+			case CHUNK_TYPE_USED:
+			case CHUNK_TYPE_RUN:
+				break;
+			default:
+				return -1;
+			}
+
+			i += chdr->size_idx;
+		}
+	}
+
+	return 0;
+}
@@ -75,17 +75,36 @@ const char *pmemlog_check_version(
 
 PMEMlogpool *pmemlog_open(const char *path);
 PMEMlogpool *pmemlog_create(const char *path, size_t poolsize, mode_t mode);
+PMEMlogpool *pmemlog_create_circular(const char *path, size_t poolsize,
+	mode_t mode);
 void pmemlog_close(PMEMlogpool *plp);
 int pmemlog_check(const char *path);
 size_t pmemlog_nbyte(PMEMlogpool *plp);
 int pmemlog_append(PMEMlogpool *plp, const void *buf, size_t count);
 int pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt);
 long long pmemlog_tell(PMEMlogpool *plp);
+long long pmemlog_head(PMEMlogpool *plp);
+int pmemlog_trim(PMEMlogpool *plp, long long upto);
 void pmemlog_rewind(PMEMlogpool *plp);
 void pmemlog_walk(PMEMlogpool *plp, size_t chunksize,
 	int (*process_chunk)(const void *buf, size_t len, void *arg),
 	void *arg);
 
+/*
+ * support for lock-free readers following the tail of the log...
+ */
+int pmemlog_read(PMEMlogpool *plp, long long *offp,
+	int (*process_chunk)(const void *buf, size_t len, void *arg),
+	void *arg);
+int pmemlog_wait(PMEMlogpool *plp, long long off, int timeout);
+
+/*
+ * support for logs made of length-prefixed, checksummed records...
+ */
+int pmemlog_append_record(PMEMlogpool *plp, const void *buf, size_t count);
+int pmemlog_record_next(PMEMlogpool *plp, long long *offp,
+	const void **bufp, size_t *lenp);
+
 /*
  * Passing NULL to pmemlog_set_funcs() tells libpmemlog to continue to use the
  * default for that function.  The replacement functions must not make calls
@@ -103,6 +103,14 @@ void pmemobj_set_funcs(
 		void *(*realloc_func)(void *ptr, size_t size),
 		char *(*strdup_func)(const char *s));
 
+/*
+ * Passing 0 threads to pmemobj_set_prefault() disables prefaulting of pools
+ * at open.  The progress callback may be NULL.
+ */
+void pmemobj_set_prefault(unsigned nthreads,
+		void (*progress)(size_t done, size_t total, void *arg),
+		void *arg);
+
 const char *pmemobj_errormsg(void);
 
 /*
@@ -133,6 +133,16 @@ typedef struct pmempool_check PMEMpoolcheck;
 PMEMpoolcheck *
 pmempool_check_init(struct pmempool_check_args *args, size_t args_size);
 
+/*
+ * set number of threads used by the check, 0 means one per online CPU
+ */
+int pmempool_check_set_threads(PMEMpoolcheck *ppc, unsigned nthreads);
+
+/*
+ * set path of the file preserving progress of the interrupted check
+ */
+int pmempool_check_set_checkpoint(PMEMpoolcheck *ppc, const char *path);
+
 /*
  * start / resume the check
  */
@@ -143,6 +153,39 @@ struct pmempool_check_status *pmempool_check(PMEMpoolcheck *ppc);
  */
 enum pmempool_check_result pmempool_check_end(PMEMpoolcheck *ppc);
 
+/*
+ * pmempool_copy flags
+ */
+
+/*
+ * skip regions of the pool not holding any data
+ */
+#define PMEMPOOL_COPY_SPARSE		(1 << 0)
+
+/*
+ * copy the pool to a new file using given number of threads
+ */
+int pmempool_copy(const char *src_path, const char *dst_path,
+	unsigned nthreads, unsigned flags);
+
+/*
+ * conversion statistics
+ */
+struct pmempool_convert_stats {
+	unsigned from_major;	/* layout version before the conversion */
+	unsigned to_major;	/* layout version after the conversion */
+	unsigned nsteps;	/* number of conversion steps performed */
+	unsigned nrolled_back;	/* steps of interrupted conversion undone */
+	uint64_t bytes;		/* bytes of the pool rewritten */
+	uint64_t journal_bytes;	/* bytes written to the journal */
+	uint64_t nsecs;		/* duration of the conversion */
+};
+
+/*
+ * convert the pool to the latest layout version
+ */
+int pmempool_convert(const char *path, struct pmempool_convert_stats *stats);
+
 /*
  * PMEMPOOL_MAJOR_VERSION and PMEMPOOL_MINOR_VERSION provide the current version
  * of the libpmempool API as provided by this header file.  Applications can
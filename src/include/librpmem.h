@@ -80,8 +80,23 @@ int rpmem_close(RPMEMpool *rpp);
 
 int rpmem_persist(RPMEMpool *rpp, size_t offset, size_t length,
 		unsigned lane);
+int rpmem_persist_async(RPMEMpool *rpp, size_t offset, size_t length,
+		unsigned lane, uint64_t *token);
+int rpmem_poll(RPMEMpool *rpp, unsigned lane, uint64_t token);
+int rpmem_wait(RPMEMpool *rpp, unsigned lane, uint64_t token);
+int rpmem_batch_begin(RPMEMpool *rpp, unsigned lane);
+int rpmem_batch_end(RPMEMpool *rpp, unsigned lane);
 int rpmem_read(RPMEMpool *rpp, void *buff, size_t offset, size_t length);
 
+struct rpmem_iov {
+	void *buff;	/* output buffer */
+	size_t offset;	/* offset in pool */
+	size_t length;	/* length of read operation */
+};
+
+int rpmem_readv(RPMEMpool *rpp, const struct rpmem_iov *iov,
+		unsigned iovcnt);
+
 /*
  * RPMEM_MAJOR_VERSION and RPMEM_MINOR_VERSION provide the current version of
  * the librpmem API as provided by this header file.  Applications can verify
@@ -46,6 +46,7 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
+#include <stdint.h>
 
 typedef struct vmem VMEM;	/* opaque type internal to libvmem */
 
@@ -61,6 +62,67 @@ void vmem_delete(VMEM *vmp);
 int vmem_check(VMEM *vmp);
 void vmem_stats_print(VMEM *vmp, const char *opts);
 
+/*
+ * allocator tuning of a memory pool, see vmem_create_with_attr()
+ *
+ * Use vmem_attr_init() to fill in the defaults before changing any field.
+ */
+struct vmem_attr {
+	unsigned narenas;	/* number of arenas, 0 means the default */
+	int tcache;		/* use per-thread caches */
+	size_t tcache_max;	/* largest size cached, 0 means the default */
+	ssize_t lg_dirty_mult;	/* purge threshold, -1 disables purging */
+	int numa;		/* assign threads to arenas per NUMA node */
+};
+
+void vmem_attr_init(struct vmem_attr *attr);
+VMEM *vmem_create_with_attr(const char *dir, size_t size,
+		const struct vmem_attr *attr);
+VMEM *vmem_create_in_region_with_attr(void *addr, size_t size,
+		const struct vmem_attr *attr);
+int vmem_ctl(VMEM *vmp, const char *name, void *oldp, size_t *oldlenp,
+		void *newp, size_t newlen);
+
+/*
+ * allocator statistics of a memory pool, see vmem_stats_get()
+ *
+ * The values are a snapshot taken by the last vmem_stats_refresh().
+ */
+struct vmem_stats {
+	size_t allocated;	/* bytes allocated by the application */
+	size_t active;		/* bytes in pages backing allocations */
+	size_t mapped;		/* bytes in chunks mapped by the allocator */
+	size_t resident;	/* active plus dirty, not yet purged, bytes */
+	unsigned narenas;	/* number of arenas */
+	unsigned nclasses;	/* number of small size classes */
+	uint64_t ncontended;	/* lock contention in all arenas */
+};
+
+struct vmem_stats_class {
+	size_t size;		/* size of the objects in the class */
+	size_t allocated;	/* bytes currently allocated */
+	uint64_t nmalloc;	/* allocations served by the arenas */
+	uint64_t ndalloc;	/* deallocations returned to the arenas */
+	uint64_t nrequests;	/* requests, including thread cache hits */
+	uint64_t ncontended;	/* contention on the class locks */
+};
+
+struct vmem_stats_arena {
+	unsigned nthreads;	/* threads assigned to the arena */
+	size_t active;		/* bytes in active pages */
+	size_t dirty;		/* bytes in dirty unused pages */
+	size_t mapped;		/* bytes in chunks mapped by the arena */
+	uint64_t npurge;	/* dirty page purge sweeps */
+	uint64_t ncontended;	/* contention on the arena lock */
+};
+
+int vmem_stats_refresh(VMEM *vmp);
+int vmem_stats_get(VMEM *vmp, struct vmem_stats *stats);
+int vmem_stats_class_get(VMEM *vmp, unsigned idx,
+		struct vmem_stats_class *stats);
+int vmem_stats_arena_get(VMEM *vmp, unsigned idx,
+		struct vmem_stats_arena *stats);
+
 /*
  * support for malloc and friends...
  */
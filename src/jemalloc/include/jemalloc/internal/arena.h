@@ -333,6 +333,12 @@ struct arena_s {
 
 	dss_prec_t		dss_prec;
 
+	/*
+	 * Purge threshold (see opt_lg_dirty_mult), inherited from the pool
+	 * when the arena is created.  Protected by lock.
+	 */
+	ssize_t			lg_dirty_mult;
+
 	/* Tree of dirty-page-containing chunks this arena manages. */
 	arena_chunk_tree_t	chunks_dirty;
 
@@ -414,6 +420,7 @@ void	*arena_chunk_alloc_huge(arena_t *arena, void *new_addr, size_t size,
     size_t alignment, bool *zero);
 void	arena_chunk_dalloc_huge(arena_t *arena, void *chunk, size_t size);
 void	arena_purge_all(arena_t *arena);
+void	arena_lg_dirty_mult_set(arena_t *arena, ssize_t lg_dirty_mult);
 void	arena_tcache_fill_small(arena_t *arena, tcache_bin_t *tbin,
     size_t binind, uint64_t prof_accumbytes);
 void	arena_alloc_junk_small(void *ptr, arena_bin_info_t *bin_info,
@@ -1098,7 +1105,7 @@ arena_malloc(arena_t *arena, size_t size, bool zero, bool try_tcache)
 		 * Initialize tcache after checking size in order to avoid
 		 * infinite recursion during tcache initialization.
 		 */
-		if (try_tcache && size <= tcache_maxclass && (tcache =
+		if (try_tcache && size <= pool->tcache_max && (tcache =
 		    tcache_get(pool, true)) != NULL)
 			return (tcache_alloc_large(tcache, size, zero));
 		else {
@@ -1177,8 +1184,8 @@ arena_dalloc(arena_chunk_t *chunk, void *ptr, bool try_tcache)
 
 		assert(((uintptr_t)ptr & PAGE_MASK) == 0);
 
-		if (try_tcache && size <= tcache_maxclass && (tcache =
-		    tcache_get(chunk->arena->pool, false)) != NULL) {
+		if (try_tcache && size <= chunk->arena->pool->tcache_max &&
+		    (tcache = tcache_get(chunk->arena->pool, false)) != NULL) {
 			tcache_dalloc_large(tcache, ptr, size);
 		} else
 			arena_dalloc_large(chunk->arena, chunk, ptr);
@@ -42,6 +42,12 @@ struct malloc_mutex_s {
 #else
 	pthread_mutex_t		lock;
 #endif
+	/*
+	 * Number of times the mutex was found held by another thread.  Only
+	 * maintained if config_stats is enabled and the mutex is pthread
+	 * based.  Protected by the mutex itself.
+	 */
+	uint64_t		ncontended;
 };
 
 #if (!defined(_WIN32) && !defined(JEMALLOC_OSSPIN) && !defined(JEMALLOC_MUTEX_INIT_CB))
@@ -102,7 +108,12 @@ malloc_mutex_lock(malloc_mutex_t *mutex)
 #elif (defined(JEMALLOC_OSSPIN))
 		OSSpinLockLock(&mutex->lock);
 #else
-		pthread_mutex_lock(&mutex->lock);
+		if (config_stats == false) {
+			pthread_mutex_lock(&mutex->lock);
+		} else if (pthread_mutex_trylock(&mutex->lock) != 0) {
+			pthread_mutex_lock(&mutex->lock);
+			mutex->ncontended++;
+		}
 #endif
 	}
 }
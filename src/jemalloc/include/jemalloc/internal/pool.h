@@ -58,6 +58,20 @@ struct pool_s {
 	unsigned narenas_total;
 	unsigned narenas_auto;
 
+	/*
+	 * Per pool tuning, initialized from the global options in pool_new()
+	 * and adjusted through the "pool.<i>." mallctl namespace.
+	 */
+	ssize_t	lg_dirty_mult;	/* Default for new arenas, see arena_s. */
+	bool	tcache_enabled;	/* Use thread caches for this pool. */
+	size_t	tcache_max;	/* Largest size class cached, <= tcache_maxclass. */
+	/*
+	 * If set, arenas[0..narenas_auto) are split evenly between NUMA nodes
+	 * and threads are assigned to an arena from the range of the node
+	 * they run on.
+	 */
+	bool	arenas_numa;
+
 	/* Tree of chunks that are stand-alone huge allocations. */
 	extent_tree_t	huge;
 	/* Protects chunk-related data structures. */
@@ -99,6 +113,7 @@ struct pool_s {
 	size_t		ctl_stats_allocated;
 	size_t		ctl_stats_active;
 	size_t		ctl_stats_mapped;
+	size_t		ctl_stats_resident;
 	size_t		stats_cactive;
 
 	/* Protects list of memory ranges. */
@@ -126,7 +141,7 @@ struct tsd_pool_s {
 /******************************************************************************/
 #ifdef JEMALLOC_H_EXTERNS
 
-bool pool_new(pool_t *pool, unsigned pool_id);
+bool pool_new(pool_t *pool, unsigned pool_id, unsigned narenas);
 void pool_destroy(pool_t *pool);
 
 extern malloc_mutex_t	pools_lock;
@@ -59,6 +59,13 @@ struct malloc_bin_stats_s {
 
 	/* Current number of runs in this bin. */
 	size_t		curruns;
+
+	/*
+	 * Number of times the bin lock was found held by another thread.  Only
+	 * filled in by arena_stats_merge(), the counter itself lives in the
+	 * lock.
+	 */
+	uint64_t	ncontended;
 };
 
 struct malloc_large_stats_s {
@@ -106,6 +113,13 @@ struct arena_stats_s {
 	uint64_t	ndalloc_huge;
 	uint64_t	nrequests_huge;
 
+	/*
+	 * Number of times the arena lock was found held by another thread.
+	 * Only filled in by arena_stats_merge(), the counter itself lives in
+	 * the lock.
+	 */
+	uint64_t	ncontended;
+
 	/*
 	 * One element for each possible size class, including sizes that
 	 * overlap with bin size classes.  This is necessary because ipalloc()
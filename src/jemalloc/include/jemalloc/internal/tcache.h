@@ -162,8 +162,12 @@ JEMALLOC_INLINE void
 tcache_flush(pool_t *pool)
 {
 	tsd_tcache_t *tsd = tcache_tsd_get();
+	tcache_t *tcache;
 
-	tcache_t *tcache = tsd->tcaches[pool->pool_id];
+	if (tsd->npools <= pool->pool_id)
+		return;
+
+	tcache = tsd->tcaches[pool->pool_id];
 
 	if (tsd->seqno[pool->pool_id] == pool->seqno) {
 		cassert(config_tcache);
@@ -239,6 +243,8 @@ tcache_get(pool_t *pool, bool create)
 		return (NULL);
 	if (config_lazy_lock && isthreaded == false)
 		return (NULL);
+	if (pool->tcache_enabled == false)
+		return (NULL);
 
 	tsd = tcache_tsd_get();
 
@@ -869,13 +869,13 @@ arena_maybe_purge(arena_t *arena)
 	size_t npurgeable, threshold;
 
 	/* Don't purge if the option is disabled. */
-	if (opt_lg_dirty_mult < 0)
+	if (arena->lg_dirty_mult < 0)
 		return;
 	/* Don't purge if all dirty pages are already being purged. */
 	if (arena->ndirty <= arena->npurgatory)
 		return;
 	npurgeable = arena->ndirty - arena->npurgatory;
-	threshold = (arena->nactive >> opt_lg_dirty_mult);
+	threshold = (arena->nactive >> arena->lg_dirty_mult);
 	/*
 	 * Don't purge unless the number of purgeable pages exceeds the
 	 * threshold.
@@ -908,7 +908,7 @@ arena_compute_npurgatory(arena_t *arena, bool all)
 	npurgeable = arena->ndirty - arena->npurgatory;
 
 	if (all == false) {
-		size_t threshold = (arena->nactive >> opt_lg_dirty_mult);
+		size_t threshold = (arena->nactive >> arena->lg_dirty_mult);
 
 		npurgatory = npurgeable - threshold;
 	} else
@@ -1103,7 +1103,7 @@ arena_purge(arena_t *arena, bool all)
 		assert(ndirty == arena->ndirty);
 	}
 	assert(arena->ndirty > arena->npurgatory || all);
-	assert((arena->nactive >> opt_lg_dirty_mult) < (arena->ndirty -
+	assert((arena->nactive >> arena->lg_dirty_mult) < (arena->ndirty -
 	    arena->npurgatory) || all);
 
 	if (config_stats)
@@ -1179,6 +1179,15 @@ arena_purge_all(arena_t *arena)
 	malloc_mutex_unlock(&arena->lock);
 }
 
+void
+arena_lg_dirty_mult_set(arena_t *arena, ssize_t lg_dirty_mult)
+{
+	malloc_mutex_lock(&arena->lock);
+	arena->lg_dirty_mult = lg_dirty_mult;
+	arena_maybe_purge(arena);
+	malloc_mutex_unlock(&arena->lock);
+}
+
 static void
 arena_run_coalesce(arena_t *arena, arena_chunk_t *chunk, size_t *p_size,
     size_t *p_run_ind, size_t *p_run_pages, size_t flag_dirty)
@@ -2372,6 +2381,7 @@ arena_stats_merge(arena_t *arena, const char **dss, size_t *nactive,
 	astats->nmalloc_huge += arena->stats.nmalloc_huge;
 	astats->ndalloc_huge += arena->stats.ndalloc_huge;
 	astats->nrequests_huge += arena->stats.nrequests_huge;
+	astats->ncontended += arena->lock.ncontended;
 
 	for (i = 0; i < nlclasses; i++) {
 		lstats[i].nmalloc += arena->stats.lstats[i].nmalloc;
@@ -2396,6 +2406,7 @@ arena_stats_merge(arena_t *arena, const char **dss, size_t *nactive,
 		bstats[i].nruns += bin->stats.nruns;
 		bstats[i].reruns += bin->stats.reruns;
 		bstats[i].curruns += bin->stats.curruns;
+		bstats[i].ncontended += bin->lock.ncontended;
 		malloc_mutex_unlock(&bin->lock);
 	}
 }
@@ -2432,6 +2443,7 @@ arena_new(pool_t *pool, arena_t *arena, unsigned ind)
 		arena->prof_accumbytes = 0;
 
 	arena->dss_prec = chunk_dss_prec_get();
+	arena->lg_dirty_mult = pool->lg_dirty_mult;
 
 	/* Initialize chunks. */
 	arena_chunk_dirty_new(&arena->chunks_dirty);
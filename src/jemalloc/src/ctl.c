@@ -128,6 +128,8 @@ CTL_PROTO(arenas_initialized)
 CTL_PROTO(arenas_quantum)
 CTL_PROTO(arenas_page)
 CTL_PROTO(arenas_tcache_max)
+CTL_PROTO(arenas_lg_dirty_mult)
+CTL_PROTO(arenas_numa)
 CTL_PROTO(arenas_nbins)
 CTL_PROTO(arenas_nhbins)
 CTL_PROTO(arenas_nlruns)
@@ -159,6 +161,7 @@ CTL_PROTO(stats_arenas_i_bins_j_nflushes)
 CTL_PROTO(stats_arenas_i_bins_j_nruns)
 CTL_PROTO(stats_arenas_i_bins_j_nreruns)
 CTL_PROTO(stats_arenas_i_bins_j_curruns)
+CTL_PROTO(stats_arenas_i_bins_j_ncontended)
 INDEX_PROTO(stats_arenas_i_bins_j)
 CTL_PROTO(stats_arenas_i_lruns_j_nmalloc)
 CTL_PROTO(stats_arenas_i_lruns_j_ndalloc)
@@ -173,15 +176,21 @@ CTL_PROTO(stats_arenas_i_mapped)
 CTL_PROTO(stats_arenas_i_npurge)
 CTL_PROTO(stats_arenas_i_nmadvise)
 CTL_PROTO(stats_arenas_i_purged)
+CTL_PROTO(stats_arenas_i_ncontended)
 INDEX_PROTO(stats_arenas_i)
 CTL_PROTO(stats_cactive)
 CTL_PROTO(stats_allocated)
 CTL_PROTO(stats_active)
 CTL_PROTO(stats_mapped)
+CTL_PROTO(stats_resident)
 INDEX_PROTO(pool_i)
 CTL_PROTO(pools_npools)
 CTL_PROTO(pool_i_base)
 CTL_PROTO(pool_i_size)
+CTL_PROTO(pool_i_epoch)
+CTL_PROTO(pool_i_tcache_enabled)
+CTL_PROTO(pool_i_tcache_max)
+CTL_PROTO(pool_i_tcache_flush)
 
 /******************************************************************************/
 /* mallctl tree. */
@@ -318,6 +327,8 @@ static const ctl_named_node_t arenas_node[] = {
 	{NAME("quantum"),		CTL(arenas_quantum)},
 	{NAME("page"),			CTL(arenas_page)},
 	{NAME("tcache_max"),		CTL(arenas_tcache_max)},
+	{NAME("lg_dirty_mult"),		CTL(arenas_lg_dirty_mult)},
+	{NAME("numa"),			CTL(arenas_numa)},
 	{NAME("nbins"),			CTL(arenas_nbins)},
 	{NAME("nhbins"),		CTL(arenas_nhbins)},
 	{NAME("bin"),			CHILD(indexed, arenas_bin)},
@@ -368,7 +379,8 @@ static const ctl_named_node_t stats_arenas_i_bins_j_node[] = {
 	{NAME("nflushes"),		CTL(stats_arenas_i_bins_j_nflushes)},
 	{NAME("nruns"),			CTL(stats_arenas_i_bins_j_nruns)},
 	{NAME("nreruns"),		CTL(stats_arenas_i_bins_j_nreruns)},
-	{NAME("curruns"),		CTL(stats_arenas_i_bins_j_curruns)}
+	{NAME("curruns"),		CTL(stats_arenas_i_bins_j_curruns)},
+	{NAME("ncontended"),		CTL(stats_arenas_i_bins_j_ncontended)}
 };
 static const ctl_named_node_t super_stats_arenas_i_bins_j_node[] = {
 	{NAME(""),			CHILD(named, stats_arenas_i_bins_j)}
@@ -401,6 +413,7 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
 	{NAME("npurge"),		CTL(stats_arenas_i_npurge)},
 	{NAME("nmadvise"),		CTL(stats_arenas_i_nmadvise)},
 	{NAME("purged"),		CTL(stats_arenas_i_purged)},
+	{NAME("ncontended"),		CTL(stats_arenas_i_ncontended)},
 	{NAME("small"),			CHILD(named, stats_arenas_i_small)},
 	{NAME("large"),			CHILD(named, stats_arenas_i_large)},
 	{NAME("huge"),			CHILD(named, stats_arenas_i_huge)},
@@ -422,18 +435,27 @@ static const ctl_named_node_t pool_stats_node[] = {
 	{NAME("cactive"),		CTL(stats_cactive)},
 	{NAME("allocated"),		CTL(stats_allocated)},
 	{NAME("active"),		CTL(stats_active)},
-	{NAME("mapped"),		CTL(stats_mapped)}
+	{NAME("mapped"),		CTL(stats_mapped)},
+	{NAME("resident"),		CTL(stats_resident)}
 };
 
 static const ctl_named_node_t pools_node[] = {
 	{NAME("npools"),               CTL(pools_npools)},
 };
 
+static const ctl_named_node_t pool_i_tcache_node[] = {
+	{NAME("enabled"),	CTL(pool_i_tcache_enabled)},
+	{NAME("max"),		CTL(pool_i_tcache_max)},
+	{NAME("flush"),		CTL(pool_i_tcache_flush)}
+};
+
 static const ctl_named_node_t pool_i_node[] = {
 	{NAME("mem_base"),      CTL(pool_i_base)},
 	{NAME("mem_size"),	CTL(pool_i_size)},
+	{NAME("epoch"),		CTL(pool_i_epoch)},
 	{NAME("arena"),		CHILD(indexed, arena)},
 	{NAME("arenas"),	CHILD(named, arenas)},
+	{NAME("tcache"),	CHILD(named, pool_i_tcache)},
 	{NAME("stats"),		CHILD(named, pool_stats)}
 };
 
@@ -541,6 +563,7 @@ ctl_arena_stats_smerge(ctl_arena_stats_t *sstats, ctl_arena_stats_t *astats)
 	sstats->astats.nmalloc_huge += astats->astats.nmalloc_huge;
 	sstats->astats.ndalloc_huge += astats->astats.ndalloc_huge;
 	sstats->astats.nrequests_huge += astats->astats.nrequests_huge;
+	sstats->astats.ncontended += astats->astats.ncontended;
 
 	for (i = 0; i < nlclasses; i++) {
 		sstats->lstats[i].nmalloc += astats->lstats[i].nmalloc;
@@ -562,6 +585,7 @@ ctl_arena_stats_smerge(ctl_arena_stats_t *sstats, ctl_arena_stats_t *astats)
 		sstats->bstats[i].nruns += astats->bstats[i].nruns;
 		sstats->bstats[i].reruns += astats->bstats[i].reruns;
 		sstats->bstats[i].curruns += astats->bstats[i].curruns;
+		sstats->bstats[i].ncontended += astats->bstats[i].ncontended;
 	}
 }
 
@@ -703,6 +727,9 @@ ctl_refresh_pool(pool_t *pool)
 		pool->ctl_stats_active =
 		    (pool->ctl_stats.arenas[pool->ctl_stats.narenas].pactive << LG_PAGE);
 		pool->ctl_stats_mapped = (pool->ctl_stats.chunks.current << opt_lg_chunk);
+		/* Dirty pages stay resident until they are purged. */
+		pool->ctl_stats_resident = pool->ctl_stats_active +
+		    (pool->ctl_stats.arenas[pool->ctl_stats.narenas].pdirty << LG_PAGE);
 	}
 
 	ctl_epoch++;
@@ -1699,6 +1726,212 @@ label_return:
 	return (ret);
 }
 
+/* ctl_mtx must be held during execution of this function. */
+static pool_t *
+ctl_pool_get(const size_t *mib)
+{
+
+	if (mib[1] >= npools)
+		return (NULL);
+	return (pools[mib[1]]);
+}
+
+static int
+arenas_lg_dirty_mult_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	ssize_t oldval;
+	pool_t *pool;
+
+	malloc_mutex_lock(&ctl_mtx);
+	if ((pool = ctl_pool_get(mib)) == NULL) {
+		ret = ENOENT;
+		goto label_return;
+	}
+	oldval = pool->lg_dirty_mult;
+	if (newp != NULL) {
+		ssize_t lg_dirty_mult;
+		unsigned i;
+
+		if (newlen != sizeof(ssize_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		lg_dirty_mult = *(ssize_t *)newp;
+		if (lg_dirty_mult < -1 ||
+		    lg_dirty_mult >= (ssize_t)(sizeof(size_t) << 3)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+
+		{
+			VARIABLE_ARRAY(arena_t *, tarenas,
+			    pool->ctl_stats.narenas);
+
+			/* Arenas created from now on inherit the new value. */
+			malloc_rwlock_wrlock(&pool->arenas_lock);
+			pool->lg_dirty_mult = lg_dirty_mult;
+			memcpy(tarenas, pool->arenas, sizeof(arena_t *) *
+			    pool->ctl_stats.narenas);
+			malloc_rwlock_unlock(&pool->arenas_lock);
+
+			for (i = 0; i < pool->ctl_stats.narenas; i++) {
+				if (tarenas[i] != NULL) {
+					arena_lg_dirty_mult_set(tarenas[i],
+					    lg_dirty_mult);
+				}
+			}
+		}
+	}
+	READ(oldval, ssize_t);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(&ctl_mtx);
+	return (ret);
+}
+
+static int
+arenas_numa_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	bool oldval;
+	pool_t *pool;
+
+	malloc_mutex_lock(&ctl_mtx);
+	if ((pool = ctl_pool_get(mib)) == NULL) {
+		ret = ENOENT;
+		goto label_return;
+	}
+	oldval = pool->arenas_numa;
+	WRITE(pool->arenas_numa, bool);
+	READ(oldval, bool);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(&ctl_mtx);
+	return (ret);
+}
+
+static int
+pool_i_tcache_enabled_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	bool oldval;
+	pool_t *pool;
+
+	if (config_tcache == false)
+		return (ENOENT);
+
+	malloc_mutex_lock(&ctl_mtx);
+	if ((pool = ctl_pool_get(mib)) == NULL) {
+		ret = ENOENT;
+		goto label_return;
+	}
+	oldval = pool->tcache_enabled;
+	WRITE(pool->tcache_enabled, bool);
+	/*
+	 * Only the calling thread's cache can be flushed here, caches of
+	 * other threads are released when those threads exit.
+	 */
+	if (newp != NULL && pool->tcache_enabled == false)
+		tcache_flush(pool);
+	READ(oldval, bool);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(&ctl_mtx);
+	return (ret);
+}
+
+static int
+pool_i_tcache_max_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	size_t oldval;
+	pool_t *pool;
+
+	if (config_tcache == false)
+		return (ENOENT);
+
+	malloc_mutex_lock(&ctl_mtx);
+	if ((pool = ctl_pool_get(mib)) == NULL) {
+		ret = ENOENT;
+		goto label_return;
+	}
+	oldval = pool->tcache_max;
+	if (newp != NULL) {
+		if (newlen != sizeof(size_t) ||
+		    *(size_t *)newp > tcache_maxclass) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		pool->tcache_max = *(size_t *)newp;
+	}
+	READ(oldval, size_t);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(&ctl_mtx);
+	return (ret);
+}
+
+static int
+pool_i_tcache_flush_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	pool_t *pool;
+
+	if (config_tcache == false)
+		return (ENOENT);
+
+	READONLY();
+	WRITEONLY();
+
+	malloc_mutex_lock(&ctl_mtx);
+	pool = ctl_pool_get(mib);
+	if (pool != NULL)
+		tcache_flush(pool);
+	malloc_mutex_unlock(&ctl_mtx);
+
+	ret = (pool != NULL) ? 0 : ENOENT;
+label_return:
+	return (ret);
+}
+
+/*
+ * Refresh the statistics of a single pool, unlike the top level "epoch"
+ * which walks all of them.
+ */
+static int
+pool_i_epoch_ctl(const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen)
+{
+	int ret;
+	UNUSED uint64_t newval;
+	pool_t *pool;
+
+	malloc_mutex_lock(&ctl_mtx);
+	if ((pool = ctl_pool_get(mib)) == NULL) {
+		ret = ENOENT;
+		goto label_return;
+	}
+	WRITE(newval, uint64_t);
+	if (newp != NULL)
+		ctl_refresh_pool(pool);
+	READ(ctl_epoch, uint64_t);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(&ctl_mtx);
+	return (ret);
+}
+
 /**
  * @stub
  */
@@ -1850,6 +2083,7 @@ CTL_RO_CGEN(config_stats, stats_cactive, &(pools[mib[1]]->stats_cactive), size_t
 CTL_RO_CGEN(config_stats, stats_allocated, pools[mib[1]]->ctl_stats_allocated, size_t)
 CTL_RO_CGEN(config_stats, stats_active, pools[mib[1]]->ctl_stats_active, size_t)
 CTL_RO_CGEN(config_stats, stats_mapped, pools[mib[1]]->ctl_stats_mapped, size_t)
+CTL_RO_CGEN(config_stats, stats_resident, pools[mib[1]]->ctl_stats_resident, size_t)
 CTL_RO_CGEN(config_stats, stats_chunks_current, pools[mib[1]]->ctl_stats.chunks.current,
     size_t)
 CTL_RO_CGEN(config_stats, stats_chunks_total, pools[mib[1]]->ctl_stats.chunks.total, uint64_t)
@@ -1867,6 +2101,8 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_nmadvise,
     pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nmadvise, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_purged,
     pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.purged, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_ncontended,
+    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.ncontended, uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_allocated,
     pools[mib[1]]->ctl_stats.arenas[mib[4]].allocated_small, size_t)
@@ -1911,6 +2147,8 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nreruns,
     pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].reruns, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_curruns,
     pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].curruns, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_ncontended,
+    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].ncontended, uint64_t)
 
 static const ctl_named_node_t *
 stats_arenas_i_bins_j_index(const size_t *mib, size_t miblen, size_t j)
@@ -37,6 +37,10 @@ bool	in_valgrind;
 unsigned	npools_cnt;	/* actual number of pools */
 unsigned	npools; 	/* size of the pools[] array */
 unsigned	ncpus;
+/* Online NUMA nodes, their IDs in ascending order. */
+#define	NNODES_MAX	64
+static unsigned	nnodes;
+static unsigned	node_ids[NNODES_MAX];
 
 pool_t		**pools;
 pool_t		base_pool;
@@ -161,6 +165,58 @@ arenas_extend(pool_t *pool, unsigned ind)
 	return (pool->arenas[0]);
 }
 
+/*
+ * Return the index in node_ids[] of the NUMA node of the CPU the calling
+ * thread runs on, or 0 if it cannot be determined.  Node IDs need not be
+ * contiguous, so the ID itself cannot be used as the index.
+ */
+static unsigned
+malloc_numa_node(void)
+{
+#ifdef SYS_getcpu
+	unsigned cpu, node, i;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+		for (i = 0; i < nnodes; i++) {
+			if (node_ids[i] == node)
+				return (i);
+		}
+		/* node brought online after initialization */
+		return (node % nnodes);
+	}
+#endif
+	return (0);
+}
+
+/*
+ * Compute the range of automatic arenas [*first, *last) the calling thread
+ * may be assigned to.  Unless the pool binds arenas to NUMA nodes that is
+ * the whole arenas[0..narenas_auto) range.  Otherwise the arenas are split
+ * evenly between the nodes, the last node taking the remainder.
+ */
+static void
+choose_arena_range(pool_t *pool, unsigned *first, unsigned *last)
+{
+	unsigned node, per_node;
+
+	*first = 0;
+	*last = pool->narenas_auto;
+
+	if (pool->arenas_numa == false || nnodes < 2)
+		return;
+
+	node = malloc_numa_node();
+	per_node = pool->narenas_auto / nnodes;
+	if (per_node == 0) {
+		*first = node % pool->narenas_auto;
+		*last = *first + 1;
+	} else {
+		*first = node * per_node;
+		if (node != nnodes - 1)
+			*last = *first + per_node;
+	}
+}
+
 /* Slow path, called only by choose_arena(). */
 arena_t *
 choose_arena_hard(pool_t *pool)
@@ -169,22 +225,23 @@ choose_arena_hard(pool_t *pool)
 	tsd_pool_t *tsd;
 
 	if (pool->narenas_auto > 1) {
-		unsigned i, choose, first_null;
+		unsigned i, first, last, choose, first_null;
 
-		choose = 0;
-		first_null = pool->narenas_auto;
+		choose_arena_range(pool, &first, &last);
+		choose = last;
+		first_null = last;
 		malloc_rwlock_wrlock(&pool->arenas_lock);
 		assert(pool->arenas[0] != NULL);
-		for (i = 1; i < pool->narenas_auto; i++) {
+		for (i = first; i < last; i++) {
 			if (pool->arenas[i] != NULL) {
 				/*
 				 * Choose the first arena that has the lowest
 				 * number of threads assigned to it.
 				 */
-				if (pool->arenas[i]->nthreads <
-				    pool->arenas[choose]->nthreads)
+				if (choose == last || pool->arenas[i]->nthreads
+				    < pool->arenas[choose]->nthreads)
 					choose = i;
-			} else if (first_null == pool->narenas_auto) {
+			} else if (first_null == last) {
 				/*
 				 * Record the index of the first uninitialized
 				 * arena, in case all extant arenas are in use.
@@ -198,8 +255,8 @@ choose_arena_hard(pool_t *pool)
 			}
 		}
 
-		if (pool->arenas[choose]->nthreads == 0
-		    || first_null == pool->narenas_auto) {
+		if (choose != last && (pool->arenas[choose]->nthreads == 0
+		    || first_null == last)) {
 			/*
 			 * Use an unloaded arena, or the least loaded arena if
 			 * all arenas are already initialized.
@@ -293,6 +350,51 @@ malloc_ncpus(void)
 	return ((result == -1) ? 1 : (unsigned)result);
 }
 
+/*
+ * Fill node_ids[] with the IDs of the online NUMA nodes and return their
+ * number.  Without NUMA information a single node 0 is assumed.
+ */
+static unsigned
+malloc_nnodes(void)
+{
+	unsigned result = 0;
+#ifdef __linux__
+	char buf[256];
+	ssize_t len;
+	int fd;
+
+	/* The list of online nodes, e.g. "0", "0-3" or "0,2-3". */
+	fd = open("/sys/devices/system/node/online", O_RDONLY);
+	if (fd != -1) {
+		len = read(fd, buf, sizeof(buf) - 1);
+		close(fd);
+	} else
+		len = -1;
+	if (len > 0) {
+		char *p, *end;
+		unsigned long first, last;
+
+		buf[len] = '\0';
+		p = buf;
+		while (isdigit((unsigned char)*p) && result < NNODES_MAX) {
+			first = last = strtoul(p, &end, 10);
+			if (*end == '-')
+				last = strtoul(end + 1, &end, 10);
+			for (; first <= last && result < NNODES_MAX; first++)
+				node_ids[result++] = (unsigned)first;
+			if (*end != ',')
+				break;
+			p = end + 1;
+		}
+	}
+#endif
+	if (result == 0) {
+		node_ids[0] = 0;
+		result = 1;
+	}
+	return (result);
+}
+
 bool
 arenas_tsd_extend(tsd_pool_t *tsd, unsigned len)
 {
@@ -399,7 +501,7 @@ malloc_init_base_pool(void)
 		return (true);
 	}
 
-	if (pool_new(&base_pool, 0)) {
+	if (pool_new(&base_pool, 0, 0)) {
 		malloc_mutex_unlock(&pool_base_lock);
 		return (true);
 	}
@@ -890,6 +992,7 @@ malloc_init_hard(void)
 	/* Recursive allocation may follow. */
 
 	ncpus = malloc_ncpus();
+	nnodes = malloc_nnodes();
 
 #if (!defined(JEMALLOC_MUTEX_INIT_CB) && !defined(JEMALLOC_ZONE) \
     && !defined(_WIN32) && !defined(__native_client__))
@@ -1479,6 +1582,12 @@ void pools_shared_data_destroy(void)
 
 pool_t *
 je_pool_create(void *addr, size_t size, int zeroed)
+{
+	return (je_pool_create_narenas(addr, size, zeroed, 0));
+}
+
+pool_t *
+je_pool_create_narenas(void *addr, size_t size, int zeroed, unsigned narenas)
 {
 	if (malloc_init())
 		return (NULL);
@@ -1542,7 +1651,7 @@ je_pool_create(void *addr, size_t size, int zeroed)
 	pool->base_past_addr = (void *)((uintptr_t)addr + size);
 
 	/* prepare pool and internal structures */
-	if (pool_new(pool, pool_id)) {
+	if (pool_new(pool, pool_id, narenas)) {
 		assert(pools[pool_id] == NULL);
 		malloc_mutex_unlock(&pools_lock);
 		pools_shared_data_destroy();
@@ -2831,6 +2940,21 @@ je_mallctl(const char *name, void *oldp, size_t *oldlenp, void *newp,
 	return (ctl_byname(name, oldp, oldlenp, newp, newlen));
 }
 
+int
+je_pool_mallctl(pool_t *pool, const char *name, void *oldp, size_t *oldlenp,
+    void *newp, size_t newlen)
+{
+	char buf[128];
+	int len;
+
+	len = malloc_snprintf(buf, sizeof(buf), "pool.%u.%s", pool->pool_id,
+	    name);
+	if (len < 0 || (size_t)len >= sizeof(buf))
+		return (ENOENT);
+
+	return (ctl_byname(buf, oldp, oldlenp, newp, newlen));
+}
+
 int
 je_mallctlnametomib(const char *name, size_t *mibp, size_t *miblenp)
 {
@@ -99,6 +99,7 @@ malloc_mutex_init(malloc_mutex_t *mutex)
 	}
 	pthread_mutexattr_destroy(&attr);
 #endif
+	mutex->ncontended = 0;
 	return (false);
 }
 
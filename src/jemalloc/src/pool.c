@@ -4,8 +4,11 @@
 malloc_mutex_t	pool_base_lock = MALLOC_MUTEX_INITIALIZER;
 malloc_mutex_t	pools_lock = MALLOC_MUTEX_INITIALIZER;
 
-/* Initialize pool and create its base arena. */
-bool pool_new(pool_t *pool, unsigned pool_id)
+/*
+ * Initialize pool and create its base arena.  If narenas is 0, the number of
+ * arenas is taken from opt_narenas.
+ */
+bool pool_new(pool_t *pool, unsigned pool_id, unsigned narenas)
 {
 	pool->pool_id = pool_id;
 
@@ -32,7 +35,12 @@ bool pool_new(pool_t *pool, unsigned pool_id)
 	pool->ctl_stats_allocated = 0;
 	pool->ctl_stats_mapped = 0;
 
-	pool->narenas_auto = opt_narenas;
+	pool->lg_dirty_mult = opt_lg_dirty_mult;
+	pool->tcache_enabled = opt_tcache;
+	pool->tcache_max = config_tcache ? tcache_maxclass : 0;
+	pool->arenas_numa = false;
+
+	pool->narenas_auto = (narenas != 0) ? narenas : opt_narenas;
 	/*
 	 * Make sure that the arenas array can be allocated.  In practice, this
 	 * limit is enough to allow the allocator to function, but the ctl
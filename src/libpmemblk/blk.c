@@ -35,6 +35,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/param.h>
@@ -300,6 +301,34 @@ pmemblk_descr_check(PMEMblkpool *pbp, size_t *bsize)
 	return 0;
 }
 
+/*
+ * blk_get_nmaplock -- (internal) return the number of btt map locks to use
+ *
+ * By default the number of map locks scales with the number of CPUs, so
+ * that unrelated LBAs are less likely to serialize their writes on the
+ * same lock.  It can be overridden by the PMEMBLK_MAP_LOCKS environment
+ * variable, which is read each time a pool is opened.
+ */
+static unsigned
+blk_get_nmaplock(unsigned ncpus)
+{
+	unsigned nmaplock = ncpus * BLK_MAP_LOCKS_PER_CPU;
+
+	char *e = getenv(PMEMBLK_MAP_LOCKS_VAR);
+	if (e) {
+		char *endp;
+		errno = 0;
+		unsigned long val = strtoul(e, &endp, 10);
+		if (errno || *endp != '\0' || val == 0 || val > UINT32_MAX)
+			LOG(2, "Invalid %s", PMEMBLK_MAP_LOCKS_VAR);
+		else
+			nmaplock = (unsigned)val;
+	}
+
+	LOG(3, "nmaplock %u", nmaplock);
+	return nmaplock;
+}
+
 /*
  * pmemblk_runtime_init -- (internal) initialize block memory pool runtime data
  */
@@ -336,6 +365,8 @@ pmemblk_runtime_init(PMEMblkpool *pbp, size_t bsize, int rdonly, int is_pmem)
 	if (ncpus < 1)
 		ncpus = 1;
 
+	unsigned nmaplock = blk_get_nmaplock((unsigned)ncpus);
+
 	ns_cb.ns_is_zeroed = pbp->is_zeroed;
 
 	/* things free by "goto err" if not NULL */
@@ -343,7 +374,7 @@ pmemblk_runtime_init(PMEMblkpool *pbp, size_t bsize, int rdonly, int is_pmem)
 	pthread_mutex_t *locks = NULL;
 
 	bttp = btt_init(pbp->datasize, (uint32_t)bsize, pbp->hdr.poolset_uuid,
-			(unsigned)ncpus * 2, pbp, &ns_cb);
+			(unsigned)ncpus * 2, nmaplock, pbp, &ns_cb);
 
 	if (bttp == NULL)
 		goto err;	/* btt_init set errno, called LOG */
@@ -39,6 +39,10 @@
 #define PMEMBLK_LOG_PREFIX "libpmemblk"
 #define PMEMBLK_LOG_LEVEL_VAR "PMEMBLK_LOG_LEVEL"
 #define PMEMBLK_LOG_FILE_VAR "PMEMBLK_LOG_FILE"
+#define PMEMBLK_MAP_LOCKS_VAR "PMEMBLK_MAP_LOCKS"
+
+/* default number of btt map locks per arena, for each online CPU */
+#define BLK_MAP_LOCKS_PER_CPU 32
 
 /* attributes of the blk memory pool format for the pool header */
 #define BLK_HDR_SIG "PMEMBLK"	/* must be 8 bytes including '\0' */
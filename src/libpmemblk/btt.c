@@ -111,6 +111,9 @@
  *	map_unlock	data structure in an area.
  *	map_abort
  *
+ *	map_lock_num	Find the map lock (and its sequence counter) that
+ *			protects a given pre-map LBA.
+ *
  *	map_entry_setf	Common code for btt_set_zero() and btt_set_error().
  *
  *	zero_block	Generate a block of all zeros (instead of actually
@@ -136,6 +139,15 @@
 #include "btt_layout.h"
 #include "sys_util.h"
 
+/*
+ * Map lock sequence counter, padded to the map cache line so the counters
+ * of neighbouring map locks don't share a cache line.
+ */
+struct map_seq {
+	uint32_t volatile seq;
+	uint8_t padding[BTT_MAP_LOCK_ALIGN - sizeof(uint32_t)];
+};
+
 /*
  * The opaque btt handle containing state tracked by this module
  * for the btt namespace.  This is created by btt_init(), handed to
@@ -171,6 +183,7 @@ struct btt {
 	uint64_t rawsize;		/* size of containing namespace */
 	uint32_t lbasize;		/* external LBA size */
 	uint32_t nfree;			/* available flog entries */
+	uint32_t nmaplock;		/* map locks per arena */
 	uint64_t nlba;			/* total number of external LBAs */
 	unsigned narena;		/* number of arenas */
 
@@ -223,10 +236,23 @@ struct btt {
 		uint32_t volatile *rtt;
 
 		/*
-		 * Map locking.  Indexed by pre-map LBA modulo nlane.
+		 * Map locking.  Indexed by the map cache line of the pre-map
+		 * LBA modulo nmaplock.
 		 */
 		pthread_mutex_t *map_locks;
 
+		/*
+		 * Map lock sequence counters.  Indexed like map_locks.
+		 *
+		 * A writer increments the counter right after acquiring the
+		 * map lock and again right before dropping it, so the counter
+		 * is odd while a map update covered by that lock is in
+		 * progress.  The read path uses the counters to detect that
+		 * no map update could have raced with it, in which case the
+		 * map entry doesn't have to be read twice.
+		 */
+		struct map_seq *map_seqs;
+
 		/*
 		 * Arena info block locking.
 		 */
@@ -744,13 +770,20 @@ static int
 build_map_locks(struct btt *bttp, struct arena *arenap)
 {
 	if ((arenap->map_locks =
-			Malloc(bttp->nfree * sizeof(*arenap->map_locks)))
+			Malloc(bttp->nmaplock * sizeof(*arenap->map_locks)))
 							== NULL) {
-		ERR("!Malloc for %d map_lock entries", bttp->nfree);
+		ERR("!Malloc for %u map_lock entries", bttp->nmaplock);
+		return -1;
+	}
+	for (uint32_t i = 0; i < bttp->nmaplock; i++)
+		util_mutex_init(&arenap->map_locks[i], NULL);
+
+	if ((arenap->map_seqs =
+			Zalloc(bttp->nmaplock * sizeof(*arenap->map_seqs)))
+							== NULL) {
+		ERR("!Zalloc for %u map_seq entries", bttp->nmaplock);
 		return -1;
 	}
-	for (uint32_t lane = 0; lane < bttp->nfree; lane++)
-		util_mutex_init(&arenap->map_locks[lane], NULL);
 
 	return 0;
 }
@@ -877,6 +910,10 @@ read_arenas(struct btt *bttp, unsigned lane, unsigned narena)
 {
 	LOG(3, "bttp %p lane %u narena %d", bttp, lane, narena);
 
+	/* unless told otherwise, use one map lock per flog entry */
+	if (bttp->nmaplock == 0)
+		bttp->nmaplock = bttp->nfree;
+
 	if ((bttp->arenas = Zalloc(narena * sizeof(*bttp->arenas))) == NULL) {
 		ERR("!Malloc for %u arenas", narena);
 		goto err;
@@ -909,6 +946,8 @@ err:
 				Free((void *)bttp->arenas[i].rtt);
 			if (bttp->arenas[i].map_locks)
 				Free((void *)bttp->arenas[i].map_locks);
+			if (bttp->arenas[i].map_seqs)
+				Free((void *)bttp->arenas[i].map_seqs);
 		}
 		Free(bttp->arenas);
 		bttp->arenas = NULL;
@@ -1405,12 +1444,19 @@ lba_to_arena_lba(struct btt *bttp, uint64_t lba,
  *
  * If arenas have different nfree values, we will be using the lowest one
  * found as limiting to the overall "bandwidth".
+ *
+ * The nmaplock argument is the number of map locks allocated per arena.
+ * Unrelated LBAs which hash to the same map lock serialize their writes,
+ * so callers expecting many concurrent writers may ask for more locks.
+ * Zero means one lock per flog entry (nfree).
  */
 struct btt *
 btt_init(uint64_t rawsize, uint32_t lbasize, uint8_t parent_uuid[],
-		unsigned maxlane, void *ns, const struct ns_callback *ns_cbp)
+		unsigned maxlane, unsigned nmaplock, void *ns,
+		const struct ns_callback *ns_cbp)
 {
-	LOG(3, "rawsize %ju lbasize %u", rawsize, lbasize);
+	LOG(3, "rawsize %ju lbasize %u nmaplock %u",
+			rawsize, lbasize, nmaplock);
 
 	if (rawsize < BTT_MIN_SIZE) {
 		ERR("rawsize smaller than BTT_MIN_SIZE %u", BTT_MIN_SIZE);
@@ -1429,6 +1475,7 @@ btt_init(uint64_t rawsize, uint32_t lbasize, uint8_t parent_uuid[],
 	memcpy(bttp->parent_uuid, parent_uuid, BTTINFO_UUID_LEN);
 	bttp->rawsize = rawsize;
 	bttp->lbasize = lbasize;
+	bttp->nmaplock = nmaplock;
 	bttp->ns = ns;
 	bttp->ns_cbp = ns_cbp;
 
@@ -1486,6 +1533,23 @@ btt_nlba(struct btt *bttp)
 	return bttp->nlba;
 }
 
+/*
+ * map_lock_num -- (internal) calculate the map lock index for a pre-map LBA
+ *
+ * map_locks[] contains nmaplock locks which are used to protect the map
+ * from concurrent access to the same cache line.  The index into map_locks[]
+ * is calculated by looking at the byte offset into the map
+ * (premap_lba * BTT_MAP_ENTRY_SIZE), figuring out how many cache lines that
+ * is into the map that is (dividing by BTT_MAP_LOCK_ALIGN), and then
+ * selecting one of nmaplock locks (the modulo at the end).
+ */
+static inline uint32_t
+map_lock_num(struct btt *bttp, uint32_t premap_lba)
+{
+	return premap_lba * BTT_MAP_ENTRY_SIZE / BTT_MAP_LOCK_ALIGN %
+			bttp->nmaplock;
+}
+
 /*
  * btt_read -- read a block from a btt namespace
  *
@@ -1513,6 +1577,18 @@ btt_read(struct btt *bttp, unsigned lane, uint64_t lba, void *buf)
 	/* convert pre-map LBA into an offset into the map */
 	map_entry_off = arenap->mapoff + BTT_MAP_ENTRY_SIZE * premap_lba;
 
+	/*
+	 * Snapshot the sequence counter of the map lock covering this entry
+	 * before reading it.  If the counter is even and still unchanged
+	 * once the rtt entry is published below, no writer could have
+	 * updated the map entry in between and it doesn't need to be
+	 * read again.
+	 */
+	uint32_t volatile *seqp = &arenap->map_seqs[map_lock_num(bttp,
+							premap_lba)].seq;
+	uint32_t seq = *seqp;
+	__sync_synchronize();
+
 	/*
 	 * Read the current map entry to get the post-map LBA for the data
 	 * block read.
@@ -1555,6 +1631,13 @@ btt_read(struct btt *bttp, unsigned lane, uint64_t lba, void *buf)
 		arenap->rtt[lane] = entry;
 		__sync_synchronize();
 
+		/*
+		 * Fast path: no writer held the map lock while the entry was
+		 * read and stored in the rtt, so the entry is still current.
+		 */
+		if ((seq & 1) == 0 && *seqp == seq)
+			break;
+
 		/*
 		 * In case this thread was preempted between reading entry and
 		 * storing it in the rtt, check to see if the map changed.  If
@@ -1563,6 +1646,9 @@ btt_read(struct btt *bttp, unsigned lane, uint64_t lba, void *buf)
 		 * undisturbed) and potentially allocated and being used for
 		 * another write (data disturbed, so not okay to continue).
 		 */
+		seq = *seqp;
+		__sync_synchronize();
+
 		uint32_t latest_entry;
 		if ((*bttp->ns_cbp->nsread)(bttp->ns, lane, &latest_entry,
 				sizeof(latest_entry), map_entry_off) < 0) {
@@ -1607,22 +1693,17 @@ map_lock(struct btt *bttp, unsigned lane, struct arena *arenap,
 	uint64_t map_entry_off =
 			arenap->mapoff + BTT_MAP_ENTRY_SIZE * premap_lba;
 
-	/*
-	 * map_locks[] contains nfree locks which are used to protect the map
-	 * from concurrent access to the same cache line.  The index into
-	 * map_locks[] is calculated by looking at the byte offset into the map
-	 * (premap_lba * BTT_MAP_ENTRY_SIZE), figuring out how many cache lines
-	 * that is into the map that is (dividing by BTT_MAP_LOCK_ALIGN), and
-	 * then selecting one of nfree locks (the modulo at the end).
-	 */
-	uint32_t map_lock_num = premap_lba * BTT_MAP_ENTRY_SIZE /
-			BTT_MAP_LOCK_ALIGN % bttp->nfree;
-	util_mutex_lock(&arenap->map_locks[map_lock_num]);
+	uint32_t lock_num = map_lock_num(bttp, premap_lba);
+	util_mutex_lock(&arenap->map_locks[lock_num]);
+
+	/* let optimistic readers know a map update is in progress */
+	__sync_fetch_and_add(&arenap->map_seqs[lock_num].seq, 1);
 
 	/* read the old map entry */
 	if ((*bttp->ns_cbp->nsread)(bttp->ns, lane, entryp,
 				sizeof(uint32_t), map_entry_off) < 0) {
-		util_mutex_unlock(&arenap->map_locks[map_lock_num]);
+		__sync_fetch_and_add(&arenap->map_seqs[lock_num].seq, 1);
+		util_mutex_unlock(&arenap->map_locks[lock_num]);
 		return -1;
 	}
 
@@ -1648,9 +1729,9 @@ map_abort(struct btt *bttp, unsigned lane, struct arena *arenap,
 	LOG(3, "bttp %p lane %u arenap %p premap_lba %u",
 			bttp, lane, arenap, premap_lba);
 
-	uint32_t map_lock_num = premap_lba * BTT_MAP_ENTRY_SIZE /
-			BTT_MAP_LOCK_ALIGN % bttp->nfree;
-	util_mutex_unlock(&arenap->map_locks[map_lock_num]);
+	uint32_t lock_num = map_lock_num(bttp, premap_lba);
+	__sync_fetch_and_add(&arenap->map_seqs[lock_num].seq, 1);
+	util_mutex_unlock(&arenap->map_locks[lock_num]);
 }
 
 /*
@@ -1670,11 +1751,11 @@ map_unlock(struct btt *bttp, unsigned lane, struct arena *arenap,
 	int err = (*bttp->ns_cbp->nswrite)(bttp->ns, lane, &entry,
 				sizeof(uint32_t), map_entry_off);
 
-	uint32_t map_lock_num =
-			premap_lba * BTT_MAP_ENTRY_SIZE / BTT_MAP_LOCK_ALIGN
-			% bttp->nfree;
+	uint32_t lock_num = map_lock_num(bttp, premap_lba);
 
-	util_mutex_unlock(&arenap->map_locks[map_lock_num]);
+	/* the map entry is written, readers may trust it again */
+	__sync_fetch_and_add(&arenap->map_seqs[lock_num].seq, 1);
+	util_mutex_unlock(&arenap->map_locks[lock_num]);
 
 	LOG(9, "unlocked map[%d]: %u%s%s", premap_lba,
 			entry & BTT_MAP_ENTRY_LBA_MASK,
@@ -2060,8 +2141,10 @@ btt_fini(struct btt *bttp)
 				Free(bttp->arenas[i].flogs);
 			if (bttp->arenas[i].rtt)
 				Free((void *)bttp->arenas[i].rtt);
-			if (bttp->arenas[i].rtt)
+			if (bttp->arenas[i].map_locks)
 				Free((void *)bttp->arenas[i].map_locks);
+			if (bttp->arenas[i].map_seqs)
+				Free((void *)bttp->arenas[i].map_seqs);
 		}
 		Free(bttp->arenas);
 	}
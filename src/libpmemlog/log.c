@@ -69,9 +69,10 @@ pmemlog_descr_create(PMEMlogpool *plp, size_t poolsize)
 					LOG_FORMAT_DATA_ALIGN));
 	plp->end_offset = htole64(poolsize);
 	plp->write_offset = plp->start_offset;
+	plp->head_offset = plp->start_offset;
 
 	/* store non-volatile part of pool's descriptor */
-	pmem_msync(&plp->start_offset, 3 * sizeof(uint64_t));
+	pmem_msync(&plp->start_offset, LOG_DESCR_NFIELDS * sizeof(uint64_t));
 
 	return 0;
 }
@@ -98,7 +99,23 @@ pmemlog_descr_check(PMEMlogpool *plp, size_t poolsize)
 		return -1;
 	}
 
-	if ((hdr.write_offset > hdr.end_offset) || (hdr.write_offset <
+	if (plp->circular) {
+		/*
+		 * The offsets of a circular log keep growing, only the amount
+		 * of data between the head and the write point is bounded.
+		 */
+		if ((hdr.head_offset < hdr.start_offset) ||
+				(hdr.write_offset < hdr.head_offset) ||
+				(hdr.write_offset - hdr.head_offset >
+				hdr.end_offset - hdr.start_offset)) {
+			ERR("wrong head/write offsets (start: %ju end: %ju "
+				"head: %ju write: %ju)",
+				hdr.start_offset, hdr.end_offset,
+				hdr.head_offset, hdr.write_offset);
+			errno = EINVAL;
+			return -1;
+		}
+	} else if ((hdr.write_offset > hdr.end_offset) || (hdr.write_offset <
 			hdr.start_offset)) {
 		ERR("wrong write offset (start: %ju end: %ju write: %ju)",
 			hdr.start_offset, hdr.end_offset, hdr.write_offset);
@@ -106,8 +123,9 @@ pmemlog_descr_check(PMEMlogpool *plp, size_t poolsize)
 		return -1;
 	}
 
-	LOG(3, "start: %ju, end: %ju, write: %ju",
-		hdr.start_offset, hdr.end_offset, hdr.write_offset);
+	LOG(3, "start: %ju, end: %ju, write: %ju, circular %d",
+		hdr.start_offset, hdr.end_offset, hdr.write_offset,
+		plp->circular);
 
 	return 0;
 }
@@ -124,7 +142,7 @@ pmemlog_runtime_init(PMEMlogpool *plp, int rdonly, int is_pmem)
 	VALGRIND_REMOVE_PMEM_MAPPING(&plp->addr,
 		sizeof(struct pmemlog) -
 		sizeof(struct pool_hdr) -
-		3 * sizeof(uint64_t));
+		LOG_DESCR_NFIELDS * sizeof(uint64_t));
 
 	/*
 	 * Use some of the memory pool area for run-time info.  This
@@ -145,6 +163,29 @@ pmemlog_runtime_init(PMEMlogpool *plp, int rdonly, int is_pmem)
 		return -1;
 	}
 
+	struct log_commit *cp;
+	if ((cp = Malloc(sizeof(*cp))) == NULL) {
+		ERR("!Malloc for group commit state");
+		pthread_rwlock_destroy(plp->rwlockp);
+		Free((void *)plp->rwlockp);
+		return -1;
+	}
+
+	util_mutex_init(&cp->lock, NULL);
+	util_cond_init(&cp->cond, NULL);
+	cp->reserved = le64toh(plp->write_offset);
+	cp->copied = cp->reserved;
+	cp->persisted = cp->reserved;
+	cp->nrewinds = 0;
+	cp->leader = 0;
+
+#ifdef DEBUG
+	/* initialize debug lock */
+	util_mutex_init(&cp->write_lock, NULL);
+#endif
+
+	plp->commitp = cp;
+
 	/*
 	 * If possible, turn off all permissions on the pool header page.
 	 *
@@ -161,18 +202,23 @@ pmemlog_runtime_init(PMEMlogpool *plp, int rdonly, int is_pmem)
 }
 
 /*
- * pmemlog_create -- create a log memory pool
+ * pmemlog_create_common -- (internal) create a log memory pool
+ *
+ * The incompat argument holds the optional format features (if any)
+ * the new pool is created with.
  */
-PMEMlogpool *
-pmemlog_create(const char *path, size_t poolsize, mode_t mode)
+static PMEMlogpool *
+pmemlog_create_common(const char *path, size_t poolsize, mode_t mode,
+	uint32_t incompat)
 {
-	LOG(3, "path %s poolsize %zu mode %d", path, poolsize, mode);
+	LOG(3, "path %s poolsize %zu mode %d incompat %#x", path, poolsize,
+		mode, incompat);
 
 	struct pool_set *set;
 
 	if (util_pool_create(&set, path, poolsize, PMEMLOG_MIN_POOL,
 			LOG_HDR_SIG, LOG_FORMAT_MAJOR,
-			LOG_FORMAT_COMPAT, LOG_FORMAT_INCOMPAT,
+			LOG_FORMAT_COMPAT, LOG_FORMAT_INCOMPAT | incompat,
 			LOG_FORMAT_RO_COMPAT) != 0) {
 		LOG(2, "cannot create pool or pool set");
 		return NULL;
@@ -189,6 +235,7 @@ pmemlog_create(const char *path, size_t poolsize, mode_t mode)
 
 	plp->addr = plp;
 	plp->size = rep->repsize;
+	plp->circular = (incompat & LOG_FORMAT_INCOMPAT_CIRCULAR) != 0;
 
 	if (set->nreplicas > 1) {
 		errno = ENOTSUP;
@@ -226,6 +273,29 @@ err:
 	return NULL;
 }
 
+/*
+ * pmemlog_create -- create a log memory pool
+ */
+PMEMlogpool *
+pmemlog_create(const char *path, size_t poolsize, mode_t mode)
+{
+	LOG(3, "path %s poolsize %zu mode %d", path, poolsize, mode);
+
+	return pmemlog_create_common(path, poolsize, mode, 0);
+}
+
+/*
+ * pmemlog_create_circular -- create a circular log memory pool
+ */
+PMEMlogpool *
+pmemlog_create_circular(const char *path, size_t poolsize, mode_t mode)
+{
+	LOG(3, "path %s poolsize %zu mode %d", path, poolsize, mode);
+
+	return pmemlog_create_common(path, poolsize, mode,
+			LOG_FORMAT_INCOMPAT_CIRCULAR);
+}
+
 /*
  * pmemlog_open_common -- (internal) open a log memory pool
  *
@@ -241,7 +311,7 @@ pmemlog_open_common(const char *path, int cow)
 
 	if (util_pool_open(&set, path, cow, PMEMLOG_MIN_POOL,
 			LOG_HDR_SIG, LOG_FORMAT_MAJOR,
-			LOG_FORMAT_COMPAT, LOG_FORMAT_INCOMPAT,
+			LOG_FORMAT_COMPAT, LOG_FORMAT_INCOMPAT_SUPPORTED,
 			LOG_FORMAT_RO_COMPAT) != 0) {
 		LOG(2, "cannot open pool or pool set");
 		return NULL;
@@ -258,6 +328,8 @@ pmemlog_open_common(const char *path, int cow)
 
 	plp->addr = plp;
 	plp->size = rep->repsize;
+	plp->circular = (le32toh(plp->hdr.incompat_features) &
+			LOG_FORMAT_INCOMPAT_CIRCULAR) != 0;
 
 	if (set->nreplicas > 1) {
 		errno = ENOTSUP;
@@ -315,6 +387,14 @@ pmemlog_close(PMEMlogpool *plp)
 		ERR("!pthread_rwlock_destroy");
 	Free((void *)plp->rwlockp);
 
+#ifdef DEBUG
+	/* destroy debug lock */
+	util_mutex_destroy(&plp->commitp->write_lock);
+#endif
+	util_cond_destroy(&plp->commitp->cond);
+	util_mutex_destroy(&plp->commitp->lock);
+	Free(plp->commitp);
+
 	VALGRIND_REMOVE_PMEM_MAPPING(plp->addr, plp->size);
 	util_unmap(plp->addr, plp->size);
 }
@@ -341,32 +421,97 @@ pmemlog_nbyte(PMEMlogpool *plp)
 }
 
 /*
- * pmemlog_persist -- (internal) persist data, then metadata
+ * log_head -- (internal) return the offset of the oldest data in the log
+ */
+static inline uint64_t
+log_head(PMEMlogpool *plp)
+{
+	return plp->circular ?
+			le64toh(*(uint64_t volatile *)&plp->head_offset) :
+			le64toh(plp->start_offset);
+}
+
+/*
+ * log_tail -- (internal) return the persisted write offset without locking
  *
- * On entry, the write lock should be held.
+ * All the data up to the returned offset is visible to the caller.
  */
-static void
-pmemlog_persist(PMEMlogpool *plp, uint64_t new_write_offset)
+static inline uint64_t
+log_tail(PMEMlogpool *plp)
 {
-	uint64_t old_write_offset = le64toh(plp->write_offset);
-	size_t length = new_write_offset - old_write_offset;
+	uint64_t write_offset =
+		le64toh(*(uint64_t volatile *)&plp->write_offset);
 
-	/* unprotect the log space range (debug version only) */
-	RANGE_RW((char *)plp->addr + old_write_offset, length);
+	/* pairs with the barrier in pmemlog_persist() */
+	__sync_synchronize();
 
-	/* persist the data */
-	if (plp->is_pmem)
-		pmem_drain(); /* data already flushed */
-	else
-		pmem_msync((char *)plp->addr + old_write_offset, length);
+	return write_offset;
+}
+
+/*
+ * log_data -- (internal) translate a log offset to an address in the pool
+ *
+ * The offsets of a circular log grow without bounds and the data area is
+ * reused modulo its size.  On entry, *lenp holds the length of the range
+ * at the given offset; on return it is trimmed to the part of the range
+ * that is contiguous in memory.
+ */
+static char *
+log_data(PMEMlogpool *plp, uint64_t off, uint64_t *lenp)
+{
+	uint64_t start_offset = le64toh(plp->start_offset);
+	uint64_t end_offset = le64toh(plp->end_offset);
 
-	/* protect the log space range (debug version only) */
-	RANGE_RO((char *)plp->addr + old_write_offset, length);
+	if (plp->circular)
+		off = start_offset + (off - start_offset) %
+				(end_offset - start_offset);
+
+	ASSERT(off <= end_offset);
+	*lenp = MIN(*lenp, end_offset - off);
+
+	return (char *)plp->addr + off;
+}
+
+/*
+ * log_stale -- (internal) check if the data at a given offset could have
+ *	been overwritten since a lock-free reader found it valid
+ *
+ * In a circular log the space is reused as soon as an appender reserves
+ * the same location one lap later, while a linear log has to be rewound.
+ */
+static int
+log_stale(PMEMlogpool *plp, uint64_t off, uint64_t nrewinds)
+{
+	struct log_commit *cp = plp->commitp;
+
+	/* the data must be read before the checks below */
+	__sync_synchronize();
+
+	if (plp->circular)
+		return cp->reserved > off + le64toh(plp->end_offset) -
+				le64toh(plp->start_offset);
+
+	return cp->nrewinds != nrewinds;
+}
+
+/*
+ * pmemlog_persist -- (internal) persist the metadata
+ *
+ * On entry, all the data up to new_write_offset must already be persistent
+ * and the caller must be the group commit leader.
+ */
+static void
+pmemlog_persist(PMEMlogpool *plp, uint64_t new_write_offset)
+{
+	LOG(4, "plp %p new write offset %ju", plp, new_write_offset);
 
 	/* unprotect the pool descriptor (debug version only) */
 	RANGE_RW((char *)plp->addr + sizeof(struct pool_hdr),
 			LOG_FORMAT_DATA_ALIGN);
 
+	/* make the data visible to lock-free readers first, see log_tail() */
+	__sync_synchronize();
+
 	/* write the metadata */
 	plp->write_offset = htole64(new_write_offset);
 
@@ -382,85 +527,224 @@ pmemlog_persist(PMEMlogpool *plp, uint64_t new_write_offset)
 }
 
 /*
- * pmemlog_append -- add data to a log memory pool
+ * log_reserve -- (internal) reserve space for new data in the log
+ *
+ * The space is handed out by atomically advancing the reserved offset,
+ * so concurrent appenders get disjoint ranges without taking any lock.
+ * The head of a circular log can't move meanwhile, since trimming the
+ * log requires the RW lock held in write mode.
+ *
+ * If the range must be contiguous and it would wrap around the end of
+ * the data area of a circular log, the rest of the data area is reserved
+ * as well and its size is returned in *padp.
+ *
+ * Returns 0 and the offset of the reserved range in *offp on success,
+ * otherwise -1/ENOSPC.
  */
-int
-pmemlog_append(PMEMlogpool *plp, const void *buf, size_t count)
+static int
+log_reserve(PMEMlogpool *plp, uint64_t count, int contig, uint64_t *offp,
+	uint64_t *padp)
 {
-	int ret = 0;
+	struct log_commit *cp = plp->commitp;
+	uint64_t end_offset = le64toh(plp->end_offset);
+	if (plp->circular)
+		end_offset = log_head(plp) + end_offset -
+				le64toh(plp->start_offset);
+	uint64_t off;
+	uint64_t pad;
+
+	do {
+		off = cp->reserved;
+		pad = 0;
+
+		if (contig && plp->circular) {
+			uint64_t len = count;
+			log_data(plp, off, &len);
+			if (len < count)
+				pad = len;
+		}
 
-	LOG(3, "plp %p buf %p count %zu", plp, buf, count);
+		/* make sure we don't write past the available space */
+		if (off >= end_offset || pad + count > end_offset - off) {
+			errno = ENOSPC;
+			return -1;
+		}
+	} while (!__sync_bool_compare_and_swap(&cp->reserved,
+			off, off + pad + count));
 
-	if (plp->rdonly) {
-		ERR("can't append to read-only log");
-		errno = EROFS;
-		return -1;
-	}
+	*offp = off;
+	*padp = pad;
+	return 0;
+}
 
-	if ((errno = pthread_rwlock_wrlock(plp->rwlockp))) {
-		ERR("!pthread_rwlock_wrlock");
-		return -1;
-	}
+/*
+ * log_copy -- (internal) copy the data to a reserved range of the log
+ *
+ * The data is flushed (but not drained) in case of pmem.
+ */
+static void
+log_copy(PMEMlogpool *plp, uint64_t off, const void *buf, size_t count)
+{
+	const char *src = buf;
 
-	/* get the current values */
-	uint64_t end_offset = le64toh(plp->end_offset);
-	uint64_t write_offset = le64toh(plp->write_offset);
+#ifdef DEBUG
+	/* grab debug write lock */
+	util_mutex_lock(&plp->commitp->write_lock);
+#endif
 
-	if (write_offset >= end_offset) {
-		/* no space left */
-		errno = ENOSPC;
-		ERR("!pmemlog_append");
-		ret = -1;
-		goto end;
+	while (count) {
+		uint64_t len = count;
+		char *dest = log_data(plp, off, &len);
+
+		/*
+		 * unprotect the log space range, where the new data will be
+		 * stored (debug version only)
+		 */
+		RANGE_RW(dest, len);
+
+		if (plp->is_pmem)
+			pmem_memcpy_nodrain(dest, src, len);
+		else
+			memcpy(dest, src, len);
+
+		/* protect the log space range (debug version only) */
+		RANGE_RO(dest, len);
+
+		src += len;
+		off += len;
+		count -= len;
 	}
 
-	/* make sure we don't write past the available space */
-	if (count > (end_offset - write_offset)) {
-		errno = ENOSPC;
-		ERR("!pmemlog_append");
-		ret = -1;
-		goto end;
+#ifdef DEBUG
+	/* release debug write lock */
+	util_mutex_unlock(&plp->commitp->write_lock);
+#endif
+}
+
+/*
+ * log_msync -- (internal) flush a range of the log to a non-pmem device
+ */
+static void
+log_msync(PMEMlogpool *plp, uint64_t off, uint64_t count)
+{
+	while (count) {
+		uint64_t len = count;
+		char *addr = log_data(plp, off, &len);
+
+		pmem_msync(addr, len);
+
+		off += len;
+		count -= len;
 	}
+}
 
-	char *data = plp->addr;
+/*
+ * log_commit -- (internal) make the copied data a part of the log
+ *
+ * Appenders leave this routine in the order they reserved their space in,
+ * so write_offset never covers a range whose data is still being copied.
+ * Whoever finds no persist in progress becomes the leader and persists
+ * write_offset on behalf of every appender that has copied its data by
+ * then.  The others wait until their range is covered.
+ *
+ * On entry, the data in the [off, end) range must already be persistent.
+ */
+static void
+log_commit(PMEMlogpool *plp, uint64_t off, uint64_t end)
+{
+	struct log_commit *cp = plp->commitp;
 
-	/*
-	 * unprotect the log space range, where the new data will be stored
-	 * (debug version only)
-	 */
-	RANGE_RW(&data[write_offset], count);
+	util_mutex_lock(&cp->lock);
 
-	if (plp->is_pmem)
-		pmem_memcpy_nodrain(&data[write_offset], buf, count);
-	else
-		memcpy(&data[write_offset], buf, count);
+	/* wait for the preceding appenders to finish copying */
+	while (cp->copied != off)
+		util_cond_wait(&cp->cond, &cp->lock);
 
-	/* protect the log space range (debug version only) */
-	RANGE_RO(&data[write_offset], count);
+	cp->copied = end;
+	util_cond_broadcast(&cp->cond);
 
-	write_offset += count;
+	while (cp->persisted < end) {
+		if (cp->leader) {
+			util_cond_wait(&cp->cond, &cp->lock);
+			continue;
+		}
 
-	/* persist the data and the metadata */
-	pmemlog_persist(plp, write_offset);
+		cp->leader = 1;
+		uint64_t new_write_offset = cp->copied;
+		util_mutex_unlock(&cp->lock);
 
-end:
-	util_rwlock_unlock(plp->rwlockp);
+		pmemlog_persist(plp, new_write_offset);
 
-	return ret;
+		util_mutex_lock(&cp->lock);
+		cp->persisted = new_write_offset;
+		cp->leader = 0;
+		util_cond_broadcast(&cp->cond);
+	}
+
+	util_mutex_unlock(&cp->lock);
 }
 
 /*
- * pmemlog_appendv -- add gathered data to a log memory pool
+ * log_record_checksum -- (internal) calculate the checksum of a record
+ *
+ * The result is the same as the one util_checksum() calculates for the
+ * record header followed by the payload padded with zeros, but the record
+ * doesn't have to be assembled in a single buffer first.
  */
-int
-pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
+static uint64_t
+log_record_checksum(uint64_t size_le, const void *buf, size_t count)
 {
-	LOG(3, "plp %p iovec %p iovcnt %d", plp, iov, iovcnt);
+	uint32_t lo32 = 0;
+	uint32_t hi32 = 0;
+	uint32_t w32[2];
+
+	/* the size field */
+	memcpy(w32, &size_le, sizeof(w32));
+	lo32 += le32toh(w32[0]);
+	hi32 += lo32;
+	lo32 += le32toh(w32[1]);
+	hi32 += lo32;
+
+	/* the checksum field is treated as zero */
+	hi32 += lo32;
+	hi32 += lo32;
+
+	/* the payload, with the last word padded with zeros if needed */
+	const char *p = buf;
+	size_t left = count;
+	while (left) {
+		size_t len = MIN(left, sizeof(w32[0]));
+		w32[0] = 0;
+		memcpy(&w32[0], p, len);
+		lo32 += le32toh(w32[0]);
+		hi32 += lo32;
+		p += len;
+		left -= len;
+	}
 
-	int ret = 0; // success
-	int i;
+	/* the padding words */
+	size_t npad = (roundup(count, LOG_RECORD_ALIGN) -
+			roundup(count, sizeof(w32[0]))) / sizeof(w32[0]);
+	while (npad--)
+		hi32 += lo32;
 
-	ASSERT(iovcnt > 0);
+	return htole64((uint64_t)hi32 << 32 | lo32);
+}
+
+/*
+ * log_append -- (internal) add gathered data to a log memory pool
+ *
+ * Appenders hold the RW lock in read mode, so they only exclude
+ * pmemlog_rewind() and pmemlog_trim() and not each other.
+ *
+ * If the data is a record, it is never split at the end of the data area
+ * of a circular log; the rest of the data area is skipped instead.
+ */
+static int
+log_append(PMEMlogpool *plp, const struct iovec *iov, int iovcnt,
+	int record)
+{
+	int ret = 0;
 
 	if (plp->rdonly) {
 		ERR("can't append to read-only log");
@@ -468,64 +752,47 @@ pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
 		return -1;
 	}
 
-	if ((errno = pthread_rwlock_wrlock(plp->rwlockp))) {
-		ERR("!pthread_rwlock_wrlock");
+	if ((errno = pthread_rwlock_rdlock(plp->rwlockp))) {
+		ERR("!pthread_rwlock_rdlock");
 		return -1;
 	}
 
-	/* get the current values */
-	uint64_t end_offset = le64toh(plp->end_offset);
-	uint64_t write_offset = le64toh(plp->write_offset);
-
-	if (write_offset >= end_offset) {
-		/* no space left */
-		errno = ENOSPC;
-		ERR("!pmemlog_appendv");
-		ret = -1;
-		goto end;
-	}
-
-	char *data = plp->addr;
-	uint64_t count = 0;
-	char *buf;
-
 	/* calculate required space */
-	for (i = 0; i < iovcnt; ++i)
+	uint64_t count = 0;
+	for (int i = 0; i < iovcnt; ++i)
 		count += iov[i].iov_len;
 
-	/* check if there is enough free space */
-	if (count > (end_offset - write_offset)) {
-		errno = ENOSPC;
+	uint64_t write_offset;
+	uint64_t pad;
+	if (log_reserve(plp, count, record, &write_offset, &pad)) {
+		ERR("!log_append");
 		ret = -1;
 		goto end;
 	}
 
-	/* append the data */
-	for (i = 0; i < iovcnt; ++i) {
-		buf = iov[i].iov_base;
-		count = iov[i].iov_len;
-
-		/*
-		 * unprotect the log space range, where the new data will be
-		 * stored (debug version only)
-		 */
-		RANGE_RW(&data[write_offset], count);
-
-		if (plp->is_pmem)
-			pmem_memcpy_nodrain(&data[write_offset], buf, count);
-		else
-			memcpy(&data[write_offset], buf, count);
-
-		/*
-		 * protect the log space range (debug version only)
-		 */
-		RANGE_RO(&data[write_offset], count);
+	/* mark the skipped space, if there is room for a record header */
+	if (pad >= sizeof(struct log_record)) {
+		struct log_record wrap;
+		wrap.size = htole64(LOG_RECORD_WRAP);
+		wrap.checksum = log_record_checksum(wrap.size, NULL, 0);
+		log_copy(plp, write_offset, &wrap, sizeof(wrap));
+	}
 
-		write_offset += count;
+	/* append the data */
+	uint64_t off = write_offset + pad;
+	for (int i = 0; i < iovcnt; ++i) {
+		log_copy(plp, off, iov[i].iov_base, iov[i].iov_len);
+		off += iov[i].iov_len;
 	}
 
-	/* persist the data and the metadata */
-	pmemlog_persist(plp, write_offset);
+	/* persist the data */
+	if (plp->is_pmem)
+		pmem_drain(); /* data already flushed */
+	else
+		log_msync(plp, write_offset, pad + count);
+
+	/* persist the metadata, possibly together with other appenders */
+	log_commit(plp, write_offset, off);
 
 end:
 	util_rwlock_unlock(plp->rwlockp);
@@ -533,6 +800,35 @@ end:
 	return ret;
 }
 
+/*
+ * pmemlog_append -- add data to a log memory pool
+ */
+int
+pmemlog_append(PMEMlogpool *plp, const void *buf, size_t count)
+{
+	LOG(3, "plp %p buf %p count %zu", plp, buf, count);
+
+	struct iovec iov = {
+		.iov_base = (void *)buf,
+		.iov_len = count,
+	};
+
+	return log_append(plp, &iov, 1, 0);
+}
+
+/*
+ * pmemlog_appendv -- add gathered data to a log memory pool
+ */
+int
+pmemlog_appendv(PMEMlogpool *plp, const struct iovec *iov, int iovcnt)
+{
+	LOG(3, "plp %p iovec %p iovcnt %d", plp, iov, iovcnt);
+
+	ASSERT(iovcnt > 0);
+
+	return log_append(plp, iov, iovcnt, 0);
+}
+
 /*
  * pmemlog_tell -- return current write point in a log memory pool
  */
@@ -557,8 +853,104 @@ pmemlog_tell(PMEMlogpool *plp)
 	return wp;
 }
 
+/*
+ * pmemlog_head -- return the offset of the oldest data in a log memory pool
+ */
+long long
+pmemlog_head(PMEMlogpool *plp)
+{
+	LOG(3, "plp %p", plp);
+
+	if ((errno = pthread_rwlock_rdlock(plp->rwlockp))) {
+		ERR("!pthread_rwlock_rdlock");
+		return (off_t)-1;
+	}
+
+	long long head = (long long)(log_head(plp) -
+			le64toh(plp->start_offset));
+
+	LOG(4, "head offset %lld", head);
+
+	util_rwlock_unlock(plp->rwlockp);
+
+	return head;
+}
+
+/*
+ * log_set_head -- (internal) persist a new head offset of a circular log
+ *
+ * The caller must hold the RW lock in write mode.
+ */
+static void
+log_set_head(PMEMlogpool *plp, uint64_t head_offset)
+{
+	/* unprotect the pool descriptor (debug version only) */
+	RANGE_RW((char *)plp->addr + sizeof(struct pool_hdr),
+			LOG_FORMAT_DATA_ALIGN);
+
+	plp->head_offset = htole64(head_offset);
+	if (plp->is_pmem)
+		pmem_persist(&plp->head_offset, sizeof(uint64_t));
+	else
+		pmem_msync(&plp->head_offset, sizeof(uint64_t));
+
+	/* set the write-protection again (debug version only) */
+	RANGE_RO((char *)plp->addr + sizeof(struct pool_hdr),
+			LOG_FORMAT_DATA_ALIGN);
+}
+
+/*
+ * pmemlog_trim -- discard the data preceding a given offset
+ *
+ * Only a circular log can be trimmed, as that's the only kind of log
+ * which can reuse the space.  Trimming up to an offset which has already
+ * been discarded is not an error, so the call may be safely repeated.
+ */
+int
+pmemlog_trim(PMEMlogpool *plp, long long upto)
+{
+	LOG(3, "plp %p upto %lld", plp, upto);
+
+	if (plp->rdonly) {
+		ERR("can't trim read-only log");
+		errno = EROFS;
+		return -1;
+	}
+
+	if (!plp->circular) {
+		ERR("can't trim a log which isn't circular");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if ((errno = pthread_rwlock_wrlock(plp->rwlockp))) {
+		ERR("!pthread_rwlock_wrlock");
+		return -1;
+	}
+
+	int ret = 0;
+	uint64_t start_offset = le64toh(plp->start_offset);
+	uint64_t write_offset = le64toh(plp->write_offset);
+
+	if (upto < 0 || (uint64_t)upto > write_offset - start_offset) {
+		ERR("trim offset %lld past the end of the log", upto);
+		errno = EINVAL;
+		ret = -1;
+	} else if (start_offset + (uint64_t)upto > log_head(plp)) {
+		log_set_head(plp, start_offset + (uint64_t)upto);
+	}
+
+	util_rwlock_unlock(plp->rwlockp);
+
+	return ret;
+}
+
 /*
  * pmemlog_rewind -- discard all data, resetting a log memory pool to empty
+ *
+ * A circular log is trimmed up to the write point instead of moving both
+ * its head and write offsets back to the start, which couldn't be done
+ * atomically.
  */
 void
 pmemlog_rewind(PMEMlogpool *plp)
@@ -576,6 +968,15 @@ pmemlog_rewind(PMEMlogpool *plp)
 		return;
 	}
 
+	if (plp->circular) {
+		log_set_head(plp, le64toh(plp->write_offset));
+		util_rwlock_unlock(plp->rwlockp);
+		return;
+	}
+
+	/* lock-free readers have to notice the data is gone, see log_stale() */
+	__sync_fetch_and_add(&plp->commitp->nrewinds, 1);
+
 	/* unprotect the pool descriptor (debug version only) */
 	RANGE_RW((char *)plp->addr + sizeof(struct pool_hdr),
 			LOG_FORMAT_DATA_ALIGN);
@@ -590,6 +991,15 @@ pmemlog_rewind(PMEMlogpool *plp)
 	RANGE_RO((char *)plp->addr + sizeof(struct pool_hdr),
 			LOG_FORMAT_DATA_ALIGN);
 
+	/* no appenders are around, as the write lock is held */
+	struct log_commit *cp = plp->commitp;
+	util_mutex_lock(&cp->lock);
+	cp->reserved = le64toh(plp->start_offset);
+	cp->copied = cp->reserved;
+	cp->persisted = cp->reserved;
+	util_cond_broadcast(&cp->cond);
+	util_mutex_unlock(&cp->lock);
+
 	util_rwlock_unlock(plp->rwlockp);
 }
 
@@ -597,7 +1007,8 @@ pmemlog_rewind(PMEMlogpool *plp)
  * pmemlog_walk -- walk through all data in a log memory pool
  *
  * chunksize of 0 means process_chunk gets called once for all data
- * as a single chunk.
+ * as a single chunk.  In a circular log, the data (or a chunk) wrapping
+ * around the end of the data area is passed in two calls.
  */
 void
 pmemlog_walk(PMEMlogpool *plp, size_t chunksize,
@@ -608,39 +1019,337 @@ pmemlog_walk(PMEMlogpool *plp, size_t chunksize,
 	/*
 	 * We are assuming that the walker doesn't change the data it's reading
 	 * in place. We prevent everyone from changing the data behind our back
-	 * until we are done with processing it.
+	 * until we are done with processing it.  Concurrent appenders are fine,
+	 * as they only write past the current write offset.
 	 */
 	if ((errno = pthread_rwlock_rdlock(plp->rwlockp))) {
 		ERR("!pthread_rwlock_rdlock");
 		return;
 	}
 
-	char *data = plp->addr;
 	uint64_t write_offset = le64toh(plp->write_offset);
-	uint64_t data_offset = le64toh(plp->start_offset);
-	size_t len;
+	uint64_t data_offset = log_head(plp);
 
 	if (chunksize == 0) {
 		/* most common case: process everything at once */
-		len = write_offset - data_offset;
-		LOG(3, "length %zu", len);
-		(*process_chunk)(&data[data_offset], len, arg);
-	} else {
-		/*
-		 * Walk through the complete record, chunk by chunk.
-		 * The callback returns 0 to terminate the walk.
-		 */
-		while (data_offset < write_offset) {
-			len = MIN(chunksize, write_offset - data_offset);
-			if (!(*process_chunk)(&data[data_offset], len, arg))
-				break;
-			data_offset += chunksize;
+		LOG(3, "length %ju", write_offset - data_offset);
+		chunksize = write_offset - data_offset;
+		if (chunksize == 0) {
+			uint64_t len = 0;
+			(*process_chunk)(log_data(plp, data_offset, &len),
+					0, arg);
 		}
 	}
 
+	/*
+	 * Walk through the complete record, chunk by chunk.
+	 * The callback returns 0 to terminate the walk.
+	 */
+	int cont = 1;
+	while (cont && data_offset < write_offset) {
+		uint64_t chunk = MIN(chunksize, write_offset - data_offset);
+		do {
+			uint64_t len = chunk;
+			char *buf = log_data(plp, data_offset, &len);
+			cont = (*process_chunk)(buf, len, arg);
+			data_offset += len;
+			chunk -= len;
+		} while (cont && chunk);
+	}
+
 	util_rwlock_unlock(plp->rwlockp);
 }
 
+/*
+ * pmemlog_read -- process the persistent data following a given offset
+ *
+ * Unlike pmemlog_walk(), no lock is held while the data is processed, so
+ * a reader can follow the tail of the log without blocking anyone.  The
+ * data is processed up to the write point found on entry and *offp is
+ * advanced past every chunk passed to process_chunk, which returns 0 to
+ * stop early.  Since the data isn't protected from being overwritten,
+ * it is verified after each chunk it hasn't been discarded by a concurrent
+ * pmemlog_trim() or pmemlog_rewind() -- if it has been, the chunk must be
+ * thrown away.
+ *
+ * Returns 0 on success, otherwise -1/errno (ESTALE if the last chunk is
+ * not valid anymore).
+ */
+int
+pmemlog_read(PMEMlogpool *plp, long long *offp,
+	int (*process_chunk)(const void *buf, size_t len, void *arg), void *arg)
+{
+	LOG(3, "plp %p offset %lld", plp, *offp);
+
+	uint64_t nrewinds = plp->commitp->nrewinds;
+	uint64_t write_offset = log_tail(plp);
+	uint64_t start_offset = le64toh(plp->start_offset);
+
+	if (*offp < 0 || (uint64_t)*offp > write_offset - start_offset) {
+		ERR("offset %lld past the end of the log", *offp);
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint64_t off = start_offset + (uint64_t)*offp;
+
+	if (off < log_head(plp)) {
+		ERR("offset %lld already trimmed", *offp);
+		errno = EINVAL;
+		return -1;
+	}
+
+	while (off < write_offset) {
+		uint64_t len = write_offset - off;
+		const char *buf = log_data(plp, off, &len);
+
+		int cont = (*process_chunk)(buf, len, arg);
+
+		if (log_stale(plp, off, nrewinds)) {
+			ERR("data at offset %lld discarded while being read",
+				*offp);
+			errno = ESTALE;
+			return -1;
+		}
+
+		off += len;
+		*offp = (long long)(off - start_offset);
+
+		if (!cont)
+			break;
+	}
+
+	return 0;
+}
+
+/*
+ * pmemlog_wait -- wait for data to be appended past a given offset
+ *
+ * The timeout is given in milliseconds; 0 means just checking and
+ * a negative value waiting for as long as it takes.  The group commit
+ * leader wakes up the waiters after it persists write_offset, which it
+ * does before taking the lock, so no wakeup can be missed.
+ *
+ * Returns 1 if there is new data, 0 on timeout, otherwise -1/errno
+ * (ESTALE if the log is rewound meanwhile).
+ */
+int
+pmemlog_wait(PMEMlogpool *plp, long long off, int timeout)
+{
+	LOG(3, "plp %p offset %lld timeout %d", plp, off, timeout);
+
+	struct log_commit *cp = plp->commitp;
+	uint64_t start_offset = le64toh(plp->start_offset);
+	struct timespec abstime;
+
+	if (timeout > 0) {
+		clock_gettime(CLOCK_REALTIME, &abstime);
+		abstime.tv_sec += timeout / 1000;
+		abstime.tv_nsec += (timeout % 1000) * 1000000;
+		if (abstime.tv_nsec >= 1000000000) {
+			abstime.tv_sec++;
+			abstime.tv_nsec -= 1000000000;
+		}
+	}
+
+	int ret = -1;
+
+	util_mutex_lock(&cp->lock);
+
+	uint64_t nrewinds = cp->nrewinds;
+
+	if (off < 0 || (uint64_t)off > log_tail(plp) - start_offset) {
+		ERR("offset %lld past the end of the log", off);
+		errno = EINVAL;
+		goto end;
+	}
+
+	while (log_tail(plp) - start_offset == (uint64_t)off &&
+			cp->nrewinds == nrewinds && timeout != 0) {
+		if (timeout < 0) {
+			util_cond_wait(&cp->cond, &cp->lock);
+			continue;
+		}
+
+		int err = pthread_cond_timedwait(&cp->cond, &cp->lock,
+				&abstime);
+		if (err == ETIMEDOUT)
+			break;
+		if (err) {
+			errno = err;
+			FATAL("!pthread_cond_timedwait");
+		}
+	}
+
+	if (cp->nrewinds != nrewinds) {
+		ERR("log rewound while waiting");
+		errno = ESTALE;
+		goto end;
+	}
+
+	ret = log_tail(plp) - start_offset > (uint64_t)off;
+
+end:
+	util_mutex_unlock(&cp->lock);
+
+	return ret;
+}
+
+/*
+ * pmemlog_append_record -- add a length-prefixed, checksummed record
+ *
+ * The record is appended atomically, like with pmemlog_appendv(), and can
+ * be read back using pmemlog_record_next().
+ */
+int
+pmemlog_append_record(PMEMlogpool *plp, const void *buf, size_t count)
+{
+	LOG(3, "plp %p buf %p count %zu", plp, buf, count);
+
+	static const char zeros[LOG_RECORD_ALIGN];
+
+	struct log_record rec;
+	rec.size = htole64(count);
+	rec.checksum = log_record_checksum(rec.size, buf, count);
+
+	struct iovec iov[3];
+	int iovcnt = 0;
+
+	iov[iovcnt].iov_base = &rec;
+	iov[iovcnt++].iov_len = sizeof(rec);
+
+	if (count) {
+		iov[iovcnt].iov_base = (void *)buf;
+		iov[iovcnt++].iov_len = count;
+	}
+
+	size_t pad = roundup(count, LOG_RECORD_ALIGN) - count;
+	if (pad) {
+		iov[iovcnt].iov_base = (void *)zeros;
+		iov[iovcnt++].iov_len = pad;
+	}
+
+	return log_append(plp, iov, iovcnt, 1);
+}
+
+/*
+ * pmemlog_record_next -- return the record found at a given offset
+ *
+ * On entry, *offp holds the offset of a record, relative to the beginning
+ * of the log (zero for the first record).  On success, *bufp points to the
+ * payload of the record in the log (no copy is made), *lenp holds its size
+ * and *offp is advanced to the next record, so the walk can be resumed
+ * from any offset returned this way.
+ *
+ * No lock is taken, so iterating over the records doesn't block anyone.
+ * Like with pmemlog_read(), the record is verified not to have been
+ * discarded concurrently, but only until the call returns.
+ *
+ * Returns 1 if a record was found, 0 at the end of the log, otherwise
+ * -1/errno (EIO if the record is corrupted, ESTALE if it's discarded).
+ */
+int
+pmemlog_record_next(PMEMlogpool *plp, long long *offp,
+	const void **bufp, size_t *lenp)
+{
+	LOG(3, "plp %p offset %lld", plp, *offp);
+
+	if (*offp < 0 || (uint64_t)*offp % LOG_RECORD_ALIGN) {
+		ERR("invalid record offset %lld", *offp);
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint64_t nrewinds = plp->commitp->nrewinds;
+	uint64_t write_offset = log_tail(plp);
+	uint64_t start_offset = le64toh(plp->start_offset);
+	uint64_t off = start_offset + (uint64_t)*offp;
+
+	if (off > write_offset) {
+		ERR("record offset %lld past the end of the log", *offp);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (off < log_head(plp)) {
+		ERR("record offset %lld already trimmed", *offp);
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint64_t left = write_offset - off;
+
+	if (left == 0) {
+		/* no more records */
+		return 0;
+	}
+
+	int ret = -1;
+	uint64_t first = off;
+	uint64_t next = 0;
+
+	uint64_t len = left;
+	struct log_record *rec = (struct log_record *)log_data(plp, off, &len);
+
+	if (len < left && (len < sizeof(*rec) ||
+			le64toh(rec->size) == LOG_RECORD_WRAP)) {
+		/* the end of the data area was skipped, see log_append() */
+		if (len >= sizeof(*rec) &&
+				!util_checksum(rec, sizeof(*rec),
+				&rec->checksum, 0)) {
+			ERR("invalid checksum of record at offset %lld",
+				*offp);
+			errno = EIO;
+			goto end;
+		}
+
+		off += len;
+		left -= len;
+		len = left;
+		rec = (struct log_record *)log_data(plp, off, &len);
+	}
+
+	/* a record is never split, so it must fit in the contiguous part */
+	if (len < sizeof(*rec)) {
+		ERR("truncated record at offset %lld", *offp);
+		errno = EIO;
+		goto end;
+	}
+
+	uint64_t size = le64toh(rec->size);
+	if (size > len - sizeof(*rec) || LOG_RECORD_SIZE(size) > len) {
+		ERR("truncated record at offset %lld", *offp);
+		errno = EIO;
+		goto end;
+	}
+
+	uint64_t reclen = LOG_RECORD_SIZE(size);
+
+	if (!util_checksum(rec, reclen, &rec->checksum, 0)) {
+		ERR("invalid checksum of record at offset %lld", *offp);
+		errno = EIO;
+		goto end;
+	}
+
+	*bufp = rec->data;
+	*lenp = size;
+	next = off + reclen;
+	ret = 1;
+
+end:
+	/* the record could have been overwritten while being validated */
+	if (log_stale(plp, first, nrewinds)) {
+		ERR("record at offset %lld discarded while being read", *offp);
+		errno = ESTALE;
+		return -1;
+	}
+
+	if (ret == 1)
+		*offp = (long long)(next - start_offset);
+
+	return ret;
+}
+
 /*
  * pmemlog_check -- log memory pool consistency check
  *
@@ -683,7 +1392,25 @@ pmemlog_check(const char *path)
 		consistent = 0;
 	}
 
-	if (hdr_write > hdr_end) {
+	if (plp->circular) {
+		uint64_t hdr_head = le64toh(plp->head_offset);
+
+		if (hdr_start > hdr_head) {
+			ERR("start_offset greater than head_offset");
+			consistent = 0;
+		}
+
+		if (hdr_head > hdr_write) {
+			ERR("head_offset greater than write_offset");
+			consistent = 0;
+		}
+
+		if (hdr_write - hdr_head > hdr_end - hdr_start) {
+			ERR("more data between head_offset and write_offset "
+				"than the log can hold");
+			consistent = 0;
+		}
+	} else if (hdr_write > hdr_end) {
 		ERR("write_offset greater than end_offset");
 		consistent = 0;
 	}
@@ -705,6 +1432,7 @@ pmemlog_convert2h(struct pmemlog *plp)
 	plp->start_offset = le64toh(plp->start_offset);
 	plp->end_offset = le64toh(plp->end_offset);
 	plp->write_offset = le64toh(plp->write_offset);
+	plp->head_offset = le64toh(plp->head_offset);
 }
 
 /*
@@ -716,6 +1444,7 @@ pmemlog_convert2le(struct pmemlog *plp)
 	plp->start_offset = htole64(plp->start_offset);
 	plp->end_offset = htole64(plp->end_offset);
 	plp->write_offset = htole64(plp->write_offset);
+	plp->head_offset = htole64(plp->head_offset);
 }
 
 #ifdef _MSC_VER
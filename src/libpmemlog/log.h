@@ -47,8 +47,44 @@
 #define LOG_FORMAT_INCOMPAT 0x0000
 #define LOG_FORMAT_RO_COMPAT 0x0000
 
+/* incompat features, not set by default */
+#define LOG_FORMAT_INCOMPAT_CIRCULAR 0x0001	/* data area wraps around */
+
+/* all the incompat features understood by this version of the library */
+#define LOG_FORMAT_INCOMPAT_SUPPORTED LOG_FORMAT_INCOMPAT_CIRCULAR
+
 extern unsigned long long Pagesize;
 
+/*
+ * Run-time state of the append path.  It is allocated separately from the
+ * pool descriptor, since the volatile part of the descriptor is kept
+ * read-only in the debug version.
+ *
+ * Appenders reserve disjoint ranges of the log by advancing the reserved
+ * offset, copy their data in parallel and then advance the copied offset
+ * in reservation order.  A single leader at a time persists write_offset
+ * up to the copied offset on behalf of all of them (group commit).
+ *
+ * Lock-free readers use the reserved offset and the number of rewinds to
+ * detect the data they have read could have been overwritten meanwhile,
+ * and wait on the condition variable for write_offset to move.
+ */
+struct log_commit {
+	uint64_t volatile reserved;	/* end of space handed out */
+	uint64_t volatile nrewinds;	/* number of rewinds of a linear log */
+
+	pthread_mutex_t lock;		/* protects the fields below */
+	pthread_cond_t cond;		/* copied or persisted has moved */
+	uint64_t copied;		/* end of contiguous copied data */
+	uint64_t persisted;		/* last persisted write_offset */
+	int leader;			/* write_offset persist in progress */
+
+#ifdef DEBUG
+	/* held during mprotected sections of the data area */
+	pthread_mutex_t write_lock;
+#endif
+};
+
 struct pmemlog {
 	struct pool_hdr hdr;	/* memory pool header */
 
@@ -56,17 +92,47 @@ struct pmemlog {
 	uint64_t start_offset;	/* start offset of the usable log space */
 	uint64_t end_offset;	/* maximum offset of the usable log space */
 	uint64_t write_offset;	/* current write point for the log */
+	uint64_t head_offset;	/* oldest valid data (circular logs only) */
 
 	/* some run-time state, allocated out of memory pool... */
 	void *addr;			/* mapped region */
 	size_t size;			/* size of mapped region */
 	int is_pmem;			/* true if pool is PMEM */
 	int rdonly;			/* true if pool is opened read-only */
+	int circular;			/* true if data area wraps around */
 	pthread_rwlock_t *rwlockp;	/* pointer to RW lock */
+	struct log_commit *commitp;	/* group commit state */
 };
 
+/* number of the on-media fields of the descriptor following the pool_hdr */
+#define LOG_DESCR_NFIELDS 4
+
 /* data area starts at this alignment after the struct pmemlog above */
 #define LOG_FORMAT_DATA_ALIGN ((uintptr_t)4096)
 
+/*
+ * A record appended by pmemlog_append_record().  The payload is padded
+ * with zeros up to LOG_RECORD_ALIGN and the checksum covers the header
+ * and the padded payload (see util_checksum()).
+ */
+struct log_record {
+	uint64_t size;		/* size of the payload in bytes */
+	uint64_t checksum;	/* checksum of the whole record */
+	char data[];		/* payload */
+};
+
+#define LOG_RECORD_ALIGN ((uint64_t)8)
+
+/*
+ * In a circular log a record never wraps around the end of the data area.
+ * If it doesn't fit, the rest of the data area is skipped and filled with
+ * a record header carrying this size, if there is enough room for one.
+ */
+#define LOG_RECORD_WRAP UINT64_MAX
+
+/* total space taken in the log by a record with a payload of given size */
+#define LOG_RECORD_SIZE(size)\
+	(sizeof(struct log_record) + roundup((size), LOG_RECORD_ALIGN))
+
 void pmemlog_convert2h(struct pmemlog *plp);
 void pmemlog_convert2le(struct pmemlog *plp);
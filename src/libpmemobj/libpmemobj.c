@@ -115,6 +115,20 @@ pmemobj_set_funcs(
 	util_set_alloc_funcs(malloc_func, free_func, realloc_func, strdup_func);
 }
 
+/*
+ * pmemobj_set_prefault -- set the number of threads prefaulting the pools
+ *                         at open and the progress callback
+ */
+void
+pmemobj_set_prefault(unsigned nthreads,
+		void (*progress)(size_t done, size_t total, void *arg),
+		void *arg)
+{
+	LOG(3, "nthreads %u progress %p arg %p", nthreads, progress, arg);
+
+	util_set_prefault(nthreads, progress, arg);
+}
+
 /*
  * pmemobj_errormsg -- return last error message
  */
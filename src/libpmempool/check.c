@@ -205,6 +205,16 @@ check_fini(PMEMpoolcheck *ppc)
 {
 	LOG(3, NULL);
 
+	/* stop the workers before the pool is closed */
+	check_tasks_fini(ppc);
+
+	/* progress of the completed check is of no use anymore */
+	if (check_is_end(ppc->data) &&
+			(ppc->result == CHECK_RESULT_CONSISTENT ||
+			ppc->result == CHECK_RESULT_REPAIRED))
+		check_checkpoint_remove(ppc);
+	check_checkpoint_fini(ppc);
+
 	pool_data_free(ppc->pool);
 	check_data_free(ppc->data);
 }
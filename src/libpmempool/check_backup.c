@@ -58,7 +58,12 @@ check_backup(PMEMpoolcheck *ppc)
 		return;
 
 	CHECK_INFO(ppc, "creating backup file: %s", ppc->backup_path);
-	if (pool_copy(ppc->pool, ppc->backup_path)) {
+
+	/*
+	 * The metadata telling which regions hold data is what the repair
+	 * may be fixing, so it cannot be trusted to skip anything.
+	 */
+	if (pool_copy(ppc->pool, ppc->backup_path, ppc->nthreads, 0)) {
 		CHECK_ERR(ppc, "unable to create backup file");
 		ppc->result = CHECK_RESULT_ERROR;
 	}
@@ -34,7 +34,9 @@
  * check_btt_map_flog.c -- check BTT Map and Flog
  */
 
+#include <stdio.h>
 #include <stdint.h>
+#include <stdarg.h>
 #include <sys/param.h>
 
 #include "out.h"
@@ -56,6 +58,7 @@ union location {
 		struct list *list_inval;
 		struct list *list_flog_inval;
 		struct list *list_unmap;
+		struct arena_scan *scans;
 
 		unsigned step;
 	};
@@ -218,6 +221,154 @@ list_free(struct list *list)
 	free(list);
 }
 
+/*
+ * errors of scanning an arena
+ */
+enum scan_error {
+	SCAN_OK,
+	SCAN_ERR_FLOG_READ,
+	SCAN_ERR_MAP_READ,
+	SCAN_ERR_BITMAP,
+	SCAN_ERR_DUP_BITMAP,
+	SCAN_ERR_FBITMAP,
+	SCAN_ERR_LIST_INVAL,
+	SCAN_ERR_LIST_FLOG_INVAL,
+	SCAN_ERR_LIST_UNMAP,
+	SCAN_ERR_LIST_ITEM,
+};
+
+static const char *scan_error_str[] = {
+	[SCAN_ERR_FLOG_READ]	= "cannot read BTT Flog",
+	[SCAN_ERR_MAP_READ]	= "cannot read BTT Map",
+	[SCAN_ERR_BITMAP]	= "cannot allocate memory for blocks bitmap",
+	[SCAN_ERR_DUP_BITMAP]	= "cannot allocate memory for duplicated "
+		"blocks bitmap",
+	[SCAN_ERR_FBITMAP]	= "cannot allocate memory for BTT Flog bitmap",
+	[SCAN_ERR_LIST_INVAL]	= "cannot allocate memory for invalid BTT map "
+		"entries list",
+	[SCAN_ERR_LIST_FLOG_INVAL] = "cannot allocate memory for invalid BTT "
+		"Flog entries list",
+	[SCAN_ERR_LIST_UNMAP]	= "cannot allocate memory for unmaped blocks "
+		"list",
+	[SCAN_ERR_LIST_ITEM]	= "cannot allocate momory for list item",
+};
+
+/*
+ * arena_scan -- result of reading and checking map and flog of an arena
+ *
+ * Arenas are scanned by the check_tasks workers, so the info statuses cannot
+ * be created directly. They are buffered and replayed by the check thread in
+ * the order they were generated.
+ */
+struct arena_scan {
+	struct arena *arenap;
+	uint8_t *bitmap;
+	uint8_t *dup_bitmap;
+	uint8_t *fbitmap;
+	struct list *list_inval;
+	struct list *list_flog_inval;
+	struct list *list_unmap;
+
+	char *msgs;		/* buffered info messages, '\0' separated */
+	size_t msgs_len;
+	size_t msgs_size;
+	int errnum;		/* errno of the failed operation */
+};
+
+/* initial size of the buffered info messages */
+#define SCAN_MSGS_SIZE 4096
+
+/*
+ * scan_info -- (internal) buffer info status generated while scanning
+ */
+static int
+scan_info(PMEMpoolcheck *ppc, struct arena_scan *scan, const char *fmt, ...)
+{
+	if (CHECK_IS_NOT(ppc, VERBOSE))
+		return 0;
+
+	va_list ap;
+	va_start(ap, fmt);
+	int len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (len < 0)
+		return -1;
+
+	size_t need = scan->msgs_len + (size_t)len + 1;
+	if (need > scan->msgs_size) {
+		size_t size = scan->msgs_size ? scan->msgs_size :
+			SCAN_MSGS_SIZE;
+		while (size < need)
+			size *= 2;
+
+		char *msgs = realloc(scan->msgs, size);
+		if (!msgs) {
+			ERR("!realloc");
+			return -1;
+		}
+		scan->msgs = msgs;
+		scan->msgs_size = size;
+	}
+
+	va_start(ap, fmt);
+	vsnprintf(scan->msgs + scan->msgs_len, (size_t)len + 1, fmt, ap);
+	va_end(ap);
+	scan->msgs_len = need;
+
+	return 0;
+}
+
+/*
+ * scan_replay -- (internal) create buffered info statuses
+ */
+static void
+scan_replay(PMEMpoolcheck *ppc, struct arena_scan *scan)
+{
+	size_t off = 0;
+	while (off < scan->msgs_len) {
+		CHECK_INFO(ppc, "%s", scan->msgs + off);
+		off += strlen(scan->msgs + off) + 1;
+	}
+
+	free(scan->msgs);
+	scan->msgs = NULL;
+	scan->msgs_len = 0;
+	scan->msgs_size = 0;
+}
+
+/*
+ * scan_release -- (internal) release resources of the arena scan not taken
+ *	over by the check thread
+ */
+static void
+scan_release(struct arena_scan *scan)
+{
+	if (scan->list_unmap)
+		list_free(scan->list_unmap);
+	if (scan->list_flog_inval)
+		list_free(scan->list_flog_inval);
+	if (scan->list_inval)
+		list_free(scan->list_inval);
+	free(scan->fbitmap);
+	free(scan->bitmap);
+	free(scan->dup_bitmap);
+	free(scan->msgs);
+}
+
+/*
+ * scans_free -- (internal) release results of all arena scans
+ */
+static void
+scans_free(void *arg)
+{
+	struct arena_scan *scans = arg;
+
+	for (struct arena_scan *scan = scans; scan->arenap; scan++)
+		scan_release(scan);
+
+	free(scans);
+}
+
 /*
  * cleanup -- (internal) prepare resources for map and flog check
  */
@@ -239,89 +390,14 @@ cleanup(PMEMpoolcheck *ppc, union location *loc)
 	if (loc->dup_bitmap)
 		free(loc->dup_bitmap);
 
-	return 0;
-}
-
-/*
- * init -- (internal) initialize map and flog check
- */
-static int
-init(PMEMpoolcheck *ppc, union location *loc)
-{
-	LOG(3, NULL);
-
-	struct arena *arenap = loc->arenap;
-
-	/* read flog and map entries */
-	if (flog_read(ppc, arenap)) {
-		CHECK_ERR(ppc, "arena %u: cannot read BTT Flog", arenap->id);
-		goto error;
-	}
-
-	if (map_read(ppc, arenap)) {
-		CHECK_ERR(ppc, "arena %u: cannot read BTT Map", arenap->id);
-		goto error;
-	}
-
-	/* create bitmaps for checking duplicated blocks */
-	uint32_t bitmapsize = howmany(arenap->btt_info.internal_nlba, 8);
-	loc->bitmap = calloc(bitmapsize, 1);
-	if (!loc->bitmap) {
-		ERR("!calloc");
-		CHECK_ERR(ppc, "arena %u: cannot allocate memory for blocks "
-			"bitmap");
-		goto error;
-	}
-
-	loc->dup_bitmap = calloc(bitmapsize, 1);
-	if (!loc->dup_bitmap) {
-		ERR("!calloc");
-		CHECK_ERR(ppc, "arena %u: cannot allocate memory for "
-			"duplicated blocks bitmap");
-		goto error;
-	}
-
-	loc->fbitmap = calloc(bitmapsize, 1);
-	if (!loc->fbitmap) {
-		ERR("!calloc");
-		CHECK_ERR(ppc, "arena %u: cannot allocate memory for BTT Flog "
-			"bitmap");
-		goto error;
-	}
-
-	/* list of invalid map entries */
-	loc->list_inval = list_alloc();
-	if (!loc->list_inval) {
-		CHECK_ERR(ppc,
-			"arena %u: cannot allocate memory for invalid BTT map "
-			"entries list");
-		goto error;
-	}
-
-	/* list of invalid flog entries */
-	loc->list_flog_inval = list_alloc();
-	if (!loc->list_flog_inval) {
-		CHECK_ERR(ppc,
-			"arena %u: cannot allocate memory for invalid BTT Flog "
-			"entries list");
-		goto error;
-	}
-
-	/* list of unmapped blocks */
-	loc->list_unmap = list_alloc();
-	if (!loc->list_unmap) {
-		CHECK_ERR(ppc,
-			"arena %u: cannot allocate memory for unmaped blocks "
-			"list");
-		goto error;
-	}
+	loc->list_unmap = NULL;
+	loc->list_flog_inval = NULL;
+	loc->list_inval = NULL;
+	loc->fbitmap = NULL;
+	loc->bitmap = NULL;
+	loc->dup_bitmap = NULL;
 
 	return 0;
-
-error:
-	ppc->result = CHECK_RESULT_ERROR;
-	cleanup(ppc, loc);
-	return -1;
 }
 
 /*
@@ -344,25 +420,25 @@ map_get_postmap_lba(struct arena *arenap, uint32_t i)
  * map_entry_check -- (internal) check single map entry
  */
 static int
-map_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i)
+map_entry_check(PMEMpoolcheck *ppc, struct arena_scan *scan, uint32_t i)
 {
-	struct arena *arenap = loc->arenap;
+	struct arena *arenap = scan->arenap;
 	uint32_t lba = map_get_postmap_lba(arenap, i);
 
 	/* add duplicated and invalid entries to list */
 	if (lba < arenap->btt_info.internal_nlba) {
-		if (util_isset(loc->bitmap, lba)) {
-			CHECK_INFO(ppc, "arena %u: BTT Map entry %u duplicated "
-				"at %u", arenap->id, lba, i);
-			util_setbit(loc->dup_bitmap, lba);
-			if (!list_push(loc->list_inval, i))
+		if (util_isset(scan->bitmap, lba)) {
+			scan_info(ppc, scan, "arena %u: BTT Map entry %u "
+				"duplicated at %u", arenap->id, lba, i);
+			util_setbit(scan->dup_bitmap, lba);
+			if (!list_push(scan->list_inval, i))
 				return -1;
 		} else
-			util_setbit(loc->bitmap, lba);
+			util_setbit(scan->bitmap, lba);
 	} else {
-		CHECK_INFO(ppc, "arena %u: invalid BTT Map entry at %u",
+		scan_info(ppc, scan, "arena %u: invalid BTT Map entry at %u",
 			arenap->id, i);
-		if (!list_push(loc->list_inval, i))
+		if (!list_push(scan->list_inval, i))
 			return -1;
 	}
 
@@ -373,10 +449,10 @@ map_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i)
  * flog_entry_check -- (internal) check single flog entry
  */
 static int
-flog_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i,
+flog_entry_check(PMEMpoolcheck *ppc, struct arena_scan *scan, uint32_t i,
 	uint8_t **ptr)
 {
-	struct arena *arenap = loc->arenap;
+	struct arena *arenap = scan->arenap;
 
 	/* flog entry consists of two btt_flog structures */
 	struct btt_flog *flog = (struct btt_flog *)*ptr;
@@ -386,9 +462,9 @@ flog_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i,
 
 	/* insert invalid and duplicated indexes to list */
 	if (!flog_cur) {
-		CHECK_INFO(ppc, "arena %u: invalid BTT Flog entry at %u",
+		scan_info(ppc, scan, "arena %u: invalid BTT Flog entry at %u",
 			arenap->id, i);
-		if (!list_push(loc->list_flog_inval, i))
+		if (!list_push(scan->list_flog_inval, i))
 			return -1;
 
 		goto next;
@@ -404,38 +480,38 @@ flog_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i,
 	if (flog_cur->lba >= arenap->btt_info.external_nlba ||
 			entry >= arenap->btt_info.internal_nlba ||
 			new_entry >= arenap->btt_info.internal_nlba) {
-		CHECK_INFO(ppc, "arena %u: invalid BTT Flog entry at %u",
+		scan_info(ppc, scan, "arena %u: invalid BTT Flog entry at %u",
 			arenap->id, i);
-		if (!list_push(loc->list_flog_inval, i))
+		if (!list_push(scan->list_flog_inval, i))
 			return -1;
 
 		goto next;
 	}
 
-	if (util_isset(loc->fbitmap, entry)) {
+	if (util_isset(scan->fbitmap, entry)) {
 		/*
 		 * here we have two flog entries which holds the same free block
 		 */
-		CHECK_INFO(ppc, "arena %u: duplicated BTT Flog entry at %u\n",
-			arenap->id, i);
-		if (!list_push(loc->list_flog_inval, i))
+		scan_info(ppc, scan, "arena %u: duplicated BTT Flog entry at "
+			"%u\n", arenap->id, i);
+		if (!list_push(scan->list_flog_inval, i))
 			return -1;
-	} else if (util_isset(loc->bitmap, entry)) {
+	} else if (util_isset(scan->bitmap, entry)) {
 		/* here we have probably an unfinished write */
-		if (util_isset(loc->bitmap, new_entry)) {
+		if (util_isset(scan->bitmap, new_entry)) {
 			/* Both old_map and new_map are already used in map. */
-			CHECK_INFO(ppc, "arena %u: duplicated BTT Flog entry "
-				"at %u", arenap->id, i);
-			util_setbit(loc->dup_bitmap, new_entry);
-			if (!list_push(loc->list_flog_inval, i))
+			scan_info(ppc, scan, "arena %u: duplicated BTT Flog "
+				"entry at %u", arenap->id, i);
+			util_setbit(scan->dup_bitmap, new_entry);
+			if (!list_push(scan->list_flog_inval, i))
 				return -1;
 		} else {
 			/*
 			 * Unfinished write. Next time pool is opened, the map
 			 * will be updated to new_map.
 			 */
-			util_setbit(loc->bitmap, new_entry);
-			util_setbit(loc->fbitmap, entry);
+			util_setbit(scan->bitmap, new_entry);
+			util_setbit(scan->fbitmap, entry);
 		}
 	} else {
 		int flog_valid = 1;
@@ -453,17 +529,17 @@ flog_entry_check(PMEMpoolcheck *ppc, union location *loc, uint32_t i,
 				util_is_zeroed((const void *)&flog[1],
 				sizeof(flog[1]));
 		else
-			flog_valid = (loc->arenap->map[flog_cur->lba] &
+			flog_valid = (arenap->map[flog_cur->lba] &
 				BTT_MAP_ENTRY_LBA_MASK) == new_entry;
 
 		if (flog_valid) {
 			/* totally fine case */
-			util_setbit(loc->bitmap, entry);
-			util_setbit(loc->fbitmap, entry);
+			util_setbit(scan->bitmap, entry);
+			util_setbit(scan->fbitmap, entry);
 		} else {
-			CHECK_INFO(ppc, "arena %u: invalid BTT Flog entry at "
-				"%u", arenap->id, i);
-			if (!list_push(loc->list_flog_inval, i))
+			scan_info(ppc, scan, "arena %u: invalid BTT Flog entry "
+				"at %u", arenap->id, i);
+			if (!list_push(scan->list_flog_inval, i))
 				return -1;
 		}
 	}
@@ -474,39 +550,207 @@ next:
 }
 
 /*
- * arena_map_flog_check -- (internal) check map and flog
+ * scan_arena -- (internal) read and check map and flog of a single arena
+ *
+ * This is a check_tasks task, so it may run concurrently with other arenas
+ * and with the check thread. It only touches its own arena and arena_scan.
  */
 static int
-arena_map_flog_check(PMEMpoolcheck *ppc, union location *loc)
+scan_arena(PMEMpoolcheck *ppc, void *arg, unsigned narena)
 {
-	LOG(3, NULL);
+	LOG(3, "arena %u", narena);
 
-	struct arena *arenap = loc->arenap;
+	struct arena_scan *scan = &((struct arena_scan *)arg)[narena];
+	struct arena *arenap = scan->arenap;
+	enum scan_error ret;
+
+	/*
+	 * Map and flog of an arena verified by the previous check are not
+	 * needed at all, they are not written back either.
+	 */
+	if (arenap->checked)
+		return SCAN_OK;
+
+	/* read flog and map entries */
+	if (flog_read(ppc, arenap)) {
+		ret = SCAN_ERR_FLOG_READ;
+		goto error;
+	}
+
+	if (map_read(ppc, arenap)) {
+		ret = SCAN_ERR_MAP_READ;
+		goto error;
+	}
+
+	/* create bitmaps for checking duplicated blocks */
+	uint32_t bitmapsize = howmany(arenap->btt_info.internal_nlba, 8);
+	scan->bitmap = calloc(bitmapsize, 1);
+	if (!scan->bitmap) {
+		ERR("!calloc");
+		ret = SCAN_ERR_BITMAP;
+		goto error;
+	}
+
+	scan->dup_bitmap = calloc(bitmapsize, 1);
+	if (!scan->dup_bitmap) {
+		ERR("!calloc");
+		ret = SCAN_ERR_DUP_BITMAP;
+		goto error;
+	}
+
+	scan->fbitmap = calloc(bitmapsize, 1);
+	if (!scan->fbitmap) {
+		ERR("!calloc");
+		ret = SCAN_ERR_FBITMAP;
+		goto error;
+	}
+
+	/* list of invalid map entries */
+	scan->list_inval = list_alloc();
+	if (!scan->list_inval) {
+		ret = SCAN_ERR_LIST_INVAL;
+		goto error;
+	}
+
+	/* list of invalid flog entries */
+	scan->list_flog_inval = list_alloc();
+	if (!scan->list_flog_inval) {
+		ret = SCAN_ERR_LIST_FLOG_INVAL;
+		goto error;
+	}
+
+	/* list of unmapped blocks */
+	scan->list_unmap = list_alloc();
+	if (!scan->list_unmap) {
+		ret = SCAN_ERR_LIST_UNMAP;
+		goto error;
+	}
+
+	ret = SCAN_ERR_LIST_ITEM;
 
 	/* check map entries */
 	uint32_t i;
 	for (i = 0; i < arenap->btt_info.external_nlba; i++) {
-		if (map_entry_check(ppc, loc, i))
-			goto error_push;
+		if (map_entry_check(ppc, scan, i))
+			goto error;
 	}
 
 	/* check flog entries */
 	uint8_t *ptr = arenap->flog;
 	for (i = 0; i < arenap->btt_info.nfree; i++) {
-		if (flog_entry_check(ppc, loc, i, &ptr))
-			goto error_push;
+		if (flog_entry_check(ppc, scan, i, &ptr))
+			goto error;
 	}
 
 	/* check unmapped blocks and insert to list */
 	for (i = 0; i < arenap->btt_info.internal_nlba; i++) {
-		if (!util_isset(loc->bitmap, i)) {
-			CHECK_INFO(ppc, "arena %u: unmapped block %u",
+		if (!util_isset(scan->bitmap, i)) {
+			scan_info(ppc, scan, "arena %u: unmapped block %u",
 				arenap->id, i);
-			if (!list_push(loc->list_unmap, i))
-				goto error_push;
+			if (!list_push(scan->list_unmap, i))
+				goto error;
 		}
 	}
 
+	return SCAN_OK;
+
+error:
+	scan->errnum = errno;
+	return ret;
+}
+
+/*
+ * scan_start -- (internal) start scanning all arenas
+ */
+static int
+scan_start(PMEMpoolcheck *ppc, union location *loc)
+{
+	LOG(3, NULL);
+
+	/* the array is terminated by an empty entry */
+	struct arena_scan *scans = calloc(ppc->pool->narenas + 1,
+		sizeof(*scans));
+	if (!scans) {
+		ERR("!calloc");
+		goto error;
+	}
+
+	unsigned narena = 0;
+	struct arena *arenap;
+	TAILQ_FOREACH(arenap, &ppc->pool->arenas, next)
+		scans[narena++].arenap = arenap;
+
+	if (check_tasks_start(ppc, narena, scan_arena, scans_free, scans)) {
+		free(scans);
+		goto error;
+	}
+
+	loc->scans = scans;
+	return 0;
+
+error:
+	ppc->result = CHECK_RESULT_ERROR;
+	return CHECK_ERR(ppc, "cannot start checking BTT Map and Flog");
+}
+
+/*
+ * scan_get -- (internal) wait for the arena scan and take over its results
+ */
+static int
+scan_get(PMEMpoolcheck *ppc, union location *loc)
+{
+	int ret = check_tasks_wait(ppc, loc->narena);
+	struct arena_scan *scan = &loc->scans[loc->narena];
+
+	scan_replay(ppc, scan);
+
+	loc->bitmap = scan->bitmap;
+	loc->dup_bitmap = scan->dup_bitmap;
+	loc->fbitmap = scan->fbitmap;
+	loc->list_inval = scan->list_inval;
+	loc->list_flog_inval = scan->list_flog_inval;
+	loc->list_unmap = scan->list_unmap;
+	int errnum = scan->errnum;
+
+	/* the check thread is the owner of the results from now on */
+	scan->bitmap = NULL;
+	scan->dup_bitmap = NULL;
+	scan->fbitmap = NULL;
+	scan->list_inval = NULL;
+	scan->list_flog_inval = NULL;
+	scan->list_unmap = NULL;
+
+	if (ret == SCAN_OK)
+		return 0;
+
+	errno = errnum;
+	CHECK_ERR(ppc, "arena %u: %s", loc->arenap->id, scan_error_str[ret]);
+	ppc->result = CHECK_RESULT_ERROR;
+	cleanup(ppc, loc);
+	return -1;
+}
+
+/*
+ * init -- (internal) initialize map and flog check
+ */
+static int
+init(PMEMpoolcheck *ppc, union location *loc)
+{
+	LOG(3, NULL);
+
+	return scan_get(ppc, loc);
+}
+
+/*
+ * arena_map_flog_check -- (internal) check map and flog
+ */
+static int
+arena_map_flog_check(PMEMpoolcheck *ppc, union location *loc)
+{
+	LOG(3, NULL);
+
+	struct arena *arenap = loc->arenap;
+
 	if (loc->list_unmap->count)
 		CHECK_INFO(ppc, "arena %u: number of unmapped blocks: %u",
 			arenap->id, loc->list_unmap->count);
@@ -517,6 +761,14 @@ arena_map_flog_check(PMEMpoolcheck *ppc, union location *loc)
 		CHECK_INFO(ppc, "arena %u: number of invalid BTT Flog entries: "
 			"%u", arenap->id, loc->list_flog_inval->count);
 
+	/* record the arena does not have to be checked again */
+	if (loc->list_unmap->count == 0 && loc->list_inval->count == 0 &&
+			loc->list_flog_inval->count == 0) {
+		arenap->checked = true;
+		if (check_checkpoint_save(ppc))
+			CHECK_INFO(ppc, "cannot save the check progress");
+	}
+
 	if (CHECK_IS_NOT(ppc, REPAIR) && loc->list_unmap->count > 0) {
 		ppc->result = CHECK_RESULT_NOT_CONSISTENT;
 		check_end(ppc->data);
@@ -554,9 +806,6 @@ arena_map_flog_check(PMEMpoolcheck *ppc, union location *loc)
 
 	return check_questions_sequence_validate(ppc);
 
-error_push:
-	CHECK_ERR(ppc, "arena %u: cannot allocate momory for list item");
-	ppc->result = CHECK_RESULT_ERROR;
 cleanup:
 	cleanup(ppc, loc);
 	return -1;
@@ -705,6 +954,9 @@ check_btt_map_flog(PMEMpoolcheck *ppc)
 	if (!loc->arenap && loc->narena == 0 &&
 			ppc->result != CHECK_RESULT_PROCESS_ANSWERS) {
 		CHECK_INFO(ppc, "checking BTT Map and Flog");
+		check_checkpoint_load(ppc);
+		if (scan_start(ppc, loc))
+			return;
 		loc->arenap = TAILQ_FIRST(&ppc->pool->arenas);
 		loc->narena = 0;
 	}
@@ -713,6 +965,14 @@ check_btt_map_flog(PMEMpoolcheck *ppc)
 		/* add info about checking next arena */
 		if (ppc->result != CHECK_RESULT_PROCESS_ANSWERS &&
 				loc->step == 0) {
+			if (loc->arenap->checked) {
+				CHECK_INFO(ppc, "arena %u: BTT Map and Flog "
+					"already checked", loc->narena);
+				if (scan_get(ppc, loc))
+					return;
+				goto next_arena;
+			}
+
 			CHECK_INFO(ppc, "arena %u: checking BTT Map and Flog",
 				loc->narena);
 		}
@@ -723,9 +983,12 @@ check_btt_map_flog(PMEMpoolcheck *ppc)
 				return;
 		}
 
+next_arena:
 		/* jump to next arena */
 		loc->arenap = TAILQ_NEXT(loc->arenap, next);
 		loc->narena++;
 		loc->step = 0;
 	}
+
+	check_tasks_fini(ppc);
 }
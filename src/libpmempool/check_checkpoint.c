@@ -0,0 +1,403 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * check_checkpoint.c -- progress of the check preserved between runs
+ *
+ * Checking the BTT Map and Flog of big pools takes most of the check time.
+ * Arenas found consistent are recorded in the checkpoint file, so the check
+ * interrupted for any reason does not have to verify them again. The file
+ * describes the state of the pool at the time it was written, so it is used
+ * only if none of the files of the pool changed since, as told by their
+ * identity, size and modification and change times, and neither did the BTT
+ * Info headers of the recorded arenas. The files are examined before any Map
+ * or Flog is read, so a change made while the check runs invalidates the
+ * checkpoint. It is removed when the check completes successfully.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "out.h"
+#include "libpmempool.h"
+#include "pmempool.h"
+#include "pool.h"
+#include "check_util.h"
+
+#define CHECKPOINT_SIG "PMEMCHECKPOINT"	/* must be 16 bytes including '\0' */
+#define CHECKPOINT_SIG_LEN 16
+#define CHECKPOINT_TMP_SUFFIX ".tmp"
+
+/*
+ * checkpoint_hdr -- header of the checkpoint file, stored in host byte order
+ */
+struct checkpoint_hdr {
+	char signature[CHECKPOINT_SIG_LEN];
+	uint64_t pool_size;
+	uint32_t narenas;
+	uint32_t nchecked;	/* number of checkpoint_arena entries */
+	uint32_t nfiles;	/* number of checkpoint_file entries */
+	uint32_t reserved;
+};
+
+/*
+ * checkpoint_file -- state of a single file of the pool
+ */
+struct checkpoint_file {
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t ctime_sec;
+	int64_t ctime_nsec;
+};
+
+/*
+ * checkpoint_arena -- arena with BTT Map and Flog found consistent
+ */
+struct checkpoint_arena {
+	uint64_t offset;
+	uint64_t info_checksum;	/* checksum of the BTT Info header */
+};
+
+/*
+ * checkpoint_file_stat -- (internal) get the state of a file of the pool
+ */
+static int
+checkpoint_file_stat(const char *path, struct checkpoint_file *file)
+{
+	struct stat buf;
+	if (stat(path, &buf)) {
+		ERR("!stat %s", path);
+		return -1;
+	}
+
+	memset(file, 0, sizeof(*file));
+	file->dev = (uint64_t)buf.st_dev;
+	file->ino = (uint64_t)buf.st_ino;
+	file->size = (uint64_t)buf.st_size;
+	file->mtime_sec = (int64_t)buf.st_mtim.tv_sec;
+	file->mtime_nsec = (int64_t)buf.st_mtim.tv_nsec;
+	file->ctime_sec = (int64_t)buf.st_ctim.tv_sec;
+	file->ctime_nsec = (int64_t)buf.st_ctim.tv_nsec;
+	return 0;
+}
+
+/*
+ * checkpoint_files_init -- (internal) record the state of all pool files
+ *
+ * Every part of every local replica is recorded, remote replicas cannot be
+ * examined and are not checked anyway.
+ */
+static int
+checkpoint_files_init(PMEMpoolcheck *ppc)
+{
+	struct pool_set_file *file = ppc->pool->set_file;
+	struct pool_set *set = file->poolset;
+	unsigned nfiles = 0;
+
+	if (set) {
+		for (unsigned r = 0; r < set->nreplicas; r++) {
+			if (!set->replica[r]->remote)
+				nfiles += set->replica[r]->nparts;
+		}
+	} else {
+		nfiles = 1;
+	}
+
+	struct checkpoint_file *files = calloc(nfiles, sizeof(*files));
+	if (!files) {
+		ERR("!calloc");
+		return -1;
+	}
+
+	if (set) {
+		unsigned i = 0;
+		for (unsigned r = 0; r < set->nreplicas; r++) {
+			struct pool_replica *rep = set->replica[r];
+			if (rep->remote)
+				continue;
+
+			for (unsigned p = 0; p < rep->nparts; p++) {
+				if (checkpoint_file_stat(rep->part[p].path,
+						&files[i++]))
+					goto err;
+			}
+		}
+	} else if (checkpoint_file_stat(file->fname, &files[0])) {
+		goto err;
+	}
+
+	ppc->checkpoint_files = files;
+	ppc->checkpoint_nfiles = nfiles;
+	return 0;
+
+err:
+	free(files);
+	return -1;
+}
+
+/*
+ * checkpoint_hdr_init -- (internal) fill the header describing current pool
+ */
+static void
+checkpoint_hdr_init(PMEMpoolcheck *ppc, struct checkpoint_hdr *hdr)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->signature, CHECKPOINT_SIG, sizeof(CHECKPOINT_SIG));
+	hdr->pool_size = ppc->pool->set_file->size;
+	hdr->narenas = ppc->pool->narenas;
+	hdr->nfiles = ppc->checkpoint_nfiles;
+}
+
+/*
+ * checkpoint_read -- (internal) read the checkpoint and mark checked arenas
+ *
+ * Returns number of arenas marked or -1 if the checkpoint does not match.
+ */
+static int
+checkpoint_read(PMEMpoolcheck *ppc, int fd)
+{
+	struct checkpoint_hdr hdr;
+	struct checkpoint_hdr expected;
+
+	checkpoint_hdr_init(ppc, &expected);
+	if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+		return -1;
+
+	expected.nchecked = hdr.nchecked;
+	if (memcmp(&hdr, &expected, sizeof(hdr)) != 0 ||
+			hdr.nchecked > hdr.narenas)
+		return -1;
+
+	for (uint32_t i = 0; i < hdr.nfiles; i++) {
+		struct checkpoint_file file;
+		if (read(fd, &file, sizeof(file)) != sizeof(file))
+			return -1;
+
+		if (memcmp(&file, &ppc->checkpoint_files[i],
+				sizeof(file)) != 0)
+			return -1;
+	}
+
+	int nmarked = 0;
+	for (uint32_t i = 0; i < hdr.nchecked; i++) {
+		struct checkpoint_arena entry;
+		if (read(fd, &entry, sizeof(entry)) != sizeof(entry))
+			return -1;
+
+		struct arena *arenap;
+		TAILQ_FOREACH(arenap, &ppc->pool->arenas, next) {
+			if (arenap->offset == entry.offset &&
+				arenap->btt_info.checksum ==
+					entry.info_checksum) {
+				arenap->checked = true;
+				nmarked++;
+				break;
+			}
+		}
+	}
+
+	return nmarked;
+}
+
+/*
+ * check_checkpoint_load -- mark arenas verified by the interrupted check
+ */
+void
+check_checkpoint_load(PMEMpoolcheck *ppc)
+{
+	LOG(3, NULL);
+
+	if (!ppc->checkpoint_path)
+		return;
+
+	int olderrno = errno;
+
+	/* without the state of the pool files the progress cannot be kept */
+	if (checkpoint_files_init(ppc)) {
+		errno = olderrno;
+		CHECK_INFO(ppc, "%s: cannot examine the pool files, the check "
+			"progress will not be saved", ppc->checkpoint_path);
+		return;
+	}
+
+	int fd = open(ppc->checkpoint_path, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			ERR("!open %s", ppc->checkpoint_path);
+		errno = olderrno;
+		return;
+	}
+
+	int nmarked = checkpoint_read(ppc, fd);
+	(void) close(fd);
+	errno = olderrno;
+
+	if (nmarked < 0) {
+		/* the arenas might have been marked before the mismatch */
+		struct arena *arenap;
+		TAILQ_FOREACH(arenap, &ppc->pool->arenas, next)
+			arenap->checked = false;
+
+		CHECK_INFO(ppc, "%s: checkpoint does not match the pool, "
+			"ignoring", ppc->checkpoint_path);
+		return;
+	}
+
+	CHECK_INFO(ppc, "%s: resuming the check, %d arena(s) already "
+		"checked", ppc->checkpoint_path, nmarked);
+}
+
+/*
+ * check_checkpoint_save -- record all arenas checked so far
+ *
+ * The new checkpoint is written to a temporary file and renamed, so the
+ * checkpoint file is always consistent.
+ */
+int
+check_checkpoint_save(PMEMpoolcheck *ppc)
+{
+	LOG(3, NULL);
+
+	if (!ppc->checkpoint_path || !ppc->checkpoint_files)
+		return 0;
+
+	int olderrno = errno;
+	int ret = -1;
+
+	size_t len = strlen(ppc->checkpoint_path) +
+		sizeof(CHECKPOINT_TMP_SUFFIX);
+	char *tmp_path = malloc(len);
+	if (!tmp_path) {
+		ERR("!malloc");
+		goto out;
+	}
+	snprintf(tmp_path, len, "%s%s", ppc->checkpoint_path,
+		CHECKPOINT_TMP_SUFFIX);
+
+	int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		ERR("!open %s", tmp_path);
+		goto out_free;
+	}
+
+	struct checkpoint_hdr hdr;
+	checkpoint_hdr_init(ppc, &hdr);
+
+	struct arena *arenap;
+	TAILQ_FOREACH(arenap, &ppc->pool->arenas, next) {
+		if (arenap->checked)
+			hdr.nchecked++;
+	}
+
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		ERR("!write %s", tmp_path);
+		goto out_close;
+	}
+
+	size_t files_size = ppc->checkpoint_nfiles *
+		sizeof(*ppc->checkpoint_files);
+	if (write(fd, ppc->checkpoint_files, files_size) !=
+			(ssize_t)files_size) {
+		ERR("!write %s", tmp_path);
+		goto out_close;
+	}
+
+	TAILQ_FOREACH(arenap, &ppc->pool->arenas, next) {
+		if (!arenap->checked)
+			continue;
+
+		struct checkpoint_arena entry = {
+			.offset		= arenap->offset,
+			.info_checksum	= arenap->btt_info.checksum,
+		};
+
+		if (write(fd, &entry, sizeof(entry)) != sizeof(entry)) {
+			ERR("!write %s", tmp_path);
+			goto out_close;
+		}
+	}
+
+	if (fsync(fd)) {
+		ERR("!fsync %s", tmp_path);
+		goto out_close;
+	}
+
+	if (rename(tmp_path, ppc->checkpoint_path)) {
+		ERR("!rename %s", tmp_path);
+		goto out_close;
+	}
+
+	ret = 0;
+
+out_close:
+	(void) close(fd);
+	if (ret)
+		(void) unlink(tmp_path);
+out_free:
+	free(tmp_path);
+out:
+	errno = olderrno;
+	return ret;
+}
+
+/*
+ * check_checkpoint_remove -- remove the checkpoint of the completed check
+ */
+void
+check_checkpoint_remove(PMEMpoolcheck *ppc)
+{
+	LOG(3, NULL);
+
+	if (!ppc->checkpoint_path)
+		return;
+
+	if (unlink(ppc->checkpoint_path) && errno != ENOENT)
+		ERR("!unlink %s", ppc->checkpoint_path);
+}
+
+/*
+ * check_checkpoint_fini -- release the recorded state of the pool files
+ */
+void
+check_checkpoint_fini(PMEMpoolcheck *ppc)
+{
+	free(ppc->checkpoint_files);
+	ppc->checkpoint_files = NULL;
+	ppc->checkpoint_nfiles = 0;
+}
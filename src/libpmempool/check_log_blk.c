@@ -58,6 +58,7 @@ enum question {
 	Q_LOG_START_OFFSET,
 	Q_LOG_END_OFFSET,
 	Q_LOG_WRITE_OFFSET,
+	Q_LOG_HEAD_OFFSET,
 	Q_BLK_BSIZE,
 };
 
@@ -127,8 +128,13 @@ log_hdr_check(PMEMpoolcheck *ppc, union location *loc)
 			goto error;
 	}
 
+	/* the offsets of a circular log keep growing past end_offset */
+	int circular = (le32toh(ppc->pool->hdr.log.hdr.incompat_features) &
+			LOG_FORMAT_INCOMPAT_CIRCULAR) != 0;
+
 	if (ppc->pool->hdr.log.write_offset < d_start_offset ||
-		ppc->pool->hdr.log.write_offset > ppc->pool->set_file->size) {
+		(!circular && ppc->pool->hdr.log.write_offset >
+		ppc->pool->set_file->size)) {
 		if (CHECK_ASK(ppc, Q_LOG_WRITE_OFFSET,
 				"invalid pmemlog.write_offset: 0x%jx.|Do you "
 				"want to set pmemlog.write_offset to "
@@ -137,6 +143,20 @@ log_hdr_check(PMEMpoolcheck *ppc, union location *loc)
 			goto error;
 	}
 
+	if (circular && (ppc->pool->hdr.log.head_offset < d_start_offset ||
+		ppc->pool->hdr.log.head_offset >
+		ppc->pool->hdr.log.write_offset ||
+		ppc->pool->hdr.log.write_offset -
+		ppc->pool->hdr.log.head_offset >
+		ppc->pool->set_file->size - d_start_offset)) {
+		if (CHECK_ASK(ppc, Q_LOG_HEAD_OFFSET,
+				"invalid pmemlog.head_offset: 0x%jx.|Do you "
+				"want to set pmemlog.head_offset to "
+				"pmemlog.write_offset?",
+				ppc->pool->hdr.log.head_offset))
+			goto error;
+	}
+
 	if (ppc->result == CHECK_RESULT_CONSISTENT ||
 		ppc->result == CHECK_RESULT_REPAIRED)
 		CHECK_INFO(ppc, "pmemlog header correct");
@@ -179,6 +199,12 @@ log_hdr_fix(PMEMpoolcheck *ppc, struct check_step_data *location,
 			"pmemlog.end_offset");
 		ppc->pool->hdr.log.write_offset = ppc->pool->set_file->size;
 		break;
+	case Q_LOG_HEAD_OFFSET:
+		CHECK_INFO(ppc, "setting pmemlog.head_offset to "
+			"pmemlog.write_offset");
+		ppc->pool->hdr.log.head_offset =
+			ppc->pool->hdr.log.write_offset;
+		break;
 	default:
 		ERR("not implemented question id: %u", question);
 	}
@@ -254,7 +254,10 @@ pool_hdr_default_check(PMEMpoolcheck *ppc, union location *loc)
 			def_hdr.compat_features);
 	}
 
-	if (hdr.incompat_features != def_hdr.incompat_features) {
+	uint32_t incompat_opt = pool_hdr_incompat_optional(
+			ppc->pool->params.type);
+	if ((hdr.incompat_features & ~incompat_opt) !=
+			def_hdr.incompat_features) {
 		CHECK_ASK(ppc, Q_DEFAULT_INCOMPAT_FEATURES,
 			"%spool_hdr.incompat_features is not valid.|Do you "
 			"want to set it to default value 0x%x?", loc->prefix,
@@ -36,6 +36,8 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "out.h"
 #include "libpmempool.h"
@@ -78,10 +80,45 @@ struct check_status {
 
 TAILQ_HEAD(check_status_head, check_status);
 
+/* state of a single task of the check_tasks engine */
+enum check_task_state {
+	CHECK_TASK_PENDING,
+	CHECK_TASK_RUNNING,
+	CHECK_TASK_DONE,
+};
+
+/*
+ * check_tasks -- independent parts of a check step performed by a pool of
+ *	worker threads
+ *
+ * Workers take tasks in order of their indexes and the check thread consumes
+ * the results in the same order. Workers never go further than nthreads tasks
+ * ahead of the check thread, so the memory used by the results is bounded.
+ */
+struct check_tasks {
+	PMEMpoolcheck *ppc;
+	check_task_fn func;
+	void (*fini)(void *arg);
+	void *arg;
+
+	unsigned ntasks;
+	unsigned nthreads;
+	pthread_t *threads;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;	/* task done or window has moved */
+	unsigned next;		/* next task to take */
+	unsigned window;	/* tasks below this index can be taken */
+	int stop;
+	enum check_task_state *state;
+	int *results;
+};
+
 /* check control context */
 struct check_data {
 	unsigned step;
 	struct check_step_data step_data;
+	struct check_tasks *tasks;
 
 	struct check_status *error;
 	struct check_status_head infos;
@@ -91,6 +128,8 @@ struct check_data {
 	struct check_status *check_status_cache;
 };
 
+static void check_tasks_fini_data(struct check_data *data);
+
 /*
  * check_data_alloc --  allocate and initialize check_data structure
  */
@@ -108,6 +147,7 @@ check_data_alloc(void)
 	data->check_status_cache = NULL;
 	data->error = NULL;
 	data->step = 0;
+	data->tasks = NULL;
 
 	TAILQ_INIT(&data->infos);
 	TAILQ_INIT(&data->questions);
@@ -124,6 +164,8 @@ check_data_free(struct check_data *data)
 {
 	LOG(3, NULL);
 
+	check_tasks_fini_data(data);
+
 	if (data->error != NULL) {
 		free(data->error);
 		data->error = NULL;
@@ -186,6 +228,208 @@ check_get_step_data(struct check_data *data)
 	return &data->step_data;
 }
 
+/*
+ * check_tasks_worker -- (internal) take and perform tasks till stopped
+ */
+static void *
+check_tasks_worker(void *arg)
+{
+	struct check_tasks *tasks = arg;
+
+	pthread_mutex_lock(&tasks->lock);
+	while (!tasks->stop && tasks->next < tasks->ntasks) {
+		if (tasks->next >= tasks->window) {
+			pthread_cond_wait(&tasks->cond, &tasks->lock);
+			continue;
+		}
+
+		unsigned i = tasks->next++;
+		tasks->state[i] = CHECK_TASK_RUNNING;
+		pthread_mutex_unlock(&tasks->lock);
+
+		int ret = tasks->func(tasks->ppc, tasks->arg, i);
+
+		pthread_mutex_lock(&tasks->lock);
+		tasks->results[i] = ret;
+		tasks->state[i] = CHECK_TASK_DONE;
+		pthread_cond_broadcast(&tasks->cond);
+	}
+	pthread_mutex_unlock(&tasks->lock);
+
+	return NULL;
+}
+
+/*
+ * check_tasks_start -- spread ntasks tasks over the worker threads
+ *
+ * The func is called once for every task index, fini is called with arg after
+ * all the workers are stopped. If the check is single-threaded the tasks are
+ * performed by check_tasks_wait() on demand.
+ */
+int
+check_tasks_start(PMEMpoolcheck *ppc, unsigned ntasks, check_task_fn func,
+	void (*fini)(void *arg), void *arg)
+{
+	LOG(3, "ntasks %u", ntasks);
+
+	ASSERTeq(ppc->data->tasks, NULL);
+
+	struct check_tasks *tasks = calloc(1, sizeof(*tasks));
+	if (!tasks) {
+		ERR("!calloc");
+		return -1;
+	}
+
+	tasks->ppc = ppc;
+	tasks->func = func;
+	tasks->fini = fini;
+	tasks->arg = arg;
+	tasks->ntasks = ntasks;
+
+	unsigned nthreads = ppc->nthreads;
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
+	}
+	/* with a single thread tasks are performed by the check thread */
+	tasks->nthreads = nthreads > 1 ? min(nthreads, ntasks) : 0;
+	tasks->window = tasks->nthreads;
+
+	tasks->state = calloc(ntasks, sizeof(*tasks->state));
+	tasks->results = calloc(ntasks, sizeof(*tasks->results));
+	if (ntasks && (!tasks->state || !tasks->results)) {
+		ERR("!calloc");
+		goto error_alloc;
+	}
+
+	if ((errno = pthread_mutex_init(&tasks->lock, NULL))) {
+		ERR("!pthread_mutex_init");
+		goto error_alloc;
+	}
+
+	if ((errno = pthread_cond_init(&tasks->cond, NULL))) {
+		ERR("!pthread_cond_init");
+		goto error_cond;
+	}
+
+	ppc->data->tasks = tasks;
+
+	if (tasks->nthreads == 0)
+		return 0;
+
+	tasks->threads = calloc(tasks->nthreads, sizeof(*tasks->threads));
+	if (!tasks->threads) {
+		ERR("!calloc");
+		tasks->nthreads = 0;
+		return 0;
+	}
+
+	for (unsigned t = 0; t < tasks->nthreads; t++) {
+		if ((errno = pthread_create(&tasks->threads[t], NULL,
+				check_tasks_worker, tasks))) {
+			/* the remaining tasks are taken by the check thread */
+			ERR("!pthread_create");
+			tasks->nthreads = t;
+			break;
+		}
+	}
+
+	return 0;
+
+error_cond:
+	pthread_mutex_destroy(&tasks->lock);
+error_alloc:
+	free(tasks->results);
+	free(tasks->state);
+	free(tasks);
+	return -1;
+}
+
+/*
+ * check_tasks_wait -- wait for the result of the task
+ *
+ * Tasks have to be waited for in order of their indexes. If the task has not
+ * been taken by any worker yet, it is performed by the calling thread.
+ */
+int
+check_tasks_wait(PMEMpoolcheck *ppc, unsigned i)
+{
+	struct check_tasks *tasks = ppc->data->tasks;
+
+	ASSERTne(tasks, NULL);
+	ASSERT(i < tasks->ntasks);
+
+	pthread_mutex_lock(&tasks->lock);
+
+	/* let the workers go further */
+	if (tasks->window < i + 1 + tasks->nthreads) {
+		tasks->window = i + 1 + tasks->nthreads;
+		pthread_cond_broadcast(&tasks->cond);
+	}
+
+	if (tasks->state[i] == CHECK_TASK_PENDING) {
+		ASSERTeq(tasks->next, i);
+		tasks->next = i + 1;
+		tasks->state[i] = CHECK_TASK_RUNNING;
+		pthread_mutex_unlock(&tasks->lock);
+
+		int ret = tasks->func(ppc, tasks->arg, i);
+
+		pthread_mutex_lock(&tasks->lock);
+		tasks->results[i] = ret;
+		tasks->state[i] = CHECK_TASK_DONE;
+	}
+
+	while (tasks->state[i] != CHECK_TASK_DONE)
+		pthread_cond_wait(&tasks->cond, &tasks->lock);
+
+	int ret = tasks->results[i];
+	pthread_mutex_unlock(&tasks->lock);
+
+	return ret;
+}
+
+/*
+ * check_tasks_fini_data -- (internal) stop the workers and release the tasks
+ */
+static void
+check_tasks_fini_data(struct check_data *data)
+{
+	struct check_tasks *tasks = data->tasks;
+	if (!tasks)
+		return;
+
+	pthread_mutex_lock(&tasks->lock);
+	tasks->stop = 1;
+	pthread_cond_broadcast(&tasks->cond);
+	pthread_mutex_unlock(&tasks->lock);
+
+	for (unsigned t = 0; t < tasks->nthreads; t++)
+		pthread_join(tasks->threads[t], NULL);
+
+	if (tasks->fini)
+		tasks->fini(tasks->arg);
+
+	pthread_cond_destroy(&tasks->cond);
+	pthread_mutex_destroy(&tasks->lock);
+	free(tasks->threads);
+	free(tasks->results);
+	free(tasks->state);
+	free(tasks);
+	data->tasks = NULL;
+}
+
+/*
+ * check_tasks_fini -- stop the workers and release the tasks
+ */
+void
+check_tasks_fini(PMEMpoolcheck *ppc)
+{
+	LOG(3, NULL);
+
+	check_tasks_fini_data(ppc->data);
+}
+
 /*
  * check_end -- mark check as ended
  */
@@ -42,6 +42,7 @@
 #define CHECK_INVALID_QUESTION	UINT_MAX
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
 
 /* check control context */
 struct check_data;
@@ -76,6 +77,14 @@ uint32_t check_step_get(struct check_data *data);
 void check_step_inc(struct check_data *data);
 struct check_step_data *check_get_step_data(struct check_data *data);
 
+/* task of a check step, returns 0 on success */
+typedef int (*check_task_fn)(PMEMpoolcheck *ppc, void *arg, unsigned i);
+
+int check_tasks_start(PMEMpoolcheck *ppc, unsigned ntasks, check_task_fn func,
+	void (*fini)(void *arg), void *arg);
+int check_tasks_wait(PMEMpoolcheck *ppc, unsigned i);
+void check_tasks_fini(PMEMpoolcheck *ppc);
+
 void check_end(struct check_data *data);
 int check_is_end_util(struct check_data *data);
 
@@ -124,6 +133,11 @@ const char *check_get_pool_type_str(enum pool_type type);
 
 void check_insert_arena(PMEMpoolcheck *ppc, struct arena *arenap);
 
+void check_checkpoint_load(PMEMpoolcheck *ppc);
+int check_checkpoint_save(PMEMpoolcheck *ppc);
+void check_checkpoint_remove(PMEMpoolcheck *ppc);
+void check_checkpoint_fini(PMEMpoolcheck *ppc);
+
 #define CHECK_IS(ppc, flag)\
 	util_flag_isset((ppc)->args.flags, PMEMPOOL_CHECK_ ## flag)
 
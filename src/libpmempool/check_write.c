@@ -172,6 +172,9 @@ btt_data_write(PMEMpoolcheck *ppc, union location *loc)
 {
 	LOG(3, NULL);
 
+	if (CHECK_WITHOUT_FIXING(ppc))
+		return 0;
+
 	struct arena *arenap;
 
 	TAILQ_FOREACH(arenap, &ppc->pool->arenas, next) {
@@ -204,6 +207,10 @@ btt_data_write(PMEMpoolcheck *ppc, union location *loc)
 			goto error;
 		}
 
+		/* map and flog of an arena checked before were not read */
+		if (arenap->checked)
+			continue;
+
 		if (blk_write_flog(ppc, arenap))
 			goto error;
 
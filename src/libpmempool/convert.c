@@ -0,0 +1,907 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * convert.c -- journaled conversion of the pool to the latest layout version
+ *
+ * Before any range of the pool is modified its old content is appended to
+ * the journal file created next to the pool, and the journal is flushed.
+ * At the end of each step the modified ranges are flushed and the step is
+ * marked as done in the journal. If the conversion is interrupted, the next
+ * one rolls back the steps not marked as done and continues from there.
+ * If a step fails, the conversion is marked as aborted in the journal and all
+ * the steps are rolled back, so the pool is left as it was before the
+ * conversion. An aborted conversion interrupted during the roll back is
+ * rolled back entirely by the next one, which then starts from scratch.
+ * The journal is removed when the pool reaches the version the journal was
+ * created for.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <time.h>
+#include <endian.h>
+#include <sys/param.h>
+
+#include "libpmem.h"
+#include "libpmempool.h"
+#include "out.h"
+#include "pmempool.h"
+#include "pool.h"
+#include "convert.h"
+
+#define JOURNAL_SIG "PMEMCONVERT"	/* must be 16 bytes including '\0' */
+#define JOURNAL_SIG_LEN 16
+#define JOURNAL_SUFFIX ".convert"
+#define JOURNAL_ALIGN ((size_t)8)
+#define CONVERT_NSTEPS 2	/* the prepare and finish steps */
+
+/*
+ * journal_hdr -- header of the conversion journal, stored in host byte order
+ */
+struct journal_hdr {
+	char signature[JOURNAL_SIG_LEN];
+	uuid_t poolset_uuid;
+	uint64_t pool_size;
+	uint32_t major;		/* source major version */
+	uint32_t nsteps;
+	uint64_t reserved;
+	uint64_t checksum;
+};
+
+enum journal_rec_type {
+	JOURNAL_REC_UNDO = 1,	/* old content of the range follows */
+	JOURNAL_REC_DONE = 2,	/* the step is done */
+	JOURNAL_REC_ABORT = 3,	/* all the steps are being rolled back */
+};
+
+/*
+ * journal_rec -- record of the journal, stored in host byte order
+ *
+ * The offset of the range is relative to the beginning of the pool for the
+ * part 0 and to the beginning of the part header for the other parts.
+ */
+struct journal_rec {
+	uint32_t type;
+	uint32_t step;
+	uint32_t part;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t len;
+	uint64_t data_checksum;
+	uint64_t checksum;
+};
+
+/*
+ * convert -- state of the conversion shared by all the steps
+ */
+struct convert {
+	struct pool_set_file *file;
+	char *addr;
+	size_t size;
+	int is_pmem;
+	const struct convert_ops *ops;
+
+	unsigned nsteps;
+	uint8_t *done;		/* steps marked as done in the journal */
+
+	char *jpath;
+	int jfd;
+	uint64_t jsize;		/* end of the last valid record */
+
+	struct pmempool_convert_stats *stats;
+};
+
+/*
+ * convert_range -- range of the pool modified by the step
+ */
+struct convert_range {
+	unsigned part;
+	char *addr;
+	size_t len;
+};
+
+/*
+ * convert_ctx -- context of the single step
+ */
+struct convert_ctx {
+	struct convert *cnv;
+	unsigned step;
+	struct convert_range *ranges;
+	size_t nranges;
+	size_t max_ranges;
+	uint64_t *journaled;	/* pages saved by the step */
+};
+
+/*
+ * convert_addr -- return address of the pool being converted
+ */
+void *
+convert_addr(struct convert_ctx *ctx)
+{
+	return ctx->cnv->addr;
+}
+
+/*
+ * convert_size -- return size of the pool being converted
+ */
+size_t
+convert_size(struct convert_ctx *ctx)
+{
+	return ctx->cnv->size;
+}
+
+/*
+ * convert_persist -- (internal) flush the range of the pool
+ */
+static int
+convert_persist(struct convert *cnv, void *addr, size_t len)
+{
+	if (cnv->is_pmem) {
+		pmem_persist(addr, len);
+		return 0;
+	}
+
+	return pmem_msync(addr, len);
+}
+
+/*
+ * convert_part_hdr -- (internal) return address of the part header
+ */
+static struct pool_hdr *
+convert_part_hdr(struct convert *cnv, unsigned p)
+{
+	if (p == 0)
+		return (struct pool_hdr *)cnv->addr;
+
+	return cnv->file->poolset->replica[0]->part[p].hdr;
+}
+
+/*
+ * convert_part_range -- (internal) return address of the range of the part
+ *
+ * Returns NULL if the range does not fit the pool or the part header.
+ */
+static char *
+convert_part_range(struct convert *cnv, unsigned p, uint64_t off,
+	uint64_t len)
+{
+	uint64_t size = p == 0 ? cnv->size : sizeof(struct pool_hdr);
+	if (p >= cnv->file->poolset->replica[0]->nparts ||
+			off > size || len > size - off)
+		return NULL;
+
+	return (char *)convert_part_hdr(cnv, p) + off;
+}
+
+/*
+ * journal_append -- (internal) append the record to the journal and flush it
+ */
+static int
+journal_append(struct convert *cnv, struct journal_rec *rec, const void *data)
+{
+	size_t dlen = rec->type == JOURNAL_REC_UNDO ?
+		roundup(rec->len, JOURNAL_ALIGN) : 0;
+	size_t len = sizeof(*rec) + dlen;
+	char *buff = malloc(len);
+	if (!buff) {
+		ERR("!malloc");
+		return -1;
+	}
+
+	rec->data_checksum = 0;
+	if (dlen) {
+		memset(buff + sizeof(*rec) + rec->len, 0, dlen - rec->len);
+		memcpy(buff + sizeof(*rec), data, rec->len);
+		util_checksum(buff + sizeof(*rec), dlen,
+			&rec->data_checksum, 1);
+	}
+	util_checksum(rec, sizeof(*rec), &rec->checksum, 1);
+	memcpy(buff, rec, sizeof(*rec));
+
+	int ret = -1;
+	ssize_t written = pwrite(cnv->jfd, buff, len, (off_t)cnv->jsize);
+	if (written != (ssize_t)len) {
+		if (written >= 0)
+			errno = ENOSPC;
+		ERR("!pwrite %s", cnv->jpath);
+		goto out;
+	}
+	if (fdatasync(cnv->jfd)) {
+		ERR("!fdatasync %s", cnv->jpath);
+		goto out;
+	}
+	cnv->jsize += len;
+	cnv->stats->journal_bytes += len;
+	ret = 0;
+out:
+	free(buff);
+	return ret;
+}
+
+/*
+ * convert_journal_range -- (internal) save old content of the range
+ */
+static int
+convert_journal_range(struct convert_ctx *ctx, unsigned p, char *addr,
+	size_t len)
+{
+	if (ctx->nranges == ctx->max_ranges) {
+		size_t max = ctx->max_ranges ? 2 * ctx->max_ranges : 64;
+		struct convert_range *ranges =
+			realloc(ctx->ranges, max * sizeof(*ranges));
+		if (!ranges) {
+			ERR("!realloc");
+			return -1;
+		}
+		ctx->ranges = ranges;
+		ctx->max_ranges = max;
+	}
+
+	struct journal_rec rec = {
+		.type = JOURNAL_REC_UNDO,
+		.step = ctx->step,
+		.part = p,
+		.offset = (uint64_t)(addr -
+			(char *)convert_part_hdr(ctx->cnv, p)),
+		.len = len,
+	};
+	if (journal_append(ctx->cnv, &rec, addr))
+		return -1;
+
+	ctx->ranges[ctx->nranges].part = p;
+	ctx->ranges[ctx->nranges].addr = addr;
+	ctx->ranges[ctx->nranges].len = len;
+	ctx->nranges++;
+
+	return 0;
+}
+
+/*
+ * convert_page_mark -- (internal) mark the page as saved, return old state
+ */
+static int
+convert_page_mark(struct convert_ctx *ctx, size_t pg)
+{
+	uint64_t mask = 1ULL << (pg % 64);
+	int marked = (ctx->journaled[pg / 64] & mask) != 0;
+	ctx->journaled[pg / 64] |= mask;
+	return marked;
+}
+
+/*
+ * convert_add_range -- save old content of the range before it is modified
+ *
+ * The content is saved in whole pages and each page only once per step, so
+ * a number of small modifications of the same page costs a single flush of
+ * the journal. The pages modified by more than one step are saved by each of
+ * them, so every step can be rolled back on its own.
+ */
+int
+convert_add_range(struct convert_ctx *ctx, void *addr, size_t len)
+{
+	struct convert *cnv = ctx->cnv;
+	size_t off = (size_t)((char *)addr - cnv->addr);
+	if ((char *)addr < cnv->addr || off > cnv->size ||
+			len > cnv->size - off) {
+		ERR("range %p %zu outside of the pool", addr, len);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (len == 0)
+		return 0;
+
+	size_t first = off / Pagesize;
+	size_t last = (off + len - 1) / Pagesize;
+
+	/* save contiguous pages not saved yet with a single record */
+	size_t start = first;
+	for (size_t pg = first; pg <= last + 1; ++pg) {
+		if (pg <= last && !convert_page_mark(ctx, pg))
+			continue;
+
+		if (pg > start) {
+			size_t soff = start * Pagesize;
+			size_t slen = MIN((pg - start) * Pagesize,
+				cnv->size - soff);
+			if (convert_journal_range(ctx, 0, cnv->addr + soff,
+					slen))
+				return -1;
+		}
+		start = pg + 1;
+	}
+
+	return 0;
+}
+
+/*
+ * convert_step_done -- (internal) flush modified ranges and mark the step
+ */
+static int
+convert_step_done(struct convert_ctx *ctx)
+{
+	struct convert *cnv = ctx->cnv;
+	uint64_t bytes = 0;
+
+	for (size_t i = 0; i < ctx->nranges; ++i) {
+		struct convert_range *r = &ctx->ranges[i];
+		if (convert_persist(cnv, r->addr, r->len))
+			return -1;
+		bytes += r->len;
+	}
+
+	struct journal_rec rec = {
+		.type = JOURNAL_REC_DONE,
+		.step = ctx->step,
+	};
+	if (journal_append(cnv, &rec, NULL))
+		return -1;
+
+	cnv->stats->bytes += bytes;
+	cnv->stats->nsteps++;
+	cnv->done[ctx->step] = 1;
+
+	return 0;
+}
+
+/*
+ * convert_hdr_update -- (internal) set the version in all the part headers
+ */
+static int
+convert_hdr_update(struct convert_ctx *ctx)
+{
+	struct convert *cnv = ctx->cnv;
+	struct pool_replica *rep = cnv->file->poolset->replica[0];
+
+	for (unsigned p = 0; p < rep->nparts; ++p) {
+		struct pool_hdr *hdr = convert_part_hdr(cnv, p);
+		if (convert_journal_range(ctx, p, (char *)hdr, sizeof(*hdr)))
+			return -1;
+
+		hdr->major = htole32(cnv->ops->major + 1);
+		util_checksum(hdr, sizeof(*hdr), &hdr->checksum, 1);
+	}
+
+	return 0;
+}
+
+/*
+ * convert_step -- (internal) run the step unless it is already done
+ */
+static int
+convert_step(struct convert *cnv, unsigned step)
+{
+	if (cnv->done[step])
+		return 0;
+
+	struct convert_ctx ctx = {
+		.cnv = cnv,
+		.step = step,
+		.ranges = NULL,
+		.nranges = 0,
+		.max_ranges = 0,
+	};
+
+	size_t npages = (cnv->size + Pagesize - 1) / Pagesize;
+	ctx.journaled = calloc((npages + 63) / 64, sizeof(uint64_t));
+	if (!ctx.journaled) {
+		ERR("!calloc");
+		return -1;
+	}
+
+	const struct convert_ops *ops = cnv->ops;
+	int ret;
+	if (step == 0)
+		ret = ops->prepare ? ops->prepare(&ctx) : 0;
+	else if ((ret = ops->finish ? ops->finish(&ctx) : 0) == 0)
+		ret = convert_hdr_update(&ctx);
+
+	if (ret == 0)
+		ret = convert_step_done(&ctx);
+
+	free(ctx.journaled);
+	free(ctx.ranges);
+	return ret;
+}
+
+/*
+ * journal_hdr_init -- (internal) fill the journal header for current pool
+ */
+static void
+journal_hdr_init(struct convert *cnv, struct journal_hdr *hdr)
+{
+	struct pool_hdr *phdr = (struct pool_hdr *)cnv->addr;
+
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->signature, JOURNAL_SIG, sizeof(JOURNAL_SIG));
+	memcpy(hdr->poolset_uuid, phdr->poolset_uuid, POOL_HDR_UUID_LEN);
+	hdr->pool_size = cnv->size;
+	hdr->major = cnv->ops ? cnv->ops->major : 0;
+	hdr->nsteps = cnv->nsteps;
+}
+
+/*
+ * journal_create -- (internal) create the journal of the conversion
+ *
+ * The directory is flushed as well, so the journal cannot disappear after
+ * the pool is modified.
+ */
+static int
+journal_create(struct convert *cnv)
+{
+	struct journal_hdr hdr;
+	journal_hdr_init(cnv, &hdr);
+	util_checksum(&hdr, sizeof(hdr), &hdr.checksum, 1);
+
+	cnv->jfd = open(cnv->jpath, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (cnv->jfd < 0) {
+		ERR("!open %s", cnv->jpath);
+		return -1;
+	}
+
+	if (write(cnv->jfd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		ERR("!write %s", cnv->jpath);
+		goto err;
+	}
+	if (fdatasync(cnv->jfd)) {
+		ERR("!fdatasync %s", cnv->jpath);
+		goto err;
+	}
+
+	char *path = strdup(cnv->jpath);
+	if (!path) {
+		ERR("!strdup");
+		goto err;
+	}
+	int dfd = open(dirname(path), O_RDONLY);
+	free(path);
+	if (dfd < 0 || fsync(dfd)) {
+		ERR("!fsync %s", cnv->jpath);
+		if (dfd >= 0)
+			(void) close(dfd);
+		goto err;
+	}
+	(void) close(dfd);
+
+	cnv->jsize = sizeof(hdr);
+	cnv->stats->journal_bytes += sizeof(hdr);
+	return 0;
+
+err:
+	(void) close(cnv->jfd);
+	(void) unlink(cnv->jpath);
+	cnv->jfd = -1;
+	return -1;
+}
+
+/*
+ * journal_remove -- (internal) close and remove the journal
+ */
+static void
+journal_remove(struct convert *cnv)
+{
+	if (cnv->jfd < 0)
+		return;
+
+	(void) close(cnv->jfd);
+	cnv->jfd = -1;
+	if (unlink(cnv->jpath))
+		ERR("!unlink %s", cnv->jpath);
+}
+
+/*
+ * journal_rollback -- (internal) restore old content of the modified ranges
+ *
+ * The records are read up to the first torn one and applied in the reverse
+ * order. If all is not set and the conversion has not been aborted the
+ * records of the steps marked as done are skipped. Returns number of the
+ * steps rolled back or -1 on error.
+ */
+static int
+journal_rollback(struct convert *cnv, int all)
+{
+	uint64_t *offs = NULL;
+	size_t noffs = 0;
+	size_t max_offs = 0;
+	uint8_t *undone = NULL;
+	int ret = -1;
+
+	memset(cnv->done, 0, cnv->nsteps);
+
+	uint64_t off = sizeof(struct journal_hdr);
+	struct journal_rec rec;
+	while (pread(cnv->jfd, &rec, sizeof(rec), (off_t)off) ==
+			sizeof(rec)) {
+		if (!util_checksum(&rec, sizeof(rec), &rec.checksum, 0) ||
+				rec.step >= cnv->nsteps)
+			break;
+
+		if (rec.type == JOURNAL_REC_DONE) {
+			cnv->done[rec.step] = 1;
+			off += sizeof(rec);
+			continue;
+		} else if (rec.type == JOURNAL_REC_ABORT) {
+			/* nothing is appended after the abort record */
+			all = 1;
+			off += sizeof(rec);
+			break;
+		} else if (rec.type != JOURNAL_REC_UNDO ||
+				!convert_part_range(cnv, rec.part, rec.offset,
+					rec.len)) {
+			break;
+		}
+
+		if (noffs == max_offs) {
+			size_t max = max_offs ? 2 * max_offs : 64;
+			uint64_t *o = realloc(offs, max * sizeof(*o));
+			if (!o) {
+				ERR("!realloc");
+				goto out;
+			}
+			offs = o;
+			max_offs = max;
+		}
+		offs[noffs++] = off;
+		off += sizeof(rec) + roundup(rec.len, JOURNAL_ALIGN);
+	}
+
+	/* the records past the torn one are never valid */
+	cnv->jsize = off;
+
+	undone = calloc(cnv->nsteps, sizeof(*undone));
+	if (!undone) {
+		ERR("!calloc");
+		goto out;
+	}
+
+	while (noffs--) {
+		off = offs[noffs];
+		if (pread(cnv->jfd, &rec, sizeof(rec), (off_t)off) !=
+				sizeof(rec)) {
+			ERR("!pread %s", cnv->jpath);
+			goto out;
+		}
+		if (!all && cnv->done[rec.step])
+			continue;
+
+		size_t dlen = roundup(rec.len, JOURNAL_ALIGN);
+		char *data = malloc(dlen);
+		if (!data) {
+			ERR("!malloc");
+			goto out;
+		}
+
+		uint64_t csum;
+		if (pread(cnv->jfd, data, dlen, (off_t)(off + sizeof(rec))) !=
+				(ssize_t)dlen) {
+			/* the record checksum does not cover the data */
+			free(data);
+			ERR("!pread %s", cnv->jpath);
+			goto out;
+		}
+		util_checksum(data, dlen, &csum, 1);
+		if (csum != rec.data_checksum) {
+			free(data);
+			ERR("%s: corrupted record at offset %" PRIu64,
+				cnv->jpath, off);
+			errno = EINVAL;
+			goto out;
+		}
+
+		char *dest = convert_part_range(cnv, rec.part, rec.offset,
+			rec.len);
+		memcpy(dest, data, rec.len);
+		free(data);
+		if (convert_persist(cnv, dest, rec.len))
+			goto out;
+
+		undone[rec.step] = 1;
+	}
+
+	ret = 0;
+	for (unsigned s = 0; s < cnv->nsteps; ++s)
+		ret += undone[s];
+
+	/* nothing is left to roll back, all the steps are run again */
+	if (all) {
+		memset(cnv->done, 0, cnv->nsteps);
+		cnv->jsize = sizeof(struct journal_hdr);
+	}
+
+out:
+	free(undone);
+	free(offs);
+	return ret;
+}
+
+/*
+ * convert_find -- (internal) find the conversion from the given version
+ */
+static const struct convert_ops *
+convert_find(struct convert *cnv, uint32_t major)
+{
+	static const struct convert_ops *convs[] = {
+		&convert_obj_v1_v2,
+	};
+
+	struct pool_hdr *hdr = (struct pool_hdr *)cnv->addr;
+	for (size_t i = 0; i < ARRAY_SIZE(convs); ++i) {
+		if (convs[i]->major == major && memcmp(hdr->signature,
+				convs[i]->signature, POOL_HDR_SIG_LEN) == 0)
+			return convs[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * convert_setup -- (internal) set up the conversion for the pool
+ */
+static int
+convert_setup(struct convert *cnv, const struct convert_ops *ops)
+{
+	cnv->ops = ops;
+	cnv->nsteps = CONVERT_NSTEPS;
+
+	free(cnv->done);
+	cnv->done = calloc(cnv->nsteps, sizeof(*cnv->done));
+	if (!cnv->done) {
+		ERR("!calloc");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * journal_open -- (internal) open the journal of the interrupted conversion
+ *
+ * Returns 1 if the conversion is resumed, 0 if there is no valid journal.
+ */
+static int
+journal_open(struct convert *cnv)
+{
+	cnv->jfd = open(cnv->jpath, O_RDWR);
+	if (cnv->jfd < 0) {
+		if (errno == ENOENT)
+			return 0;
+		ERR("!open %s", cnv->jpath);
+		return -1;
+	}
+
+	struct journal_hdr hdr;
+	if (read(cnv->jfd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+			!util_checksum(&hdr, sizeof(hdr), &hdr.checksum, 0)) {
+		/* the header is flushed before the pool is modified */
+		LOG(2, "%s: incomplete journal, removing", cnv->jpath);
+		journal_remove(cnv);
+		return 0;
+	}
+
+	struct journal_hdr expected;
+	journal_hdr_init(cnv, &expected);
+	if (memcmp(hdr.signature, expected.signature, JOURNAL_SIG_LEN) ||
+			memcmp(hdr.poolset_uuid, expected.poolset_uuid,
+				POOL_HDR_UUID_LEN) ||
+			hdr.pool_size != expected.pool_size) {
+		ERR("%s: journal does not match the pool", cnv->jpath);
+		goto err;
+	}
+
+	const struct convert_ops *ops = convert_find(cnv, hdr.major);
+	if (!ops) {
+		ERR("%s: unknown conversion from version %u", cnv->jpath,
+			hdr.major);
+		goto err;
+	}
+
+	if (convert_setup(cnv, ops))
+		goto err_close;
+
+	if (cnv->nsteps != hdr.nsteps) {
+		ERR("%s: journal does not match the pool", cnv->jpath);
+		goto err;
+	}
+
+	int nsteps = journal_rollback(cnv, 0);
+	if (nsteps < 0)
+		goto err_close;
+
+	if (ftruncate(cnv->jfd, (off_t)cnv->jsize)) {
+		ERR("!ftruncate %s", cnv->jpath);
+		goto err_close;
+	}
+	if (fdatasync(cnv->jfd)) {
+		ERR("!fdatasync %s", cnv->jpath);
+		goto err_close;
+	}
+
+	LOG(3, "%s: resuming the conversion, %d step(s) rolled back",
+		cnv->jpath, nsteps);
+	cnv->stats->nrolled_back += (unsigned)nsteps;
+	return 1;
+
+err:
+	errno = EINVAL;
+err_close:
+	(void) close(cnv->jfd);
+	cnv->jfd = -1;
+	return -1;
+}
+
+/*
+ * convert_run -- (internal) run all the steps not done yet
+ */
+static int
+convert_run(struct convert *cnv)
+{
+	LOG(3, "version %u nsteps %u", cnv->ops->major, cnv->nsteps);
+
+	if (convert_step(cnv, 0) || convert_step(cnv, 1)) {
+		int oerrno = errno;
+
+		/*
+		 * The steps marked as done may be rolled back only after
+		 * the abort is recorded, otherwise the next run would resume
+		 * the conversion of a partially restored pool. If it cannot
+		 * be recorded, only the failed steps are rolled back and the
+		 * next run resumes the conversion.
+		 */
+		struct journal_rec rec = {
+			.type = JOURNAL_REC_ABORT,
+		};
+		if (journal_append(cnv, &rec, NULL)) {
+			(void) journal_rollback(cnv, 0);
+			ERR("%s: cannot abort the conversion", cnv->jpath);
+			(void) close(cnv->jfd);
+			cnv->jfd = -1;
+		} else if (journal_rollback(cnv, 1) < 0) {
+			/* keep the journal to let the next run fix it */
+			ERR("%s: cannot roll back the conversion",
+				cnv->jpath);
+			(void) close(cnv->jfd);
+			cnv->jfd = -1;
+		}
+		errno = oerrno;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * pool_convert -- convert the pool to the latest layout version
+ */
+int
+pool_convert(struct pool_data *pool, struct pmempool_convert_stats *stats)
+{
+	LOG(3, NULL);
+
+	struct pool_set_file *file = pool->set_file;
+	if (!file->poolset || file->poolset->nreplicas > 1) {
+		ERR("conversion of the pool replicas is not supported");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	struct convert cnv = {
+		.file = file,
+		.addr = file->addr,
+		.size = file->size,
+		.is_pmem = file->poolset->replica[0]->is_pmem,
+		.jfd = -1,
+		.stats = stats,
+	};
+	memset(stats, 0, sizeof(*stats));
+
+	int ret = -1;
+	int oerrno;
+	size_t len = strlen(file->fname) + sizeof(JOURNAL_SUFFIX);
+	cnv.jpath = malloc(len);
+	if (!cnv.jpath) {
+		ERR("!malloc");
+		goto out;
+	}
+	snprintf(cnv.jpath, len, "%s%s", file->fname, JOURNAL_SUFFIX);
+
+	/* headers of the parts other than the first one are not mapped */
+	if (pool_set_file_map_headers(file, 0))
+		goto out;
+
+	int resumed = journal_open(&cnv);
+	if (resumed < 0)
+		goto out_unmap;
+
+	struct pool_hdr *hdr = (struct pool_hdr *)cnv.addr;
+	stats->from_major = resumed ? cnv.ops->major : le32toh(hdr->major);
+	if (!resumed) {
+		const struct convert_ops *ops =
+			convert_find(&cnv, stats->from_major);
+		if (!ops) {
+			ERR("no conversion from version %u of the pool",
+				stats->from_major);
+			errno = ENOTSUP;
+			goto out_unmap;
+		}
+		if (convert_setup(&cnv, ops))
+			goto out_unmap;
+	}
+
+	while (cnv.ops) {
+		if (cnv.jfd < 0 && journal_create(&cnv))
+			goto out_unmap;
+
+		if (convert_run(&cnv))
+			goto out_close;
+
+		journal_remove(&cnv);
+
+		/* continue with the next version if there is a conversion */
+		const struct convert_ops *ops =
+			convert_find(&cnv, le32toh(hdr->major));
+		if (!ops)
+			break;
+		if (convert_setup(&cnv, ops))
+			goto out_unmap;
+	}
+
+	stats->to_major = le32toh(hdr->major);
+	ret = 0;
+
+out_close:
+	/* the journal is still open only if the conversion was rolled back */
+	journal_remove(&cnv);
+out_unmap:
+	pool_set_file_unmap_headers(file);
+out:
+	oerrno = errno;
+	free(cnv.done);
+	free(cnv.jpath);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	stats->nsecs = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+		(uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+
+	errno = oerrno;
+	return ret;
+}
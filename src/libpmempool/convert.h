@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * convert.h -- internal definitions for the pool format conversion
+ *
+ * A conversion from one major version of the pool layout to the next one
+ * is split into steps. The prepare step runs first and the finish step runs
+ * last. Before a step modifies any part of the pool it has to register the
+ * range with convert_add_range(), which saves its old content in the
+ * conversion journal. A step interrupted by a crash is rolled back from the
+ * journal and run again by the next conversion of the pool.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct convert_ctx;
+
+/*
+ * convert_ops -- conversion of the pool layout from the given major version
+ */
+struct convert_ops {
+	const char *signature;	/* signature of the pool header */
+	uint32_t major;		/* source major version */
+
+	/* optional, runs first */
+	int (*prepare)(struct convert_ctx *ctx);
+	/* optional, runs before the pool header is updated */
+	int (*finish)(struct convert_ctx *ctx);
+};
+
+void *convert_addr(struct convert_ctx *ctx);
+size_t convert_size(struct convert_ctx *ctx);
+int convert_add_range(struct convert_ctx *ctx, void *addr, size_t len);
+
+extern const struct convert_ops convert_obj_v1_v2;
+
+struct pool_data;
+struct pmempool_convert_stats;
+
+int pool_convert(struct pool_data *pool,
+	struct pmempool_convert_stats *stats);
@@ -31,14 +31,18 @@
  */
 
 /*
- * convert_obj_v1_v2.c -- pmempool convert command source file
+ * convert_obj_v1_v2.c -- conversion of the pmemobj pool from version 1 to 2
+ *
+ * The layout of the version 1 is defined here, so the definitions used by
+ * the current version of the library do not affect the conversion.
  */
 
 #include <stdio.h>
 #include <inttypes.h>
 #include <string.h>
-#include <assert.h>
-#include <endian.h>
+#include <errno.h>
+
+#include "out.h"
 #include "convert.h"
 
 #define PMEMOBJ_MAX_LAYOUT ((size_t)1024)
@@ -201,13 +205,10 @@ struct tx_range_cache {
 #define REDO_FINISH_FLAG	((uint64_t)1<<0)
 #define REDO_FLAG_MASK		(~REDO_FINISH_FLAG)
 
-static struct pmemobjpool *pop;
-static struct heap_layout *heap;
+#define D_RW(_ctx, _oid) pmemobj_direct((_ctx), (_oid))
 
-#define D_RW pmemobj_direct
-
-#define D_RW_OBJ(_oid)\
-((struct object *)((uint64_t)D_RW((_oid)) - sizeof(struct object)))
+#define D_RW_OBJ(_ctx, _oid)\
+((struct object *)((uint64_t)D_RW((_ctx), (_oid)) - sizeof(struct object)))
 
 #define BITS_PER_VALUE 64U
 #define MAX_CACHELINE_ALIGNMENT 40 /* run alignment, 5 cachelines */
@@ -280,6 +281,7 @@ struct heap_layout {
 };
 
 #define ZONE_MAX_SIZE (sizeof(struct zone) + sizeof(struct chunk) * MAX_CHUNK)
+#define ZONE_MIN_SIZE (sizeof(struct zone) + sizeof(struct chunk))
 
 #define ZID_TO_ZONE(layoutp, zone_id)\
 	((struct zone *)((uintptr_t)&(((struct heap_layout *)(layoutp))->zone0)\
@@ -288,10 +290,77 @@ struct heap_layout {
 #define CALC_SIZE_IDX(_unit_size, _size)\
 ((uint32_t)(((_size - 1) / _unit_size) + 1))
 
+#define SOURCE_MAJOR_VERSION 1
+
+/*
+ * pmemobj_direct -- return address of the object in the pool
+ */
 static void *
-pmemobj_direct(PMEMoid oid)
+pmemobj_direct(struct convert_ctx *ctx, PMEMoid oid)
+{
+	return (char *)convert_addr(ctx) + oid.off;
+}
+
+/*
+ * obj_heap -- return address of the heap
+ */
+static struct heap_layout *
+obj_heap(struct convert_ctx *ctx)
 {
-	return (char *)pop + oid.off;
+	struct pmemobjpool *pop = convert_addr(ctx);
+	return (struct heap_layout *)((char *)pop + pop->heap_offset);
+}
+
+/*
+ * heap_max_zone -- return number of zones the heap fits
+ */
+static unsigned
+heap_max_zone(size_t size)
+{
+	unsigned max_zone = 0;
+	if (size < sizeof(struct heap_header))
+		return 0;
+	size -= sizeof(struct heap_header);
+
+	while (size >= ZONE_MIN_SIZE) {
+		max_zone++;
+		size -= size <= ZONE_MAX_SIZE ? size : ZONE_MAX_SIZE;
+	}
+
+	return max_zone;
+}
+
+/*
+ * obj_valid_off -- check if the object at the offset lies within the heap
+ */
+static int
+obj_valid_off(struct convert_ctx *ctx, uint64_t offset)
+{
+	struct pmemobjpool *pop = convert_addr(ctx);
+	uint64_t heap_end = pop->heap_offset + pop->heap_size;
+
+	if (heap_end > convert_size(ctx) || heap_end < pop->heap_offset ||
+			offset < pop->heap_offset + sizeof(struct object) ||
+			offset >= heap_end) {
+		ERR("invalid object offset 0x%" PRIx64, offset);
+		errno = EINVAL;
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * obj_set -- journal and set the 64-bit value
+ */
+static int
+obj_set(struct convert_ctx *ctx, uint64_t *val, uint64_t value)
+{
+	if (convert_add_range(ctx, val, sizeof(*val)))
+		return -1;
+
+	*val = value;
+	return 0;
 }
 
 static size_t
@@ -308,86 +377,146 @@ redo_log_nflags(struct redo_log *redo, size_t nentries)
 	return ret;
 }
 
-static void
-redo_recover(struct redo_log *redo, size_t nentries)
+static int
+redo_recover(struct convert_ctx *ctx, struct redo_log *redo, size_t nentries)
 {
 	size_t nflags = redo_log_nflags(redo, nentries);
 	if (nflags == 0)
-		return;
+		return 0;
 
-	assert(nflags != 1);
+	if (nflags != 1) {
+		ERR("invalid redo log");
+		errno = EINVAL;
+		return -1;
+	}
 
-	uint64_t *val;
+	char *base = convert_addr(ctx);
 	while ((redo->offset & REDO_FINISH_FLAG) == 0) {
-		val = (uint64_t *)((uintptr_t)pop + redo->offset);
-		*val = redo->value;
+		if (obj_set(ctx, (uint64_t *)(base + redo->offset),
+				redo->value))
+			return -1;
 
 		redo++;
 	}
 
 	uint64_t offset = redo->offset & REDO_FLAG_MASK;
-	val = (uint64_t *)((uintptr_t)pop + offset);
-	*val = redo->value;
+	return obj_set(ctx, (uint64_t *)(base + offset), redo->value);
 }
 
 static int
-pfree(uint64_t *off)
+pfree(struct convert_ctx *ctx, uint64_t offset)
 {
-	uint64_t offset = *off;
 	if (offset == 0)
 		return 0;
 
+	if (!obj_valid_off(ctx, offset))
+		return -1;
+
 	PMEMoid oid;
 	oid.off = offset;
 
-	struct allocation_header *hdr = &D_RW_OBJ(oid)->alloch;
+	struct allocation_header *hdr = &D_RW_OBJ(ctx, oid)->alloch;
+
+	struct pmemobjpool *pop = convert_addr(ctx);
+	if (hdr->zone_id >= heap_max_zone(pop->heap_size)) {
+		ERR("invalid zone %u of object at offset 0x%" PRIx64,
+			hdr->zone_id, offset);
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct zone *z = ZID_TO_ZONE(obj_heap(ctx), hdr->zone_id);
+	if (hdr->chunk_id >= z->header.size_idx ||
+			hdr->chunk_id >= MAX_CHUNK) {
+		ERR("invalid chunk %u of object at offset 0x%" PRIx64,
+			hdr->chunk_id, offset);
+		errno = EINVAL;
+		return -1;
+	}
 
-	struct zone *z = ZID_TO_ZONE(heap, hdr->zone_id);
 	struct chunk_header *chdr = &z->chunk_headers[hdr->chunk_id];
 	if (chdr->type == CHUNK_TYPE_USED) {
+		if (convert_add_range(ctx, &chdr->type, sizeof(chdr->type)))
+			return -1;
 		chdr->type = CHUNK_TYPE_FREE;
 		return 0;
 	} else if (chdr->type != CHUNK_TYPE_RUN) {
-		assert(0);
+		ERR("invalid chunk type %u of object at offset 0x%" PRIx64,
+			chdr->type, offset);
+		errno = EINVAL;
+		return -1;
 	}
 
 	struct chunk_run *run =
 		(struct chunk_run *)&z->chunks[hdr->chunk_id].data;
+	if ((uintptr_t)hdr < (uintptr_t)&run->data ||
+			(uintptr_t)hdr >= (uintptr_t)&run->data[RUNSIZE] ||
+			run->block_size == 0 || hdr->size == 0) {
+		ERR("invalid run block of object at offset 0x%" PRIx64,
+			offset);
+		errno = EINVAL;
+		return -1;
+	}
+
 	uintptr_t diff = (uintptr_t)hdr - (uintptr_t)&run->data;
 	uint64_t block_off = (uint16_t)((size_t)diff / run->block_size);
 	uint64_t size_idx = CALC_SIZE_IDX(run->block_size, hdr->size);
 
-	uint64_t bmask = ((1ULL << size_idx) - 1ULL) <<
-			(block_off % BITS_PER_VALUE);
-
 	uint64_t bpos = block_off / BITS_PER_VALUE;
+	uint64_t bit = block_off % BITS_PER_VALUE;
+	if (bpos >= MAX_BITMAP_VALUES || size_idx > BITS_PER_VALUE - bit) {
+		ERR("invalid run block of object at offset 0x%" PRIx64,
+			offset);
+		errno = EINVAL;
+		return -1;
+	}
 
-	run->bitmap[bpos] &= ~bmask;
-	*off = 0;
+	uint64_t bmask = size_idx == BITS_PER_VALUE ? UINT64_MAX :
+			((1ULL << size_idx) - 1ULL) << bit;
 
-	return 0;
+	return obj_set(ctx, &run->bitmap[bpos], run->bitmap[bpos] & ~bmask);
 }
 
 static int
-lane_alloc_recover(struct allocator_lane_section *alloc)
+lane_alloc_recover(struct convert_ctx *ctx,
+	struct allocator_lane_section *alloc)
 {
-	redo_recover(alloc->redo, REDO_LOG_SIZE);
+	return redo_recover(ctx, alloc->redo, REDO_LOG_SIZE);
+}
 
-	return 0;
+static int
+lane_list_recover(struct convert_ctx *ctx, struct lane_list_section *list)
+{
+	if (redo_recover(ctx, list->redo, REDO_NUM_ENTRIES))
+		return -1;
+
+	if (list->obj_offset == 0)
+		return 0;
+
+	if (pfree(ctx, list->obj_offset))
+		return -1;
+
+	return obj_set(ctx, &list->obj_offset, 0);
 }
 
+/*
+ * is_zeroed -- check if the range contains only zeroes
+ */
 static int
-lane_list_recover(struct lane_list_section *list)
+is_zeroed(const void *addr, size_t len)
 {
-	redo_recover(list->redo, REDO_NUM_ENTRIES);
-	pfree(&list->obj_offset);
+	const unsigned char *p = addr;
+	for (size_t i = 0; i < len; ++i) {
+		if (p[i])
+			return 0;
+	}
 
-	return 0;
+	return 1;
 }
 
-static void
-foreach_clear_undo_list(struct list_head *head,
-	void (*cb)(PMEMoid oid), int free)
+static int
+foreach_clear_undo_list(struct convert_ctx *ctx, struct list_head *head,
+	int (*cb)(struct convert_ctx *ctx, PMEMoid oid), int free)
 {
 	PMEMoid iter = head->pe_first;
 	PMEMoid next = {0, 0};
@@ -397,148 +526,172 @@ foreach_clear_undo_list(struct list_head *head,
 	 * initialized with zeroes - same as the first element of an empty list
 	 */
 	while (next.off != head->pe_first.off) {
-		next = D_RW_OBJ(iter)->oobh.oob.pe_next;
+		if (!obj_valid_off(ctx, iter.off))
+			return -1;
+
+		next = D_RW_OBJ(ctx, iter)->oobh.oob.pe_next;
 
-		if (cb)
-			cb(iter);
+		if (cb && cb(ctx, iter))
+			return -1;
 
-		if (free)
-			pfree(&iter.off);
-		else
-			memset(&D_RW_OBJ(iter)->oobh.oob, 0,
-				sizeof(struct list_entry));
+		if (free) {
+			if (pfree(ctx, iter.off))
+				return -1;
+		} else {
+			struct list_entry *entry =
+				&D_RW_OBJ(ctx, iter)->oobh.oob;
+			if (convert_add_range(ctx, entry, sizeof(*entry)))
+				return -1;
+			memset(entry, 0, sizeof(*entry));
+		}
 
 		iter = next;
 	};
 
+	/* clearing the lane pages which are zeroed anyway is not journaled */
+	if (is_zeroed(head, sizeof(*head)))
+		return 0;
+
+	if (convert_add_range(ctx, head, sizeof(*head)))
+		return -1;
 	memset(head, 0, sizeof(*head));
+
+	return 0;
 }
 
-static void
-restore_range(struct tx_range *r)
+static int
+restore_range(struct convert_ctx *ctx, struct tx_range *r)
 {
-	void *dest = (char *)pop + r->offset;
+	void *dest = (char *)convert_addr(ctx) + r->offset;
+	if (convert_add_range(ctx, dest, r->size))
+		return -1;
+
 	memcpy(dest, r->data, r->size);
+	return 0;
 }
 
-static void
-restore_set_range(PMEMoid set)
+static int
+restore_set_range(struct convert_ctx *ctx, PMEMoid set)
 {
-	restore_range(D_RW(set));
+	return restore_range(ctx, D_RW(ctx, set));
 }
 
-static void
-restore_set_cache_range(PMEMoid cache)
+static int
+restore_set_cache_range(struct convert_ctx *ctx, PMEMoid cache)
 {
-	struct tx_range_cache *c = D_RW(cache);
+	struct tx_range_cache *c = D_RW(ctx, cache);
 	struct tx_range *range = NULL;
 	for (int i = 0; i < MAX_CACHED_RANGES; ++i) {
 		range = (struct tx_range *)&c->range[i];
 		if (range->offset == 0 || range->size == 0)
 			break;
 
-		restore_range(range);
+		if (restore_range(ctx, range))
+			return -1;
 	}
+
+	return 0;
 }
 
 static int
-lane_tx_abort(struct lane_tx_layout *tx)
+lane_tx_abort(struct convert_ctx *ctx, struct lane_tx_layout *tx)
 {
-	foreach_clear_undo_list(&tx->undo_alloc,
-		NULL, 1);
-	foreach_clear_undo_list(&tx->undo_free,
-		NULL, 0);
-	foreach_clear_undo_list(&tx->undo_set,
-		restore_set_range, 1);
-	foreach_clear_undo_list(&tx->undo_set_cache,
+	if (foreach_clear_undo_list(ctx, &tx->undo_alloc,
+			NULL, 1))
+		return -1;
+	if (foreach_clear_undo_list(ctx, &tx->undo_free,
+			NULL, 0))
+		return -1;
+	if (foreach_clear_undo_list(ctx, &tx->undo_set,
+			restore_set_range, 1))
+		return -1;
+	return foreach_clear_undo_list(ctx, &tx->undo_set_cache,
 		restore_set_cache_range, 1);
-
-	return 0;
 }
 
 static int
-lane_tx_commit(struct lane_tx_layout *tx)
+lane_tx_commit(struct convert_ctx *ctx, struct lane_tx_layout *tx)
 {
-	foreach_clear_undo_list(&tx->undo_alloc, NULL, 0);
-	foreach_clear_undo_list(&tx->undo_free, NULL, 1);
-	foreach_clear_undo_list(&tx->undo_set, NULL, 1);
-	foreach_clear_undo_list(&tx->undo_set_cache, NULL, 1);
-
-	return 0;
+	if (foreach_clear_undo_list(ctx, &tx->undo_alloc, NULL, 0))
+		return -1;
+	if (foreach_clear_undo_list(ctx, &tx->undo_free, NULL, 1))
+		return -1;
+	if (foreach_clear_undo_list(ctx, &tx->undo_set, NULL, 1))
+		return -1;
+	return foreach_clear_undo_list(ctx, &tx->undo_set_cache, NULL, 1);
 }
 
 static int
-lane_tx_recover(struct lane_tx_layout *tx)
+lane_tx_recover(struct convert_ctx *ctx, struct lane_tx_layout *tx)
 {
 	if (tx->state == TX_STATE_NONE) { /* abort */
-		return lane_tx_abort(tx);
+		return lane_tx_abort(ctx, tx);
 	} else if (tx->state == TX_STATE_COMMITTED) {
-		tx->state = TX_STATE_NONE;
+		if (obj_set(ctx, &tx->state, TX_STATE_NONE))
+			return -1;
 
-		return lane_tx_commit(tx);
+		return lane_tx_commit(ctx, tx);
 	} else {
+		ERR("invalid transaction state %" PRIu64, tx->state);
+		errno = EINVAL;
 		return -1;
 	}
 }
 
-#define SOURCE_MAJOR_VERSION 1
-#define TARGET_MAJOR_VERSION 2
+/*
+ * obj_lanes -- return address of the lanes
+ */
+static struct lane_layout *
+obj_lanes(struct convert_ctx *ctx)
+{
+	struct pmemobjpool *pop = convert_addr(ctx);
+	return (struct lane_layout *)((char *)pop + pop->lanes_offset);
+}
 
+/*
+ * obj_v1_v2_prepare -- recover all the lanes as the version 1 would do
+ */
 static int
-util_checksum(void *addr, size_t len, uint64_t *csump, int insert)
+obj_v1_v2_prepare(struct convert_ctx *ctx)
 {
-	uint32_t *p32 = addr;
-	uint32_t *p32end = (uint32_t *)((char *)addr + len);
-	uint32_t lo32 = 0;
-	uint32_t hi32 = 0;
-	uint64_t csum;
-
-	while (p32 < p32end)
-		if (p32 == (uint32_t *)csump) {
-			/* lo32 += 0; treat first 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-			/* lo32 += 0; treat second 32-bits as zero */
-			p32++;
-			hi32 += lo32;
-		} else {
-			lo32 += le32toh(*p32);
-			++p32;
-			hi32 += lo32;
-		}
+	struct pmemobjpool *pop = convert_addr(ctx);
+	struct lane_layout *lanes = obj_lanes(ctx);
 
-	csum = (uint64_t)hi32 << 32 | lo32;
-
-	if (insert) {
-		*csump = htole64(csum);
-		return 1;
+	for (uint64_t i = 0; i < pop->nlanes; ++i) {
+		if (lane_alloc_recover(ctx, (struct allocator_lane_section *)
+				&lanes[i].sections[LANE_SECTION_ALLOCATOR]))
+			return -1;
+		if (lane_list_recover(ctx, (struct lane_list_section *)
+				&lanes[i].sections[LANE_SECTION_LIST]))
+			return -1;
+		if (lane_tx_recover(ctx, (struct lane_tx_layout *)
+				&lanes[i].sections[LANE_SECTION_TRANSACTION]))
+			return -1;
 	}
 
-	return *csump == htole64(csum);
+	return 0;
 }
 
-int
-convert_v1_v2(void *addr)
+/*
+ * obj_v1_v2_finish -- clear the lanes, the version 2 has different layout
+ */
+static int
+obj_v1_v2_finish(struct convert_ctx *ctx)
 {
-	pop = addr;
-	heap = (struct heap_layout *)((char *)addr + pop->heap_offset);
-	if (le32toh(pop->hdr.major) != SOURCE_MAJOR_VERSION)
-		return -1;
-
-	pop->hdr.major = htole32(TARGET_MAJOR_VERSION);
-	util_checksum(&pop->hdr, sizeof(pop->hdr), &pop->hdr.checksum, 1);
+	struct pmemobjpool *pop = convert_addr(ctx);
+	struct lane_layout *lanes = obj_lanes(ctx);
+	size_t len = pop->nlanes * sizeof(struct lane_layout);
 
-	struct lane_layout *lanes =
-		(struct lane_layout *)((char *)addr + pop->lanes_offset);
-	for (uint64_t i = 0; i < pop->nlanes; ++i) {
-		lane_alloc_recover((struct allocator_lane_section *)
-			&lanes[i].sections[LANE_SECTION_ALLOCATOR]);
-		lane_list_recover((struct lane_list_section *)
-			&lanes[i].sections[LANE_SECTION_LIST]);
-		lane_tx_recover((struct lane_tx_layout *)
-			&lanes[i].sections[LANE_SECTION_TRANSACTION]);
-	}
-	memset(lanes, 0, pop->nlanes * sizeof(struct lane_layout));
+	if (convert_add_range(ctx, lanes, len))
+		return -1;
 
+	memset(lanes, 0, len);
 	return 0;
 }
+
+const struct convert_ops convert_obj_v1_v2 = {
+	.signature = "PMEMOBJ",
+	.major = SOURCE_MAJOR_VERSION,
+	.prepare = obj_v1_v2_prepare,
+	.finish = obj_v1_v2_finish,
+};
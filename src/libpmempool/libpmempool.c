@@ -44,6 +44,7 @@
 #include "pmempool.h"
 #include "pool.h"
 #include "check.h"
+#include "convert.h"
 
 /*
  * libpmempool_init -- load-time initialization for libpmempool
@@ -124,6 +125,9 @@ pmempool_ppc_set_default(PMEMpoolcheck *ppc)
 		.data		= NULL,
 		.pool		= NULL,
 		.result		= CHECK_RESULT_CONSISTENT,
+		.nthreads	= 0,
+		.checkpoint_path = NULL,
+		.started	= 0,
 	};
 	*ppc = ppc_default;
 }
@@ -224,6 +228,54 @@ error_path_malloc:
 	return NULL;
 }
 
+/*
+ * pmempool_check_set_threads -- set number of threads used by the check
+ */
+int
+pmempool_check_set_threads(PMEMpoolcheck *ppc, unsigned nthreads)
+{
+	LOG(3, "ppc %p nthreads %u", ppc, nthreads);
+	ASSERTne(ppc, NULL);
+
+	if (ppc->started) {
+		ERR("check already started");
+		errno = EBUSY;
+		return -1;
+	}
+
+	ppc->nthreads = nthreads;
+	return 0;
+}
+
+/*
+ * pmempool_check_set_checkpoint -- set path of the check progress file
+ */
+int
+pmempool_check_set_checkpoint(PMEMpoolcheck *ppc, const char *path)
+{
+	LOG(3, "ppc %p path %s", ppc, path);
+	ASSERTne(ppc, NULL);
+
+	if (ppc->started) {
+		ERR("check already started");
+		errno = EBUSY;
+		return -1;
+	}
+
+	char *checkpoint_path = NULL;
+	if (path != NULL) {
+		checkpoint_path = strdup(path);
+		if (!checkpoint_path) {
+			ERR("!strdup");
+			return -1;
+		}
+	}
+
+	free(ppc->checkpoint_path);
+	ppc->checkpoint_path = checkpoint_path;
+	return 0;
+}
+
 /*
  * pmempool_check -- continue check till produce status to consume for caller
  */
@@ -233,6 +285,8 @@ pmempool_check(PMEMpoolcheck *ppc)
 	LOG(3, NULL);
 	ASSERTne(ppc, NULL);
 
+	ppc->started = 1;
+
 	struct check_status *result;
 	do {
 		result = check_step(ppc);
@@ -256,6 +310,7 @@ pmempool_check_end(PMEMpoolcheck *ppc)
 	check_fini(ppc);
 	free(ppc->path);
 	free(ppc->backup_path);
+	free(ppc->checkpoint_path);
 	free(ppc);
 
 	switch (result) {
@@ -275,3 +330,76 @@ pmempool_check_end(PMEMpoolcheck *ppc)
 			return PMEMPOOL_CHECK_RESULT_ERROR;
 	}
 }
+
+/*
+ * pmempool_copy -- copy the pool to a new file
+ */
+int
+pmempool_copy(const char *src_path, const char *dst_path, unsigned nthreads,
+	unsigned flags)
+{
+	LOG(3, "src_path %s dst_path %s nthreads %u flags %x", src_path,
+		dst_path, nthreads, flags);
+
+	if (flags & ~(unsigned)PMEMPOOL_COPY_SPARSE) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* the pool is opened read-only as for the check without repair */
+	PMEMpoolcheck ppc;
+	pmempool_ppc_set_default(&ppc);
+	ppc.path = (char *)src_path;
+	ppc.args.path = src_path;
+
+	struct pool_data *pool = pool_data_alloc(&ppc);
+	if (pool == NULL) {
+		/* in case errno not set by any of the used functions */
+		if (errno == 0)
+			errno = EINVAL;
+		return -1;
+	}
+
+	int ret = pool_copy(pool, dst_path, nthreads, flags);
+
+	int oerrno = errno;
+	pool_data_free(pool);
+	errno = oerrno;
+	return ret;
+}
+
+/*
+ * pmempool_convert -- convert the pool to the latest layout version
+ */
+int
+pmempool_convert(const char *path, struct pmempool_convert_stats *stats)
+{
+	LOG(3, "path %s stats %p", path, stats);
+
+	struct pmempool_convert_stats local_stats;
+	if (stats == NULL)
+		stats = &local_stats;
+
+	/* the pool is opened for writing as for the check with repair */
+	PMEMpoolcheck ppc;
+	pmempool_ppc_set_default(&ppc);
+	ppc.path = (char *)path;
+	ppc.args.path = path;
+	ppc.args.flags = PMEMPOOL_CHECK_REPAIR;
+
+	struct pool_data *pool = pool_data_alloc(&ppc);
+	if (pool == NULL) {
+		/* in case errno not set by any of the used functions */
+		if (errno == 0)
+			errno = EINVAL;
+		return -1;
+	}
+
+	int ret = pool_convert(pool, stats);
+
+	int oerrno = errno;
+	pool_data_free(pool);
+	errno = oerrno;
+	return ret;
+}
@@ -62,4 +62,10 @@ struct pmempool_check {
 	struct check_data *data;
 	struct pool_data *pool;
 	enum check_result result;
+
+	unsigned nthreads;	/* 0 means one per online CPU */
+	char *checkpoint_path;
+	struct checkpoint_file *checkpoint_files; /* pool files at start */
+	unsigned checkpoint_nfiles;
+	int started;		/* pmempool_check() has been called */
 };
@@ -34,13 +34,20 @@
  * pool.c -- pool processing functions
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#include "libpmem.h"
 #include "libpmemlog.h"
 #include "libpmemblk.h"
 #include "libpmempool.h"
@@ -50,6 +57,12 @@
 #include "pool.h"
 #include "lane.h"
 #include "obj.h"
+#include "redo.h"
+#include "memops.h"
+#include "pmalloc.h"
+#include "list.h"
+#include "heap_layout.h"
+#include "util_pmemobj.h"
 #include "btt.h"
 #include "check_util.h"
 
@@ -67,17 +80,21 @@ pool_btt_lseek(struct pool_data *pool, off_t offset, int whence)
 }
 
 /*
- * pool_btt_read -- (internal) perform read in BTT file mode
+ * pool_btt_pread -- (internal) perform read at given offset in BTT file mode
+ *
+ * It does not move the file offset, so it may be used by many threads at the
+ * same time.
  */
 static inline ssize_t
-pool_btt_read(struct pool_data *pool, void *dst, size_t count)
+pool_btt_pread(struct pool_data *pool, void *dst, size_t count, off_t off)
 {
 	size_t total = 0;
 	ssize_t nread;
 	while (count > total &&
-		(nread = read(pool->set_file->fd, dst, count - total))) {
+		(nread = pread(pool->set_file->fd, dst, count - total,
+			off + (off_t)total))) {
 		if (nread == -1) {
-			ERR("!read");
+			ERR("!pread");
 			return total ? (ssize_t)total : -1;
 		}
 
@@ -508,9 +525,8 @@ pool_read(struct pool_data *pool, void *buff, size_t nbytes, uint64_t off)
 	if (pool->params.type != POOL_TYPE_BTT)
 		memcpy(buff, (char *)pool->set_file->addr + off, nbytes);
 	else {
-		if (pool_btt_lseek(pool, (off_t)off, SEEK_SET) == -1)
-			return -1;
-		if ((size_t)pool_btt_read(pool, buff, nbytes) != nbytes)
+		if ((size_t)pool_btt_pread(pool, buff, nbytes, (off_t)off) !=
+				nbytes)
 			return -1;
 	}
 
@@ -542,66 +558,615 @@ pool_write(struct pool_data *pool, const void *buff, size_t nbytes,
 /* arbitrary size of a buffer used to read and write to / from files */
 #define READ_WRITE_BUFFER_SIZE (128 * 1024 * 1024)
 
+/* skipped regions shorter than this are copied anyway */
+#define COPY_SKIP_MIN ((uint64_t)CHUNKSIZE)
+
+/* unit of work of a single copying thread */
+#define COPY_UNIT_SIZE ((uint64_t)64 << 20)
+
+/* number of BTT Map entries read at once while looking for unused blocks */
+#define COPY_MAP_ENTRIES (64 * 1024)
+
+/*
+ * copy_range -- range of the pool skipped or copied by pool_copy()
+ */
+struct copy_range {
+	uint64_t off;
+	uint64_t len;
+};
+
+/*
+ * copy_ranges -- growable array of ranges
+ */
+struct copy_ranges {
+	struct copy_range *ranges;
+	size_t nranges;
+	size_t maxranges;
+};
+
+/*
+ * copy_ranges_append -- (internal) append range to the array
+ */
+static int
+copy_ranges_append(struct copy_ranges *rs, uint64_t off, uint64_t len)
+{
+	if (rs->nranges == rs->maxranges) {
+		size_t maxranges = rs->maxranges ? 2 * rs->maxranges : 64;
+		struct copy_range *ranges = realloc(rs->ranges,
+			maxranges * sizeof(*ranges));
+		if (ranges == NULL) {
+			ERR("!realloc");
+			return -1;
+		}
+
+		rs->ranges = ranges;
+		rs->maxranges = maxranges;
+	}
+
+	rs->ranges[rs->nranges].off = off;
+	rs->ranges[rs->nranges].len = len;
+	rs->nranges++;
+	return 0;
+}
+
+/*
+ * copy_ranges_add -- (internal) add range, merge with the last one if adjacent
+ */
+static int
+copy_ranges_add(struct copy_ranges *rs, uint64_t off, uint64_t len)
+{
+	if (len == 0)
+		return 0;
+
+	if (rs->nranges != 0) {
+		struct copy_range *last = &rs->ranges[rs->nranges - 1];
+		if (last->off + last->len == off) {
+			last->len += len;
+			return 0;
+		}
+	}
+
+	return copy_ranges_append(rs, off, len);
+}
+
+/*
+ * copy_range_cmp -- (internal) compare ranges by offset
+ */
+static int
+copy_range_cmp(const void *a, const void *b)
+{
+	const struct copy_range *ra = a;
+	const struct copy_range *rb = b;
+
+	if (ra->off < rb->off)
+		return -1;
+	return ra->off > rb->off;
+}
+
+/*
+ * pool_copy_skip_holes -- (internal) skip holes of the pool file
+ *
+ * Only a pool consisting of a single file is examined, holes of the parts of
+ * a pool set are not looked for.
+ */
+static int
+pool_copy_skip_holes(struct pool_data *pool, struct copy_ranges *rs)
+{
+	struct pool_set_file *file = pool->set_file;
+	if (pool->params.is_poolset)
+		return 0;
+
+	int fd = open(file->fname, O_RDONLY);
+	if (fd < 0) {
+		ERR("!open %s", file->fname);
+		return -1;
+	}
+
+	int ret = 0;
+	off_t size = (off_t)file->size;
+	off_t off = 0;
+	while (off < size) {
+		off_t data = lseek(fd, off, SEEK_DATA);
+		if (data < 0) {
+			/* ENXIO means there is no data past the offset */
+			if (errno == ENXIO)
+				ret = copy_ranges_add(rs, (uint64_t)off,
+					(uint64_t)(size - off));
+			break;
+		}
+
+		if (data > size)
+			data = size;
+
+		if (copy_ranges_add(rs, (uint64_t)off,
+				(uint64_t)(data - off))) {
+			ret = -1;
+			break;
+		}
+
+		off = lseek(fd, data, SEEK_HOLE);
+		if (off < 0)
+			break;
+	}
+
+	close(fd);
+	return ret;
+}
+
+/*
+ * pool_copy_skip_log -- (internal) skip the part of the data area of the log
+ *	not holding any data
+ */
+static int
+pool_copy_skip_log(struct pool_data *pool, struct copy_ranges *rs)
+{
+	struct pmemlog plp;
+	if (pool_read(pool, &plp, sizeof(plp), 0))
+		return -1;
+
+	if (!util_checksum(&plp.hdr, sizeof(plp.hdr), &plp.hdr.checksum, 0))
+		return -1;
+
+	uint64_t start = le64toh(plp.start_offset);
+	uint64_t end = le64toh(plp.end_offset);
+	uint64_t write = le64toh(plp.write_offset);
+	uint64_t head = le64toh(plp.head_offset);
+
+	if (start >= end || end > pool->set_file->size)
+		return -1;
+
+	if (!(le32toh(plp.hdr.incompat_features) &
+			LOG_FORMAT_INCOMPAT_CIRCULAR)) {
+		if (write < start || write > end)
+			return -1;
+
+		return copy_ranges_add(rs, write, end - write);
+	}
+
+	/*
+	 * The offsets of a circular log grow without bounds, the live data
+	 * between the head and the write point may wrap around the end of
+	 * the data area.
+	 */
+	uint64_t size = end - start;
+	if (head < start || write < head || write - head > size)
+		return -1;
+
+	uint64_t len = write - head;
+	if (len == 0)
+		return copy_ranges_add(rs, start, size);
+
+	uint64_t off = start + (head - start) % size;
+	if (off + len <= end) {
+		if (copy_ranges_add(rs, start, off - start))
+			return -1;
+		return copy_ranges_add(rs, off + len, end - off - len);
+	}
+
+	uint64_t wrapped = start + len - (end - off);
+	return copy_ranges_add(rs, wrapped, off - wrapped);
+}
+
+/*
+ * pool_copy_btt_used -- (internal) mark post-map block as used
+ */
+static inline int
+pool_copy_btt_used(uint8_t *used, const struct btt_info *infop, uint32_t entry)
+{
+	uint32_t lba = entry & BTT_MAP_ENTRY_LBA_MASK;
+	if (lba >= infop->internal_nlba)
+		return -1;
+
+	util_setbit(used, lba);
+	return 0;
+}
+
+/*
+ * pool_copy_skip_arena -- (internal) skip data blocks of the arena not
+ *	referenced by the BTT Map nor the BTT Flog
+ *
+ * Blocks referenced by map entries in the initial or zero state are read as
+ * zeros, so their contents are not needed either.
+ */
+static int
+pool_copy_skip_arena(struct pool_data *pool, struct copy_ranges *rs,
+	uint64_t arena_off, uint64_t arena_size, const struct btt_info *infop)
+{
+	uint64_t dataoff = arena_off + infop->dataoff;
+	uint64_t mapoff = arena_off + infop->mapoff;
+	uint64_t flogoff = arena_off + infop->flogoff;
+	uint64_t arena_end = arena_off + arena_size;
+	uint64_t lbasize = infop->internal_lbasize;
+	uint64_t flog_pair = roundup(2 * sizeof(struct btt_flog),
+		BTT_FLOG_PAIR_ALIGN);
+
+	if (lbasize == 0 || infop->external_nlba > infop->internal_nlba ||
+			infop->internal_nlba > BTT_MAP_ENTRY_LBA_MASK ||
+			dataoff + infop->internal_nlba * lbasize > arena_end ||
+			mapoff + infop->external_nlba *
+				(uint64_t)BTT_MAP_ENTRY_SIZE > arena_end ||
+			flogoff + infop->nfree * flog_pair > arena_end)
+		return -1;
+
+	uint8_t *used = calloc(howmany(infop->internal_nlba, 8), 1);
+	if (used == NULL) {
+		ERR("!calloc");
+		return -1;
+	}
+
+	int ret = -1;
+	uint32_t *map = malloc(COPY_MAP_ENTRIES * BTT_MAP_ENTRY_SIZE);
+	if (map == NULL) {
+		ERR("!malloc");
+		goto out_used;
+	}
+
+	for (uint32_t i = 0; i < infop->external_nlba; i += COPY_MAP_ENTRIES) {
+		uint32_t n = min(COPY_MAP_ENTRIES, infop->external_nlba - i);
+		if (pool_read(pool, map, n * BTT_MAP_ENTRY_SIZE,
+				mapoff + i * (uint64_t)BTT_MAP_ENTRY_SIZE))
+			goto out_map;
+
+		for (uint32_t j = 0; j < n; ++j) {
+			uint32_t entry = le32toh(map[j]);
+			uint32_t flags = entry & ~BTT_MAP_ENTRY_LBA_MASK;
+			if (flags == 0 || flags == BTT_MAP_ENTRY_ZERO)
+				continue;
+
+			if (pool_copy_btt_used(used, infop, entry))
+				goto out_map;
+		}
+	}
+
+	/* blocks of both entries of every flog pair are kept */
+	for (uint32_t i = 0; i < infop->nfree; ++i) {
+		struct btt_flog flog[2];
+		if (pool_read(pool, flog, sizeof(flog),
+				flogoff + i * flog_pair))
+			goto out_map;
+
+		for (int j = 0; j < 2; ++j) {
+			if (pool_copy_btt_used(used, infop,
+					le32toh(flog[j].old_map)) ||
+					pool_copy_btt_used(used, infop,
+					le32toh(flog[j].new_map)))
+				goto out_map;
+		}
+	}
+
+	for (uint32_t i = 0; i < infop->internal_nlba; ++i) {
+		if (util_isset(used, i))
+			continue;
+
+		if (copy_ranges_add(rs, dataoff + i * lbasize, lbasize))
+			goto out_map;
+	}
+
+	ret = 0;
+out_map:
+	free(map);
+out_used:
+	free(used);
+	return ret;
+}
+
+/*
+ * pool_copy_skip_btt -- (internal) skip unused data blocks of all arenas
+ */
+static int
+pool_copy_skip_btt(struct pool_data *pool, struct copy_ranges *rs)
+{
+	uint64_t size = pool->set_file->size;
+	uint64_t off = pool->params.type == POOL_TYPE_BLK ?
+		2 * BTT_ALIGNMENT : 0;
+
+	/*
+	 * The BTT layout of the blk pool is written on the first write,
+	 * before that the area past the pool header holds no data.
+	 */
+	struct btt_info info;
+	bool zeroed = true;
+	if (pool->params.type == POOL_TYPE_BLK && pool_get_first_valid_btt(
+			pool, &info, off, &zeroed) == 0)
+		return zeroed ? copy_ranges_add(rs, off, size - off) : -1;
+
+	while (off < size) {
+		if (pool_read(pool, &info, sizeof(info), off))
+			return -1;
+
+		if (!pool_btt_info_valid(&info))
+			return -1;
+
+		btt_info_convert2h(&info);
+		if (info.nextoff > size - off)
+			return -1;
+
+		uint64_t arena_size = info.nextoff ? info.nextoff : size - off;
+		if (pool_copy_skip_arena(pool, rs, off, arena_size, &info))
+			return -1;
+
+		if (info.nextoff == 0)
+			break;
+
+		off += info.nextoff;
+	}
+
+	return 0;
+}
+
+/*
+ * pool_copy_skip_range -- (internal) add range reported by the heap walk
+ */
+static int
+pool_copy_skip_range(uint64_t off, uint64_t len, void *arg)
+{
+	return copy_ranges_add(arg, off, len);
+}
+
+/*
+ * pool_copy_skip_obj -- (internal) skip free chunks and chunks of zones not
+ *	initialized yet
+ */
+static int
+pool_copy_skip_obj(struct pool_data *pool, struct copy_ranges *rs)
+{
+	return util_pmemobj_unused(pool->set_file->addr,
+		pool->set_file->size, pool_copy_skip_range, rs);
+}
+
+/*
+ * pool_copy_ranges -- (internal) find ranges of the pool to copy
+ *
+ * With PMEMPOOL_COPY_SPARSE flag holes of the pool file and regions not
+ * holding any data according to the pool metadata are skipped. Metadata is
+ * trusted only if it passes basic validation, otherwise the whole pool is
+ * copied.
+ */
+static int
+pool_copy_ranges(struct pool_data *pool, unsigned flags,
+	struct copy_ranges *copy)
+{
+	uint64_t size = pool->set_file->size;
+	struct copy_ranges skip = { NULL, 0, 0 };
+	int ret = -1;
+
+	if (flags & PMEMPOOL_COPY_SPARSE) {
+		if (pool_copy_skip_holes(pool, &skip))
+			goto out;
+
+		size_t nholes = skip.nranges;
+		int meta = 0;
+		switch (pool->params.type) {
+		case POOL_TYPE_LOG:
+			meta = pool_copy_skip_log(pool, &skip);
+			break;
+		case POOL_TYPE_BLK:
+		case POOL_TYPE_BTT:
+			meta = pool_copy_skip_btt(pool, &skip);
+			break;
+		case POOL_TYPE_OBJ:
+			meta = pool_copy_skip_obj(pool, &skip);
+			break;
+		default:
+			break;
+		}
+
+		if (meta) {
+			LOG(3, "pool metadata not trusted, copying whole pool");
+			skip.nranges = nholes;
+		}
+
+		qsort(skip.ranges, skip.nranges, sizeof(*skip.ranges),
+			copy_range_cmp);
+	}
+
+	/* copy everything between skipped ranges, page aligned */
+	uint64_t off = 0;
+	for (size_t i = 0; i <= skip.nranges; ++i) {
+		uint64_t skip_off = size;
+		uint64_t skip_end = size;
+		if (i < skip.nranges) {
+			skip_off = roundup(skip.ranges[i].off, Pagesize);
+			uint64_t end = skip.ranges[i].off + skip.ranges[i].len;
+
+			/* merge overlapping and adjacent ranges */
+			while (i + 1 < skip.nranges &&
+					skip.ranges[i + 1].off <= end) {
+				i++;
+				end = max(end, skip.ranges[i].off +
+					skip.ranges[i].len);
+			}
+
+			skip_off = max(skip_off, off);
+			skip_end = min(end & ~(Pagesize - 1), size);
+			if (skip_end < skip_off ||
+					skip_end - skip_off < COPY_SKIP_MIN)
+				continue;
+		}
+
+		while (off < skip_off) {
+			uint64_t len = min(skip_off - off, COPY_UNIT_SIZE);
+			if (copy_ranges_append(copy, off, len))
+				goto out;
+			off += len;
+		}
+
+		off = skip_end;
+	}
+
+	ret = 0;
+out:
+	free(skip.ranges);
+	return ret;
+}
+
+/*
+ * copy_ctx -- state shared by copying threads
+ */
+struct copy_ctx {
+	struct pool_data *pool;
+	char *daddr;
+	struct copy_ranges *units;
+	size_t next;	/* next unit to copy */
+	int error;	/* errno of the failed read */
+};
+
+/*
+ * pool_copy_worker -- (internal) copy units of the pool until all are done
+ */
+static void *
+pool_copy_worker(void *arg)
+{
+	struct copy_ctx *ctx = arg;
+	struct pool_data *pool = ctx->pool;
+
+	size_t i;
+	while ((i = __sync_fetch_and_add(&ctx->next, 1)) <
+			ctx->units->nranges) {
+		if (ctx->error)
+			break;
+
+		struct copy_range *unit = &ctx->units->ranges[i];
+		char *dst = ctx->daddr + unit->off;
+		if (pool->params.type != POOL_TYPE_BTT) {
+			pmem_memcpy_nodrain(dst, (char *)pool->set_file->addr +
+				unit->off, unit->len);
+			continue;
+		}
+
+		if ((size_t)pool_btt_pread(pool, dst, unit->len,
+				(off_t)unit->off) != unit->len) {
+			ctx->error = errno ? errno : EIO;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * pool_copy_create -- (internal) create destination file of the copy
+ *
+ * A sparse copy is created as a sparse file, so that the skipped regions do
+ * not take any space.
+ */
+static int
+pool_copy_create(const char *dst_path, size_t size, unsigned flags)
+{
+	if (!(flags & PMEMPOOL_COPY_SPARSE))
+		return util_file_create(dst_path, size, 0);
+
+	int fd = open(dst_path, O_RDWR | O_CREAT | O_EXCL, 0);
+	if (fd < 0) {
+		ERR("!open %s", dst_path);
+		return -1;
+	}
+
+	if (ftruncate(fd, (off_t)size)) {
+		ERR("!ftruncate");
+		int oerrno = errno;
+		close(fd);
+		unlink(dst_path);
+		errno = oerrno;
+		return -1;
+	}
+
+	return fd;
+}
+
 /*
  * pool_copy -- make a copy of the pool
+ *
+ * The pool is split into units copied by nthreads threads (one per online
+ * CPU if zero) using non-temporal stores.
  */
 int
-pool_copy(struct pool_data *pool, const char *dst_path)
+pool_copy(struct pool_data *pool, const char *dst_path, unsigned nthreads,
+	unsigned flags)
 {
+	LOG(3, "dst_path %s nthreads %u flags %x", dst_path, nthreads, flags);
+
 	struct pool_set_file *file = pool->set_file;
-	int dfd = util_file_create(dst_path, file->size, 0);
-	if (dfd < 0)
+	struct copy_ranges units = { NULL, 0, 0 };
+	if (pool_copy_ranges(pool, flags, &units))
 		return -1;
 
-	int result = 0;
+	int result = -1;
+	int dfd = pool_copy_create(dst_path, file->size, flags);
+	if (dfd < 0)
+		goto out_units;
+
 	struct stat stat_buf;
-	if (stat(file->fname, &stat_buf)) {
-		result = -1;
+	if (stat(file->fname, &stat_buf))
 		goto out_close;
-	}
 
-	if (fchmod(dfd, stat_buf.st_mode)) {
-		result = -1;
+	if (fchmod(dfd, stat_buf.st_mode))
 		goto out_close;
-	}
 
 	void *daddr = mmap(NULL, file->size, PROT_READ | PROT_WRITE,
 		MAP_SHARED, dfd, 0);
-	if (daddr == MAP_FAILED) {
-		result = -1;
+	if (daddr == MAP_FAILED)
 		goto out_close;
-	}
 
-	if (pool->params.type != POOL_TYPE_BTT) {
-		void *saddr = pool_set_file_map(file, 0);
-		memcpy(daddr, saddr, file->size);
-		goto out_unmap;
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
 	}
-
-	void *buf = malloc(READ_WRITE_BUFFER_SIZE);
-	if (buf == NULL) {
-		ERR("!malloc");
-		result = -1;
-		goto out_unmap;
+	nthreads = (unsigned)min(nthreads, units.nranges);
+
+	struct copy_ctx ctx = {
+		.pool = pool,
+		.daddr = daddr,
+		.units = &units,
+		.next = 0,
+		.error = 0,
+	};
+
+	pthread_t *threads = NULL;
+	unsigned started = 0;
+	if (nthreads > 1) {
+		threads = malloc(nthreads * sizeof(*threads));
+		if (threads == NULL)
+			ERR("!malloc");
 	}
 
-	pool_btt_lseek(pool, 0, SEEK_SET);
-	ssize_t buf_read = 0;
-	void *dst = daddr;
-	while ((buf_read = pool_btt_read(pool, buf, READ_WRITE_BUFFER_SIZE))) {
-		if (buf_read == -1)
+	for (; threads && started < nthreads; ++started) {
+		if ((errno = pthread_create(&threads[started], NULL,
+				pool_copy_worker, &ctx)) != 0) {
+			ERR("!pthread_create");
 			break;
+		}
+	}
+
+	/* the calling thread helps the others or does all the work alone */
+	pool_copy_worker(&ctx);
 
-		memcpy(dst, buf, (size_t)buf_read);
-		dst  = (void *)((ssize_t)dst + buf_read);
+	for (unsigned i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	if (ctx.error) {
+		errno = ctx.error;
+		goto out_unmap;
 	}
 
-	free(buf);
+	if (pmem_is_pmem(daddr, file->size))
+		pmem_drain();
+	else if (pmem_msync(daddr, file->size))
+		goto out_unmap;
+
+	result = 0;
 out_unmap:
 	munmap(daddr, file->size);
 out_close:
-	if (dfd >= 0)
-		close(dfd);
+	if (result) {
+		int oerrno = errno;
+		unlink(dst_path);
+		errno = oerrno;
+	}
+	close(dfd);
+out_units:
+	free(units.ranges);
 	return result;
 }
 
@@ -755,6 +1320,22 @@ pool_hdr_default(enum pool_type type, struct pool_hdr *hdrp)
 	}
 }
 
+/*
+ * pool_hdr_incompat_optional -- return incompat features a pool of given
+ *	type may have been created with, apart from the default ones
+ */
+uint32_t
+pool_hdr_incompat_optional(enum pool_type type)
+{
+	switch (type) {
+	case POOL_TYPE_LOG:
+		return POOL_FEAT_ALIGNMENT |
+			(LOG_FORMAT_INCOMPAT_SUPPORTED & ~LOG_FORMAT_INCOMPAT);
+	default:
+		return POOL_FEAT_ALIGNMENT;
+	}
+}
+
 /*
  * pool_hdr_get_type -- return pool type based on pool header data
  */
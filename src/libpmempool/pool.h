@@ -89,6 +89,7 @@ struct arena {
 	uint32_t id;
 	bool valid;
 	bool zeroed;
+	bool checked;	/* map and flog found consistent by previous check */
 	uint64_t offset;
 	uint8_t *flog;
 	size_t flogsize;
@@ -125,7 +126,8 @@ int pool_read(struct pool_data *pool, void *buff, size_t nbytes,
 	uint64_t off);
 int pool_write(struct pool_data *pool, const void *buff, size_t nbytes,
 	uint64_t off);
-int pool_copy(struct pool_data *pool, const char *dst_path);
+int pool_copy(struct pool_data *pool, const char *dst_path, unsigned nthreads,
+	unsigned flags);
 int pool_memset(struct pool_data *pool, uint64_t off, int c, size_t count);
 
 unsigned pool_set_files_count(struct pool_set_file *file);
@@ -133,6 +135,7 @@ int pool_set_file_map_headers(struct pool_set_file *file, int rdonly);
 void pool_set_file_unmap_headers(struct pool_set_file *file);
 
 void pool_hdr_default(enum pool_type type, struct pool_hdr *hdrp);
+uint32_t pool_hdr_incompat_optional(enum pool_type type);
 enum pool_type pool_hdr_get_type(const struct pool_hdr *hdrp);
 
 int pool_btt_info_valid(struct btt_info *infop);
@@ -121,6 +121,78 @@ rpmem_persist(RPMEMpool *rpp, size_t offset, size_t length, unsigned lane)
 	return -1;
 }
 
+/*
+ * rpmem_persist_async -- post persist operation on target node without
+ * waiting for its completion
+ *
+ * rpp           -- remote pool handle
+ * offset        -- offset in pool
+ * length        -- length of persist operation
+ * lane          -- lane number
+ * token         -- completion token for rpmem_wait() and rpmem_poll()
+ */
+int
+rpmem_persist_async(RPMEMpool *rpp, size_t offset, size_t length,
+	unsigned lane, uint64_t *token)
+{
+	/* XXX */
+	return -1;
+}
+
+/*
+ * rpmem_poll -- check whether persist operation has completed
+ *
+ * rpp           -- remote pool handle
+ * lane          -- lane number the operation has been posted on
+ * token         -- completion token returned by rpmem_persist_async()
+ */
+int
+rpmem_poll(RPMEMpool *rpp, unsigned lane, uint64_t token)
+{
+	/* XXX */
+	return -1;
+}
+
+/*
+ * rpmem_wait -- wait for persist operation to complete
+ *
+ * rpp           -- remote pool handle
+ * lane          -- lane number the operation has been posted on
+ * token         -- completion token returned by rpmem_persist_async()
+ */
+int
+rpmem_wait(RPMEMpool *rpp, unsigned lane, uint64_t token)
+{
+	/* XXX */
+	return -1;
+}
+
+/*
+ * rpmem_batch_begin -- start batching persist operations on a lane
+ *
+ * rpp           -- remote pool handle
+ * lane          -- lane number
+ */
+int
+rpmem_batch_begin(RPMEMpool *rpp, unsigned lane)
+{
+	/* XXX */
+	return -1;
+}
+
+/*
+ * rpmem_batch_end -- persist all ranges batched on a lane
+ *
+ * rpp           -- remote pool handle
+ * lane          -- lane number
+ */
+int
+rpmem_batch_end(RPMEMpool *rpp, unsigned lane)
+{
+	/* XXX */
+	return -1;
+}
+
 /*
  * rpmem_read -- read data from remote pool:
  *
@@ -135,3 +207,17 @@ rpmem_read(RPMEMpool *rpp, void *buff, size_t offset, size_t length)
 	/* XXX */
 	return -1;
 }
+
+/*
+ * rpmem_readv -- read multiple ranges from remote pool at once:
+ *
+ * rpp           -- remote pool handle
+ * iov           -- ranges to read and their output buffers
+ * iovcnt        -- number of ranges
+ */
+int
+rpmem_readv(RPMEMpool *rpp, const struct rpmem_iov *iov, unsigned iovcnt)
+{
+	/* XXX */
+	return -1;
+}
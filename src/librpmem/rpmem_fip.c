@@ -59,6 +59,7 @@
 #include "rpmem_util.h"
 #include "rpmem_fip_msg.h"
 #include "rpmem_fip_lane.h"
+#include "rpmem_hist.h"
 #include "rpmem_fip.h"
 
 #define RPMEM_FI_ERR(e, fmt, args...)\
@@ -74,8 +75,32 @@
 
 #define RPMEM_RD_BUFF_SIZE 8192
 
-typedef int (*rpmem_fip_persist_fn)(struct rpmem_fip *fip, size_t offset,
-		size_t len, unsigned lane);
+/* number of READ operations in flight, each one using its own buffer */
+#define RPMEM_FIP_RD_DEPTH 64
+
+/* maximum read-ahead, leaves half of the READ buffers for the reads */
+#define RPMEM_FIP_RA_MAX (RPMEM_FIP_RD_DEPTH / 2 * RPMEM_RD_BUFF_SIZE)
+
+/* all events a persist operation may wait for */
+#define RPMEM_FIP_PERSIST_EVENTS (FI_SEND | FI_RECV | FI_READ)
+
+/* number of WRITE operations in flight per connection during sync */
+#define RPMEM_FIP_SYNC_DEPTH 8
+
+/* maximum size of a single WRITE operation during sync */
+#define RPMEM_FIP_SYNC_CHUNK (4 << 20)
+
+/*
+ * rpmem_fip_range -- range of the pool to persist
+ */
+struct rpmem_fip_range {
+	size_t offset;
+	size_t len;
+};
+
+typedef int (*rpmem_fip_persist_fn)(struct rpmem_fip *fip,
+		const struct rpmem_fip_range *ranges, unsigned nranges,
+		unsigned slot);
 
 typedef int (*rpmem_fip_process_fn)(struct rpmem_fip *fip,
 		void *context, uint64_t flags);
@@ -88,6 +113,7 @@ typedef void (*rpmem_fip_fini_fn)(struct rpmem_fip *fip);
  */
 struct rpmem_fip_ops {
 	rpmem_fip_persist_fn persist;
+	rpmem_fip_persist_fn drain;
 	rpmem_fip_process_fn process;
 	rpmem_fip_init_fn lanes_init;
 	rpmem_fip_fini_fn lanes_fini;
@@ -95,7 +121,7 @@ struct rpmem_fip_ops {
 };
 
 /*
- * rpmem_fip_plane_apm -- persist operation's lane for APM
+ * rpmem_fip_plane_apm -- persist operation's slot for APM
  */
 struct rpmem_fip_plane_apm {
 	struct rpmem_fip_lane lane;	/* base lane structure */
@@ -104,7 +130,7 @@ struct rpmem_fip_plane_apm {
 };
 
 /*
- * rpmem_fip_plane_gpspm -- persist operation's lane for GPSPM
+ * rpmem_fip_plane_gpspm -- persist operation's slot for GPSPM
  */
 struct rpmem_fip_plane_gpspm {
 	struct rpmem_fip_lane lane;	/* base lane structure */
@@ -112,12 +138,59 @@ struct rpmem_fip_plane_gpspm {
 	struct rpmem_fip_msg send;	/* SEND message */
 };
 
+/*
+ * rpmem_fip_batch -- persist operations batched on a lane
+ *
+ * Between rpmem_fip_batch_begin() and rpmem_fip_batch_end() persist
+ * operations only record their ranges, merging the overlapping and
+ * adjacent ones.  The ranges are posted as a single operation when the
+ * batch ends or no more ranges fit in a persist message.
+ */
+struct rpmem_fip_batch {
+	int active;		/* batch in progress */
+	unsigned nranges;	/* number of ranges recorded */
+	uint64_t first;		/* first operation posted by the batch */
+	struct rpmem_fip_range ranges[RPMEM_PERSIST_MAX_RANGES];
+};
+
+/*
+ * rpmem_fip_sync_ctx -- WRITE operation in flight during sync
+ */
+struct rpmem_fip_sync_ctx {
+	struct rpmem_fip_lane lane;	/* base lane structure */
+	struct rpmem_fip_rma write;	/* WRITE message */
+};
+
 /*
  * rpmem_fip_rlane -- read operation's lane
+ *
+ * A lane holds the data of a single READ in its part of the read buffer
+ * until it is copied to the destination.  The data read ahead has no
+ * destination and stays in the buffer until the lane is reused.
  */
 struct rpmem_fip_rlane {
 	struct rpmem_fip_lane lane;	/* base lane structure */
 	struct rpmem_fip_rma read;	/* READ message */
+	void *buff;	/* lane's part of the read buffer */
+	size_t off;	/* pool offset of the data */
+	size_t len;	/* length of the data, 0 if none */
+	void *dst;	/* destination of the data, NULL if read ahead */
+};
+
+/*
+ * rpmem_fip_conn -- connection to remote peer
+ *
+ * The slots are striped across the connections, the n-th slot uses the
+ * connection n % nconns.  The read operation's lane uses the first one.
+ * Each connection has its own completion queue and processing thread.
+ */
+struct rpmem_fip_conn {
+	struct rpmem_fip *fip;
+	struct fid_ep *ep;		/* endpoint */
+	struct fid_cq *cq;		/* completion queue */
+	volatile int cq_polling;	/* completion queue is being read */
+	struct fi_cq_msg_entry *cq_entries; /* busy-poll entries buffer */
+	pthread_t process_thread;	/* processing thread */
 };
 
 struct rpmem_fip {
@@ -125,12 +198,20 @@ struct rpmem_fip {
 	struct fid_fabric *fabric; /* fabric domain */
 	struct fid_domain *domain; /* fabric protection domain */
 	struct fid_eq *eq; /* event queue */
-	struct fid_ep *ep; /* endpoint */
+
+	unsigned nconns;		/* number of connections */
+	struct rpmem_fip_conn *conns;	/* connections */
 
 	volatile int closing;
 
-	struct fid_cq *cq; /* completion queue */
-	size_t cq_size;	/* completion queue size */
+	size_t cq_size;	/* completion queue size of a connection */
+
+	/*
+	 * In the busy-poll mode there is no processing thread.  The threads
+	 * waiting for completions read the completion queue themselves,
+	 * one at a time, and process the completions of all the lanes.
+	 */
+	int busy_poll;
 
 	uint64_t raddr;	/* remote memory base address */
 	uint64_t rkey;	/* remote memory protection key */
@@ -142,13 +223,41 @@ struct rpmem_fip {
 	enum rpmem_persist_method persist_method;
 	struct rpmem_fip_ops *ops;
 
+	/*
+	 * Each lane owns depth consecutive slots, so up to depth persist
+	 * operations may be in flight on a lane at a time.  The operations
+	 * issued on a lane are numbered and the n-th one uses the slot
+	 * n % depth of the lane, once the operation issued depth operations
+	 * earlier has completed.  The lane id sent in a persist message
+	 * is the slot number.
+	 */
 	unsigned nlanes;
+	unsigned depth;		/* number of slots per lane */
+	unsigned nslots;	/* total number of slots */
+	uint64_t *lane_seq;	/* number of the next operation on a lane */
+	uint64_t *slot_seq;	/* number of the last operation in a slot */
+	struct rpmem_fip_batch *batches; /* batched operations of lanes */
+
+	/*
+	 * Persist latency statistics of lanes and the time each slot's
+	 * operation has been posted at, 0 once its completion is observed.
+	 */
+	int stats;
+	struct rpmem_fip_stats *lane_stats;
+	uint64_t *slot_ts;
 	union {
 		struct rpmem_fip_plane_apm *apm;
 		struct rpmem_fip_plane_gpspm *gpspm;
 	} lanes;
 
-	struct rpmem_fip_rlane rd_lane; /* lane for read operation */
+	struct rpmem_fip_rlane *rd_lanes; /* lanes for read operations */
+	unsigned rd_next;	/* next read operation's lane to use */
+	size_t ra_size;		/* read-ahead size, 0 if disabled */
+	size_t rd_end;		/* end of the last read */
+	size_t ra_end;		/* end of the data read ahead */
+
+	/* WRITE operations of sync, RPMEM_FIP_SYNC_DEPTH per connection */
+	struct rpmem_fip_sync_ctx *sync;
 	void *rd_buff;		/* buffer for read operation */
 	struct fid_mr *rd_mr;	/* read buffer memory region */
 	void *rd_mr_desc;	/* read buffer memory descriptor */
@@ -166,18 +275,27 @@ struct rpmem_fip {
 	uint64_t raw_buff;		/* READ-after-WRITE buffer */
 	struct fid_mr *raw_mr;		/* RAW memory region */
 	void *raw_mr_desc;		/* RAW memory descriptor */
-
-	pthread_t process_thread;	/* processing thread */
 };
 
+/*
+ * rpmem_fip_slot_conn -- (internal) return connection used by a slot
+ */
+static inline struct rpmem_fip_conn *
+rpmem_fip_slot_conn(struct rpmem_fip *fip, unsigned slot)
+{
+	return &fip->conns[slot % fip->nconns];
+}
+
 /*
  * rpmem_fip_set_nlanes -- (internal) set maximum number of lanes supported
  */
 static void
 rpmem_fip_set_nlanes(struct rpmem_fip *fip, unsigned nlanes)
 {
+	/* the limit applies to each connection separately */
 	size_t max_nlanes = rpmem_fip_max_nlanes(fip->fi,
-			fip->persist_method, RPMEM_FIP_NODE_CLIENT);
+			fip->persist_method, RPMEM_FIP_NODE_CLIENT) *
+			fip->nconns;
 
 	/*
 	 * Get minimum of maximum supported and number of
@@ -185,7 +303,19 @@ rpmem_fip_set_nlanes(struct rpmem_fip *fip, unsigned nlanes)
 	 */
 	size_t min_nlanes = max_nlanes < nlanes ? max_nlanes : nlanes;
 
-	fip->nlanes = (unsigned)(min_nlanes - 1); /* one for read operation */
+	/* one for read operation */
+	unsigned nslots = (unsigned)(min_nlanes - 1);
+
+	if (fip->depth == 0)
+		fip->depth = 1;
+	if (fip->depth > nslots)
+		fip->depth = nslots;
+
+	fip->nlanes = nslots / fip->depth;
+	fip->nslots = fip->nlanes * fip->depth;
+
+	if (fip->nconns > fip->nslots)
+		fip->nconns = fip->nslots;
 }
 
 /*
@@ -292,8 +422,8 @@ rpmem_fip_init_memory(struct rpmem_fip *fip)
 	/* get local memory descriptor */
 	fip->mr_desc = fi_mr_desc(fip->mr);
 
-	/* allocate buffer for read operation */
-	fip->rd_buff = Malloc(RPMEM_RD_BUFF_SIZE);
+	/* allocate buffer for read operations */
+	fip->rd_buff = Malloc(RPMEM_FIP_RD_DEPTH * RPMEM_RD_BUFF_SIZE);
 	if (!fip->rd_buff) {
 		RPMEM_LOG(ERR, "!allocating read buffer");
 		ret = -1;
@@ -306,8 +436,8 @@ rpmem_fip_init_memory(struct rpmem_fip *fip)
 	 * the FI_REMOTE_WRITE flag.
 	 */
 	ret = fi_mr_reg(fip->domain, fip->rd_buff,
-			RPMEM_RD_BUFF_SIZE, FI_REMOTE_WRITE,
-			0, 0, 0, &fip->rd_mr, NULL);
+			RPMEM_FIP_RD_DEPTH * RPMEM_RD_BUFF_SIZE,
+			FI_REMOTE_WRITE, 0, 0, 0, &fip->rd_mr, NULL);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "registrating read buffer");
 		goto err_rd_mr;
@@ -343,23 +473,131 @@ rpmem_fip_init_lanes_common(struct rpmem_fip *fip)
 {
 	int ret;
 
-	/* initialize lane for read operation */
-	ret = rpmem_fip_lane_init(&fip->rd_lane.lane);
-	if (ret)
-		goto err_lane_init;
+	/* allocate lanes for read operations */
+	fip->rd_lanes = Zalloc(RPMEM_FIP_RD_DEPTH * sizeof(*fip->rd_lanes));
+	if (!fip->rd_lanes) {
+		RPMEM_LOG(ERR, "!allocating read lanes");
+		goto err_malloc_rd_lanes;
+	}
+
+	unsigned r;
+	for (r = 0; r < RPMEM_FIP_RD_DEPTH; r++) {
+		struct rpmem_fip_rlane *rlanep = &fip->rd_lanes[r];
+		ret = rpmem_fip_lane_init(&rlanep->lane);
+		if (ret)
+			goto err_rd_lane_init;
+
+		rlanep->buff = (void *)((uintptr_t)fip->rd_buff +
+				r * RPMEM_RD_BUFF_SIZE);
+
+		/*
+		 * Initialize READ message. The completion is required in
+		 * order to signal thread that READ operation has been
+		 * completed.
+		 */
+		rpmem_fip_rma_init(&rlanep->read, fip->rd_mr_desc, 0,
+				fip->rkey, rlanep, FI_COMPLETION);
+	}
+
+	/* allocate persist operations' sequence numbers */
+	fip->lane_seq = Zalloc(fip->nlanes * sizeof(*fip->lane_seq));
+	if (!fip->lane_seq) {
+		RPMEM_LOG(ERR, "!allocating lanes sequence numbers");
+		goto err_malloc_lane_seq;
+	}
+
+	fip->slot_seq = Zalloc(fip->nslots * sizeof(*fip->slot_seq));
+	if (!fip->slot_seq) {
+		RPMEM_LOG(ERR, "!allocating slots sequence numbers");
+		goto err_malloc_slot_seq;
+	}
+
+	fip->batches = Zalloc(fip->nlanes * sizeof(*fip->batches));
+	if (!fip->batches) {
+		RPMEM_LOG(ERR, "!allocating lanes batches");
+		goto err_malloc_batches;
+	}
+
+	if (fip->stats) {
+		fip->lane_stats = Zalloc(fip->nlanes *
+				sizeof(*fip->lane_stats));
+		if (!fip->lane_stats) {
+			RPMEM_LOG(ERR, "!allocating lanes statistics");
+			goto err_malloc_lane_stats;
+		}
+
+		fip->slot_ts = Zalloc(fip->nslots * sizeof(*fip->slot_ts));
+		if (!fip->slot_ts) {
+			RPMEM_LOG(ERR, "!allocating slots timestamps");
+			goto err_malloc_slot_ts;
+		}
+	}
 
 	/*
-	 * Initialize READ message. The completion is required in order
-	 * to signal thread that READ operation has been completed.
+	 * Unlike in persist operations the completion of sync's WRITEs
+	 * is required, the WRITE's context is released when it completes.
 	 */
-	rpmem_fip_rma_init(&fip->rd_lane.read, fip->rd_mr_desc, 0,
-			fip->rkey, &fip->rd_lane, FI_COMPLETION);
+	unsigned nsync = fip->nconns * RPMEM_FIP_SYNC_DEPTH;
+	fip->sync = Zalloc(nsync * sizeof(*fip->sync));
+	if (!fip->sync) {
+		RPMEM_LOG(ERR, "!allocating sync contexts");
+		goto err_malloc_sync;
+	}
+
+	unsigned i;
+	for (i = 0; i < nsync; i++) {
+		ret = rpmem_fip_lane_init(&fip->sync[i].lane);
+		if (ret)
+			goto err_sync_lane_init;
+
+		rpmem_fip_rma_init(&fip->sync[i].write, fip->mr_desc, 0,
+				fip->rkey, &fip->sync[i], FI_COMPLETION);
+	}
 
 	return 0;
-err_lane_init:
+err_sync_lane_init:
+	for (unsigned j = 0; j < i; j++)
+		rpmem_fip_lane_fini(&fip->sync[j].lane);
+	Free(fip->sync);
+err_malloc_sync:
+	Free(fip->slot_ts);
+err_malloc_slot_ts:
+	Free(fip->lane_stats);
+err_malloc_lane_stats:
+	Free(fip->batches);
+err_malloc_batches:
+	Free(fip->slot_seq);
+err_malloc_slot_seq:
+	Free(fip->lane_seq);
+err_malloc_lane_seq:
+err_rd_lane_init:
+	for (unsigned j = 0; j < r; j++)
+		rpmem_fip_lane_fini(&fip->rd_lanes[j].lane);
+	Free(fip->rd_lanes);
+err_malloc_rd_lanes:
 	return -1;
 }
 
+/*
+ * rpmem_fip_fini_lanes_common -- (internal) deinitialize common lanes
+ * resources
+ */
+static void
+rpmem_fip_fini_lanes_common(struct rpmem_fip *fip)
+{
+	for (unsigned i = 0; i < fip->nconns * RPMEM_FIP_SYNC_DEPTH; i++)
+		rpmem_fip_lane_fini(&fip->sync[i].lane);
+	Free(fip->sync);
+	Free(fip->slot_ts);
+	Free(fip->lane_stats);
+	Free(fip->batches);
+	Free(fip->slot_seq);
+	Free(fip->lane_seq);
+	for (unsigned r = 0; r < RPMEM_FIP_RD_DEPTH; r++)
+		rpmem_fip_lane_fini(&fip->rd_lanes[r].lane);
+	Free(fip->rd_lanes);
+}
+
 /*
  * rpmem_fip_init_lanes -- (internal) initialize lanes
  */
@@ -378,14 +616,25 @@ rpmem_fip_init_lanes(struct rpmem_fip *fip)
 
 	return 0;
 err_init_lanes:
+	rpmem_fip_fini_lanes_common(fip);
 	return ret;
 }
 
 /*
- * rpmem_fip_init_cq -- (internal) initialize completion queue(s)
+ * rpmem_fip_fini_lanes -- (internal) deinitialize lanes
+ */
+static void
+rpmem_fip_fini_lanes(struct rpmem_fip *fip)
+{
+	fip->ops->lanes_fini(fip);
+	rpmem_fip_fini_lanes_common(fip);
+}
+
+/*
+ * rpmem_fip_init_cq -- (internal) initialize connection's completion queue
  */
 static int
-rpmem_fip_init_cq(struct rpmem_fip *fip)
+rpmem_fip_init_cq(struct rpmem_fip *fip, struct rpmem_fip_conn *conn)
 {
 	int ret;
 
@@ -393,13 +642,23 @@ rpmem_fip_init_cq(struct rpmem_fip *fip)
 		.size = fip->cq_size,
 		.flags = 0,
 		.format = FI_CQ_FORMAT_MSG,
-		.wait_obj = FI_WAIT_UNSPEC,
+		/* nobody blocks on the completion queue when busy polling */
+		.wait_obj = fip->busy_poll ? FI_WAIT_NONE : FI_WAIT_UNSPEC,
 		.signaling_vector = 0,
 		.wait_cond = FI_CQ_COND_NONE,
 		.wait_set = NULL,
 	};
 
-	ret = fi_cq_open(fip->domain, &cq_attr, &fip->cq, NULL);
+	if (fip->busy_poll) {
+		conn->cq_entries = Malloc(fip->cq_size *
+				sizeof(*conn->cq_entries));
+		if (!conn->cq_entries) {
+			RPMEM_LOG(ERR, "!allocating completion queue buffer");
+			goto err_malloc;
+		}
+	}
+
+	ret = fi_cq_open(fip->domain, &cq_attr, &conn->cq, NULL);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "opening completion queue");
 		goto err_cq_open;
@@ -407,28 +666,34 @@ rpmem_fip_init_cq(struct rpmem_fip *fip)
 
 	return 0;
 err_cq_open:
+	Free(conn->cq_entries);
+	conn->cq_entries = NULL;
+err_malloc:
 	return -1;
 }
 
 /*
- * rpmem_fip_fini_cq -- (internal) deinitialize completion queue(s)
+ * rpmem_fip_fini_cq -- (internal) deinitialize connection's completion queue
  */
 static int
-rpmem_fip_fini_cq(struct rpmem_fip *fip)
+rpmem_fip_fini_cq(struct rpmem_fip_conn *conn)
 {
-	return RPMEM_FI_CLOSE(fip->cq, "closing completion queue");
+	Free(conn->cq_entries);
+	conn->cq_entries = NULL;
+
+	return RPMEM_FI_CLOSE(conn->cq, "closing completion queue");
 }
 
 /*
- * rpmem_fip_init_ep -- (internal) initialize endpoint
+ * rpmem_fip_init_ep -- (internal) initialize connection's endpoint
  */
 static int
-rpmem_fip_init_ep(struct rpmem_fip *fip)
+rpmem_fip_init_ep(struct rpmem_fip *fip, struct rpmem_fip_conn *conn)
 {
 	int ret;
 
 	/* create an endpoint */
-	ret = fi_endpoint(fip->domain, fip->fi, &fip->ep, NULL);
+	ret = fi_endpoint(fip->domain, fip->fi, &conn->ep, NULL);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "allocating endpoint");
 		goto err_endpoint;
@@ -438,7 +703,7 @@ rpmem_fip_init_ep(struct rpmem_fip *fip)
 	 * Bind an event queue to an endpoint to get
 	 * connection-related events for the endpoint.
 	 */
-	ret = fi_ep_bind(fip->ep, &fip->eq->fid, 0);
+	ret = fi_ep_bind(conn->ep, &fip->eq->fid, 0);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "binding event queue to endpoint");
 		goto err_ep_bind_eq;
@@ -456,7 +721,7 @@ rpmem_fip_init_ep(struct rpmem_fip *fip)
 	 * persistency method used and are configured in lanes
 	 * initialization specified for persistency method utilized.
 	 */
-	ret = fi_ep_bind(fip->ep, &fip->cq->fid,
+	ret = fi_ep_bind(conn->ep, &conn->cq->fid,
 			FI_RECV | FI_TRANSMIT | FI_SELECTIVE_COMPLETION);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "binding completion queue to endpoint");
@@ -467,7 +732,7 @@ rpmem_fip_init_ep(struct rpmem_fip *fip)
 	 * Enable endpoint so it is possible to post inbound/outbound
 	 * operations if required.
 	 */
-	ret = fi_enable(fip->ep);
+	ret = fi_enable(conn->ep);
 	if (ret) {
 		RPMEM_FI_ERR(ret, "activating endpoint");
 		goto err_fi_enable;
@@ -477,17 +742,18 @@ rpmem_fip_init_ep(struct rpmem_fip *fip)
 err_fi_enable:
 err_ep_bind_cq:
 err_ep_bind_eq:
+	RPMEM_FI_CLOSE(conn->ep, "closing endpoint");
 err_endpoint:
 	return ret;
 }
 
 /*
- * rpmem_fip_fini_ep -- (internal) deinitialize endpoint
+ * rpmem_fip_fini_ep -- (internal) deinitialize connection's endpoint
  */
 static int
-rpmem_fip_fini_ep(struct rpmem_fip *fip)
+rpmem_fip_fini_ep(struct rpmem_fip_conn *conn)
 {
-	return RPMEM_FI_CLOSE(fip->ep, "closing endpoint");
+	return RPMEM_FI_CLOSE(conn->ep, "closing endpoint");
 }
 
 /*
@@ -499,7 +765,7 @@ rpmem_fip_init_lanes_apm(struct rpmem_fip *fip)
 	int ret;
 
 	/* allocate APM lanes */
-	fip->lanes.apm = Zalloc(fip->nlanes * sizeof(*fip->lanes.apm));
+	fip->lanes.apm = Zalloc(fip->nslots * sizeof(*fip->lanes.apm));
 	if (!fip->lanes.apm) {
 		RPMEM_LOG(ERR, "!allocating APM lanes");
 		goto err_malloc_lanes;
@@ -527,7 +793,7 @@ rpmem_fip_init_lanes_apm(struct rpmem_fip *fip)
 	 * The context is a lane structure.
 	 */
 	unsigned i;
-	for (i = 0; i < fip->nlanes; i++) {
+	for (i = 0; i < fip->nslots; i++) {
 		ret = rpmem_fip_lane_init(&fip->lanes.apm[i].lane);
 		if (ret)
 			goto err_lane_init;
@@ -592,49 +858,79 @@ rpmem_fip_process_apm(struct rpmem_fip *fip, void *context, uint64_t flags)
 }
 
 /*
- * rpmem_fip_persist_apm -- (internal) perform persist operation for APM
+ * rpmem_fip_drain_apm -- (internal) post READ flushing all the WRITEs posted
+ * on slot's connection so far for APM
  */
 static int
-rpmem_fip_persist_apm(struct rpmem_fip *fip, size_t offset,
-	size_t len, unsigned lane)
+rpmem_fip_drain_apm(struct rpmem_fip *fip,
+	const struct rpmem_fip_range *ranges, unsigned nranges, unsigned slot)
 {
-	struct rpmem_fip_plane_apm *lanep = &fip->lanes.apm[lane];
+	struct rpmem_fip_plane_apm *lanep = &fip->lanes.apm[slot];
+	struct fid_ep *ep = rpmem_fip_slot_conn(fip, slot)->ep;
 
-	RPMEM_ASSERT(!rpmem_fip_lane_busy(&lanep->lane));
+	RPMEM_ASSERT(nranges > 0);
 
 	rpmem_fip_lane_begin(&lanep->lane, FI_READ);
 
-	int ret;
-	void *laddr = (void *)((uintptr_t)fip->laddr + offset);
-	uint64_t raddr = fip->raddr + offset;
-
-	/* WRITE for requested memory region */
-	ret = rpmem_fip_writemsg(fip->ep, &lanep->write, laddr, len, raddr);
-	if (unlikely(ret)) {
-		RPMEM_FI_ERR((int)ret, "RMA write");
-		return ret;
-	}
-
-	/* READ to read-after-write buffer */
-	ret = rpmem_fip_readmsg(fip->ep, &lanep->read, &fip->raw_buff,
+	/*
+	 * READ to read-after-write buffer, the single READ flushes
+	 * all the WRITEs posted before.
+	 */
+	uint64_t raddr = fip->raddr + ranges[nranges - 1].offset;
+	int ret = rpmem_fip_readmsg(ep, &lanep->read, &fip->raw_buff,
 			sizeof(fip->raw_buff), raddr);
 	if (unlikely(ret)) {
 		RPMEM_FI_ERR((int)ret, "RMA read");
 		return (int)ret;
 	}
 
-	/* wait for READ completion */
-	return rpmem_fip_lane_wait(&lanep->lane, FI_READ);
+	/* READ completion is awaited by rpmem_fip_wait */
+	return 0;
+}
+
+/*
+ * rpmem_fip_persist_apm -- (internal) post persist operation for APM
+ */
+static int
+rpmem_fip_persist_apm(struct rpmem_fip *fip,
+	const struct rpmem_fip_range *ranges, unsigned nranges, unsigned slot)
+{
+	struct rpmem_fip_plane_apm *lanep = &fip->lanes.apm[slot];
+	struct fid_ep *ep = rpmem_fip_slot_conn(fip, slot)->ep;
+
+	RPMEM_ASSERT(!rpmem_fip_lane_busy(&lanep->lane));
+
+	/* WRITE for requested memory regions */
+	for (unsigned i = 0; i < nranges; i++) {
+		void *laddr = (void *)((uintptr_t)fip->laddr +
+				ranges[i].offset);
+		uint64_t raddr = fip->raddr + ranges[i].offset;
+
+		int ret = rpmem_fip_writemsg(ep, &lanep->write, laddr,
+				ranges[i].len, raddr);
+		if (unlikely(ret)) {
+			RPMEM_FI_ERR((int)ret, "RMA write");
+			return ret;
+		}
+	}
+
+	return rpmem_fip_drain_apm(fip, ranges, nranges, slot);
 }
 
 /*
  * rpmem_fip_gpspm_post_resp -- (internal) post persist response message buffer
+ *
+ * The response for a slot is received on the slot's connection, so the
+ * n-th buffer is always posted to the connection of the n-th slot.
  */
 static inline int
 rpmem_fip_gpspm_post_resp(struct rpmem_fip *fip,
 	struct rpmem_fip_msg *resp)
 {
-	int ret = rpmem_fip_recvmsg(fip->ep, resp);
+	unsigned slot = (unsigned)(resp - fip->recv);
+	struct fid_ep *ep = rpmem_fip_slot_conn(fip, slot)->ep;
+
+	int ret = rpmem_fip_recvmsg(ep, resp);
 	if (unlikely(ret)) {
 		RPMEM_FI_ERR(ret, "posting GPSPM recv buffer");
 		return ret;
@@ -651,7 +947,7 @@ static int
 rpmem_fip_post_lanes_gpspm(struct rpmem_fip *fip)
 {
 	int ret = 0;
-	for (unsigned i = 0; i < fip->nlanes; i++) {
+	for (unsigned i = 0; i < fip->nslots; i++) {
 		ret = rpmem_fip_gpspm_post_resp(fip, &fip->recv[i]);
 		if (ret)
 			break;
@@ -669,14 +965,14 @@ rpmem_fip_init_lanes_gpspm(struct rpmem_fip *fip)
 	int ret = 0;
 
 	/* allocate GPSPM lanes */
-	fip->lanes.gpspm = Zalloc(fip->nlanes * sizeof(*fip->lanes.gpspm));
+	fip->lanes.gpspm = Zalloc(fip->nslots * sizeof(*fip->lanes.gpspm));
 	if (!fip->lanes.gpspm) {
 		RPMEM_LOG(ERR, "allocating GPSPM lanes");
 		goto err_malloc_lanes;
 	}
 
 	/* allocate persist messages buffer */
-	size_t msg_size = fip->nlanes * sizeof(struct rpmem_msg_persist);
+	size_t msg_size = fip->nslots * sizeof(struct rpmem_msg_persist);
 	fip->pmsg = Malloc(msg_size);
 	if (!fip->pmsg) {
 		RPMEM_LOG(ERR, "!allocating messages buffer");
@@ -699,7 +995,7 @@ rpmem_fip_init_lanes_gpspm(struct rpmem_fip *fip)
 	fip->pmsg_mr_desc = fi_mr_desc(fip->pmsg_mr);
 
 	/* allocate persist response messages buffer */
-	size_t msg_resp_size = fip->nlanes *
+	size_t msg_resp_size = fip->nslots *
 				sizeof(struct rpmem_msg_persist_resp);
 	fip->pres = Malloc(msg_resp_size);
 	if (!fip->pres) {
@@ -723,7 +1019,7 @@ rpmem_fip_init_lanes_gpspm(struct rpmem_fip *fip)
 	fip->pres_mr_desc = fi_mr_desc(fip->pres_mr);
 
 	/* allocate RECV structures for fi_recvmsg(3) */
-	fip->recv = Malloc(fip->nlanes * sizeof(*fip->recv));
+	fip->recv = Malloc(fip->nslots * sizeof(*fip->recv));
 	if (!fip->recv) {
 		RPMEM_LOG(ERR, "!allocating response message iov buffer");
 		goto err_malloc_recv;
@@ -743,12 +1039,12 @@ rpmem_fip_init_lanes_gpspm(struct rpmem_fip *fip)
 	 *
 	 * For SEND the context is lane structure.
 	 *
-	 * The received buffer contains a lane id which is used
-	 * to obtain a lane which must be signaled that operation
+	 * The received buffer contains a slot id which is used
+	 * to obtain a slot which must be signaled that operation
 	 * has been completed.
 	 */
 	unsigned i;
-	for (i = 0; i < fip->nlanes; i++) {
+	for (i = 0; i < fip->nslots; i++) {
 		ret = rpmem_fip_lane_init(&fip->lanes.gpspm[i].lane);
 		if (ret)
 			goto err_lane_init;
@@ -824,7 +1120,7 @@ rpmem_fip_process_gpspm(struct rpmem_fip *fip, void *context, uint64_t flags)
 		struct rpmem_msg_persist_resp *msg_resp =
 			rpmem_fip_msg_get_pres(resp);
 
-		if (unlikely(msg_resp->lane >= fip->nlanes))
+		if (unlikely(msg_resp->lane >= fip->nslots))
 			return -1;
 
 		struct rpmem_fip_lane *lanep =
@@ -849,51 +1145,69 @@ rpmem_fip_process_gpspm(struct rpmem_fip *fip, void *context, uint64_t flags)
 }
 
 /*
- * rpmem_fip_persist_gpspm -- (internal) perform persist operation for GPSPM
+ * rpmem_fip_drain_gpspm -- (internal) send persist message for ranges
+ * already written on slot's connection for GPSPM
  */
 static int
-rpmem_fip_persist_gpspm(struct rpmem_fip *fip, size_t offset,
-	size_t len, unsigned lane)
+rpmem_fip_drain_gpspm(struct rpmem_fip *fip,
+	const struct rpmem_fip_range *ranges, unsigned nranges, unsigned slot)
 {
-	int ret;
-	struct rpmem_fip_plane_gpspm *lanep = &fip->lanes.gpspm[lane];
-
-	ret = rpmem_fip_lane_wait(&lanep->lane, FI_SEND);
-	if (unlikely(ret)) {
-		RPMEM_LOG(ERR, "waiting for SEND buffer");
-		return ret;
-	}
+	struct rpmem_fip_plane_gpspm *gpspm = &fip->lanes.gpspm[slot];
+	struct fid_ep *ep = rpmem_fip_slot_conn(fip, slot)->ep;
 
-	RPMEM_ASSERT(!rpmem_fip_lane_busy(&lanep->lane));
+	RPMEM_ASSERT(nranges > 0 && nranges <= RPMEM_PERSIST_MAX_RANGES);
 
-	rpmem_fip_lane_begin(&lanep->lane, FI_SEND | FI_RECV);
+	rpmem_fip_lane_begin(&gpspm->lane, FI_SEND | FI_RECV);
 
-	void *laddr = (void *)((uintptr_t)fip->laddr + offset);
-	uint64_t raddr = fip->raddr + offset;
-	struct rpmem_msg_persist *msg;
-	struct rpmem_fip_plane_gpspm *gpspm = (void *)lanep;
+	struct rpmem_msg_persist *msg = rpmem_fip_msg_get_pmsg(&gpspm->send);
+	msg->lane = slot;
+	msg->nranges = nranges;
 
-	/* WRITE for requested memory region */
-	ret = rpmem_fip_writemsg(fip->ep, &gpspm->write, laddr, len, raddr);
-	if (unlikely(ret)) {
-		RPMEM_FI_ERR((int)ret, "RMA write");
-		return ret;
+	for (unsigned i = 0; i < nranges; i++) {
+		msg->ranges[i].addr = fip->raddr + ranges[i].offset;
+		msg->ranges[i].size = ranges[i].len;
 	}
 
-	/* SEND persist message */
-	msg = rpmem_fip_msg_get_pmsg(&gpspm->send);
-	msg->lane = lane;
-	msg->addr = raddr;
-	msg->size = len;
+	/* SEND persist message, only the ranges in use */
+	gpspm->send.iov.iov_len = RPMEM_MSG_PERSIST_SIZE(nranges);
 
-	ret = rpmem_fip_sendmsg(fip->ep, &gpspm->send);
+	int ret = rpmem_fip_sendmsg(ep, &gpspm->send);
 	if (unlikely(ret)) {
 		RPMEM_FI_ERR((int)ret, "MSG send");
 		return (int)ret;
 	}
 
-	/* wait for persist operation completion */
-	return rpmem_fip_lane_wait(&lanep->lane, FI_RECV);
+	/* SEND and RECV completions are awaited by rpmem_fip_wait */
+	return 0;
+}
+
+/*
+ * rpmem_fip_persist_gpspm -- (internal) post persist operation for GPSPM
+ */
+static int
+rpmem_fip_persist_gpspm(struct rpmem_fip *fip,
+	const struct rpmem_fip_range *ranges, unsigned nranges, unsigned slot)
+{
+	struct rpmem_fip_plane_gpspm *gpspm = &fip->lanes.gpspm[slot];
+	struct fid_ep *ep = rpmem_fip_slot_conn(fip, slot)->ep;
+
+	RPMEM_ASSERT(!rpmem_fip_lane_busy(&gpspm->lane));
+
+	/* WRITE for requested memory regions */
+	for (unsigned i = 0; i < nranges; i++) {
+		void *laddr = (void *)((uintptr_t)fip->laddr +
+				ranges[i].offset);
+		uint64_t raddr = fip->raddr + ranges[i].offset;
+
+		int ret = rpmem_fip_writemsg(ep, &gpspm->write, laddr,
+				ranges[i].len, raddr);
+		if (unlikely(ret)) {
+			RPMEM_FI_ERR((int)ret, "RMA write");
+			return ret;
+		}
+	}
+
+	return rpmem_fip_drain_gpspm(fip, ranges, nranges, slot);
 }
 
 /*
@@ -902,6 +1216,7 @@ rpmem_fip_persist_gpspm(struct rpmem_fip *fip, size_t offset,
 static struct rpmem_fip_ops rpmem_fip_ops[MAX_RPMEM_PM] = {
 	[RPMEM_PM_GPSPM] = {
 		.persist = rpmem_fip_persist_gpspm,
+		.drain = rpmem_fip_drain_gpspm,
 		.process = rpmem_fip_process_gpspm,
 		.lanes_init = rpmem_fip_init_lanes_gpspm,
 		.lanes_fini = rpmem_fip_fini_lanes_gpspm,
@@ -909,6 +1224,7 @@ static struct rpmem_fip_ops rpmem_fip_ops[MAX_RPMEM_PM] = {
 	},
 	[RPMEM_PM_APM] = {
 		.persist = rpmem_fip_persist_apm,
+		.drain = rpmem_fip_drain_apm,
 		.process = rpmem_fip_process_apm,
 		.lanes_init = rpmem_fip_init_lanes_apm,
 		.lanes_fini = rpmem_fip_fini_lanes_apm,
@@ -927,13 +1243,30 @@ rpmem_fip_set_attr(struct rpmem_fip *fip, struct rpmem_fip_attr *attr)
 	fip->laddr = attr->laddr;
 	fip->size = attr->size;
 	fip->persist_method = attr->persist_method;
+	fip->depth = attr->depth;
+	fip->busy_poll = attr->busy_poll;
+	fip->stats = attr->stats;
+	fip->nconns = attr->nconns ? attr->nconns : 1;
+	if (fip->nconns > RPMEM_MAX_NCONNS)
+		fip->nconns = RPMEM_MAX_NCONNS;
 
 	rpmem_fip_set_nlanes(fip, attr->nlanes);
 
-	fip->cq_size = rpmem_fip_cq_size(fip->nlanes,
+	/* slots of a connection and the read operations' lanes */
+	size_t nslots = (fip->nslots + fip->nconns - 1) / fip->nconns;
+	fip->cq_size = rpmem_fip_cq_size(nslots + RPMEM_FIP_RD_DEPTH,
 			fip->persist_method, RPMEM_FIP_NODE_CLIENT);
 
+	/* completions of sync's WRITEs */
+	fip->cq_size += RPMEM_FIP_SYNC_DEPTH;
+
 	fip->ops = &rpmem_fip_ops[fip->persist_method];
+
+	/* read-ahead in whole READ operations */
+	fip->ra_size = (attr->read_ahead + RPMEM_RD_BUFF_SIZE - 1) /
+			RPMEM_RD_BUFF_SIZE * RPMEM_RD_BUFF_SIZE;
+	if (fip->ra_size > RPMEM_FIP_RA_MAX)
+		fip->ra_size = RPMEM_FIP_RA_MAX;
 }
 
 /*
@@ -945,29 +1278,110 @@ rpmem_fip_signal_all(struct rpmem_fip *fip, int ret)
 {
 	switch (fip->persist_method) {
 	case RPMEM_PM_APM:
-		for (unsigned i = 0; i < fip->nlanes; i++)
+		for (unsigned i = 0; i < fip->nslots; i++)
 			rpmem_fip_lane_sigret(&fip->lanes.apm[i].lane,
 					FI_WRITE | FI_READ, ret);
 		break;
 	case RPMEM_PM_GPSPM:
-		for (unsigned i = 0; i < fip->nlanes; i++)
+		for (unsigned i = 0; i < fip->nslots; i++)
 			rpmem_fip_lane_sigret(&fip->lanes.gpspm[i].lane,
 					FI_WRITE | FI_SEND | FI_RECV, ret);
 		break;
 	default:
 		RPMEM_ASSERT(0);
 	}
+
+	for (unsigned i = 0; i < fip->nconns * RPMEM_FIP_SYNC_DEPTH; i++)
+		rpmem_fip_lane_sigret(&fip->sync[i].lane, FI_WRITE, ret);
+
+	for (unsigned r = 0; r < RPMEM_FIP_RD_DEPTH; r++)
+		rpmem_fip_lane_sigret(&fip->rd_lanes[r].lane, FI_READ, ret);
 }
 
 /*
- * rpmem_fip_process -- (internal) process completion events
+ * rpmem_fip_slot -- (internal) return base lane structure of a slot
  */
-static int
-rpmem_fip_process(struct rpmem_fip *fip)
+static inline struct rpmem_fip_lane *
+rpmem_fip_slot(struct rpmem_fip *fip, unsigned slot)
+{
+	switch (fip->persist_method) {
+	case RPMEM_PM_APM:
+		return &fip->lanes.apm[slot].lane;
+	case RPMEM_PM_GPSPM:
+		return &fip->lanes.gpspm[slot].lane;
+	default:
+		RPMEM_ASSERT(0);
+		return NULL;
+	}
+}
+
+/*
+ * rpmem_fip_cq_error -- (internal) log the error read from completion queue
+ */
+static void
+rpmem_fip_cq_error(struct rpmem_fip_conn *conn)
 {
-	ssize_t sret;
 	struct fi_cq_err_entry err;
 	const char *str_err;
+	ssize_t sret;
+
+	sret = fi_cq_readerr(conn->cq, &err, 0);
+	if (sret < 0) {
+		RPMEM_FI_ERR((int)sret, "error reading from completion queue: "
+			"cannot read error from event queue");
+		return;
+	}
+
+	str_err = fi_cq_strerror(conn->cq, err.prov_errno, NULL, NULL, 0);
+	RPMEM_LOG(ERR, "error reading from completion queue: %s", str_err);
+}
+
+/*
+ * rpmem_fip_process_entries -- (internal) process completion queue entries
+ */
+static int
+rpmem_fip_process_entries(struct rpmem_fip *fip,
+	struct fi_cq_msg_entry *cq_entries, size_t count)
+{
+	int ret;
+
+	for (size_t i = 0; i < count; i++) {
+		struct fi_cq_msg_entry *comp = &cq_entries[i];
+
+		/*
+		 * If the context is NULL it probably means that
+		 * we get an unexpected CQ entry. The CQ is configured
+		 * with FI_SELECTIVE_COMPLETION so every inbound or
+		 * outbound operation must be issued with FI_COMPLETION
+		 * flag and non-NULL context.
+		 */
+		RPMEM_ASSERT(comp->op_context);
+
+		/* read operation */
+		struct rpmem_fip_rlane *rlanep = comp->op_context;
+		if (unlikely(rlanep >= fip->rd_lanes &&
+				rlanep < fip->rd_lanes + RPMEM_FIP_RD_DEPTH)) {
+			rpmem_fip_lane_signal(&rlanep->lane, FI_READ);
+			continue;
+		}
+
+		/* persist operation */
+		ret = fip->ops->process(fip, comp->op_context, comp->flags);
+		if (unlikely(ret))
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmem_fip_process -- (internal) process completion events of a connection
+ */
+static int
+rpmem_fip_process(struct rpmem_fip_conn *conn)
+{
+	struct rpmem_fip *fip = conn->fip;
+	ssize_t sret;
 	int ret;
 	struct fi_cq_msg_entry *cq_entries;
 
@@ -978,7 +1392,7 @@ rpmem_fip_process(struct rpmem_fip *fip)
 	}
 
 	while (!fip->closing) {
-		sret = fi_cq_sread(fip->cq, cq_entries, fip->cq_size,
+		sret = fi_cq_sread(conn->cq, cq_entries, fip->cq_size,
 				NULL, RPMEM_FIP_CQ_WAIT_MS);
 
 		if (unlikely(fip->closing))
@@ -992,51 +1406,75 @@ rpmem_fip_process(struct rpmem_fip *fip)
 			goto err_cq_read;
 		}
 
-		for (ssize_t i = 0; i < sret; i++) {
-			struct fi_cq_msg_entry *comp = &cq_entries[i];
-
-			/*
-			 * If the context is NULL it probably means that
-			 * we get an unexpected CQ entry. The CQ is configured
-			 * with FI_SELECTIVE_COMPLETION so every inbound or
-			 * outbound operation must be issued with FI_COMPLETION
-			 * flag and non-NULL context.
-			 */
-			RPMEM_ASSERT(comp->op_context);
-
-			/* read operation */
-			if (unlikely(comp->op_context == &fip->rd_lane)) {
-				rpmem_fip_lane_signal(&fip->rd_lane.lane,
-						FI_READ);
-				continue;
-			}
-
-			/* persist operation */
-			ret = fip->ops->process(fip, comp->op_context,
-					comp->flags);
-			if (unlikely(ret))
-				goto err;
-		}
+		ret = rpmem_fip_process_entries(fip, cq_entries,
+				(size_t)sret);
+		if (unlikely(ret))
+			goto err;
 	}
 
 	Free(cq_entries);
 	return 0;
 err_cq_read:
-	sret = fi_cq_readerr(fip->cq, &err, 0);
-	if (sret < 0) {
-		RPMEM_FI_ERR((int)sret, "error reading from completion queue: "
-			"cannot read error from event queue");
-		goto err;
-	}
-
-	str_err = fi_cq_strerror(fip->cq, err.prov_errno, NULL, NULL, 0);
-	RPMEM_LOG(ERR, "error reading from completion queue: %s", str_err);
+	rpmem_fip_cq_error(conn);
 err:
 	rpmem_fip_signal_all(fip, ret);
 	Free(cq_entries);
 	return ret;
 }
 
+/*
+ * rpmem_fip_poll_cq -- (internal) read and process available completion
+ * events in the busy-poll mode
+ *
+ * Only one thread at a time reads the completion queue, the others return
+ * immediately and recheck their lanes.
+ */
+static int
+rpmem_fip_poll_cq(struct rpmem_fip_conn *conn)
+{
+	if (!__sync_bool_compare_and_swap(&conn->cq_polling, 0, 1))
+		return 0;
+
+	struct rpmem_fip *fip = conn->fip;
+	int ret = 0;
+	ssize_t sret = fi_cq_read(conn->cq, conn->cq_entries, fip->cq_size);
+	if (likely(sret > 0)) {
+		ret = rpmem_fip_process_entries(fip, conn->cq_entries,
+				(size_t)sret);
+	} else if (unlikely(sret != -FI_EAGAIN)) {
+		ret = (int)sret;
+		rpmem_fip_cq_error(conn);
+	}
+
+	__sync_synchronize();
+	conn->cq_polling = 0;
+
+	if (unlikely(ret))
+		rpmem_fip_signal_all(fip, ret);
+
+	return ret;
+}
+
+/*
+ * rpmem_fip_wait_lane -- (internal) wait for specified event(s) on a lane,
+ * polling the completion queue of lane's connection in the busy-poll mode
+ */
+static inline int
+rpmem_fip_wait_lane(struct rpmem_fip *fip, struct rpmem_fip_conn *conn,
+	struct rpmem_fip_lane *lanep, uint64_t sig)
+{
+	if (!fip->busy_poll)
+		return rpmem_fip_lane_wait(lanep, sig);
+
+	while (lanep->sync & sig) {
+		int ret = rpmem_fip_poll_cq(conn);
+		if (unlikely(ret))
+			return ret;
+	}
+
+	return lanep->ret;
+}
+
 /*
  * rpmem_fip_process_thread -- (internal) process thread callback
  */
@@ -1045,9 +1483,9 @@ rpmem_fip_process_thread(void *arg)
 {
 	int ret;
 
-	struct rpmem_fip *fip = arg;
+	struct rpmem_fip_conn *conn = arg;
 
-	ret = rpmem_fip_process(fip);
+	ret = rpmem_fip_process(conn);
 
 	return (void *)(uintptr_t)ret;
 }
@@ -1074,6 +1512,17 @@ rpmem_fip_init(const char *node, const char *service,
 	rpmem_fip_set_attr(fip, attr);
 
 	*nlanes = fip->nlanes;
+	attr->nconns = fip->nconns;
+	attr->read_ahead = fip->ra_size;
+
+	fip->conns = Zalloc(fip->nconns * sizeof(*fip->conns));
+	if (!fip->conns) {
+		RPMEM_LOG(ERR, "!allocating connections");
+		goto err_alloc_conns;
+	}
+
+	for (unsigned i = 0; i < fip->nconns; i++)
+		fip->conns[i].fip = fip;
 
 	ret = rpmem_fip_init_fabric_res(fip);
 	if (ret)
@@ -1093,6 +1542,8 @@ err_init_lanes:
 err_init_memory:
 	rpmem_fip_fini_fabric_res(fip);
 err_init_fabric_res:
+	Free(fip->conns);
+err_alloc_conns:
 	fi_freeinfo(fip->fi);
 err_getinfo:
 	Free(fip);
@@ -1105,53 +1556,67 @@ err_getinfo:
 void
 rpmem_fip_fini(struct rpmem_fip *fip)
 {
-	fip->ops->lanes_fini(fip);
+	rpmem_fip_fini_lanes(fip);
 	rpmem_fip_fini_memory(fip);
 	rpmem_fip_fini_fabric_res(fip);
+	Free(fip->conns);
 	fi_freeinfo(fip->fi);
 	Free(fip);
 }
 
 /*
  * rpmem_fip_connect -- connect to remote peer
+ *
+ * The connections are established one by one, so the remote peer accepts
+ * them in the same order.
  */
 int
 rpmem_fip_connect(struct rpmem_fip *fip)
 {
 	int ret;
 	struct fi_eq_cm_entry entry;
+	unsigned i;
 
-	ret = rpmem_fip_init_cq(fip);
-	if (ret)
-		goto err_init_cq;
+	for (i = 0; i < fip->nconns; i++) {
+		ret = rpmem_fip_init_cq(fip, &fip->conns[i]);
+		if (ret)
+			goto err_init_conn;
 
-	ret = rpmem_fip_init_ep(fip);
-	if (ret)
-		goto err_init_ep;
+		ret = rpmem_fip_init_ep(fip, &fip->conns[i]);
+		if (ret) {
+			rpmem_fip_fini_cq(&fip->conns[i]);
+			goto err_init_conn;
+		}
+	}
 
 	ret = fip->ops->lanes_post(fip);
 	if (ret)
 		goto err_lanes_post;
 
-	ret = fi_connect(fip->ep, fip->fi->dest_addr, NULL, 0);
-	if (ret) {
-		RPMEM_FI_ERR(ret, "initiating connection request");
-		goto err_fi_connect;
-	}
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		struct fid_ep *ep = fip->conns[c].ep;
 
-	ret = rpmem_fip_read_eq(fip->eq, &entry, FI_CONNECTED,
-			&fip->ep->fid, -1);
-	if (ret)
-		goto err_fi_eq_read;
+		ret = fi_connect(ep, fip->fi->dest_addr, NULL, 0);
+		if (ret) {
+			RPMEM_FI_ERR(ret, "initiating connection request");
+			goto err_fi_connect;
+		}
+
+		ret = rpmem_fip_read_eq(fip->eq, &entry, FI_CONNECTED,
+				&ep->fid, -1);
+		if (ret)
+			goto err_fi_eq_read;
+	}
 
 	return 0;
 err_fi_eq_read:
 err_fi_connect:
 err_lanes_post:
-	rpmem_fip_fini_ep(fip);
-err_init_ep:
-	rpmem_fip_fini_cq(fip);
-err_init_cq:
+err_init_conn:
+	while (i--) {
+		rpmem_fip_fini_ep(&fip->conns[i]);
+		rpmem_fip_fini_cq(&fip->conns[i]);
+	}
 	return ret;
 }
 
@@ -1164,22 +1629,26 @@ rpmem_fip_close(struct rpmem_fip *fip)
 	int ret;
 	int lret = 0;
 
-	ret = fi_shutdown(fip->ep, 0);
-	if (ret) {
-		RPMEM_FI_ERR(ret, "disconnecting endpoint");
-		lret = ret;
-	}
+	for (unsigned i = 0; i < fip->nconns; i++) {
+		struct rpmem_fip_conn *conn = &fip->conns[i];
 
-	ret = rpmem_fip_fini_ep(fip);
-	if (ret)
-		lret = ret;
+		ret = fi_shutdown(conn->ep, 0);
+		if (ret) {
+			RPMEM_FI_ERR(ret, "disconnecting endpoint");
+			lret = ret;
+		}
 
-	ret = rpmem_fip_fini_cq(fip);
-	if (ret)
-		lret = ret;
+		ret = rpmem_fip_fini_ep(conn);
+		if (ret)
+			lret = ret;
 
-	return lret;
-}
+		ret = rpmem_fip_fini_cq(conn);
+		if (ret)
+			lret = ret;
+	}
+
+	return lret;
+}
 
 /*
  * prmem_fip_process -- run process thread
@@ -1189,12 +1658,26 @@ rpmem_fip_process_start(struct rpmem_fip *fip)
 {
 	int ret;
 
-	ret = pthread_create(&fip->process_thread, NULL,
-			rpmem_fip_process_thread, fip);
-	if (ret) {
-		RPMEM_LOG(ERR, "creating process thread -- %d", ret);
+	/* the waiting threads process the completions themselves */
+	if (fip->busy_poll)
+		return 0;
+
+	unsigned i;
+	for (i = 0; i < fip->nconns; i++) {
+		ret = pthread_create(&fip->conns[i].process_thread, NULL,
+				rpmem_fip_process_thread, &fip->conns[i]);
+		if (ret) {
+			RPMEM_LOG(ERR, "creating process thread -- %d", ret);
+			goto err_create;
+		}
 	}
 
+	return 0;
+err_create:
+	fip->closing = 1;
+	while (i--)
+		pthread_join(fip->conns[i].process_thread, NULL);
+	fip->closing = 0;
 	return ret;
 }
 
@@ -1206,25 +1689,316 @@ rpmem_fip_process_stop(struct rpmem_fip *fip)
 {
 	int ret;
 
+	int lret = 0;
+
 	fip->closing = 1;
 
-	void *tret;
-	ret = pthread_join(fip->process_thread, &tret);
-	if (ret) {
-		RPMEM_LOG(ERR, "joining process thread -- %d", ret);
-		return ret;
-	} else {
-		ret = (int)(uintptr_t)tret;
+	if (fip->busy_poll)
+		return 0;
+
+	for (unsigned i = 0; i < fip->nconns; i++) {
+		void *tret;
+		ret = pthread_join(fip->conns[i].process_thread, &tret);
 		if (ret) {
-			RPMEM_LOG(ERR, "process thread failed -- %d", ret);
+			RPMEM_LOG(ERR, "joining process thread -- %d", ret);
+			lret = ret;
+		} else {
+			ret = (int)(uintptr_t)tret;
+			if (ret) {
+				RPMEM_LOG(ERR, "process thread failed -- %d",
+						ret);
+				lret = ret;
+			}
 		}
 	}
 
+	return lret;
+}
+
+/*
+ * rpmem_fip_post -- (internal) post remote persist operation of a number
+ * of ranges
+ *
+ * On success the number of the operation is stored in *token.  If the
+ * operation posted to the reused slot failed and hasn't been waited for,
+ * its error is returned here.
+ */
+static int
+rpmem_fip_post(struct rpmem_fip *fip, const struct rpmem_fip_range *ranges,
+	unsigned nranges, unsigned lane, uint64_t *token)
+{
+	uint64_t seq = fip->lane_seq[lane];
+	unsigned slot = lane * fip->depth + (unsigned)(seq % fip->depth);
+	struct rpmem_fip_lane *lanep = rpmem_fip_slot(fip, slot);
+	struct rpmem_fip_conn *conn = rpmem_fip_slot_conn(fip, slot);
+
+	/* wait for the operation issued depth operations earlier */
+	int ret = rpmem_fip_wait_lane(fip, conn, lanep,
+			RPMEM_FIP_PERSIST_EVENTS);
+	if (unlikely(ret))
+		return ret;
+
+	fip->slot_seq[slot] = seq;
+	fip->lane_seq[lane] = seq + 1;
+
+	uint64_t start = fip->stats ? rpmem_hist_now() : 0;
+
+	ret = fip->ops->persist(fip, ranges, nranges, slot);
+	if (unlikely(ret)) {
+		/* do not let anyone wait for events which will never come */
+		rpmem_fip_lane_sigret(lanep, RPMEM_FIP_PERSIST_EVENTS, ret);
+		return ret;
+	}
+
+	if (fip->stats) {
+		rpmem_hist_add(&fip->lane_stats[lane].post,
+				rpmem_hist_now() - start);
+		fip->slot_ts[slot] = start;
+	}
+
+	*token = seq;
+
+	return 0;
+}
+
+/*
+ * rpmem_fip_persist_async -- post remote persist operation
+ *
+ * On success the number of the operation is stored in *token, which can be
+ * passed to rpmem_fip_wait() or rpmem_fip_poll() on the same lane.
+ * The operation is never batched.
+ */
+int
+rpmem_fip_persist_async(struct rpmem_fip *fip, size_t offset, size_t len,
+	unsigned lane, uint64_t *token)
+{
+	RPMEM_ASSERT(lane < fip->nlanes);
+	if (unlikely(lane >= fip->nlanes)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_fip_range range = {
+		.offset = offset,
+		.len = len,
+	};
+
+	return rpmem_fip_post(fip, &range, 1, lane, token);
+}
+
+/*
+ * rpmem_fip_token_slot -- (internal) return slot of an operation and its
+ * connection or NULL if the slot has been reused by a later operation
+ */
+static struct rpmem_fip_lane *
+rpmem_fip_token_slot(struct rpmem_fip *fip, unsigned lane, uint64_t token,
+	struct rpmem_fip_conn **conn)
+{
+	unsigned slot = lane * fip->depth + (unsigned)(token % fip->depth);
+	if (fip->slot_seq[slot] != token)
+		return NULL;
+
+	*conn = rpmem_fip_slot_conn(fip, slot);
+	return rpmem_fip_slot(fip, slot);
+}
+
+/*
+ * rpmem_fip_stats_done -- (internal) record statistics of an operation
+ * whose completion has been observed
+ *
+ * The latency of the whole operation is recorded only the first time
+ * its completion is observed.
+ */
+static void
+rpmem_fip_stats_done(struct rpmem_fip *fip, unsigned lane, uint64_t token,
+	uint64_t wait_start)
+{
+	unsigned slot = lane * fip->depth + (unsigned)(token % fip->depth);
+	struct rpmem_fip_stats *stats = &fip->lane_stats[lane];
+	uint64_t now = rpmem_hist_now();
+
+	if (wait_start)
+		rpmem_hist_add(&stats->wait, now - wait_start);
+
+	if (fip->slot_ts[slot]) {
+		rpmem_hist_add(&stats->total, now - fip->slot_ts[slot]);
+		fip->slot_ts[slot] = 0;
+	}
+}
+
+/*
+ * rpmem_fip_poll -- check whether remote persist operation has completed
+ *
+ * Returns 1 if the operation has completed, 0 if it is still in flight
+ * and an error code if it has failed.
+ */
+int
+rpmem_fip_poll(struct rpmem_fip *fip, unsigned lane, uint64_t token)
+{
+	RPMEM_ASSERT(lane < fip->nlanes);
+	if (unlikely(lane >= fip->nlanes || token >= fip->lane_seq[lane])) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_fip_conn *conn;
+	struct rpmem_fip_lane *lanep = rpmem_fip_token_slot(fip, lane, token,
+			&conn);
+	if (!lanep)
+		return 1;
+
+	/* make progress, nobody else would */
+	if (fip->busy_poll && (lanep->sync & RPMEM_FIP_PERSIST_EVENTS)) {
+		int ret = rpmem_fip_poll_cq(conn);
+		if (unlikely(ret))
+			return ret;
+	}
+
+	if (lanep->sync & RPMEM_FIP_PERSIST_EVENTS)
+		return 0;
+
+	if (lanep->ret)
+		return lanep->ret;
+
+	if (fip->stats)
+		rpmem_fip_stats_done(fip, lane, token, 0);
+
+	return 1;
+}
+
+/*
+ * rpmem_fip_wait -- wait for remote persist operation to complete
+ */
+int
+rpmem_fip_wait(struct rpmem_fip *fip, unsigned lane, uint64_t token)
+{
+	RPMEM_ASSERT(lane < fip->nlanes);
+	if (unlikely(lane >= fip->nlanes || token >= fip->lane_seq[lane])) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_fip_conn *conn;
+	struct rpmem_fip_lane *lanep = rpmem_fip_token_slot(fip, lane, token,
+			&conn);
+	if (!lanep)
+		return 0;
+
+	uint64_t start = fip->stats ? rpmem_hist_now() : 0;
+
+	int ret = rpmem_fip_wait_lane(fip, conn, lanep,
+			RPMEM_FIP_PERSIST_EVENTS);
+
+	if (fip->stats && !ret)
+		rpmem_fip_stats_done(fip, lane, token, start);
+
 	return ret;
 }
 
+/*
+ * rpmem_fip_batch_add -- (internal) record range in the batch, merging it
+ * with an overlapping or adjacent one if possible
+ *
+ * Returns 0 if there is no room for another range.
+ */
+static int
+rpmem_fip_batch_add(struct rpmem_fip_batch *batch, size_t offset, size_t len)
+{
+	for (unsigned i = 0; i < batch->nranges; i++) {
+		struct rpmem_fip_range *r = &batch->ranges[i];
+		if (offset > r->offset + r->len || r->offset > offset + len)
+			continue;
+
+		size_t end = offset + len > r->offset + r->len ?
+			offset + len : r->offset + r->len;
+		if (offset < r->offset)
+			r->offset = offset;
+		r->len = end - r->offset;
+
+		return 1;
+	}
+
+	if (batch->nranges == RPMEM_PERSIST_MAX_RANGES)
+		return 0;
+
+	batch->ranges[batch->nranges].offset = offset;
+	batch->ranges[batch->nranges].len = len;
+	batch->nranges++;
+
+	return 1;
+}
+
+/*
+ * rpmem_fip_batch_flush -- (internal) post ranges recorded in the batch
+ */
+static int
+rpmem_fip_batch_flush(struct rpmem_fip *fip, unsigned lane)
+{
+	struct rpmem_fip_batch *batch = &fip->batches[lane];
+	if (batch->nranges == 0)
+		return 0;
+
+	uint64_t token;
+	int ret = rpmem_fip_post(fip, batch->ranges, batch->nranges,
+			lane, &token);
+
+	batch->nranges = 0;
+
+	return ret;
+}
+
+/*
+ * rpmem_fip_batch_begin -- start batching persist operations on a lane
+ */
+int
+rpmem_fip_batch_begin(struct rpmem_fip *fip, unsigned lane)
+{
+	RPMEM_ASSERT(lane < fip->nlanes);
+	if (unlikely(lane >= fip->nlanes || fip->batches[lane].active)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_fip_batch *batch = &fip->batches[lane];
+
+	batch->active = 1;
+	batch->nranges = 0;
+	batch->first = fip->lane_seq[lane];
+
+	return 0;
+}
+
+/*
+ * rpmem_fip_batch_end -- post batched persist operations and wait for all
+ * of them to complete
+ */
+int
+rpmem_fip_batch_end(struct rpmem_fip *fip, unsigned lane)
+{
+	RPMEM_ASSERT(lane < fip->nlanes);
+	if (unlikely(lane >= fip->nlanes || !fip->batches[lane].active)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_fip_batch *batch = &fip->batches[lane];
+	batch->active = 0;
+
+	int lret = rpmem_fip_batch_flush(fip, lane);
+
+	for (uint64_t t = batch->first; t < fip->lane_seq[lane]; t++) {
+		int ret = rpmem_fip_wait(fip, lane, t);
+		if (ret && !lret)
+			lret = ret;
+	}
+
+	return lret;
+}
+
 /*
  * rpmem_fip_persist -- perform remote persist operation
+ *
+ * Inside a batch the operation is only recorded.
  */
 int
 rpmem_fip_persist(struct rpmem_fip *fip, size_t offset, size_t len,
@@ -1236,41 +2010,228 @@ rpmem_fip_persist(struct rpmem_fip *fip, size_t offset, size_t len,
 		return -1;
 	}
 
-	return fip->ops->persist(fip, offset, len, lane);
+	struct rpmem_fip_batch *batch = &fip->batches[lane];
+	if (batch->active) {
+		if (rpmem_fip_batch_add(batch, offset, len))
+			return 0;
+
+		int ret = rpmem_fip_batch_flush(fip, lane);
+		if (unlikely(ret))
+			return ret;
+
+		rpmem_fip_batch_add(batch, offset, len);
+		return 0;
+	}
+
+	uint64_t token;
+	int ret = rpmem_fip_persist_async(fip, offset, len, lane, &token);
+	if (unlikely(ret))
+		return ret;
+
+	return rpmem_fip_wait(fip, lane, token);
 }
 
 /*
- * rpmem_fip_read -- perform read operation
+ * rpmem_fip_rd_complete -- (internal) wait for READ on a lane and copy
+ * the data to its destination
  */
-int
-rpmem_fip_read(struct rpmem_fip *fip, void *buff, size_t len, size_t off)
+static int
+rpmem_fip_rd_complete(struct rpmem_fip *fip, struct rpmem_fip_rlane *rlanep)
 {
-	RPMEM_ASSERT(!rpmem_fip_lane_busy(&fip->rd_lane.lane));
+	int ret = rpmem_fip_wait_lane(fip, &fip->conns[0], &rlanep->lane,
+			FI_READ);
+	if (unlikely(ret)) {
+		rlanep->len = 0;
+		return ret;
+	}
 
-	int ret = 0;
-	size_t rd = 0;
-	uint8_t *cbuff = buff;
-	while (rd < len) {
-		rpmem_fip_lane_begin(&fip->rd_lane.lane, FI_READ);
+	if (rlanep->dst) {
+		memcpy(rlanep->dst, rlanep->buff, rlanep->len);
+		rlanep->dst = NULL;
+		rlanep->len = 0;
+	}
 
-		size_t rd_len = len - rd < RPMEM_RD_BUFF_SIZE ?
-				len - rd : RPMEM_RD_BUFF_SIZE;
-		size_t rd_off = off + rd;
-		uint64_t raddr = fip->raddr + rd_off;
+	return 0;
+}
+
+/*
+ * rpmem_fip_rd_post -- (internal) post READ on the next lane
+ *
+ * The lanes are reused in order, so up to RPMEM_FIP_RD_DEPTH READs are
+ * in flight.  The data read by the lane's previous READ is copied to its
+ * destination first or discarded if it has been read ahead.
+ */
+static int
+rpmem_fip_rd_post(struct rpmem_fip *fip, size_t off, size_t len, void *dst)
+{
+	RPMEM_ASSERT(len <= RPMEM_RD_BUFF_SIZE);
 
-		ret = rpmem_fip_readmsg(fip->ep, &fip->rd_lane.read,
-				fip->rd_buff, rd_len, raddr);
+	struct rpmem_fip_rlane *rlanep = &fip->rd_lanes[fip->rd_next];
+	fip->rd_next = (fip->rd_next + 1) % RPMEM_FIP_RD_DEPTH;
 
-		ret = rpmem_fip_lane_wait(&fip->rd_lane.lane, FI_READ);
-		if (ret)
+	int ret = rpmem_fip_rd_complete(fip, rlanep);
+	if (unlikely(ret))
+		return ret;
+
+	rpmem_fip_lane_begin(&rlanep->lane, FI_READ);
+	rlanep->off = off;
+	rlanep->len = len;
+	rlanep->dst = dst;
+
+	ret = rpmem_fip_readmsg(fip->conns[0].ep, &rlanep->read,
+			rlanep->buff, len, fip->raddr + off);
+	if (unlikely(ret)) {
+		RPMEM_FI_ERR(ret, "RMA read");
+		rlanep->len = 0;
+		rlanep->dst = NULL;
+		rpmem_fip_lane_signal(&rlanep->lane, FI_READ);
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmem_fip_ra_find -- (internal) find data read ahead at given offset
+ */
+static struct rpmem_fip_rlane *
+rpmem_fip_ra_find(struct rpmem_fip *fip, size_t off)
+{
+	for (unsigned r = 0; r < RPMEM_FIP_RD_DEPTH; r++) {
+		struct rpmem_fip_rlane *rlanep = &fip->rd_lanes[r];
+		if (rlanep->len && !rlanep->dst && off >= rlanep->off &&
+				off - rlanep->off < rlanep->len)
+			return rlanep;
+	}
+
+	return NULL;
+}
+
+/*
+ * rpmem_fip_ra_post -- (internal) read ahead data following a sequential read
+ */
+static int
+rpmem_fip_ra_post(struct rpmem_fip *fip, size_t off, size_t end)
+{
+	int seq = off == fip->rd_end;
+	fip->rd_end = end;
+
+	if (!seq) {
+		fip->ra_end = 0;
+		return 0;
+	}
+
+	size_t ra_off = fip->ra_end > end ? fip->ra_end : end;
+	size_t ra_end = end + fip->ra_size < fip->size ?
+			end + fip->ra_size : fip->size;
+
+	while (ra_off < ra_end) {
+		size_t len = ra_end - ra_off < RPMEM_RD_BUFF_SIZE ?
+				ra_end - ra_off : RPMEM_RD_BUFF_SIZE;
+
+		int ret = rpmem_fip_rd_post(fip, ra_off, len, NULL);
+		if (unlikely(ret))
 			return ret;
 
-		memcpy(&cbuff[rd], fip->rd_buff, rd_len);
+		ra_off += len;
+		fip->ra_end = ra_off;
+	}
 
-		rd += rd_len;
+	return 0;
+}
+
+/*
+ * rpmem_fip_readv -- perform read operations of multiple ranges
+ *
+ * READs for all the ranges are posted at once, up to RPMEM_FIP_RD_DEPTH
+ * of them in flight, and awaited together.  If read-ahead is enabled the
+ * data read ahead is used and a read which starts where the previous one
+ * ended triggers reading ahead of the data which follows it.  The data read
+ * ahead is not updated by persist operations, so the read-ahead is meant
+ * for sequential scans of data which is not modified meanwhile.
+ *
+ * Read operations must not be called concurrently.
+ */
+int
+rpmem_fip_readv(struct rpmem_fip *fip, const struct rpmem_fip_rd_iov *iov,
+	unsigned iovcnt)
+{
+	int ret = 0;
+
+	for (unsigned i = 0; i < iovcnt; i++) {
+		if (iov[i].off > fip->size ||
+				iov[i].len > fip->size - iov[i].off) {
+			errno = EINVAL;
+			return -1;
+		}
 	}
 
-	return ret;
+	for (unsigned i = 0; i < iovcnt; i++) {
+		uint8_t *cbuff = iov[i].buff;
+		size_t rd = 0;
+		while (rd < iov[i].len) {
+			size_t off = iov[i].off + rd;
+			size_t len = iov[i].len - rd;
+
+			struct rpmem_fip_rlane *rlanep = fip->ra_size ?
+				rpmem_fip_ra_find(fip, off) : NULL;
+			if (rlanep) {
+				ret = rpmem_fip_rd_complete(fip, rlanep);
+				if (unlikely(ret))
+					goto err;
+
+				size_t roff = off - rlanep->off;
+				if (len > rlanep->len - roff)
+					len = rlanep->len - roff;
+
+				memcpy(&cbuff[rd], (uint8_t *)rlanep->buff +
+						roff, len);
+			} else {
+				if (len > RPMEM_RD_BUFF_SIZE)
+					len = RPMEM_RD_BUFF_SIZE;
+
+				ret = rpmem_fip_rd_post(fip, off, len,
+						&cbuff[rd]);
+				if (unlikely(ret))
+					goto err;
+			}
+
+			rd += len;
+		}
+	}
+
+err:
+	/* wait for all the READs with destination */
+	for (unsigned r = 0; r < RPMEM_FIP_RD_DEPTH; r++) {
+		struct rpmem_fip_rlane *rlanep = &fip->rd_lanes[r];
+		if (!rlanep->dst)
+			continue;
+
+		int cret = rpmem_fip_rd_complete(fip, rlanep);
+		if (!ret)
+			ret = cret;
+	}
+
+	if (ret || !fip->ra_size || !iovcnt)
+		return ret;
+
+	const struct rpmem_fip_rd_iov *last = &iov[iovcnt - 1];
+	return rpmem_fip_ra_post(fip, last->off, last->off + last->len);
+}
+
+/*
+ * rpmem_fip_read -- perform read operation
+ */
+int
+rpmem_fip_read(struct rpmem_fip *fip, void *buff, size_t len, size_t off)
+{
+	struct rpmem_fip_rd_iov iov = {
+		.buff = buff,
+		.off = off,
+		.len = len,
+	};
+
+	return rpmem_fip_readv(fip, &iov, 1);
 }
 
 /*
@@ -1282,5 +2243,220 @@ rpmem_fip_monitor(struct rpmem_fip *fip, int nonblock)
 	struct fi_eq_cm_entry entry;
 	int timeout = nonblock ? 0 : -1;
 	return rpmem_fip_read_eq(fip->eq, &entry, FI_CONNECTED,
-			&fip->ep->fid, timeout);
+			&fip->conns[0].ep->fid, timeout);
+}
+
+/*
+ * rpmem_fip_sync_next -- (internal) find next range to write during sync
+ *
+ * Without checksums the range is the next chunk of the part.  Otherwise it
+ * is the next run of blocks which differ from the remote ones, limited to
+ * a chunk.  Returns 0 if there is nothing more to write in the part.
+ */
+static int
+rpmem_fip_sync_next(struct rpmem_fip *fip, size_t *offp, size_t end,
+	size_t offset, size_t blk_size, const uint64_t *sums,
+	struct rpmem_fip_range *range)
+{
+	size_t off = *offp;
+
+	if (!sums) {
+		if (off == end)
+			return 0;
+
+		range->offset = off;
+		range->len = end - off < RPMEM_FIP_SYNC_CHUNK ?
+				end - off : RPMEM_FIP_SYNC_CHUNK;
+		*offp = off + range->len;
+		return 1;
+	}
+
+	range->len = 0;
+	while (off < end) {
+		size_t blen = end - off < blk_size ? end - off : blk_size;
+		uint64_t csum = sums[(off - offset) / blk_size];
+		void *laddr = (void *)((uintptr_t)fip->laddr + off);
+
+		if (util_checksum(laddr, blen, &csum, 0)) {
+			off += blen;
+			if (range->len)
+				break;
+			continue;
+		}
+
+		if (range->len + blen > RPMEM_FIP_SYNC_CHUNK)
+			break;
+
+		if (!range->len)
+			range->offset = off;
+		range->len += blen;
+		off += blen;
+	}
+
+	*offp = off;
+	return range->len != 0;
+}
+
+/*
+ * rpmem_fip_sync -- synchronize range of the remote pool with local memory
+ *
+ * The range is split into one contiguous part per connection and written
+ * using large WRITEs, up to RPMEM_FIP_SYNC_DEPTH of them in flight on each
+ * connection.  The durability of the whole part is ensured once, by a single
+ * drain after all of its WRITEs.
+ *
+ * If sums is not NULL it contains checksums (see util_checksum) of the
+ * consecutive blk_size blocks of the remote range and only the blocks
+ * which differ are written.
+ *
+ * It must not be called concurrently with any other operation.
+ */
+int
+rpmem_fip_sync(struct rpmem_fip *fip, size_t offset, size_t len,
+	size_t blk_size, const uint64_t *sums)
+{
+	if (offset > fip->size || len > fip->size - offset) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (sums && (!blk_size || blk_size % 4 || offset % 4 || len % 4 ||
+			blk_size > RPMEM_FIP_SYNC_CHUNK)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!len)
+		return 0;
+
+	size_t unit = sums ? blk_size : RPMEM_FIP_SYNC_CHUNK;
+	size_t nunits = (len + unit - 1) / unit;
+	size_t part_units = (nunits + fip->nconns - 1) / fip->nconns;
+
+	struct rpmem_fip_range parts[RPMEM_MAX_NCONNS];
+	size_t offs[RPMEM_MAX_NCONNS];
+	unsigned next[RPMEM_MAX_NCONNS];
+	int active[RPMEM_MAX_NCONNS];
+
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		size_t start = c * part_units * unit;
+		size_t end = start + part_units * unit;
+		if (start > len)
+			start = len;
+		if (end > len)
+			end = len;
+
+		parts[c].offset = offset + start;
+		parts[c].len = end - start;
+		offs[c] = parts[c].offset;
+		next[c] = 0;
+		active[c] = parts[c].len != 0;
+	}
+
+	int ret = 0;
+	int nactive;
+	do {
+		nactive = 0;
+		for (unsigned c = 0; c < fip->nconns; c++) {
+			if (!active[c])
+				continue;
+
+			struct rpmem_fip_range range;
+			size_t end = parts[c].offset + parts[c].len;
+			if (!rpmem_fip_sync_next(fip, &offs[c], end, offset,
+					blk_size, sums, &range)) {
+				active[c] = 0;
+				continue;
+			}
+
+			nactive++;
+
+			struct rpmem_fip_conn *conn = &fip->conns[c];
+			struct rpmem_fip_sync_ctx *ctx =
+				&fip->sync[c * RPMEM_FIP_SYNC_DEPTH + next[c]];
+			next[c] = (next[c] + 1) % RPMEM_FIP_SYNC_DEPTH;
+
+			ret = rpmem_fip_wait_lane(fip, conn, &ctx->lane,
+					FI_WRITE);
+			if (unlikely(ret))
+				goto err;
+
+			rpmem_fip_lane_begin(&ctx->lane, FI_WRITE);
+
+			void *laddr = (void *)((uintptr_t)fip->laddr +
+					range.offset);
+			ret = rpmem_fip_writemsg(conn->ep, &ctx->write, laddr,
+					range.len, fip->raddr + range.offset);
+			if (unlikely(ret)) {
+				RPMEM_FI_ERR(ret, "RMA write");
+				rpmem_fip_lane_signal(&ctx->lane, FI_WRITE);
+				goto err;
+			}
+		}
+	} while (nactive);
+
+	/* single durability barrier per connection, using its first slot */
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		if (!parts[c].len)
+			continue;
+
+		struct rpmem_fip_lane *lanep = rpmem_fip_slot(fip, c);
+		ret = rpmem_fip_wait_lane(fip, &fip->conns[c], lanep,
+				RPMEM_FIP_PERSIST_EVENTS);
+		if (unlikely(ret))
+			goto err;
+
+		ret = fip->ops->drain(fip, &parts[c], 1, c);
+		if (unlikely(ret))
+			goto err;
+	}
+
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		if (!parts[c].len)
+			continue;
+
+		struct rpmem_fip_lane *lanep = rpmem_fip_slot(fip, c);
+		ret = rpmem_fip_wait_lane(fip, &fip->conns[c], lanep,
+				RPMEM_FIP_PERSIST_EVENTS);
+		if (unlikely(ret))
+			goto err;
+	}
+
+err:
+	/* wait for all the WRITEs in flight before returning */
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		for (unsigned k = 0; k < RPMEM_FIP_SYNC_DEPTH; k++) {
+			struct rpmem_fip_sync_ctx *ctx =
+				&fip->sync[c * RPMEM_FIP_SYNC_DEPTH + k];
+			int wret = rpmem_fip_wait_lane(fip, &fip->conns[c],
+					&ctx->lane, FI_WRITE);
+			if (!ret)
+				ret = wret;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * rpmem_fip_stats -- collect persist latency statistics of all the lanes
+ *
+ * The statistics are collected only if enabled by the stats attribute,
+ * otherwise all the histograms are empty.
+ */
+void
+rpmem_fip_stats(struct rpmem_fip *fip, struct rpmem_fip_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!fip->stats)
+		return;
+
+	for (unsigned l = 0; l < fip->nlanes; l++) {
+		struct rpmem_fip_stats *lstats = &fip->lane_stats[l];
+
+		rpmem_hist_merge(&stats->post, &lstats->post);
+		rpmem_hist_merge(&stats->wait, &lstats->wait);
+		rpmem_hist_merge(&stats->total, &lstats->total);
+	}
 }
@@ -47,10 +47,33 @@ struct rpmem_fip_attr {
 	void *laddr;
 	size_t size;
 	unsigned nlanes;
+	unsigned depth;	/* persist operations in flight per lane, 0 means 1 */
+	int busy_poll;	/* waiting threads poll the completion queue */
+	unsigned nconns; /* number of connections, 0 means 1, set on init */
+	size_t read_ahead; /* read-ahead of sequential reads, 0 disables */
+	int stats;	/* collect persist latency statistics */
 	void *raddr;
 	uint64_t rkey;
 };
 
+/*
+ * rpmem_fip_stats -- persist latency statistics, see rpmem_hist.h
+ */
+struct rpmem_fip_stats {
+	struct rpmem_hist post;	/* posting persist operation */
+	struct rpmem_hist wait;	/* waiting for its completion */
+	struct rpmem_hist total; /* from posting until completion observed */
+};
+
+/*
+ * rpmem_fip_rd_iov -- range of the pool to read and its destination
+ */
+struct rpmem_fip_rd_iov {
+	void *buff;
+	size_t off;
+	size_t len;
+};
+
 struct rpmem_fip *rpmem_fip_init(const char *node, const char *service,
 		struct rpmem_fip_attr *attr, unsigned *nlanes);
 void rpmem_fip_fini(struct rpmem_fip *fip);
@@ -63,6 +86,19 @@ int rpmem_fip_process_stop(struct rpmem_fip *fip);
 
 int rpmem_fip_persist(struct rpmem_fip *fip, size_t offset, size_t len,
 		unsigned lane);
+int rpmem_fip_persist_async(struct rpmem_fip *fip, size_t offset, size_t len,
+		unsigned lane, uint64_t *token);
+int rpmem_fip_poll(struct rpmem_fip *fip, unsigned lane, uint64_t token);
+int rpmem_fip_wait(struct rpmem_fip *fip, unsigned lane, uint64_t token);
+
+int rpmem_fip_batch_begin(struct rpmem_fip *fip, unsigned lane);
+int rpmem_fip_batch_end(struct rpmem_fip *fip, unsigned lane);
 
 int rpmem_fip_read(struct rpmem_fip *fip, void *buff,
 		size_t len, size_t off);
+int rpmem_fip_readv(struct rpmem_fip *fip, const struct rpmem_fip_rd_iov *iov,
+		unsigned iovcnt);
+int rpmem_fip_sync(struct rpmem_fip *fip, size_t offset, size_t len,
+		size_t blk_size, const uint64_t *sums);
+
+void rpmem_fip_stats(struct rpmem_fip *fip, struct rpmem_fip_stats *stats);
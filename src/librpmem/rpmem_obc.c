@@ -195,6 +195,7 @@ rpmem_obc_alloc_create_msg(const struct rpmem_req_attr *req,
 	msg->pool_size = req->pool_size;
 	msg->nlanes = req->nlanes;
 	msg->provider = req->provider;
+	msg->nconns = req->nconns;
 
 	rpmem_obc_set_pool_desc(&msg->pool_desc,
 			req->pool_desc, pool_desc_size);
@@ -285,6 +286,7 @@ rpmem_obc_get_res(struct rpmem_resp_attr *res,
 	res->persist_method =
 		(enum rpmem_persist_method)ibc->persist_method;
 	res->nlanes = ibc->nlanes;
+	res->nconns = ibc->nconns ? ibc->nconns : 1;
 }
 
 /*
@@ -309,6 +311,7 @@ rpmem_obc_alloc_open_msg(const struct rpmem_req_attr *req,
 	msg->pool_size = req->pool_size;
 	msg->nlanes = req->nlanes;
 	msg->provider = req->provider;
+	msg->nconns = req->nconns;
 
 	rpmem_obc_set_pool_desc(&msg->pool_desc,
 			req->pool_desc, pool_desc_size);
@@ -753,6 +756,88 @@ err_notconnected:
 	return -1;
 }
 
+/*
+ * rpmem_obc_checksum -- perform checksum request operation
+ *
+ * Stores checksums of consecutive blocks of blk_size bytes of the given range
+ * of the opened pool in the sums array, which must be big enough to hold
+ * one checksum per block.  The last block may be shorter.
+ *
+ * Returns error if connection is not already established.
+ */
+int
+rpmem_obc_checksum(struct rpmem_obc *rpc, size_t offset, size_t len,
+	size_t blk_size, uint64_t *sums)
+{
+	if (!rpmem_obc_is_connected(rpc)) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	if (!len || !blk_size || offset % 4 || len % 4 || blk_size % 4) {
+		RPMEM_LOG(ERR, "invalid checksum request range "
+			"(%zu, %zu, %zu)", offset, len, blk_size);
+		errno = EINVAL;
+		return -1;
+	}
+
+	size_t nsums = (len - 1) / blk_size + 1;
+	if (nsums > RPMEM_CHECKSUM_MAX_BLOCKS) {
+		RPMEM_LOG(ERR, "too many blocks in checksum request -- %zu",
+				nsums);
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct rpmem_msg_checksum msg = {
+		.offset = offset,
+		.len = len,
+		.blk_size = blk_size,
+	};
+	rpmem_obc_set_msg_hdr(&msg.hdr, RPMEM_MSG_TYPE_CHECKSUM, sizeof(msg));
+
+	rpmem_hton_msg_checksum(&msg);
+
+	if (rpmem_obc_send(rpc->sockfd, &msg, sizeof(msg))) {
+		RPMEM_LOG(ERR, "!sending checksum request message failed");
+		return -1;
+	}
+
+	struct rpmem_msg_checksum_resp resp;
+	if (rpmem_obc_recv(rpc->sockfd, &resp, sizeof(resp))) {
+		RPMEM_LOG(ERR, "!receiving checksum request response failed");
+		return -1;
+	}
+
+	rpmem_ntoh_msg_checksum_resp(&resp);
+
+	/* the checksums follow only a successful response */
+	size_t resp_size = sizeof(resp);
+	if (!resp.hdr.status)
+		resp_size += nsums * sizeof(*sums);
+
+	if (rpmem_obc_check_hdr_resp(&resp.hdr, RPMEM_MSG_TYPE_CHECKSUM_RESP,
+			resp_size))
+		return -1;
+
+	if (resp.nsums != nsums) {
+		RPMEM_LOG(ERR, "invalid number of checksums -- %lu",
+				resp.nsums);
+		errno = EPROTO;
+		return -1;
+	}
+
+	if (rpmem_obc_recv(rpc->sockfd, sums, nsums * sizeof(*sums))) {
+		RPMEM_LOG(ERR, "!receiving checksums failed");
+		return -1;
+	}
+
+	for (size_t i = 0; i < nsums; i++)
+		sums[i] = be64toh(sums[i]);
+
+	return 0;
+}
+
 /*
  * rpmem_obc_close -- perform close request operation
  *
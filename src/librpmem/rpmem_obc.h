@@ -34,6 +34,7 @@
  * rpmem_obc.h -- rpmem out-of-band connection client header file
  */
 
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -60,4 +61,6 @@ int rpmem_obc_open(struct rpmem_obc *rpc,
 		struct rpmem_resp_attr *res,
 		struct rpmem_pool_attr *pool_attr);
 int rpmem_obc_remove(struct rpmem_obc *rpc, const char *pool_desc);
+int rpmem_obc_checksum(struct rpmem_obc *rpc, size_t offset, size_t len,
+		size_t blk_size, uint64_t *sums);
 int rpmem_obc_close(struct rpmem_obc *rpc);
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_shm.c -- rpmem shared memory transport module source file
+ *
+ * The pool of rpmemd is mapped directly, so the data are copied to it by
+ * the persisting thread itself and only the request to persist them is
+ * passed to rpmemd through the lane's ring.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "out.h"
+#include "util.h"
+#include "rpmem_common.h"
+#include "rpmem_shm_common.h"
+#include "rpmem_util.h"
+#include "rpmem_shm.h"
+
+/*
+ * rpmem_shm -- shared memory transport context
+ */
+struct rpmem_shm {
+	void *laddr;		/* local pool */
+	size_t size;		/* pool size */
+	unsigned nlanes;
+	unsigned port;		/* channel of rpmemd */
+
+	int sockfd;		/* connection to rpmemd */
+	void *pool_map;		/* mapping of the pool file */
+	size_t pool_map_size;
+	char *pool;		/* pool of rpmemd */
+	struct rpmem_shm_ctrl *ctrl;
+	size_t ctrl_size;
+};
+
+/*
+ * rpmem_shm_wait -- (internal) wait for the condition to become false,
+ * spin for a while and yield the processor later on
+ */
+#define rpmem_shm_wait(shm, cond) (\
+{\
+	int _ret = 0;\
+	unsigned _spin = 0;\
+	while (cond) {\
+		if ((shm)->ctrl->closed) {\
+			errno = ECONNRESET;\
+			_ret = -1;\
+			break;\
+		}\
+		if (++_spin > RPMEM_SHM_SPIN)\
+			sched_yield();\
+	}\
+	_ret;\
+})
+
+/*
+ * rpmem_shm_init -- initialize shared memory transport, the service is
+ * the channel number returned by rpmemd
+ */
+struct rpmem_shm *
+rpmem_shm_init(const char *service, struct rpmem_shm_attr *attr,
+	unsigned *nlanes)
+{
+	RPMEM_ASSERT(service);
+	RPMEM_ASSERT(attr);
+	RPMEM_ASSERT(nlanes);
+
+	char *end;
+	errno = 0;
+	unsigned long port = strtoul(service, &end, 10);
+	if (errno || *end || port == 0 || port > USHRT_MAX) {
+		RPMEM_LOG(ERR, "invalid shared memory channel -- %s", service);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!attr->nlanes) {
+		RPMEM_LOG(ERR, "invalid number of lanes");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct rpmem_shm *shm = Zalloc(sizeof(*shm));
+	if (!shm) {
+		RPMEM_LOG(ERR, "!allocating shared memory transport handle");
+		return NULL;
+	}
+
+	shm->laddr = attr->laddr;
+	shm->size = attr->size;
+	shm->nlanes = attr->nlanes;
+	shm->port = (unsigned)port;
+	shm->sockfd = -1;
+
+	*nlanes = shm->nlanes;
+
+	return shm;
+}
+
+/*
+ * rpmem_shm_fini -- deinitialize shared memory transport
+ */
+void
+rpmem_shm_fini(struct rpmem_shm *shm)
+{
+	Free(shm);
+}
+
+/*
+ * rpmem_shm_map -- (internal) map the pool file and the control region
+ * passed by rpmemd
+ */
+static int
+rpmem_shm_map(struct rpmem_shm *shm, const struct rpmem_shm_conn_msg *msg,
+	const int *fds)
+{
+	if (msg->pool_size < shm->size) {
+		RPMEM_LOG(ERR, "pool of rpmemd too small -- %zu",
+				(size_t)msg->pool_size);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (msg->ctrl_size < rpmem_shm_ctrl_size(shm->nlanes)) {
+		RPMEM_LOG(ERR, "invalid control region size -- %zu",
+				(size_t)msg->ctrl_size);
+		errno = EPROTO;
+		return -1;
+	}
+
+	/* the mapping must start at a page boundary */
+	size_t delta = (size_t)msg->pool_off & (Pagesize - 1);
+	shm->pool_map_size = shm->size + delta;
+	shm->pool_map = mmap(NULL, shm->pool_map_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fds[0],
+			(off_t)(msg->pool_off - delta));
+	if (shm->pool_map == MAP_FAILED) {
+		RPMEM_LOG(ERR, "!mapping pool");
+		return -1;
+	}
+
+	shm->pool = (char *)shm->pool_map + delta;
+
+	shm->ctrl_size = (size_t)msg->ctrl_size;
+	shm->ctrl = mmap(NULL, shm->ctrl_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fds[1], 0);
+	if (shm->ctrl == MAP_FAILED) {
+		RPMEM_LOG(ERR, "!mapping control region");
+		goto err_map_ctrl;
+	}
+
+	if (shm->ctrl->magic != RPMEM_SHM_MAGIC ||
+		shm->ctrl->nlanes < shm->nlanes) {
+		RPMEM_LOG(ERR, "invalid control region");
+		errno = EPROTO;
+		goto err_ctrl;
+	}
+
+	return 0;
+err_ctrl:
+	munmap(shm->ctrl, shm->ctrl_size);
+err_map_ctrl:
+	munmap(shm->pool_map, shm->pool_map_size);
+	return -1;
+}
+
+/*
+ * rpmem_shm_connect -- connect to rpmemd and map its pool
+ */
+int
+rpmem_shm_connect(struct rpmem_shm *shm)
+{
+	struct sockaddr_un addr;
+	socklen_t addrlen;
+	if (rpmem_shm_sockaddr(&addr, shm->port, &addrlen))
+		return -1;
+
+	shm->sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (shm->sockfd < 0) {
+		RPMEM_LOG(ERR, "!socket");
+		return -1;
+	}
+
+	if (connect(shm->sockfd, (struct sockaddr *)&addr, addrlen)) {
+		RPMEM_LOG(ERR, "!connecting to shared memory channel %u",
+				shm->port);
+		goto err_connect;
+	}
+
+	struct rpmem_shm_conn_msg msg;
+	int fds[RPMEM_SHM_CONN_NFDS];
+	if (rpmem_shm_recv_fds(shm->sockfd, &msg, sizeof(msg),
+			fds, RPMEM_SHM_CONN_NFDS))
+		goto err_recv;
+
+	int ret = rpmem_shm_map(shm, &msg, fds);
+
+	/* the mappings are enough */
+	for (unsigned i = 0; i < RPMEM_SHM_CONN_NFDS; i++)
+		(void) close(fds[i]);
+
+	if (ret)
+		goto err_map;
+
+	return 0;
+err_map:
+err_recv:
+err_connect:
+	(void) close(shm->sockfd);
+	shm->sockfd = -1;
+	return -1;
+}
+
+/*
+ * rpmem_shm_close -- unmap the pool of rpmemd and close the connection
+ */
+int
+rpmem_shm_close(struct rpmem_shm *shm)
+{
+	if (shm->sockfd < 0)
+		return 0;
+
+	munmap(shm->ctrl, shm->ctrl_size);
+	munmap(shm->pool_map, shm->pool_map_size);
+
+	int ret = close(shm->sockfd);
+	if (ret)
+		RPMEM_LOG(ERR, "!close");
+	shm->sockfd = -1;
+
+	return ret;
+}
+
+/*
+ * rpmem_shm_check_range -- (internal) check the range fits in the pool
+ */
+static inline int
+rpmem_shm_check_range(struct rpmem_shm *shm, size_t offset, size_t len)
+{
+	if (offset > shm->size || len > shm->size - offset) {
+		RPMEM_LOG(ERR, "range out of pool -- offset %zu length %zu",
+				offset, len);
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmem_shm_persist -- copy the data to the pool of rpmemd and wait until
+ * rpmemd persists them
+ *
+ * Every lane must be used by a single thread at a time.
+ */
+int
+rpmem_shm_persist(struct rpmem_shm *shm, size_t offset, size_t len,
+	unsigned lane)
+{
+	RPMEM_ASSERT(lane < shm->nlanes);
+
+	if (rpmem_shm_check_range(shm, offset, len))
+		return -1;
+
+	struct rpmem_shm_ring *ring = &shm->ctrl->rings[lane];
+
+	memcpy(shm->pool + offset, (char *)shm->laddr + offset, len);
+
+	struct rpmem_shm_msg msg = {
+		.offset = offset,
+		.len = len,
+	};
+
+	uint64_t seq;
+	if (rpmem_shm_wait(shm, rpmem_shm_ring_push(ring, &msg, &seq)))
+		return -1;
+
+	return rpmem_shm_wait(shm, ring->head < seq);
+}
+
+/*
+ * rpmem_shm_read -- read the data from the pool of rpmemd
+ */
+int
+rpmem_shm_read(struct rpmem_shm *shm, void *buff, size_t len, size_t off)
+{
+	if (rpmem_shm_check_range(shm, off, len))
+		return -1;
+
+	memcpy(buff, shm->pool + off, len);
+
+	return 0;
+}
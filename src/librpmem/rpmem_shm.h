@@ -0,0 +1,59 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_shm.h -- rpmem shared memory transport module header file
+ *
+ * The transport is an alternative to the fabric when rpmemd runs on the
+ * same host, see rpmem_shm_common.h.
+ */
+
+#include <stddef.h>
+
+struct rpmem_shm;
+
+struct rpmem_shm_attr {
+	void *laddr;
+	size_t size;
+	unsigned nlanes;
+};
+
+struct rpmem_shm *rpmem_shm_init(const char *service,
+		struct rpmem_shm_attr *attr, unsigned *nlanes);
+void rpmem_shm_fini(struct rpmem_shm *shm);
+
+int rpmem_shm_connect(struct rpmem_shm *shm);
+int rpmem_shm_close(struct rpmem_shm *shm);
+
+int rpmem_shm_persist(struct rpmem_shm *shm, size_t offset, size_t len,
+		unsigned lane);
+int rpmem_shm_read(struct rpmem_shm *shm, void *buff, size_t len, size_t off);
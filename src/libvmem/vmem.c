@@ -35,6 +35,7 @@
  */
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
@@ -137,14 +138,125 @@ vmem_fini(void)
 	out_fini();
 }
 
+/*
+ * vmem_attr_init -- fill in the default pool attributes
+ */
+void
+vmem_attr_init(struct vmem_attr *attr)
+{
+	vmem_init();
+	LOG(3, "attr %p", attr);
+
+	memset(attr, 0, sizeof(*attr));
+
+	/* the defaults follow the allocator-wide options */
+	bool tcache = true;
+	size_t len = sizeof(tcache);
+	if (je_vmem_mallctl("opt.tcache", &tcache, &len, NULL, 0) != 0)
+		tcache = true;
+	attr->tcache = tcache;
+
+	len = sizeof(attr->lg_dirty_mult);
+	if (je_vmem_mallctl("opt.lg_dirty_mult", &attr->lg_dirty_mult, &len,
+			NULL, 0) != 0)
+		attr->lg_dirty_mult = VMEM_LG_DIRTY_MULT_DEFAULT;
+}
+
+/*
+ * vmem_pool_tune -- (internal) apply the attributes to a new pool
+ */
+static int
+vmem_pool_tune(pool_t *pool, const struct vmem_attr *attr)
+{
+	int ret;
+
+	ret = je_vmem_pool_mallctl(pool, "arenas.lg_dirty_mult", NULL, NULL,
+			(void *)&attr->lg_dirty_mult,
+			sizeof(attr->lg_dirty_mult));
+	if (ret != 0) {
+		ERR("invalid lg_dirty_mult %zd", attr->lg_dirty_mult);
+		goto err;
+	}
+
+	if (attr->numa) {
+		bool numa = true;
+		ret = je_vmem_pool_mallctl(pool, "arenas.numa", NULL, NULL,
+				&numa, sizeof(numa));
+		if (ret != 0) {
+			ERR("cannot bind arenas to NUMA nodes");
+			goto err;
+		}
+	}
+
+	/* thread caches may be compiled out, nothing to tune then */
+	if (!attr->tcache) {
+		bool tcache = false;
+		ret = je_vmem_pool_mallctl(pool, "tcache.enabled", NULL, NULL,
+				&tcache, sizeof(tcache));
+		if (ret != 0 && ret != ENOENT) {
+			ERR("cannot disable thread caches");
+			goto err;
+		}
+	} else if (attr->tcache_max != 0) {
+		size_t tcache_max = attr->tcache_max;
+		ret = je_vmem_pool_mallctl(pool, "tcache.max", NULL, NULL,
+				&tcache_max, sizeof(tcache_max));
+		if (ret != 0 && ret != ENOENT) {
+			ERR("invalid tcache_max %zu", attr->tcache_max);
+			goto err;
+		}
+	}
+
+	return 0;
+
+err:
+	errno = ret;
+	return -1;
+}
+
+/*
+ * vmem_pool_create -- (internal) prepare the pool for jemalloc
+ */
+static pool_t *
+vmem_pool_create(struct vmem *vmp, int zeroed, const struct vmem_attr *attr)
+{
+	pool_t *pool = je_vmem_pool_create_narenas(
+			(void *)((uintptr_t)vmp->addr + Header_size),
+			vmp->size - Header_size, zeroed,
+			attr ? attr->narenas : 0);
+	if (pool == NULL) {
+		ERR("pool creation failed");
+		return NULL;
+	}
+
+	if (attr != NULL && vmem_pool_tune(pool, attr)) {
+		int oerrno = errno;
+		je_vmem_pool_delete(pool);
+		errno = oerrno;
+		return NULL;
+	}
+
+	return pool;
+}
+
 /*
  * vmem_create -- create a memory pool in a temp file
  */
 VMEM *
 vmem_create(const char *dir, size_t size)
+{
+	return vmem_create_with_attr(dir, size, NULL);
+}
+
+/*
+ * vmem_create_with_attr -- create a tuned memory pool in a temp file
+ */
+VMEM *
+vmem_create_with_attr(const char *dir, size_t size,
+		const struct vmem_attr *attr)
 {
 	vmem_init();
-	LOG(3, "dir \"%s\" size %zu", dir, size);
+	LOG(3, "dir \"%s\" size %zu attr %p", dir, size, attr);
 
 	if (size < VMEM_MIN_POOL) {
 		ERR("size %zu smaller than %zu", size, VMEM_MIN_POOL);
@@ -168,10 +280,10 @@ vmem_create(const char *dir, size_t size)
 	vmp->caller_mapped = 0;
 
 	/* Prepare pool for jemalloc */
-	if (je_vmem_pool_create((void *)((uintptr_t)addr + Header_size),
-			size - Header_size, 1) == NULL) {
-		ERR("pool creation failed");
+	if (vmem_pool_create(vmp, 1, attr) == NULL) {
+		int oerrno = errno;
 		util_unmap(vmp->addr, vmp->size);
+		errno = oerrno;
 		return NULL;
 	}
 
@@ -192,9 +304,20 @@ vmem_create(const char *dir, size_t size)
  */
 VMEM *
 vmem_create_in_region(void *addr, size_t size)
+{
+	return vmem_create_in_region_with_attr(addr, size, NULL);
+}
+
+/*
+ * vmem_create_in_region_with_attr -- create a tuned memory pool in a given
+ *	range
+ */
+VMEM *
+vmem_create_in_region_with_attr(void *addr, size_t size,
+		const struct vmem_attr *attr)
 {
 	vmem_init();
-	LOG(3, "addr %p size %zu", addr, size);
+	LOG(3, "addr %p size %zu attr %p", addr, size, attr);
 
 	if (((uintptr_t)addr & (Pagesize - 1)) != 0) {
 		ERR("addr %p not aligned to pagesize %llu", addr, Pagesize);
@@ -217,11 +340,8 @@ vmem_create_in_region(void *addr, size_t size)
 	vmp->caller_mapped = 1;
 
 	/* Prepare pool for jemalloc */
-	if (je_vmem_pool_create((void *)((uintptr_t)addr + Header_size),
-				size - Header_size, 0) == NULL) {
-		ERR("pool creation failed");
+	if (vmem_pool_create(vmp, 0, attr) == NULL)
 		return NULL;
-	}
 
 	/*
 	 * If possible, turn off all permissions on the pool header page.
@@ -281,6 +401,233 @@ vmem_stats_print(VMEM *vmp, const char *opts)
 			print_jemalloc_stats, NULL, opts);
 }
 
+/*
+ * vmem_ctl -- query or change the allocator settings of a pool
+ *
+ * The names are those of the "pool.<i>." subtree of jemalloc's mallctl
+ * namespace, see libvmem(3) for the supported ones.
+ */
+int
+vmem_ctl(VMEM *vmp, const char *name, void *oldp, size_t *oldlenp,
+		void *newp, size_t newlen)
+{
+	LOG(3, "vmp %p name \"%s\"", vmp, name);
+
+	int ret = je_vmem_pool_mallctl(
+			(pool_t *)((uintptr_t)vmp + Header_size),
+			name, oldp, oldlenp, newp, newlen);
+	if (ret != 0) {
+		errno = ret;
+		ERR("!vmem_ctl \"%s\"", name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * vmem_stat -- (internal) read a single statistic of a pool
+ *
+ * The name is built from fmt like in printf(3) and must name a value of
+ * exactly len bytes.
+ */
+static int
+vmem_stat(VMEM *vmp, void *oldp, size_t len, const char *fmt, ...)
+{
+	char name[VMEM_STAT_NAME_MAX];
+	va_list ap;
+
+	va_start(ap, fmt);
+	int n = vsnprintf(name, sizeof(name), fmt, ap);
+	va_end(ap);
+	if (n < 0 || (size_t)n >= sizeof(name)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	size_t oldlen = len;
+	int ret = je_vmem_pool_mallctl(
+			(pool_t *)((uintptr_t)vmp + Header_size),
+			name, oldp, &oldlen, NULL, 0);
+	if (ret != 0) {
+		errno = ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * vmem_stats_refresh -- take a new snapshot of the statistics of a pool
+ *
+ * Only this pool is walked, so this is cheap enough to be done
+ * periodically.
+ */
+int
+vmem_stats_refresh(VMEM *vmp)
+{
+	LOG(3, "vmp %p", vmp);
+
+	uint64_t epoch = 1;
+	size_t len = sizeof(epoch);
+	int ret = je_vmem_pool_mallctl(
+			(pool_t *)((uintptr_t)vmp + Header_size),
+			"epoch", &epoch, &len, &epoch, sizeof(epoch));
+	if (ret != 0) {
+		errno = ret;
+		ERR("!vmem_stats_refresh");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * vmem_stats_get -- return the pool wide statistics
+ */
+int
+vmem_stats_get(VMEM *vmp, struct vmem_stats *stats)
+{
+	LOG(3, "vmp %p stats %p", vmp, stats);
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (vmem_stat(vmp, &stats->allocated, sizeof(stats->allocated),
+			"stats.allocated") ||
+	    vmem_stat(vmp, &stats->active, sizeof(stats->active),
+			"stats.active") ||
+	    vmem_stat(vmp, &stats->mapped, sizeof(stats->mapped),
+			"stats.mapped") ||
+	    vmem_stat(vmp, &stats->resident, sizeof(stats->resident),
+			"stats.resident") ||
+	    vmem_stat(vmp, &stats->narenas, sizeof(stats->narenas),
+			"arenas.narenas") ||
+	    vmem_stat(vmp, &stats->nclasses, sizeof(stats->nclasses),
+			"arenas.nbins"))
+		goto err;
+
+	/* the merged statistics of all arenas are at index narenas */
+	if (vmem_stat(vmp, &stats->ncontended, sizeof(stats->ncontended),
+			"stats.arenas.%u.ncontended", stats->narenas))
+		goto err;
+
+	for (unsigned i = 0; i < stats->nclasses; ++i) {
+		uint64_t ncontended;
+		if (vmem_stat(vmp, &ncontended, sizeof(ncontended),
+				"stats.arenas.%u.bins.%u.ncontended",
+				stats->narenas, i))
+			goto err;
+		stats->ncontended += ncontended;
+	}
+
+	return 0;
+
+err:
+	ERR("!vmem_stats_get");
+	return -1;
+}
+
+/*
+ * vmem_stats_class_get -- return the statistics of a small size class,
+ * merged over all arenas
+ */
+int
+vmem_stats_class_get(VMEM *vmp, unsigned idx, struct vmem_stats_class *stats)
+{
+	LOG(3, "vmp %p idx %u stats %p", vmp, idx, stats);
+
+	unsigned narenas;
+	unsigned nclasses;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (vmem_stat(vmp, &narenas, sizeof(narenas), "arenas.narenas") ||
+	    vmem_stat(vmp, &nclasses, sizeof(nclasses), "arenas.nbins"))
+		goto err;
+
+	if (idx >= nclasses) {
+		ERR("invalid size class %u", idx);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vmem_stat(vmp, &stats->size, sizeof(stats->size),
+			"arenas.bin.%u.size", idx) ||
+	    vmem_stat(vmp, &stats->allocated, sizeof(stats->allocated),
+			"stats.arenas.%u.bins.%u.allocated", narenas, idx) ||
+	    vmem_stat(vmp, &stats->nmalloc, sizeof(stats->nmalloc),
+			"stats.arenas.%u.bins.%u.nmalloc", narenas, idx) ||
+	    vmem_stat(vmp, &stats->ndalloc, sizeof(stats->ndalloc),
+			"stats.arenas.%u.bins.%u.ndalloc", narenas, idx) ||
+	    vmem_stat(vmp, &stats->nrequests, sizeof(stats->nrequests),
+			"stats.arenas.%u.bins.%u.nrequests", narenas, idx) ||
+	    vmem_stat(vmp, &stats->ncontended, sizeof(stats->ncontended),
+			"stats.arenas.%u.bins.%u.ncontended", narenas, idx))
+		goto err;
+
+	return 0;
+
+err:
+	ERR("!vmem_stats_class_get");
+	return -1;
+}
+
+/*
+ * vmem_stats_arena_get -- return the statistics of a single arena
+ *
+ * Arenas no thread has used yet are not initialized and report zeroes.
+ */
+int
+vmem_stats_arena_get(VMEM *vmp, unsigned idx, struct vmem_stats_arena *stats)
+{
+	LOG(3, "vmp %p idx %u stats %p", vmp, idx, stats);
+
+	unsigned narenas;
+	size_t page;
+	size_t pactive;
+	size_t pdirty;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (vmem_stat(vmp, &narenas, sizeof(narenas), "arenas.narenas") ||
+	    vmem_stat(vmp, &page, sizeof(page), "arenas.page"))
+		goto err;
+
+	if (idx >= narenas) {
+		ERR("invalid arena %u", idx);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vmem_stat(vmp, &stats->nthreads, sizeof(stats->nthreads),
+			"stats.arenas.%u.nthreads", idx)) {
+		if (errno == ENOENT)
+			return 0;
+		goto err;
+	}
+
+	if (vmem_stat(vmp, &pactive, sizeof(pactive),
+			"stats.arenas.%u.pactive", idx) ||
+	    vmem_stat(vmp, &pdirty, sizeof(pdirty),
+			"stats.arenas.%u.pdirty", idx) ||
+	    vmem_stat(vmp, &stats->mapped, sizeof(stats->mapped),
+			"stats.arenas.%u.mapped", idx) ||
+	    vmem_stat(vmp, &stats->npurge, sizeof(stats->npurge),
+			"stats.arenas.%u.npurge", idx) ||
+	    vmem_stat(vmp, &stats->ncontended, sizeof(stats->ncontended),
+			"stats.arenas.%u.ncontended", idx))
+		goto err;
+
+	stats->active = pactive * page;
+	stats->dirty = pdirty * page;
+
+	return 0;
+
+err:
+	ERR("!vmem_stats_arena_get");
+	return -1;
+}
+
 /*
  * vmem_malloc -- allocate memory
  */
@@ -38,6 +38,12 @@
 #define VMEM_LOG_LEVEL_VAR "VMEM_LOG_LEVEL"
 #define VMEM_LOG_FILE_VAR "VMEM_LOG_FILE"
 
+/* jemalloc's purge threshold unless overridden by its options */
+#define VMEM_LG_DIRTY_MULT_DEFAULT 3
+
+/* longest mallctl name built by the statistics functions */
+#define VMEM_STAT_NAME_MAX 64
+
 /* attributes of the vmem memory pool format for the pool header */
 #define VMEM_HDR_SIG "VMEM   "	/* must be 8 bytes including '\0' */
 #define VMEM_FORMAT_MAJOR 1
@@ -146,6 +146,7 @@ rpmem_obc_keepalive(int fd)
 static const char *provider2str[MAX_RPMEM_PROV] = {
 	[RPMEM_PROV_LIBFABRIC_VERBS] = "verbs",
 	[RPMEM_PROV_LIBFABRIC_SOCKETS] = "sockets",
+	[RPMEM_PROV_LOCAL] = "local",
 };
 
 /*
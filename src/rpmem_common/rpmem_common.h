@@ -48,6 +48,11 @@
  */
 #define RPMEM_TCP_KEEPINTVL	1
 
+/*
+ * The maximum number of connections a single pool can be striped across.
+ */
+#define RPMEM_MAX_NCONNS	16
+
 #include <sys/socket.h>
 
 /*
@@ -88,6 +93,7 @@ enum rpmem_provider {
 	RPMEM_PROV_UNKNOWN = 0,
 	RPMEM_PROV_LIBFABRIC_VERBS	= 1,
 	RPMEM_PROV_LIBFABRIC_SOCKETS	= 2,
+	RPMEM_PROV_LOCAL		= 3,	/* shared memory, same host */
 
 	MAX_RPMEM_PROV,
 };
@@ -103,6 +109,7 @@ struct rpmem_req_attr {
 	unsigned nlanes;
 	enum rpmem_provider provider;
 	const char *pool_desc;
+	unsigned nconns;	/* number of connections, 0 means 1 */
 };
 
 /*
@@ -114,6 +121,7 @@ struct rpmem_resp_attr {
 	uint64_t raddr;
 	unsigned nlanes;
 	enum rpmem_persist_method persist_method;
+	unsigned nconns;	/* number of connections granted */
 };
 
 int rpmem_obc_send(int sockfd, const void *buf, size_t len);
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_hist.h -- rpmem latency histogram definition
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+/* number of histogram buckets, the last one covers more than ~9 minutes */
+#define RPMEM_HIST_NBUCKETS 40
+
+/*
+ * rpmem_hist -- histogram of latencies in nanoseconds
+ *
+ * The n-th bucket counts the latencies in range [2^n, 2^(n+1)) ns, the first
+ * one counts also zero and the last one all the latencies above its range.
+ * The histogram is not thread-safe, every thread is supposed to update its
+ * own one and the histograms are merged when the statistics are collected.
+ */
+struct rpmem_hist {
+	uint64_t count;		/* number of samples */
+	uint64_t sum;		/* sum of the samples */
+	uint64_t max;		/* maximum sample */
+	uint64_t buckets[RPMEM_HIST_NBUCKETS];
+};
+
+/*
+ * rpmem_hist_now -- return monotonic time in nanoseconds
+ */
+static inline uint64_t
+rpmem_hist_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * rpmem_hist_add -- add a sample to the histogram
+ */
+static inline void
+rpmem_hist_add(struct rpmem_hist *hist, uint64_t ns)
+{
+	unsigned b = ns ? 63 - (unsigned)__builtin_clzll(ns) : 0;
+	if (b >= RPMEM_HIST_NBUCKETS)
+		b = RPMEM_HIST_NBUCKETS - 1;
+
+	hist->buckets[b]++;
+	hist->count++;
+	hist->sum += ns;
+	if (ns > hist->max)
+		hist->max = ns;
+}
+
+/*
+ * rpmem_hist_merge -- add all the samples of src histogram to dst histogram
+ */
+static inline void
+rpmem_hist_merge(struct rpmem_hist *dst, const struct rpmem_hist *src)
+{
+	for (unsigned b = 0; b < RPMEM_HIST_NBUCKETS; b++)
+		dst->buckets[b] += src->buckets[b];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/*
+ * rpmem_hist_quantile -- return upper bound of the bucket the num/den
+ * quantile of samples falls into, e.g. 999/1000 for the 99.9th percentile
+ */
+static inline uint64_t
+rpmem_hist_quantile(const struct rpmem_hist *hist, unsigned num, unsigned den)
+{
+	if (!hist->count)
+		return 0;
+
+	uint64_t rank = (hist->count * num + den - 1) / den;
+	uint64_t n = 0;
+	for (unsigned b = 0; b < RPMEM_HIST_NBUCKETS - 1; b++) {
+		n += hist->buckets[b];
+		if (n >= rank) {
+			uint64_t bound = ((uint64_t)2 << b) - 1;
+			return bound < hist->max ? bound : hist->max;
+		}
+	}
+
+	return hist->max;
+}
+
+/*
+ * rpmem_hist_mean -- return mean of the samples
+ */
+static inline uint64_t
+rpmem_hist_mean(const struct rpmem_hist *hist)
+{
+	return hist->count ? hist->sum / hist->count : 0;
+}
@@ -34,6 +34,7 @@
  * rpmem_proto.h -- rpmem protocol definitions
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <endian.h>
 
@@ -48,7 +49,7 @@
 #define RPMEM_SERVICE		_STR(RPMEM_PORT)
 #define RPMEM_PROTO		"tcp"
 #define RPMEM_PROTO_MAJOR	0
-#define RPMEM_PROTO_MINOR	1
+#define RPMEM_PROTO_MINOR	3
 #define RPMEM_SIG_SIZE		8
 #define RPMEM_UUID_SIZE		16
 #define RPMEM_PROV_SIZE		32
@@ -66,6 +67,8 @@ enum rpmem_msg_type {
 	RPMEM_MSG_TYPE_CLOSE_RESP	= 6, /* close request response */
 	RPMEM_MSG_TYPE_REMOVE		= 7, /* remove request */
 	RPMEM_MSG_TYPE_REMOVE_RESP	= 8, /* remove request response */
+	RPMEM_MSG_TYPE_CHECKSUM		= 9, /* checksum request */
+	RPMEM_MSG_TYPE_CHECKSUM_RESP	= 10, /* checksum request response */
 
 	MAX_RPMEM_MSG_TYPE,
 };
@@ -83,6 +86,7 @@ struct rpmem_msg_ibc_attr {
 	uint64_t rkey;			/* remote key */
 	uint64_t raddr;			/* remote address */
 	uint32_t nlanes;		/* number of lanes */
+	uint32_t nconns;		/* number of connections */
 } PACKED;
 
 /*
@@ -130,6 +134,7 @@ struct rpmem_msg_create {
 	uint64_t pool_size;		/* minimum required size of a pool */
 	uint32_t nlanes;		/* number of lanes used by initiator */
 	uint32_t provider;		/* provider */
+	uint32_t nconns;		/* number of connections requested */
 	struct rpmem_pool_attr pool_attr;	/* pool attributes */
 	struct rpmem_msg_pool_desc pool_desc;	/* pool descriptor */
 } PACKED;
@@ -159,6 +164,7 @@ struct rpmem_msg_open {
 	uint64_t pool_size;		/* minimum required size of a pool */
 	uint32_t nlanes;		/* number of lanes used by initiator */
 	uint32_t provider;		/* provider */
+	uint32_t nconns;		/* number of connections requested */
 	struct rpmem_msg_pool_desc pool_desc;	/* pool descriptor */
 } PACKED;
 
@@ -221,15 +227,67 @@ struct rpmem_msg_remove_resp {
 	/* no more fields */
 } PACKED;
 
+/* maximum number of blocks in a single checksum request */
+#define RPMEM_CHECKSUM_MAX_BLOCKS (1 << 24)
+
 /*
- * rpmem_msg_persist -- remote persist message
+ * rpmem_msg_checksum -- checksum request message
+ *
+ * Requests util_checksum() values of consecutive blocks of the opened pool,
+ * the last block may be shorter.  The offset, length and block size must be
+ * multiples of 4.
+ *
+ * The type of message must be set to RPMEM_MSG_TYPE_CHECKSUM.
+ * The size of message must be set to sizeof(struct rpmem_msg_checksum)
  */
-struct rpmem_msg_persist {
-	uint64_t lane;	/* lane identifier */
+struct rpmem_msg_checksum {
+	struct rpmem_msg_hdr hdr;	/* message header */
+	uint64_t offset;		/* offset of the range in the pool */
+	uint64_t len;			/* length of the range */
+	uint64_t blk_size;		/* size of a checksummed block */
+} PACKED;
+
+/*
+ * rpmem_msg_checksum_resp -- checksum request response message
+ *
+ * The type of message must be set to RPMEM_MSG_TYPE_CHECKSUM_RESP
+ * The size of message must be set to
+ *     sizeof(struct rpmem_msg_checksum_resp) + nsums * sizeof(uint64_t)
+ * The checksums are not sent if the status is not zero.
+ */
+struct rpmem_msg_checksum_resp {
+	struct rpmem_msg_hdr_resp hdr;	/* message header */
+	uint64_t nsums;			/* number of checksums */
+	uint64_t sums[0];		/* checksums of the blocks */
+} PACKED;
+
+/*
+ * rpmem_msg_persist_range -- range of remote memory to persist
+ */
+struct rpmem_msg_persist_range {
 	uint64_t addr;	/* remote memory address */
 	uint64_t size;	/* remote memory size */
 };
 
+/* maximum number of ranges in a single persist message */
+#define RPMEM_PERSIST_MAX_RANGES 16
+
+/*
+ * rpmem_msg_persist -- remote persist message
+ *
+ * Only the first nranges ranges are sent, so the size of the message
+ * on the wire is RPMEM_MSG_PERSIST_SIZE(nranges).
+ */
+struct rpmem_msg_persist {
+	uint64_t lane;		/* lane identifier */
+	uint64_t nranges;	/* number of ranges to persist */
+	struct rpmem_msg_persist_range ranges[RPMEM_PERSIST_MAX_RANGES];
+};
+
+#define RPMEM_MSG_PERSIST_SIZE(n)\
+	(offsetof(struct rpmem_msg_persist, ranges) +\
+	(n) * sizeof(struct rpmem_msg_persist_range))
+
 /*
  * rpmem_msg_persist_resp -- remote persist response message
  */
@@ -247,6 +305,8 @@ rpmem_ntoh_msg_ibc_attr(struct rpmem_msg_ibc_attr *ibc)
 	ibc->persist_method = be32toh(ibc->persist_method);
 	ibc->rkey = be64toh(ibc->rkey);
 	ibc->raddr = be64toh(ibc->raddr);
+	ibc->nlanes = be32toh(ibc->nlanes);
+	ibc->nconns = be32toh(ibc->nconns);
 }
 
 /*
@@ -321,6 +381,7 @@ rpmem_ntoh_msg_create(struct rpmem_msg_create *msg)
 	msg->pool_size = be64toh(msg->pool_size);
 	msg->nlanes = be32toh(msg->nlanes);
 	msg->provider = be32toh(msg->provider);
+	msg->nconns = be32toh(msg->nconns);
 	rpmem_ntoh_pool_attr(&msg->pool_attr);
 	rpmem_ntoh_msg_pool_desc(&msg->pool_desc);
 }
@@ -367,6 +428,7 @@ rpmem_ntoh_msg_open(struct rpmem_msg_open *msg)
 	msg->pool_size = be64toh(msg->pool_size);
 	msg->nlanes = be32toh(msg->nlanes);
 	msg->provider = be32toh(msg->provider);
+	msg->nconns = be32toh(msg->nconns);
 	rpmem_ntoh_msg_pool_desc(&msg->pool_desc);
 }
 
@@ -476,3 +538,45 @@ rpmem_hton_msg_close_resp(struct rpmem_msg_close_resp *msg)
 {
 	rpmem_ntoh_msg_close_resp(msg);
 }
+
+/*
+ * rpmem_ntoh_msg_checksum -- convert rpmem_msg_checksum to host byte order
+ */
+static inline void
+rpmem_ntoh_msg_checksum(struct rpmem_msg_checksum *msg)
+{
+	rpmem_ntoh_msg_hdr(&msg->hdr);
+	msg->offset = be64toh(msg->offset);
+	msg->len = be64toh(msg->len);
+	msg->blk_size = be64toh(msg->blk_size);
+}
+
+/*
+ * rpmem_hton_msg_checksum -- convert rpmem_msg_checksum to network byte order
+ */
+static inline void
+rpmem_hton_msg_checksum(struct rpmem_msg_checksum *msg)
+{
+	rpmem_ntoh_msg_checksum(msg);
+}
+
+/*
+ * rpmem_ntoh_msg_checksum_resp -- convert rpmem_msg_checksum_resp to host
+ * byte order, the checksums are converted separately
+ */
+static inline void
+rpmem_ntoh_msg_checksum_resp(struct rpmem_msg_checksum_resp *msg)
+{
+	rpmem_ntoh_msg_hdr_resp(&msg->hdr);
+	msg->nsums = be64toh(msg->nsums);
+}
+
+/*
+ * rpmem_hton_msg_checksum_resp -- convert rpmem_msg_checksum_resp to network
+ * byte order, the checksums are converted separately
+ */
+static inline void
+rpmem_hton_msg_checksum_resp(struct rpmem_msg_checksum_resp *msg)
+{
+	rpmem_ntoh_msg_checksum_resp(msg);
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_shm_common.c -- common functions of the shared memory transport
+ */
+
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "rpmem_common.h"
+#include "rpmem_shm_common.h"
+#include "rpmem_common_log.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+/*
+ * rpmem_shm_sockaddr -- fill the abstract unix domain socket address of
+ * the channel identified by the port
+ */
+int
+rpmem_shm_sockaddr(struct sockaddr_un *addr, unsigned port,
+	socklen_t *addrlen)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	/* the leading null byte selects the abstract namespace */
+	int ret = snprintf(&addr->sun_path[1], sizeof(addr->sun_path) - 1,
+			RPMEM_SHM_SOCK_FMT, port);
+	if (ret < 0) {
+		RPMEMC_LOG(ERR, "!snprintf");
+		return -1;
+	}
+
+	*addrlen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) +
+			1 + (size_t)ret);
+
+	return 0;
+}
+
+/*
+ * rpmem_shm_send_fds -- send a message along with file descriptors
+ */
+int
+rpmem_shm_send_fds(int sockfd, const void *buf, size_t len,
+	const int *fds, unsigned nfds)
+{
+	char cbuf[CMSG_SPACE(RPMEM_SHM_CONN_NFDS * sizeof(int))];
+	RPMEMC_ASSERT(nfds <= RPMEM_SHM_CONN_NFDS);
+
+	struct iovec iov = {
+		.iov_base = (void *)buf,
+		.iov_len = len,
+	};
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	memset(cbuf, 0, sizeof(cbuf));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+
+	ssize_t ret = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+	if (ret < 0) {
+		RPMEMC_LOG(ERR, "!sendmsg");
+		return -1;
+	}
+
+	if ((size_t)ret != len) {
+		RPMEMC_LOG(ERR, "short write of connection message");
+		errno = EPROTO;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmem_shm_recv_fds -- receive a message along with file descriptors
+ */
+int
+rpmem_shm_recv_fds(int sockfd, void *buf, size_t len,
+	int *fds, unsigned nfds)
+{
+	char cbuf[CMSG_SPACE(RPMEM_SHM_CONN_NFDS * sizeof(int))];
+	RPMEMC_ASSERT(nfds <= RPMEM_SHM_CONN_NFDS);
+
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = len,
+	};
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+
+	ssize_t ret = recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+	if (ret < 0) {
+		RPMEMC_LOG(ERR, "!recvmsg");
+		return -1;
+	}
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if ((size_t)ret != len || !cmsg ||
+		cmsg->cmsg_level != SOL_SOCKET ||
+		cmsg->cmsg_type != SCM_RIGHTS ||
+		cmsg->cmsg_len != CMSG_LEN(nfds * sizeof(int))) {
+		RPMEMC_LOG(ERR, "invalid connection message");
+		/* do not leak the descriptors received anyway */
+		if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+			int *rfds = (int *)CMSG_DATA(cmsg);
+			size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) /
+					sizeof(int);
+			for (size_t i = 0; i < n; i++)
+				(void) close(rfds[i]);
+		}
+		errno = EPROTO;
+		return -1;
+	}
+
+	memcpy(fds, CMSG_DATA(cmsg), nfds * sizeof(int));
+
+	return 0;
+}
+
+/*
+ * rpmem_shm_memfd -- create an anonymous file for the control region
+ */
+int
+rpmem_shm_memfd(const char *name)
+{
+	int fd = (int)syscall(SYS_memfd_create, name, MFD_CLOEXEC);
+	if (fd < 0)
+		RPMEMC_LOG(ERR, "!memfd_create");
+
+	return fd;
+}
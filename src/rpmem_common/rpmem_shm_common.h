@@ -0,0 +1,192 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_shm_common.h -- common definitions of the shared memory transport
+ *
+ * The shared memory transport is used instead of the fabric when the client
+ * and rpmemd run on the same host.  The client maps the pool file of rpmemd
+ * and a control region created by rpmemd, both passed over a unix domain
+ * socket.  The client copies the data to the pool directly and rpmemd
+ * persists them on request.  Persist requests are passed through a single
+ * producer single consumer ring per lane (see rpmemd_fip_ring.h for the
+ * in-process variant of the same design).  Messages are stored in the
+ * ring by value, since the ring is mapped at different addresses by both
+ * processes, and the head and tail are free running counters, so the head
+ * doubles as the number of requests processed in the lane.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define RPMEM_SHM_MAGIC		0x4d48534d454d5052ULL	/* "RPMEMSHM" */
+#define RPMEM_SHM_CACHELINE	64
+#define RPMEM_SHM_NSLOTS	64	/* number of slots in lane's ring */
+#define RPMEM_SHM_SPIN		1024	/* number of polls before yielding */
+
+/* abstract unix domain socket name, the port identifies the channel */
+#define RPMEM_SHM_SOCK_FMT	"rpmem-shm-%u"
+
+/*
+ * rpmem_shm_msg -- persist request
+ */
+struct rpmem_shm_msg {
+	uint64_t offset;	/* offset within the pool */
+	uint64_t len;		/* length of data to persist */
+};
+
+/*
+ * rpmem_shm_ring -- single producer single consumer ring of persist
+ * requests of a single lane
+ *
+ * The producer (client) and the consumer (rpmemd) parts are placed
+ * in separate cache lines.
+ */
+struct rpmem_shm_ring {
+	volatile uint64_t tail;	/* number of requests pushed */
+	char pad0[RPMEM_SHM_CACHELINE - sizeof(uint64_t)];
+	volatile uint64_t head;	/* number of requests processed */
+	char pad1[RPMEM_SHM_CACHELINE - sizeof(uint64_t)];
+	struct rpmem_shm_msg msgs[RPMEM_SHM_NSLOTS];
+};
+
+/*
+ * rpmem_shm_ctrl -- control region shared by the client and rpmemd
+ */
+struct rpmem_shm_ctrl {
+	uint64_t magic;		/* RPMEM_SHM_MAGIC */
+	uint64_t nlanes;	/* number of lanes */
+	volatile uint64_t closed; /* rpmemd does not process requests */
+	char pad[RPMEM_SHM_CACHELINE - 3 * sizeof(uint64_t)];
+	struct rpmem_shm_ring rings[];
+};
+
+/*
+ * rpmem_shm_conn_msg -- message sent by rpmemd with the file descriptors
+ * of the pool file and the control region
+ */
+struct rpmem_shm_conn_msg {
+	uint64_t pool_off;	/* offset of the pool within the file */
+	uint64_t pool_size;	/* size of the pool */
+	uint64_t ctrl_size;	/* size of the control region */
+};
+
+#define RPMEM_SHM_CONN_NFDS	2	/* pool file and control region */
+
+/*
+ * rpmem_shm_ctrl_size -- size of the control region with given number of
+ * lanes
+ */
+static inline size_t
+rpmem_shm_ctrl_size(unsigned nlanes)
+{
+	return sizeof(struct rpmem_shm_ctrl) +
+		nlanes * sizeof(struct rpmem_shm_ring);
+}
+
+/*
+ * rpmem_shm_ring_is_full -- returns true if ring is full
+ */
+static inline int
+rpmem_shm_ring_is_full(struct rpmem_shm_ring *ring)
+{
+	return ring->tail - ring->head == RPMEM_SHM_NSLOTS;
+}
+
+/*
+ * rpmem_shm_ring_is_empty -- returns true if ring is empty
+ */
+static inline int
+rpmem_shm_ring_is_empty(struct rpmem_shm_ring *ring)
+{
+	return ring->head == ring->tail;
+}
+
+/*
+ * rpmem_shm_ring_push -- push a request to the ring and return its
+ * sequence number, the request is processed when the head passes it
+ */
+static inline int
+rpmem_shm_ring_push(struct rpmem_shm_ring *ring,
+	const struct rpmem_shm_msg *msg, uint64_t *seq)
+{
+	if (rpmem_shm_ring_is_full(ring))
+		return -1;
+
+	uint64_t tail = ring->tail;
+	ring->msgs[tail % RPMEM_SHM_NSLOTS] = *msg;
+
+	/* the message must be visible before the tail moves */
+	__sync_synchronize();
+	ring->tail = tail + 1;
+	*seq = tail + 1;
+
+	return 0;
+}
+
+/*
+ * rpmem_shm_ring_peek -- return the nth oldest not processed request or
+ * NULL if there are not so many requests, the request stays in the ring
+ * until it is completed by rpmem_shm_ring_complete()
+ */
+static inline const struct rpmem_shm_msg *
+rpmem_shm_ring_peek(struct rpmem_shm_ring *ring, uint64_t nth)
+{
+	uint64_t head = ring->head + nth;
+	if (head == ring->tail)
+		return NULL;
+
+	/* read the message after the tail */
+	__sync_synchronize();
+	return &ring->msgs[head % RPMEM_SHM_NSLOTS];
+}
+
+/*
+ * rpmem_shm_ring_complete -- mark n oldest requests as processed
+ */
+static inline void
+rpmem_shm_ring_complete(struct rpmem_shm_ring *ring, uint64_t n)
+{
+	/* all the effects of processing must be visible first */
+	__sync_synchronize();
+	ring->head += n;
+}
+
+int rpmem_shm_sockaddr(struct sockaddr_un *addr, unsigned port,
+		socklen_t *addrlen);
+int rpmem_shm_send_fds(int sockfd, const void *buf, size_t len,
+		const int *fds, unsigned nfds);
+int rpmem_shm_recv_fds(int sockfd, void *buf, size_t len,
+		int *fds, unsigned nfds);
+int rpmem_shm_memfd(const char *name);
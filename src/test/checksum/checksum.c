@@ -34,6 +34,7 @@
  * checksum.c -- unit test for library internal checksum routine
  *
  * usage: checksum files...
+ *        checksum -l
  */
 
 #include <endian.h>
@@ -65,13 +66,63 @@ fletcher64(void *addr, size_t len)
 	return htole64((uint64_t)hi32 << 32 | lo32);
 }
 
+#define MAX_WORDS 1024
+
+/*
+ * check_lengths -- verify util_checksum() against the gold standard for
+ * all the lengths up to MAX_WORDS words, with the checksum at the beginning,
+ * in the middle, at the end and outside of the range
+ */
+static void
+check_lengths(void)
+{
+	static uint32_t buff[MAX_WORDS + 2];
+
+	srand(1);
+	for (size_t i = 0; i < MAX_WORDS + 2; i++)
+		buff[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+
+	for (size_t nwords = 2; nwords <= MAX_WORDS; nwords++) {
+		size_t len = nwords * sizeof(uint32_t);
+		size_t offs[] = { 0, (nwords - 1) / 2, nwords - 2, nwords };
+
+		for (size_t i = 0; i < sizeof(offs) / sizeof(offs[0]); i++) {
+			uint32_t *csump32 = buff + offs[i];
+			uint32_t save[2] = { csump32[0], csump32[1] };
+
+			uint64_t csum;
+			util_checksum(buff, len, &csum, 1);
+			if (offs[i] < nwords) {
+				util_checksum(buff, len, (uint64_t *)csump32,
+					1);
+				memcpy(&csum, csump32, sizeof(csum));
+				csump32[0] = 0;
+				csump32[1] = 0;
+			}
+
+			uint64_t gold_csum = fletcher64(buff, len);
+			UT_ASSERTeq(csum, gold_csum);
+
+			csump32[0] = save[0];
+			csump32[1] = save[1];
+		}
+	}
+
+	UT_OUT("checked lengths up to %d words", MAX_WORDS);
+}
+
 int
 main(int argc, char *argv[])
 {
 	START(argc, argv, "checksum");
 
 	if (argc < 2)
-		UT_FATAL("usage: %s files...", argv[0]);
+		UT_FATAL("usage: %s files... | -l", argv[0]);
+
+	if (strcmp(argv[1], "-l") == 0) {
+		check_lengths();
+		DONE(NULL);
+	}
 
 	for (int arg = 1; arg < argc; arg++) {
 		int fd = OPEN(argv[arg], O_RDONLY);
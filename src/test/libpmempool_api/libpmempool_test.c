@@ -57,7 +57,8 @@ struct pmempool_check_args_1_0 {
  * check_pool -- check given pool
  */
 static void
-check_pool(struct pmempool_check_args *args, size_t args_size)
+check_pool(struct pmempool_check_args *args, size_t args_size,
+	unsigned nthreads, const char *checkpoint)
 {
 	const char *status2str[] = {
 		[PMEMPOOL_CHECK_RESULT_CONSISTENT]	= "consistent",
@@ -73,6 +74,12 @@ check_pool(struct pmempool_check_args *args, size_t args_size)
 		return;
 	}
 
+	if (nthreads && pmempool_check_set_threads(ppc, nthreads))
+		UT_FATAL("!pmempool_check_set_threads");
+
+	if (checkpoint && pmempool_check_set_checkpoint(ppc, checkpoint))
+		UT_FATAL("!pmempool_check_set_checkpoint");
+
 	struct pmempool_check_status *status = NULL;
 	while ((status = pmempool_check(ppc)) != NULL) {
 		switch (status->type) {
@@ -104,7 +111,8 @@ print_usage(char *name)
 {
 	UT_OUT("Usage: %s [-t <pool_type>] [-r <repair>] [-d <dry_run>] "
 			"[-y <always_yes>] [-f <flags>] [-a <advanced>] "
-			"[-b <backup_path>] <pool_path>", name);
+			"[-b <backup_path>] [-j <nthreads>] "
+			"[-c <checkpoint_path>] <pool_path>", name);
 }
 
 /*
@@ -134,8 +142,10 @@ main(int argc, char *argv[])
 	};
 
 	size_t args_size = sizeof(struct pmempool_check_args_1_0);
+	unsigned nthreads = 0;
+	const char *checkpoint = NULL;
 
-	while ((opt = getopt(argc, argv, "t:r:d:a:y:s:b:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:r:d:a:y:s:b:j:c:")) != -1) {
 		switch (opt) {
 		case 't':
 			if (strcmp(optarg, "blk") == 0) {
@@ -170,6 +180,12 @@ main(int argc, char *argv[])
 		case 'b':
 			args.backup_path = optarg;
 			break;
+		case 'j':
+			nthreads = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			checkpoint = optarg;
+			break;
 		default:
 			print_usage(argv[0]);
 			UT_FATAL("unknown option: %c", opt);
@@ -180,7 +196,8 @@ main(int argc, char *argv[])
 		args.path = argv[optind];
 	}
 
-	check_pool((struct pmempool_check_args *)&args, args_size);
+	check_pool((struct pmempool_check_args *)&args, args_size, nthreads,
+		checkpoint);
 
 	DONE(NULL);
 }
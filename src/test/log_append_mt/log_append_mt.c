@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * log_append_mt.c -- unit test for multi-threaded pmemlog_append
+ *
+ * usage: log_append_mt file nthread nops
+ *
+ */
+
+#include "unittest.h"
+
+/* a single log entry, appended as one unit */
+struct entry {
+	uint32_t tid;
+	uint32_t seq;
+	char pad[56];
+};
+
+static unsigned Nthread;
+static unsigned Nops;
+static PMEMlogpool *Handle;
+
+/*
+ * worker -- the work each thread performs
+ */
+static void *
+worker(void *arg)
+{
+	unsigned mytid = (unsigned)(uintptr_t)arg;
+	struct entry e;
+
+	for (unsigned i = 0; i < Nops; i++) {
+		e.tid = mytid;
+		e.seq = i;
+		memset(e.pad, (int)(mytid + i), sizeof(e.pad));
+
+		if (i % 2) {
+			struct iovec iov[2] = {
+				{
+					.iov_base = &e,
+					.iov_len = sizeof(e) / 2
+				},
+				{
+					.iov_base = (char *)&e + sizeof(e) / 2,
+					.iov_len = sizeof(e) - sizeof(e) / 2
+				}
+			};
+
+			if (pmemlog_appendv(Handle, iov, 2) < 0)
+				UT_FATAL("!appendv tid %u seq %u", mytid, i);
+		} else {
+			if (pmemlog_append(Handle, &e, sizeof(e)) < 0)
+				UT_FATAL("!append tid %u seq %u", mytid, i);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * check_entries -- (walker) verify no entry is torn or out of order
+ */
+static int
+check_entries(const void *buf, size_t len, void *arg)
+{
+	unsigned *next_seq = arg;
+	const struct entry *e = buf;
+
+	UT_ASSERTeq(len % sizeof(*e), 0);
+
+	for (size_t n = 0; n < len / sizeof(*e); n++, e++) {
+		UT_ASSERT(e->tid < Nthread);
+		UT_ASSERTeq(e->seq, next_seq[e->tid]);
+
+		for (size_t i = 0; i < sizeof(e->pad); i++)
+			UT_ASSERTeq(e->pad[i], (char)(e->tid + e->seq));
+
+		next_seq[e->tid]++;
+	}
+
+	return 0;
+}
+
+/*
+ * do_check -- walk the log and verify its contents
+ */
+static void
+do_check(PMEMlogpool *plp)
+{
+	unsigned *next_seq = CALLOC(Nthread, sizeof(*next_seq));
+
+	pmemlog_walk(plp, 0, check_entries, next_seq);
+
+	for (unsigned i = 0; i < Nthread; i++)
+		UT_ASSERTeq(next_seq[i], Nops);
+
+	FREE(next_seq);
+
+	UT_OUT("tell %lld", pmemlog_tell(plp));
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "log_append_mt");
+
+	if (argc != 4)
+		UT_FATAL("usage: %s file nthread nops", argv[0]);
+
+	const char *path = argv[1];
+	Nthread = (unsigned)strtoul(argv[2], NULL, 0);
+	Nops = (unsigned)strtoul(argv[3], NULL, 0);
+
+	if ((Handle = pmemlog_create(path, 0, S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!%s: pmemlog_create", path);
+
+	UT_OUT("%u threads, %u appends each", Nthread, Nops);
+
+	pthread_t threads[Nthread];
+
+	/* kick off nthread threads */
+	for (unsigned i = 0; i < Nthread; i++)
+		PTHREAD_CREATE(&threads[i], NULL, worker,
+				(void *)(uintptr_t)i);
+
+	/* wait for all the threads to complete */
+	for (unsigned i = 0; i < Nthread; i++)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	do_check(Handle);
+	pmemlog_close(Handle);
+
+	/* the write offset must have been persisted for all the appends */
+	if ((Handle = pmemlog_open(path)) == NULL)
+		UT_FATAL("!%s: pmemlog_open", path);
+
+	do_check(Handle);
+	pmemlog_close(Handle);
+
+	int result = pmemlog_check(path);
+	if (result < 0)
+		UT_OUT("!%s: pmemlog_check", path);
+	else if (result == 0)
+		UT_OUT("%s: pmemlog_check: not consistent", path);
+
+	DONE(NULL);
+}
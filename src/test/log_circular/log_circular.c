@@ -0,0 +1,282 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * log_circular.c -- unit test for circular logs
+ *
+ * usage: log_circular file file2 file3
+ *
+ */
+
+#include "unittest.h"
+
+#define RECORD_SIZE 100000
+#define CHUNK_SIZE 1000000
+
+/*
+ * fill -- fill a buffer with a pattern seeded by n
+ */
+static void
+fill(char *buf, size_t len, int n)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (char)(n + i % 251);
+}
+
+/*
+ * check -- verify the pattern stored by fill()
+ */
+static void
+check(const char *buf, size_t len, int n)
+{
+	for (size_t i = 0; i < len; i++)
+		UT_ASSERTeq(buf[i], (char)(n + i % 251));
+}
+
+/*
+ * do_append_records -- append records until the log is full
+ */
+static void
+do_append_records(PMEMlogpool *plp, int *np)
+{
+	char *buf = MALLOC(RECORD_SIZE);
+	int count = 0;
+
+	while (1) {
+		fill(buf, RECORD_SIZE, *np);
+		if (pmemlog_append_record(plp, buf, RECORD_SIZE) < 0)
+			break;
+		(*np)++;
+		count++;
+	}
+
+	UT_OUT("appended %d records: %s", count, strerror(errno));
+	UT_OUT("head %lld tell %lld", pmemlog_head(plp), pmemlog_tell(plp));
+
+	FREE(buf);
+}
+
+/*
+ * do_iterate -- verify all records starting from the head of the log
+ *
+ * Returns the offset of the n-th record.
+ */
+static long long
+do_iterate(PMEMlogpool *plp, int first, int n)
+{
+	long long off = pmemlog_head(plp);
+	long long nth = -1;
+	const void *buf;
+	size_t len;
+	int ret;
+
+	UT_OUT("iterate from %lld", off);
+
+	for (int i = first; ; i++) {
+		long long cur = off;
+		ret = pmemlog_record_next(plp, &off, &buf, &len);
+		if (ret != 1)
+			break;
+
+		UT_ASSERTeq(len, RECORD_SIZE);
+		check(buf, len, i);
+		UT_OUT("record %d offset %lld", i, cur);
+
+		if (i - first == n)
+			nth = cur;
+	}
+
+	if (ret < 0)
+		UT_OUT("!pmemlog_record_next at %lld", off);
+	else
+		UT_OUT("end at %lld", off);
+
+	return nth;
+}
+
+/*
+ * test_records -- fill a circular log with records, trim and wrap around
+ */
+static void
+test_records(const char *path)
+{
+	PMEMlogpool *plp;
+
+	if ((plp = pmemlog_create_circular(path, 0,
+			S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create_circular: %s", path);
+
+	UT_OUT("nbyte %zu", pmemlog_nbyte(plp));
+
+	int n = 0;
+	do_append_records(plp, &n);
+	long long fifth = do_iterate(plp, 0, 5);
+
+	/* free the space taken by the first five records */
+	if (pmemlog_trim(plp, fifth) < 0)
+		UT_FATAL("!pmemlog_trim");
+
+	/* trimming already discarded data is a no-op */
+	if (pmemlog_trim(plp, 0) < 0)
+		UT_FATAL("!pmemlog_trim");
+
+	/* can't trim past the write point */
+	if (pmemlog_trim(plp, pmemlog_tell(plp) + 8) < 0)
+		UT_OUT("!pmemlog_trim");
+
+	/* the discarded records can't be read */
+	long long off = 0;
+	const void *buf;
+	size_t len;
+	if (pmemlog_record_next(plp, &off, &buf, &len) < 0)
+		UT_OUT("!pmemlog_record_next at 0");
+
+	/* the next record wraps around the end of the data area */
+	do_append_records(plp, &n);
+	do_iterate(plp, 5, 0);
+
+	pmemlog_close(plp);
+
+	if ((plp = pmemlog_open(path)) == NULL)
+		UT_FATAL("!pmemlog_open: %s", path);
+
+	do_iterate(plp, 5, 0);
+
+	/* rewinding a circular log discards the data */
+	pmemlog_rewind(plp);
+	UT_OUT("head %lld tell %lld", pmemlog_head(plp), pmemlog_tell(plp));
+	do_iterate(plp, 0, 0);
+
+	pmemlog_close(plp);
+
+	int result = pmemlog_check(path);
+	if (result < 0)
+		UT_OUT("!%s: pmemlog_check", path);
+	else if (result == 0)
+		UT_OUT("%s: pmemlog_check: not consistent", path);
+}
+
+/*
+ * walk_cb -- verify and print the size of a chunk
+ */
+static int
+walk_cb(const void *buf, size_t len, void *arg)
+{
+	size_t *pos = arg;
+
+	for (size_t i = 0; i < len; i++)
+		UT_ASSERTeq(((const char *)buf)[i],
+			(char)((*pos + i) % CHUNK_SIZE % 251));
+	*pos += len;
+
+	UT_OUT("chunk %zu", len);
+
+	return 1;
+}
+
+/*
+ * test_raw -- append raw data wrapping around the end of the data area
+ */
+static void
+test_raw(const char *path)
+{
+	PMEMlogpool *plp;
+
+	if ((plp = pmemlog_create_circular(path, 0,
+			S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create_circular: %s", path);
+
+	char *buf = MALLOC(CHUNK_SIZE);
+	fill(buf, CHUNK_SIZE, 0);
+
+	for (int i = 0; i < 3; i++) {
+		if (pmemlog_append(plp, buf, CHUNK_SIZE) < 0)
+			UT_OUT("!pmemlog_append");
+		else
+			UT_OUT("tell %lld", pmemlog_tell(plp));
+	}
+
+	if (pmemlog_trim(plp, CHUNK_SIZE) < 0)
+		UT_FATAL("!pmemlog_trim");
+
+	/* the data doesn't fit before the end of the data area */
+	if (pmemlog_append(plp, buf, CHUNK_SIZE) < 0)
+		UT_FATAL("!pmemlog_append");
+	UT_OUT("head %lld tell %lld", pmemlog_head(plp), pmemlog_tell(plp));
+
+	size_t pos = 0;
+	UT_OUT("walk 0");
+	pmemlog_walk(plp, 0, walk_cb, &pos);
+
+	pos = 0;
+	UT_OUT("walk %d", CHUNK_SIZE);
+	pmemlog_walk(plp, CHUNK_SIZE, walk_cb, &pos);
+
+	FREE(buf);
+	pmemlog_close(plp);
+}
+
+/*
+ * test_linear -- a regular log can't be trimmed
+ */
+static void
+test_linear(const char *path)
+{
+	PMEMlogpool *plp;
+
+	if ((plp = pmemlog_create(path, 0, S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create: %s", path);
+
+	if (pmemlog_append(plp, "data", 4) < 0)
+		UT_FATAL("!pmemlog_append");
+
+	if (pmemlog_trim(plp, 4) < 0)
+		UT_OUT("!pmemlog_trim");
+	UT_OUT("head %lld tell %lld", pmemlog_head(plp), pmemlog_tell(plp));
+
+	pmemlog_close(plp);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "log_circular");
+
+	if (argc != 4)
+		UT_FATAL("usage: %s file file2 file3", argv[0]);
+
+	test_records(argv[1]);
+	test_raw(argv[2]);
+	test_linear(argv[3]);
+
+	DONE(NULL);
+}
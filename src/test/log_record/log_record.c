@@ -0,0 +1,159 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * log_record.c -- unit test for pmemlog_append_record and pmemlog_record_next
+ *
+ * usage: log_record file
+ *
+ */
+
+#include "unittest.h"
+
+#define NRECORDS 10
+
+/*
+ * fill -- fill the payload of n-th record
+ */
+static void
+fill(char *buf, size_t len, int n)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (char)('a' + (n + i) % 26);
+}
+
+/*
+ * do_append -- append records of different sizes
+ */
+static void
+do_append(PMEMlogpool *plp)
+{
+	char buf[NRECORDS * 3];
+
+	for (int n = 0; n < NRECORDS; n++) {
+		size_t len = (size_t)n * 3;
+		fill(buf, len, n);
+		if (pmemlog_append_record(plp, buf, len) < 0)
+			UT_FATAL("!pmemlog_append_record");
+	}
+
+	UT_OUT("tell %lld", pmemlog_tell(plp));
+}
+
+/*
+ * do_iterate -- print all records starting from given offset
+ *
+ * Returns the offset of the third record found.
+ */
+static long long
+do_iterate(PMEMlogpool *plp, long long off)
+{
+	const void *buf;
+	size_t len;
+	long long third = -1;
+	int n = 0;
+	int ret;
+
+	UT_OUT("iterate from %lld", off);
+
+	while (1) {
+		long long cur = off;
+		ret = pmemlog_record_next(plp, &off, &buf, &len);
+		if (ret != 1)
+			break;
+
+		char *str = MALLOC(len + 1);
+		memcpy(str, buf, len);
+		str[len] = '\0';
+		UT_OUT("offset %lld size %zu \"%s\"", cur, len, str);
+		FREE(str);
+
+		if (++n == 3)
+			third = cur;
+	}
+
+	if (ret < 0)
+		UT_OUT("!pmemlog_record_next at %lld", off);
+	else
+		UT_OUT("end at %lld", off);
+
+	return third;
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "log_record");
+
+	if (argc != 2)
+		UT_FATAL("usage: %s file", argv[0]);
+
+	const char *path = argv[1];
+	PMEMlogpool *plp;
+
+	if ((plp = pmemlog_create(path, 0, S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create: %s", path);
+
+	/* empty log */
+	do_iterate(plp, 0);
+
+	do_append(plp);
+	long long third = do_iterate(plp, 0);
+
+	/* resume from the middle of the log */
+	do_iterate(plp, third);
+
+	/* misaligned offset */
+	do_iterate(plp, 1);
+
+	/* offset past the end of the log */
+	do_iterate(plp, pmemlog_tell(plp) + 8);
+
+	pmemlog_close(plp);
+
+	if ((plp = pmemlog_open(path)) == NULL)
+		UT_FATAL("!pmemlog_open: %s", path);
+
+	/* the records survive reopening the pool */
+	do_iterate(plp, third);
+
+	/* a raw append doesn't make a valid record */
+	long long raw = pmemlog_tell(plp);
+	if (pmemlog_append(plp, "not a record", 12) < 0)
+		UT_FATAL("!pmemlog_append");
+	do_iterate(plp, raw);
+
+	pmemlog_close(plp);
+
+	DONE(NULL);
+}
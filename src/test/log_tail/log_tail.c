@@ -0,0 +1,256 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * log_tail.c -- unit test for pmemlog_read and pmemlog_wait
+ *
+ * usage: log_tail file file2 nops
+ *
+ */
+
+#include "unittest.h"
+
+static unsigned Nops;
+static PMEMlogpool *Handle;
+
+/*
+ * producer -- append consecutive numbers to the log
+ */
+static void *
+producer(void *arg)
+{
+	for (uint64_t i = 0; i < Nops; i++) {
+		if (pmemlog_append(Handle, &i, sizeof(i)) < 0)
+			UT_FATAL("!pmemlog_append");
+	}
+
+	return NULL;
+}
+
+struct consumer {
+	uint64_t next;		/* next number expected */
+	size_t partial;		/* bytes of a number split between chunks */
+	uint64_t val;		/* the number being assembled */
+};
+
+/*
+ * consume_cb -- verify the numbers found in a chunk of the log
+ */
+static int
+consume_cb(const void *buf, size_t len, void *arg)
+{
+	struct consumer *c = arg;
+	const char *p = buf;
+
+	for (size_t i = 0; i < len; i++) {
+		((char *)&c->val)[c->partial++] = p[i];
+		if (c->partial == sizeof(c->val)) {
+			UT_ASSERTeq(c->val, c->next);
+			c->next++;
+			c->partial = 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * consumer -- follow the tail of the log until all numbers are read
+ */
+static void *
+consumer(void *arg)
+{
+	struct consumer c = { 0, 0, 0 };
+	long long off = 0;
+
+	while (c.next < Nops) {
+		if (pmemlog_wait(Handle, off, -1) != 1)
+			UT_FATAL("!pmemlog_wait");
+		if (pmemlog_read(Handle, &off, consume_cb, &c) < 0)
+			UT_FATAL("!pmemlog_read");
+	}
+
+	UT_ASSERTeq(off, (long long)(Nops * sizeof(uint64_t)));
+
+	return NULL;
+}
+
+/*
+ * test_follow -- read the log while it's being appended to
+ */
+static void
+test_follow(const char *path)
+{
+	if ((Handle = pmemlog_create(path, 0, S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create: %s", path);
+
+	pthread_t threads[2];
+	PTHREAD_CREATE(&threads[0], NULL, consumer, NULL);
+	PTHREAD_CREATE(&threads[1], NULL, producer, NULL);
+	PTHREAD_JOIN(threads[0], NULL);
+	PTHREAD_JOIN(threads[1], NULL);
+
+	UT_OUT("tell %lld", pmemlog_tell(Handle));
+
+	/* nothing new to read */
+	UT_OUT("wait %d", pmemlog_wait(Handle, pmemlog_tell(Handle), 0));
+	UT_OUT("wait %d", pmemlog_wait(Handle, pmemlog_tell(Handle), 10));
+	UT_OUT("wait %d", pmemlog_wait(Handle, 0, 0));
+
+	/* offset past the end of the log */
+	if (pmemlog_wait(Handle, pmemlog_tell(Handle) + 1, 0) < 0)
+		UT_OUT("!pmemlog_wait");
+
+	pmemlog_close(Handle);
+}
+
+/*
+ * print_cb -- print a chunk of the log and stop
+ */
+static int
+print_cb(const void *buf, size_t len, void *arg)
+{
+	UT_OUT("chunk %zu \"%.*s\"", len, (int)len, (const char *)buf);
+
+	return 0;
+}
+
+/*
+ * rewind_cb -- rewind the log while its data is being read
+ */
+static int
+rewind_cb(const void *buf, size_t len, void *arg)
+{
+	pmemlog_rewind(Handle);
+	if (pmemlog_append(Handle, "XXXX", 4) < 0)
+		UT_FATAL("!pmemlog_append");
+
+	return 1;
+}
+
+/*
+ * overwrite_cb -- make a circular log wrap over the data being read
+ */
+static int
+overwrite_cb(const void *buf, size_t len, void *arg)
+{
+	size_t nbyte = pmemlog_nbyte(Handle);
+	char *data = MALLOC(nbyte / 2);
+	memset(data, 'X', nbyte / 2);
+
+	for (int i = 0; i < 2; i++) {
+		if (pmemlog_trim(Handle, pmemlog_tell(Handle)) < 0)
+			UT_FATAL("!pmemlog_trim");
+		if (pmemlog_append(Handle, data, nbyte / 2) < 0)
+			UT_FATAL("!pmemlog_append");
+	}
+
+	FREE(data);
+
+	return 1;
+}
+
+/*
+ * test_stale -- discard the data while it's being read
+ */
+static void
+test_stale(const char *path, const char *cpath)
+{
+	long long off = 0;
+
+	if ((Handle = pmemlog_create(path, 0, S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create: %s", path);
+
+	if (pmemlog_append(Handle, "abcdefgh", 8) < 0)
+		UT_FATAL("!pmemlog_append");
+
+	/* the callback may stop the read */
+	if (pmemlog_read(Handle, &off, print_cb, NULL) < 0)
+		UT_FATAL("!pmemlog_read");
+	UT_OUT("offset %lld", off);
+
+	off = 0;
+	if (pmemlog_read(Handle, &off, rewind_cb, NULL) < 0)
+		UT_OUT("!pmemlog_read");
+	UT_OUT("offset %lld", off);
+
+	/* a cursor from before the rewind is past the end of the log */
+	off = 8;
+	if (pmemlog_read(Handle, &off, print_cb, NULL) < 0)
+		UT_OUT("!pmemlog_read");
+
+	pmemlog_close(Handle);
+
+	if ((Handle = pmemlog_create_circular(cpath, 0,
+			S_IWUSR | S_IRUSR)) == NULL)
+		UT_FATAL("!pmemlog_create_circular: %s", cpath);
+
+	if (pmemlog_append(Handle, "abcdefgh", 8) < 0)
+		UT_FATAL("!pmemlog_append");
+
+	off = 0;
+	if (pmemlog_read(Handle, &off, overwrite_cb, NULL) < 0)
+		UT_OUT("!pmemlog_read");
+	UT_OUT("offset %lld", off);
+
+	/* the data has been trimmed */
+	if (pmemlog_read(Handle, &off, print_cb, NULL) < 0)
+		UT_OUT("!pmemlog_read");
+
+	/* a trim which doesn't reuse the space being read is fine */
+	off = pmemlog_tell(Handle);
+	if (pmemlog_append(Handle, "ijkl", 4) < 0)
+		UT_FATAL("!pmemlog_append");
+	if (pmemlog_trim(Handle, off) < 0)
+		UT_FATAL("!pmemlog_trim");
+	if (pmemlog_read(Handle, &off, print_cb, NULL) < 0)
+		UT_FATAL("!pmemlog_read");
+	UT_OUT("head %lld offset %lld", pmemlog_head(Handle), off);
+
+	pmemlog_close(Handle);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "log_tail");
+
+	if (argc != 5)
+		UT_FATAL("usage: %s file file2 file3 nops", argv[0]);
+
+	Nops = (unsigned)strtoul(argv[4], NULL, 0);
+
+	test_follow(argv[1]);
+	test_stale(argv[2], argv[3]);
+
+	DONE(NULL);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_prefault.c -- unit test for pmemobj_set_prefault()
+ *
+ * usage: obj_prefault file nthreads
+ */
+
+#include "unittest.h"
+
+#define LAYOUT "prefault"
+#define POOL_SIZE ((size_t)(96 << 20))
+
+struct progress {
+	unsigned ncalls;
+	size_t done;
+	size_t total;
+};
+
+/*
+ * progress_cb -- check the progress only moves forward
+ */
+static void
+progress_cb(size_t done, size_t total, void *arg)
+{
+	struct progress *p = arg;
+
+	UT_ASSERT(done >= p->done);
+	UT_ASSERT(done <= total);
+	UT_ASSERT(p->ncalls == 0 || total == p->total);
+
+	p->ncalls++;
+	p->done = done;
+	p->total = total;
+}
+
+/*
+ * check_progress -- check the whole pool has been prefaulted
+ */
+static void
+check_progress(struct progress *p, const char *op)
+{
+	UT_ASSERT(p->ncalls > 0);
+	UT_ASSERTeq(p->done, p->total);
+	UT_ASSERT(p->total >= POOL_SIZE);
+
+	UT_OUT("%s: prefaulted %zu", op, p->total);
+
+	memset(p, 0, sizeof(*p));
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_prefault");
+
+	if (argc != 3)
+		UT_FATAL("usage: %s file nthreads", argv[0]);
+
+	const char *path = argv[1];
+	unsigned nthreads = (unsigned)atoi(argv[2]);
+	struct progress p;
+	memset(&p, 0, sizeof(p));
+
+	pmemobj_set_prefault(nthreads, progress_cb, &p);
+
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT, POOL_SIZE,
+			S_IWUSR | S_IRUSR);
+	if (pop == NULL)
+		UT_FATAL("!pmemobj_create: %s", path);
+	pmemobj_close(pop);
+	check_progress(&p, "create");
+
+	pop = pmemobj_open(path, LAYOUT);
+	if (pop == NULL)
+		UT_FATAL("!pmemobj_open: %s", path);
+	pmemobj_close(pop);
+	check_progress(&p, "open");
+
+	/* disabled */
+	pmemobj_set_prefault(0, progress_cb, &p);
+
+	pop = pmemobj_open(path, LAYOUT);
+	if (pop == NULL)
+		UT_FATAL("!pmemobj_open: %s", path);
+	pmemobj_close(pop);
+	UT_ASSERTeq(p.ncalls, 0);
+
+	DONE(NULL);
+}
@@ -48,9 +48,11 @@
 #include "rpmem_util.h"
 #include "rpmem_fip_common.h"
 #include "rpmem_fip_sock.h"
+#include "rpmem_hist.h"
 #include "rpmemd_fip.h"
 #include "rpmemd_log.h"
 #include "rpmem_fip.h"
+#include "util.h"
 
 #define SIZE_PER_LANE	64
 #define COUNT_PER_LANE	32
@@ -68,9 +70,21 @@ TEST_CASE_DECLARE(server_init);
 TEST_CASE_DECLARE(client_connect);
 TEST_CASE_DECLARE(server_connect);
 TEST_CASE_DECLARE(server_process);
+TEST_CASE_DECLARE(server_process_drain);
+TEST_CASE_DECLARE(server_process_busy);
+TEST_CASE_DECLARE(server_process_conns);
+TEST_CASE_DECLARE(server_process_stats);
 TEST_CASE_DECLARE(client_persist);
 TEST_CASE_DECLARE(client_persist_mt);
+TEST_CASE_DECLARE(client_persist_mt_busy);
+TEST_CASE_DECLARE(client_persist_mt_stats);
+TEST_CASE_DECLARE(client_persist_async);
+TEST_CASE_DECLARE(client_persist_batch);
 TEST_CASE_DECLARE(client_read);
+TEST_CASE_DECLARE(client_readv);
+TEST_CASE_DECLARE(client_read_ahead);
+TEST_CASE_DECLARE(client_sync);
+TEST_CASE_DECLARE(client_sync_delta);
 
 /*
  * get_persist_method -- parse persist method
@@ -219,6 +233,7 @@ client_init(const struct test_case *tc, int argc, char *argv[])
 		.nlanes = resp.nlanes,
 		.raddr = (void *)resp.raddr,
 		.rkey = resp.rkey,
+		.nconns = resp.nconns,
 	};
 
 	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
@@ -323,6 +338,7 @@ client_connect(const struct test_case *tc, int argc, char *argv[])
 		.nlanes = resp.nlanes,
 		.raddr = (void *)resp.raddr,
 		.rkey = resp.rkey,
+		.nconns = resp.nconns,
 	};
 
 	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
@@ -403,10 +419,13 @@ server_connect(const struct test_case *tc, int argc, char *argv[])
 }
 
 /*
- * server_process -- test case for processing data on server side
+ * server_process_common -- process data on server side using either
+ * the persist function or the flush and drain functions, optionally
+ * busy polling for completions and accepting multiple connections
  */
-void
-server_process(const struct test_case *tc, int argc, char *argv[])
+static void
+server_process_common(const struct test_case *tc, int argc, char *argv[],
+	int drain, int busy_poll, unsigned nconns, unsigned stats_interval)
 {
 	if (argc != 3)
 		UT_FATAL("usage: %s <addr> <port> <persist method>", tc->name);
@@ -428,10 +447,16 @@ server_process(const struct test_case *tc, int argc, char *argv[])
 		.addr = rpool,
 		.size = POOL_SIZE,
 		.nlanes = nlanes,
+		.nconns = nconns,
 		.provider = provider,
 		.persist_method = persist_method,
 		.persist = pmem_persist,
+		.flush = drain ? pmem_flush : NULL,
+		.drain = drain ? pmem_drain : NULL,
 		.nthreads = NTHREADS,
+		.busy_poll = busy_poll,
+		.poll_cpus = busy_poll ? "0" : NULL,
+		.stats_interval = stats_interval,
 	};
 
 	int ret;
@@ -455,6 +480,15 @@ server_process(const struct test_case *tc, int argc, char *argv[])
 	ret = rpmemd_fip_process_stop(fip);
 	UT_ASSERTeq(ret, 0);
 
+	if (stats_interval && persist_method == RPMEM_PM_GPSPM) {
+		struct rpmemd_fip_stats stats;
+		rpmemd_fip_stats(fip, &stats);
+
+		UT_ASSERTne(stats.total.count, 0);
+		UT_ASSERTeq(stats.queue.count, stats.total.count);
+		UT_ASSERTeq(stats.persist.count, stats.total.count);
+	}
+
 	server_close_end(fd);
 
 	ret = rpmemd_fip_wait_close(fip, -1);
@@ -466,6 +500,55 @@ server_process(const struct test_case *tc, int argc, char *argv[])
 	rpmemd_fip_fini(fip);
 }
 
+/*
+ * server_process -- test case for processing data on server side
+ */
+void
+server_process(const struct test_case *tc, int argc, char *argv[])
+{
+	server_process_common(tc, argc, argv, 0, 0, 1, 0);
+}
+
+/*
+ * server_process_drain -- test case for processing data on server side
+ * with a single drain per batch of persist messages
+ */
+void
+server_process_drain(const struct test_case *tc, int argc, char *argv[])
+{
+	server_process_common(tc, argc, argv, 1, 0, 1, 0);
+}
+
+/*
+ * server_process_busy -- test case for processing data on server side
+ * by busy-polling threads
+ */
+void
+server_process_busy(const struct test_case *tc, int argc, char *argv[])
+{
+	server_process_common(tc, argc, argv, 1, 1, 1, 0);
+}
+
+/*
+ * server_process_conns -- test case for processing data on server side
+ * with lanes striped across multiple connections
+ */
+void
+server_process_conns(const struct test_case *tc, int argc, char *argv[])
+{
+	server_process_common(tc, argc, argv, 0, 0, 2, 0);
+}
+
+/*
+ * server_process_stats -- test case for processing data on server side
+ * with latency statistics logged every second
+ */
+void
+server_process_stats(const struct test_case *tc, int argc, char *argv[])
+{
+	server_process_common(tc, argc, argv, 1, 0, 1, 1);
+}
+
 /*
  * client_persist -- test case for single-threaded persist operation
  */
@@ -509,6 +592,7 @@ client_persist(const struct test_case *tc, int argc, char *argv[])
 		.nlanes = resp.nlanes,
 		.raddr = (void *)resp.raddr,
 		.rkey = resp.rkey,
+		.nconns = resp.nconns,
 	};
 
 	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
@@ -552,10 +636,12 @@ client_persist(const struct test_case *tc, int argc, char *argv[])
 }
 
 /*
- * client_persist_mt -- test case for multi-threaded persist operation
+ * client_persist_mt_common -- multi-threaded persist operation, optionally
+ * with the persisting threads polling for completions themselves
  */
-void
-client_persist_mt(const struct test_case *tc, int argc, char *argv[])
+static void
+client_persist_mt_common(const struct test_case *tc, int argc, char *argv[],
+	int busy_poll, int stats)
 {
 	if (argc != 2)
 		UT_FATAL("usage: %s <addr>[:<port>] <provider>", tc->name);
@@ -595,6 +681,9 @@ client_persist_mt(const struct test_case *tc, int argc, char *argv[])
 		.nlanes = resp.nlanes,
 		.raddr = (void *)resp.raddr,
 		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+		.busy_poll = busy_poll,
+		.stats = stats,
 	};
 
 	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
@@ -624,6 +713,17 @@ client_persist_mt(const struct test_case *tc, int argc, char *argv[])
 	for (unsigned i = 0; i < nlanes; i++)
 		PTHREAD_JOIN(persist_thread[i], NULL);
 
+	if (stats) {
+		struct rpmem_fip_stats fstats;
+		rpmem_fip_stats(fip, &fstats);
+
+		uint64_t nops = (uint64_t)nlanes * COUNT_PER_LANE;
+		UT_ASSERTeq(fstats.post.count, nops);
+		UT_ASSERTeq(fstats.wait.count, nops);
+		UT_ASSERTeq(fstats.total.count, nops);
+		UT_ASSERT(fstats.total.max >= fstats.wait.max);
+	}
+
 	ret = rpmem_fip_read(fip, rpool, POOL_SIZE, 0);
 	UT_ASSERTeq(ret, 0);
 
@@ -648,10 +748,298 @@ client_persist_mt(const struct test_case *tc, int argc, char *argv[])
 }
 
 /*
- * client_read -- test case for read operation
+ * client_persist_mt -- test case for multi-threaded persist operation
  */
 void
-client_read(const struct test_case *tc, int argc, char *argv[])
+client_persist_mt(const struct test_case *tc, int argc, char *argv[])
+{
+	client_persist_mt_common(tc, argc, argv, 0, 0);
+}
+
+/*
+ * client_persist_mt_busy -- test case for multi-threaded persist operation
+ * in the busy-poll mode
+ */
+void
+client_persist_mt_busy(const struct test_case *tc, int argc, char *argv[])
+{
+	client_persist_mt_common(tc, argc, argv, 1, 0);
+}
+
+/*
+ * client_persist_mt_stats -- test case for multi-threaded persist operation
+ * with latency statistics
+ */
+void
+client_persist_mt_stats(const struct test_case *tc, int argc, char *argv[])
+{
+	client_persist_mt_common(tc, argc, argv, 0, 1);
+}
+
+/*
+ * client_persist_async -- test case for pipelined persist operations
+ */
+void
+client_persist_async(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc != 3)
+		UT_FATAL("usage: %s <addr>[:<port>] <provider> <depth>",
+				tc->name);
+
+	char *target = argv[0];
+	char *prov_name = argv[1];
+	unsigned depth = (unsigned)strtoul(argv[2], NULL, 0);
+
+	char *node;
+	char *service;
+	char fip_service[NI_MAXSERV];
+
+	int ret;
+
+	ret = rpmem_target_split(target, NULL, &node, &service);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(node, NULL);
+	UT_ASSERTne(service, NULL);
+
+	set_pool_data(lpool, 1);
+	set_pool_data(rpool, 1);
+
+	unsigned nlanes;
+	enum rpmem_provider provider = get_provider(node,
+			prov_name, &nlanes);
+
+	int fd;
+	struct rpmem_resp_attr resp;
+	struct sockaddr_in addr_in;
+	fd = client_exchange(node, service, NLANES, provider,
+			&resp, &addr_in);
+
+	struct rpmem_fip_attr attr = {
+		.provider = provider,
+		.persist_method = resp.persist_method,
+		.laddr = lpool,
+		.size = POOL_SIZE,
+		.nlanes = resp.nlanes,
+		.depth = depth,
+		.raddr = (void *)resp.raddr,
+		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+	};
+
+	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
+	UT_ASSERT(sret > 0);
+
+	struct rpmem_fip *fip;
+	fip = rpmem_fip_init(node, fip_service, &attr, &nlanes);
+	UT_ASSERTne(fip, NULL);
+
+	ret = rpmem_fip_connect(fip);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_process_start(fip);
+	UT_ASSERTeq(ret, 0);
+
+	uint64_t *tokens = MALLOC(nlanes * COUNT_PER_LANE * sizeof(*tokens));
+
+	/* keep all lanes busy with more operations than their depth */
+	for (unsigned i = 0; i < COUNT_PER_LANE; i++) {
+		for (unsigned l = 0; l < nlanes; l++) {
+			size_t offset = l * TOTAL_PER_LANE + i * SIZE_PER_LANE;
+			memset(&lpool[offset], (int)(l + i), SIZE_PER_LANE);
+
+			ret = rpmem_fip_persist_async(fip, offset,
+					SIZE_PER_LANE, l,
+					&tokens[l * COUNT_PER_LANE + i]);
+			UT_ASSERTeq(ret, 0);
+		}
+	}
+
+	for (unsigned l = 0; l < nlanes; l++) {
+		for (unsigned i = 0; i < COUNT_PER_LANE; i++) {
+			uint64_t token = tokens[l * COUNT_PER_LANE + i];
+
+			ret = rpmem_fip_poll(fip, l, token);
+			UT_ASSERT(ret == 0 || ret == 1);
+
+			ret = rpmem_fip_wait(fip, l, token);
+			UT_ASSERTeq(ret, 0);
+
+			ret = rpmem_fip_poll(fip, l, token);
+			UT_ASSERTeq(ret, 1);
+		}
+
+		/* operation which has not been posted yet */
+		ret = rpmem_fip_wait(fip, l, COUNT_PER_LANE);
+		UT_ASSERTeq(ret, -1);
+		UT_ASSERTeq(errno, EINVAL);
+	}
+
+	ret = rpmem_fip_read(fip, rpool, POOL_SIZE, 0);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_process_stop(fip);
+	UT_ASSERTeq(ret, 0);
+
+	client_close(fd);
+
+	ret = rpmem_fip_close(fip);
+	UT_ASSERTeq(ret, 0);
+
+	rpmem_fip_fini(fip);
+
+	FREE(tokens);
+
+	ret = memcmp(rpool, lpool, POOL_SIZE);
+	UT_ASSERTeq(ret, 0);
+
+	FREE(node);
+	FREE(service);
+}
+
+/*
+ * client_persist_batch -- test case for batched persist operations
+ */
+void
+client_persist_batch(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s <addr>[:<port>] <provider>", tc->name);
+
+	char *target = argv[0];
+	char *prov_name = argv[1];
+
+	char *node;
+	char *service;
+	char fip_service[NI_MAXSERV];
+
+	int ret;
+
+	ret = rpmem_target_split(target, NULL, &node, &service);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(node, NULL);
+	UT_ASSERTne(service, NULL);
+
+	set_pool_data(lpool, 1);
+	set_pool_data(rpool, 1);
+
+	unsigned nlanes;
+	enum rpmem_provider provider = get_provider(node,
+			prov_name, &nlanes);
+
+	int fd;
+	struct rpmem_resp_attr resp;
+	struct sockaddr_in addr_in;
+	fd = client_exchange(node, service, NLANES, provider,
+			&resp, &addr_in);
+
+	struct rpmem_fip_attr attr = {
+		.provider = provider,
+		.persist_method = resp.persist_method,
+		.laddr = lpool,
+		.size = POOL_SIZE,
+		.nlanes = resp.nlanes,
+		.raddr = (void *)resp.raddr,
+		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+	};
+
+	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
+	UT_ASSERT(sret > 0);
+
+	struct rpmem_fip *fip;
+	fip = rpmem_fip_init(node, fip_service, &attr, &nlanes);
+	UT_ASSERTne(fip, NULL);
+
+	ret = rpmem_fip_connect(fip);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_process_start(fip);
+	UT_ASSERTeq(ret, 0);
+
+	/* the odd chunks of a lane join the even ones into a single range */
+	for (unsigned l = 0; l < nlanes; l++) {
+		ret = rpmem_fip_batch_begin(fip, l);
+		UT_ASSERTeq(ret, 0);
+
+		for (unsigned s = 0; s < 2; s++) {
+			for (unsigned i = s; i < COUNT_PER_LANE; i += 2) {
+				size_t offset = l * TOTAL_PER_LANE +
+					i * SIZE_PER_LANE;
+				memset(&lpool[offset], (int)(l + i),
+						SIZE_PER_LANE);
+
+				ret = rpmem_fip_persist(fip, offset,
+						SIZE_PER_LANE, l);
+				UT_ASSERTeq(ret, 0);
+			}
+		}
+
+		ret = rpmem_fip_batch_end(fip, l);
+		UT_ASSERTeq(ret, 0);
+	}
+
+	/* disjoint ranges of all lanes overflow a single persist message */
+	ret = rpmem_fip_batch_begin(fip, 0);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_batch_begin(fip, 0);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	for (unsigned l = 0; l < nlanes; l++) {
+		size_t offset = l * TOTAL_PER_LANE;
+		memset(&lpool[offset], 0xff, SIZE_PER_LANE);
+
+		ret = rpmem_fip_persist(fip, offset, SIZE_PER_LANE, 0);
+		UT_ASSERTeq(ret, 0);
+	}
+
+	ret = rpmem_fip_batch_end(fip, 0);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_batch_end(fip, 0);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	ret = rpmem_fip_read(fip, rpool, POOL_SIZE, 0);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_process_stop(fip);
+	UT_ASSERTeq(ret, 0);
+
+	client_close(fd);
+
+	ret = rpmem_fip_close(fip);
+	UT_ASSERTeq(ret, 0);
+
+	rpmem_fip_fini(fip);
+
+	ret = memcmp(rpool, lpool, POOL_SIZE);
+	UT_ASSERTeq(ret, 0);
+
+	FREE(node);
+	FREE(service);
+}
+
+/*
+ * read_mode -- the way client_read_common reads the remote pool
+ */
+enum read_mode {
+	READ_SINGLE,	/* single read of the whole pool */
+	READ_VECTOR,	/* vectored read of lanes' data in reverse order */
+	READ_AHEAD,	/* sequential reads with read-ahead enabled */
+};
+
+/* size of a read for READ_AHEAD, not a multiple of the READ size */
+#define READ_AHEAD_CHUNK	3000
+#define READ_AHEAD_SIZE		(64 * 1024)
+
+/*
+ * client_read_common -- read remote pool and verify its content
+ */
+static void
+client_read_common(const struct test_case *tc, int argc, char *argv[],
+	enum read_mode mode)
 {
 	if (argc != 2)
 		UT_FATAL("usage: %s <addr>[:<port>] <provider>", tc->name);
@@ -691,6 +1079,8 @@ client_read(const struct test_case *tc, int argc, char *argv[])
 		.nlanes = resp.nlanes,
 		.raddr = (void *)resp.raddr,
 		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+		.read_ahead = mode == READ_AHEAD ? READ_AHEAD_SIZE : 0,
 	};
 
 	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
@@ -706,7 +1096,173 @@ client_read(const struct test_case *tc, int argc, char *argv[])
 	ret = rpmem_fip_process_start(fip);
 	UT_ASSERTeq(ret, 0);
 
-	ret = rpmem_fip_read(fip, lpool, POOL_SIZE, 0);
+	switch (mode) {
+	case READ_SINGLE:
+		ret = rpmem_fip_read(fip, lpool, POOL_SIZE, 0);
+		UT_ASSERTeq(ret, 0);
+		break;
+	case READ_VECTOR:
+	{
+		struct rpmem_fip_rd_iov *iov = MALLOC(NLANES * sizeof(*iov));
+		for (unsigned l = 0; l < NLANES; l++) {
+			size_t offset = (NLANES - 1 - l) * TOTAL_PER_LANE;
+			iov[l].buff = &lpool[offset];
+			iov[l].off = offset;
+			iov[l].len = TOTAL_PER_LANE;
+		}
+
+		ret = rpmem_fip_readv(fip, iov, NLANES);
+		UT_ASSERTeq(ret, 0);
+		FREE(iov);
+		break;
+	}
+	case READ_AHEAD:
+		UT_ASSERTeq(attr.read_ahead, READ_AHEAD_SIZE);
+		for (size_t off = 0; off < POOL_SIZE; off += READ_AHEAD_CHUNK) {
+			size_t len = POOL_SIZE - off < READ_AHEAD_CHUNK ?
+				POOL_SIZE - off : READ_AHEAD_CHUNK;
+			ret = rpmem_fip_read(fip, &lpool[off], len, off);
+			UT_ASSERTeq(ret, 0);
+		}
+		break;
+	}
+
+	ret = rpmem_fip_process_stop(fip);
+	UT_ASSERTeq(ret, 0);
+
+	client_close(fd);
+
+	ret = rpmem_fip_close(fip);
+	UT_ASSERTeq(ret, 0);
+
+	rpmem_fip_fini(fip);
+
+	ret = memcmp(rpool, lpool, POOL_SIZE);
+	UT_ASSERTeq(ret, 0);
+
+	FREE(node);
+	FREE(service);
+}
+
+/*
+ * client_read -- test case for read operation
+ */
+void
+client_read(const struct test_case *tc, int argc, char *argv[])
+{
+	client_read_common(tc, argc, argv, READ_SINGLE);
+}
+
+/*
+ * client_readv -- test case for vectored read operation
+ */
+void
+client_readv(const struct test_case *tc, int argc, char *argv[])
+{
+	client_read_common(tc, argc, argv, READ_VECTOR);
+}
+
+/*
+ * client_read_ahead -- test case for sequential reads with read-ahead
+ */
+void
+client_read_ahead(const struct test_case *tc, int argc, char *argv[])
+{
+	client_read_common(tc, argc, argv, READ_AHEAD);
+}
+
+/*
+ * client_sync_common -- synchronize remote pool with local one and verify
+ * the remote content by reading it back
+ *
+ * In the delta mode the checksums of the remote blocks are computed from
+ * the well known content of the remote pool and only some of the blocks
+ * are modified locally.
+ */
+static void
+client_sync_common(const struct test_case *tc, int argc, char *argv[],
+	int delta)
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s <addr>[:<port>] <provider>", tc->name);
+
+	char *target = argv[0];
+	char *prov_name = argv[1];
+
+	char *node;
+	char *service;
+	char fip_service[NI_MAXSERV];
+
+	int ret;
+
+	ret = rpmem_target_split(target, NULL, &node, &service);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTne(node, NULL);
+	UT_ASSERTne(service, NULL);
+
+	size_t nblocks = POOL_SIZE / TOTAL_PER_LANE;
+	uint64_t *sums = NULL;
+
+	if (delta) {
+		set_pool_data(rpool, 1);
+		memcpy(lpool, rpool, POOL_SIZE);
+
+		sums = MALLOC(nblocks * sizeof(*sums));
+		for (size_t i = 0; i < nblocks; i++)
+			util_checksum(&rpool[i * TOTAL_PER_LANE],
+					TOTAL_PER_LANE, &sums[i], 1);
+
+		/* modify every third block and a run of adjacent ones */
+		for (size_t i = 0; i < nblocks; i++) {
+			if (i % 3 && (i < 100 || i >= 110))
+				continue;
+
+			memset(&lpool[i * TOTAL_PER_LANE], (int)i,
+					TOTAL_PER_LANE);
+		}
+	} else {
+		set_pool_data(lpool, 0);
+	}
+
+	unsigned nlanes;
+	enum rpmem_provider provider = get_provider(node,
+			prov_name, &nlanes);
+
+	int fd;
+	struct rpmem_resp_attr resp;
+	struct sockaddr_in addr_in;
+	fd = client_exchange(node, service, NLANES, provider,
+			&resp, &addr_in);
+
+	struct rpmem_fip_attr attr = {
+		.provider = provider,
+		.persist_method = resp.persist_method,
+		.laddr = lpool,
+		.size = POOL_SIZE,
+		.nlanes = resp.nlanes,
+		.raddr = (void *)resp.raddr,
+		.rkey = resp.rkey,
+		.nconns = resp.nconns,
+	};
+
+	ssize_t sret = snprintf(fip_service, NI_MAXSERV, "%u", resp.port);
+	UT_ASSERT(sret > 0);
+
+	struct rpmem_fip *fip;
+	fip = rpmem_fip_init(node, fip_service, &attr, &nlanes);
+	UT_ASSERTne(fip, NULL);
+
+	ret = rpmem_fip_connect(fip);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_process_start(fip);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmem_fip_sync(fip, 0, POOL_SIZE, TOTAL_PER_LANE, sums);
+	UT_ASSERTeq(ret, 0);
+
+	memset(rpool, 0, POOL_SIZE);
+	ret = rpmem_fip_read(fip, rpool, POOL_SIZE, 0);
 	UT_ASSERTeq(ret, 0);
 
 	ret = rpmem_fip_process_stop(fip);
@@ -722,10 +1278,30 @@ client_read(const struct test_case *tc, int argc, char *argv[])
 	ret = memcmp(rpool, lpool, POOL_SIZE);
 	UT_ASSERTeq(ret, 0);
 
+	if (sums)
+		FREE(sums);
 	FREE(node);
 	FREE(service);
 }
 
+/*
+ * client_sync -- test case for synchronization of the whole pool
+ */
+void
+client_sync(const struct test_case *tc, int argc, char *argv[])
+{
+	client_sync_common(tc, argc, argv, 0);
+}
+
+/*
+ * client_sync_delta -- test case for synchronization of modified blocks only
+ */
+void
+client_sync_delta(const struct test_case *tc, int argc, char *argv[])
+{
+	client_sync_common(tc, argc, argv, 1);
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -736,8 +1312,20 @@ static struct test_case test_cases[] = {
 	TEST_CASE(server_connect),
 	TEST_CASE(client_persist),
 	TEST_CASE(client_persist_mt),
+	TEST_CASE(client_persist_mt_busy),
+	TEST_CASE(client_persist_mt_stats),
+	TEST_CASE(client_persist_async),
+	TEST_CASE(client_persist_batch),
 	TEST_CASE(server_process),
+	TEST_CASE(server_process_drain),
+	TEST_CASE(server_process_busy),
+	TEST_CASE(server_process_conns),
+	TEST_CASE(server_process_stats),
 	TEST_CASE(client_read),
+	TEST_CASE(client_readv),
+	TEST_CASE(client_read_ahead),
+	TEST_CASE(client_sync),
+	TEST_CASE(client_sync_delta),
 };
 
 #define NTESTS	(sizeof(test_cases) / sizeof(test_cases[0]))
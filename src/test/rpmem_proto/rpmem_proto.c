@@ -103,6 +103,7 @@ main(int argc, char *argv[])
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_ibc_attr, rkey);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_ibc_attr, raddr);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_ibc_attr, nlanes);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_ibc_attr, nconns);
 	ASSERT_ALIGNED_CHECK(struct rpmem_msg_ibc_attr);
 
 	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_pool_desc);
@@ -116,6 +117,7 @@ main(int argc, char *argv[])
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, pool_size);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, nlanes);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, provider);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, nconns);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, pool_attr);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_create, pool_desc);
 	ASSERT_ALIGNED_CHECK(struct rpmem_msg_create);
@@ -132,6 +134,7 @@ main(int argc, char *argv[])
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_open, pool_size);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_open, nlanes);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_open, provider);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_open, nconns);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_open, pool_desc);
 	ASSERT_ALIGNED_CHECK(struct rpmem_msg_open);
 
@@ -160,10 +163,27 @@ main(int argc, char *argv[])
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_close_resp, hdr);
 	ASSERT_ALIGNED_CHECK(struct rpmem_msg_close_resp);
 
+	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_checksum);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum, hdr);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum, offset);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum, len);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum, blk_size);
+	ASSERT_ALIGNED_CHECK(struct rpmem_msg_checksum);
+
+	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_checksum_resp);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum_resp, hdr);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_checksum_resp, nsums);
+	ASSERT_ALIGNED_CHECK(struct rpmem_msg_checksum_resp);
+
+	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_persist_range);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist_range, addr);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist_range, size);
+	ASSERT_ALIGNED_CHECK(struct rpmem_msg_persist_range);
+
 	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_persist);
 	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist, lane);
-	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist, addr);
-	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist, size);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist, nranges);
+	ASSERT_ALIGNED_FIELD(struct rpmem_msg_persist, ranges);
 	ASSERT_ALIGNED_CHECK(struct rpmem_msg_persist);
 
 	ASSERT_ALIGNED_BEGIN(struct rpmem_msg_persist_resp);
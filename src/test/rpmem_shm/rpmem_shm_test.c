@@ -0,0 +1,347 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmem_shm_test.c -- tests for rpmem_shm and rpmemd_shm modules
+ *
+ * Both the client and rpmemd side run in the same process, the rpmemd
+ * side in a separate thread.
+ */
+#include <stdio.h>
+#include <netdb.h>
+#include <sys/mman.h>
+
+#include "unittest.h"
+#include "out.h"
+
+#include "rpmem_common.h"
+#include "rpmem_util.h"
+#include "rpmem_shm_common.h"
+#include "rpmem_shm.h"
+#include "rpmemd_shm.h"
+#include "rpmemd_log.h"
+#include "util.h"
+
+#define NLANES		8
+#define SIZE_PER_LANE	64
+#define COUNT_PER_LANE	256
+#define POOL_SIZE	(NLANES * SIZE_PER_LANE * COUNT_PER_LANE)
+#define POOL_OFF	(4096 + 128)	/* not page aligned on purpose */
+#define NTHREADS	2
+
+TEST_CASE_DECLARE(persist);
+TEST_CASE_DECLARE(persist_mt);
+TEST_CASE_DECLARE(read_pool);
+
+static char lpool[POOL_SIZE];
+
+/*
+ * server -- rpmemd side context
+ */
+struct server {
+	int fd;
+	void *map;
+	char *pool;
+	struct rpmemd_shm *shm;
+	struct rpmem_resp_attr resp;
+	pthread_t thread;
+};
+
+/*
+ * server_accept -- accept the client and start processing
+ */
+static void *
+server_accept(void *arg)
+{
+	struct server *srv = arg;
+
+	int ret = rpmemd_shm_accept(srv->shm);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmemd_shm_process_start(srv->shm);
+	UT_ASSERTeq(ret, 0);
+
+	return NULL;
+}
+
+/*
+ * server_start -- create the pool file, initialize the rpmemd side and
+ * wait for the client in a separate thread
+ */
+static void
+server_start(struct server *srv, const char *path, int drain)
+{
+	srv->fd = OPEN(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	FTRUNCATE(srv->fd, POOL_OFF + POOL_SIZE);
+
+	srv->map = MMAP(NULL, POOL_OFF + POOL_SIZE, PROT_READ | PROT_WRITE,
+			MAP_SHARED, srv->fd, 0);
+	srv->pool = (char *)srv->map + POOL_OFF;
+
+	struct rpmemd_shm_attr attr = {
+		.addr = srv->pool,
+		.size = POOL_SIZE,
+		.fd = srv->fd,
+		.fd_off = POOL_OFF,
+		.nlanes = NLANES,
+		.nthreads = NTHREADS,
+		.persist = pmem_persist,
+		.flush = drain ? pmem_flush : NULL,
+		.drain = drain ? pmem_drain : NULL,
+	};
+
+	enum rpmem_err err;
+	srv->shm = rpmemd_shm_init(&attr, &srv->resp, &err);
+	UT_ASSERTne(srv->shm, NULL);
+	UT_ASSERTeq(srv->resp.nlanes, NLANES);
+	UT_ASSERTeq(srv->resp.persist_method, RPMEM_PM_GPSPM);
+
+	PTHREAD_CREATE(&srv->thread, NULL, server_accept, srv);
+}
+
+/*
+ * client_close -- close the client
+ */
+static void
+client_close(struct rpmem_shm *shm)
+{
+	int ret = rpmem_shm_close(shm);
+	UT_ASSERTeq(ret, 0);
+
+	rpmem_shm_fini(shm);
+}
+
+/*
+ * server_stop -- stop processing, close the client and wait for
+ * the connection to be closed
+ */
+static void
+server_stop(struct server *srv, struct rpmem_shm *shm)
+{
+	int ret = rpmemd_shm_process_stop(srv->shm);
+	UT_ASSERTeq(ret, 0);
+
+	client_close(shm);
+
+	ret = rpmemd_shm_wait_close(srv->shm, -1);
+	UT_ASSERTeq(ret, 0);
+
+	ret = rpmemd_shm_close(srv->shm);
+	UT_ASSERTeq(ret, 0);
+
+	rpmemd_shm_fini(srv->shm);
+
+	MUNMAP(srv->map, POOL_OFF + POOL_SIZE);
+	CLOSE(srv->fd);
+}
+
+/*
+ * client_connect -- connect the client to the rpmemd side
+ */
+static struct rpmem_shm *
+client_connect(struct server *srv)
+{
+	char service[NI_MAXSERV];
+	int ret = snprintf(service, sizeof(service), "%u", srv->resp.port);
+	UT_ASSERT(ret > 0);
+
+	struct rpmem_shm_attr attr = {
+		.laddr = lpool,
+		.size = POOL_SIZE,
+		.nlanes = srv->resp.nlanes,
+	};
+
+	unsigned nlanes;
+	struct rpmem_shm *shm = rpmem_shm_init(service, &attr, &nlanes);
+	UT_ASSERTne(shm, NULL);
+	UT_ASSERTeq(nlanes, NLANES);
+
+	ret = rpmem_shm_connect(shm);
+	UT_ASSERTeq(ret, 0);
+
+	PTHREAD_JOIN(srv->thread, NULL);
+
+	return shm;
+}
+
+/*
+ * persist_arg -- arguments of the persist thread
+ */
+struct persist_arg {
+	struct rpmem_shm *shm;
+	unsigned lane;
+};
+
+/*
+ * persist_thread -- persist the lane's part of the pool in chunks
+ */
+static void *
+persist_thread(void *arg)
+{
+	struct persist_arg *args = arg;
+
+	for (unsigned i = 0; i < COUNT_PER_LANE; i++) {
+		size_t offset = (i * NLANES + args->lane) * SIZE_PER_LANE;
+		memset(&lpool[offset], (int)(offset / SIZE_PER_LANE) & 0xff,
+				SIZE_PER_LANE);
+
+		int ret = rpmem_shm_persist(args->shm, offset,
+				SIZE_PER_LANE, args->lane);
+		UT_ASSERTeq(ret, 0);
+	}
+
+	return NULL;
+}
+
+/*
+ * persist_common -- persist the pool using given number of lanes in
+ * parallel and check the rpmemd side got the data
+ */
+static void
+persist_common(const struct test_case *tc, int argc, char *argv[],
+	unsigned nlanes, int drain)
+{
+	if (argc < 1)
+		UT_FATAL("usage: %s <file>", tc->name);
+
+	struct server srv;
+	server_start(&srv, argv[0], drain);
+
+	struct rpmem_shm *shm = client_connect(&srv);
+
+	pthread_t threads[NLANES];
+	struct persist_arg args[NLANES];
+	for (unsigned i = 0; i < nlanes; i++) {
+		args[i].shm = shm;
+		args[i].lane = i;
+		PTHREAD_CREATE(&threads[i], NULL, persist_thread, &args[i]);
+	}
+
+	for (unsigned i = 0; i < nlanes; i++)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	for (size_t off = 0; off < POOL_SIZE; off += SIZE_PER_LANE) {
+		unsigned lane = (unsigned)(off / SIZE_PER_LANE) % NLANES;
+		if (lane >= nlanes)
+			continue;
+
+		UT_ASSERTeq(memcmp(&srv.pool[off], &lpool[off],
+				SIZE_PER_LANE), 0);
+	}
+
+	/* a range out of the pool must be rejected */
+	int ret = rpmem_shm_persist(shm, POOL_SIZE - SIZE_PER_LANE,
+			2 * SIZE_PER_LANE, 0);
+	UT_ASSERTne(ret, 0);
+	UT_ASSERTeq(errno, EINVAL);
+
+	server_stop(&srv, shm);
+}
+
+/*
+ * persist -- test case for persist operation using a single lane
+ */
+void
+persist(const struct test_case *tc, int argc, char *argv[])
+{
+	persist_common(tc, argc, argv, 1, 0);
+}
+
+/*
+ * persist_mt -- test case for persist operation using all lanes
+ * in parallel, with a single drain per batch of requests
+ */
+void
+persist_mt(const struct test_case *tc, int argc, char *argv[])
+{
+	persist_common(tc, argc, argv, NLANES, 1);
+}
+
+/*
+ * read_pool -- test case for read operation
+ */
+void
+read_pool(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: %s <file>", tc->name);
+
+	struct server srv;
+	server_start(&srv, argv[0], 0);
+
+	for (size_t i = 0; i < POOL_SIZE; i++)
+		srv.pool[i] = (char)i;
+
+	struct rpmem_shm *shm = client_connect(&srv);
+
+	char buff[SIZE_PER_LANE];
+	for (size_t off = 0; off < POOL_SIZE; off += SIZE_PER_LANE) {
+		int ret = rpmem_shm_read(shm, buff, SIZE_PER_LANE, off);
+		UT_ASSERTeq(ret, 0);
+		UT_ASSERTeq(memcmp(buff, &srv.pool[off], SIZE_PER_LANE), 0);
+	}
+
+	int ret = rpmem_shm_read(shm, buff, SIZE_PER_LANE, POOL_SIZE);
+	UT_ASSERTne(ret, 0);
+	UT_ASSERTeq(errno, EINVAL);
+
+	server_stop(&srv, shm);
+}
+
+/*
+ * test_cases -- available test cases
+ */
+static struct test_case test_cases[] = {
+	TEST_CASE(persist),
+	TEST_CASE(persist_mt),
+	TEST_CASE(read_pool),
+};
+
+#define NTESTS	(sizeof(test_cases) / sizeof(test_cases[0]))
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "rpmem_shm");
+	util_init();
+	out_init("rpmem_shm",
+		"RPMEM_LOG_LEVEL",
+		"RPMEM_LOG_FILE", 0, 0);
+	rpmemd_log_init("rpmemd", getenv("RPMEMD_LOG_FILE"), 0);
+	rpmemd_log_level = rpmemd_log_level_from_str(
+			getenv("RPMEMD_LOG_LEVEL"));
+	TEST_CASE_PROCESS(argc, argv, test_cases, NTESTS);
+
+	out_fini();
+	rpmemd_log_close();
+	DONE(NULL);
+}
@@ -58,7 +58,10 @@ static const char *config_print_fmt =
 "verify_pool_sets:\t%s\n"
 "port:\t\t\t%hu\n"
 "max_lanes:\t\t%" PRIu64 "\n"
-"log_level:\t\t%s\n";
+"log_level:\t\t%s\n"
+"busy_poll:\t\t%s\n"
+"poll_cpus:\t\t%s\n"
+"stats_interval:\t\t%" PRIu64 "\n";
 
 static inline const char *
 bool_to_str(bool v)
@@ -94,7 +97,10 @@ config_print(struct rpmemd_config *config)
 		verify_pool_sets_to_str(config),
 		config->port,
 		config->max_lanes,
-		rpmemd_log_level_to_str(config->log_level));
+		rpmemd_log_level_to_str(config->log_level),
+		bool_to_str(config->busy_poll),
+		config->poll_cpus ? config->poll_cpus : "none",
+		config->stats_interval);
 }
 
 int
@@ -343,6 +343,111 @@ fini:
 	return ret;
 }
 
+/*
+ * test_catalog_open -- (internal) create and open the pool set, check
+ * the result against the expected errno value
+ */
+static int
+test_catalog_open(struct rpmemd_db *db, const char *pool_desc, int err)
+{
+	struct rpmem_pool_attr attr;
+	struct rpmemd_db_pool *prp;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.major = 1;
+
+	prp = rpmemd_db_pool_create(db, pool_desc, 0, &attr);
+	if (prp == NULL) {
+		if (errno == err)
+			return 0;
+		FAILED_FUNC_PARAM("rpmemd_db_pool_create", pool_desc);
+		return -1;
+	}
+
+	if (err) {
+		UT_ERR("%s(): %s created unexpectedly", __func__, pool_desc);
+		rpmemd_db_pool_close(db, prp);
+		rpmemd_db_pool_remove(db, pool_desc);
+		return -1;
+	}
+
+	/* the pool set is in use */
+	int ret = -1;
+	if (rpmemd_db_pool_open(db, pool_desc, 0, &attr) != NULL ||
+			errno != EBUSY) {
+		UT_ERR("%s(): %s opened twice", __func__, pool_desc);
+		goto err_close;
+	}
+	if (rpmemd_db_pool_remove(db, pool_desc) == 0 || errno != EBUSY) {
+		UT_ERR("%s(): %s removed while open", __func__, pool_desc);
+		goto err_close;
+	}
+	ret = 0;
+
+err_close:
+	rpmemd_db_pool_close(db, prp);
+	if (rpmemd_db_pool_remove(db, pool_desc)) {
+		FAILED_FUNC_PARAM("rpmemd_db_pool_remove", pool_desc);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+/*
+ * test_catalog -- test the catalog of pool set files is kept up to date
+ */
+static int
+test_catalog(const char *root_dir, const char *pool_desc)
+{
+	const char *new_desc = "catalog.set";
+	char old_path[PATH_MAX];
+	char new_path[PATH_MAX];
+	struct rpmemd_db *db;
+	int ret = -1;
+
+	snprintf(old_path, PATH_MAX, "%s/%s", root_dir, pool_desc);
+	snprintf(new_path, PATH_MAX, "%s/%s", root_dir, new_desc);
+
+	db = rpmemd_db_init(root_dir, POOL_MODE);
+	if (db == NULL) {
+		FAILED_FUNC("rpmemd_db_init");
+		return -1;
+	}
+	if (rpmemd_db_check_dir(db)) {
+		FAILED_FUNC("rpmemd_db_check_dir");
+		goto fini;
+	}
+	if (rpmemd_db_watch_fd(db) < 0) {
+		FAILED_FUNC("rpmemd_db_watch_fd");
+		goto fini;
+	}
+
+	if (test_catalog_open(db, pool_desc, 0))
+		goto fini;
+	if (test_catalog_open(db, new_desc, ENOENT))
+		goto fini;
+
+	/* the pool set file is moved within the root directory */
+	RENAME(old_path, new_path);
+	rpmemd_db_update(db);
+
+	if (test_catalog_open(db, pool_desc, ENOENT))
+		goto err_rename;
+	if (test_catalog_open(db, new_desc, 0))
+		goto err_rename;
+
+	ret = 0;
+
+err_rename:
+	RENAME(new_path, old_path);
+	if (ret == 0)
+		ret = test_catalog_open(db, pool_desc, 0);
+fini:
+	rpmemd_db_fini(db);
+	return ret;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -371,6 +476,7 @@ main(int argc, char *argv[])
 	test_create_dual(root_dir, pool_desc[0], pool_desc[1]);
 	test_open(root_dir, pool_desc[0]);
 	test_open_dual(root_dir, pool_desc[0], pool_desc[1]);
+	test_catalog(root_dir, pool_desc[1]);
 
 	rpmemd_log_close();
 
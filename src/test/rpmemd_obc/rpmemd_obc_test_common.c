@@ -203,6 +203,39 @@ req_cb_remove(struct rpmemd_obc_client *client, void *arg,
 	return ret;
 }
 
+/*
+ * req_cb_checksum -- callback for checksum request operation
+ *
+ * This function behaves according to arguments specified via
+ * struct req_cb_arg.
+ */
+static int
+req_cb_checksum(struct rpmemd_obc_client *client, void *arg,
+		size_t offset, size_t len, size_t blk_size)
+{
+	UT_ASSERTne(arg, NULL);
+	UT_ASSERTne(blk_size, 0);
+
+	struct req_cb_arg *args = arg;
+
+	args->types |= (1 << RPMEM_MSG_TYPE_CHECKSUM);
+
+	int ret = args->ret;
+
+	if (args->resp) {
+		size_t nsums = (len - 1) / blk_size + 1;
+		uint64_t *sums = ZALLOC(nsums * sizeof(*sums));
+		ret = rpmemd_obc_client_checksum_resp(client, args->status,
+				sums, nsums);
+		FREE(sums);
+	}
+
+	if (args->force_ret)
+		ret = args->ret;
+
+	return ret;
+}
+
 /*
  * REQ_CB -- request callbacks
  */
@@ -211,6 +244,7 @@ struct rpmemd_obc_client_requests REQ_CB = {
 	.open = req_cb_open,
 	.close = req_cb_close,
 	.remove = req_cb_remove,
+	.checksum = req_cb_checksum,
 };
 
 /*
@@ -338,7 +338,7 @@ main(int argc, char *argv[])
 
 	/* init btt in requested area */
 	struct btt *bttp = btt_init(opts.poolsize - BTT_CREATE_DEF_OFFSET_SIZE,
-		opts.blocksize, opts.uuid, opts.maxlanes,
+		opts.blocksize, opts.uuid, opts.maxlanes, 0,
 		(void *)&btt_context,
 		&btt_ns_callback);
 	if (!bttp) {
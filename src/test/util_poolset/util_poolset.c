@@ -66,9 +66,12 @@ void out_fini(void);
  * poolset_info -- (internal) dumps poolset info and checks its integrity
  *
  * Performs the following checks:
- * - part_size[i] == rounddown(file_size - pool_hdr_size, Pagesize)
+ * - part_size[i] == rounddown(file_size - data_off, Pagesize)
  * - replica_size == sum(part_size)
  * - pool_size == min(replica_size)
+ * - replica is mapped with pages of the requested alignment
+ *
+ * where data_off is the pool set alignment or the pool header size.
  */
 static void
 poolset_info(const char *fname, struct pool_set *set, int o)
@@ -83,6 +86,7 @@ poolset_info(const char *fname, struct pool_set *set, int o)
 			set->zeroed);
 
 	size_t poolsize = SIZE_MAX;
+	size_t data_off = set->alignment ? set->alignment : POOL_HDR_SIZE;
 
 	for (int r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
@@ -91,6 +95,14 @@ poolset_info(const char *fname, struct pool_set *set, int o)
 		UT_OUT("  replica[%d]: nparts %d repsize %zu is_pmem %d",
 			r, rep->nparts, rep->repsize, rep->is_pmem);
 
+		if (set->alignment) {
+			UT_OUT("  replica[%d]: alignment %zu pagesize %zu",
+				r, set->alignment, rep->pagesize);
+			UT_ASSERTeq((uintptr_t)rep->part[0].addr %
+				set->alignment, 0);
+			UT_ASSERTeq(rep->pagesize, set->alignment);
+		}
+
 		for (int i = 0; i < rep->nparts; i++) {
 			struct pool_set_part *part = &rep->part[i];
 			UT_OUT("    part[%d] path %s filesize %zu size %zu",
@@ -99,10 +111,10 @@ poolset_info(const char *fname, struct pool_set *set, int o)
 			repsize += partsize;
 			if (i > 0)
 				UT_ASSERTeq(part->size,
-					partsize - POOL_HDR_SIZE);
+					partsize - data_off);
 		}
 
-		repsize -= (rep->nparts - 1) * POOL_HDR_SIZE;
+		repsize -= (rep->nparts - 1) * data_off;
 		UT_ASSERTeq(rep->repsize, repsize);
 		UT_ASSERTeq(rep->part[0].size, repsize);
 
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * vmem_ctl.c -- unit test for vmem_create_with_attr and vmem_ctl
+ *
+ * usage: vmem_ctl [a|d] directory
+ *
+ * a - create the pool with tuned attributes
+ * d - create the pool with the default attributes
+ */
+
+#include <stdbool.h>
+#include "unittest.h"
+
+#define POOL_SIZE (32 * 1024 * 1024)
+#define NTHREADS 4
+#define NALLOCS 1000
+#define ALLOC_SIZE 128
+
+static VMEM *Vmp;
+
+/*
+ * worker -- allocate and free from many threads at once
+ */
+static void *
+worker(void *arg)
+{
+	void *ptrs[NALLOCS];
+
+	for (int i = 0; i < NALLOCS; ++i) {
+		ptrs[i] = vmem_malloc(Vmp, ALLOC_SIZE);
+		UT_ASSERTne(ptrs[i], NULL);
+		memset(ptrs[i], i & 0xff, ALLOC_SIZE);
+	}
+
+	for (int i = 0; i < NALLOCS; ++i)
+		vmem_free(Vmp, ptrs[i]);
+
+	return NULL;
+}
+
+/*
+ * run_workers -- exercise the pool from NTHREADS threads
+ */
+static void
+run_workers(void)
+{
+	pthread_t threads[NTHREADS];
+
+	for (int t = 0; t < NTHREADS; ++t)
+		PTHREAD_CREATE(&threads[t], NULL, worker, NULL);
+
+	for (int t = 0; t < NTHREADS; ++t)
+		PTHREAD_JOIN(threads[t], NULL);
+}
+
+/*
+ * print_settings -- print the current tuning of the pool
+ */
+static void
+print_settings(void)
+{
+	unsigned narenas;
+	ssize_t lg_dirty_mult;
+	bool tcache;
+	bool numa;
+	size_t len;
+
+	len = sizeof(narenas);
+	UT_ASSERTeq(vmem_ctl(Vmp, "arenas.narenas", &narenas, &len, NULL, 0),
+			0);
+	len = sizeof(lg_dirty_mult);
+	UT_ASSERTeq(vmem_ctl(Vmp, "arenas.lg_dirty_mult", &lg_dirty_mult, &len,
+			NULL, 0), 0);
+	len = sizeof(tcache);
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.enabled", &tcache, &len, NULL, 0),
+			0);
+	len = sizeof(numa);
+	UT_ASSERTeq(vmem_ctl(Vmp, "arenas.numa", &numa, &len, NULL, 0), 0);
+
+	UT_OUT("narenas %u lg_dirty_mult %zd tcache %d numa %d",
+			narenas, lg_dirty_mult, tcache, numa);
+}
+
+/*
+ * test_tuned -- pool created with non-default attributes
+ */
+static void
+test_tuned(const char *dir)
+{
+	struct vmem_attr attr;
+	vmem_attr_init(&attr);
+	attr.narenas = 2;
+	attr.tcache = 0;
+	attr.lg_dirty_mult = -1;
+	attr.numa = 1;
+
+	Vmp = vmem_create_with_attr(dir, POOL_SIZE, &attr);
+	if (Vmp == NULL)
+		UT_FATAL("!vmem_create_with_attr");
+
+	print_settings();
+	run_workers();
+
+	/* re-enable purging at runtime and purge all arenas */
+	ssize_t lg_dirty_mult = 5;
+	UT_ASSERTeq(vmem_ctl(Vmp, "arenas.lg_dirty_mult", NULL, NULL,
+			&lg_dirty_mult, sizeof(lg_dirty_mult)), 0);
+	UT_ASSERTeq(vmem_ctl(Vmp, "arena.2.purge", NULL, NULL, NULL, 0), 0);
+	print_settings();
+
+	/* out of range purge threshold */
+	lg_dirty_mult = -2;
+	UT_ASSERTeq(vmem_ctl(Vmp, "arenas.lg_dirty_mult", NULL, NULL,
+			&lg_dirty_mult, sizeof(lg_dirty_mult)), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	vmem_delete(Vmp);
+
+	/* invalid attributes fail the pool creation */
+	void *mem = MMAP_ANON_ALIGNED(VMEM_MIN_POOL, 4 << 20);
+	vmem_attr_init(&attr);
+	attr.lg_dirty_mult = 100;
+	errno = 0;
+	UT_ASSERTeq(vmem_create_in_region_with_attr(mem, VMEM_MIN_POOL, &attr),
+			NULL);
+	UT_ASSERTeq(errno, EINVAL);
+
+	/* the region can be reused after the failure */
+	vmem_attr_init(&attr);
+	Vmp = vmem_create_in_region_with_attr(mem, VMEM_MIN_POOL, &attr);
+	UT_ASSERTne(Vmp, NULL);
+	vmem_delete(Vmp);
+	MUNMAP_ANON_ALIGNED(mem, VMEM_MIN_POOL);
+}
+
+/*
+ * test_defaults -- pool created with the default attributes
+ */
+static void
+test_defaults(const char *dir)
+{
+	struct vmem_attr attr;
+	vmem_attr_init(&attr);
+
+	UT_OUT("attr narenas %u tcache %d tcache_max %zu lg_dirty_mult %zd "
+			"numa %d", attr.narenas, attr.tcache, attr.tcache_max,
+			attr.lg_dirty_mult, attr.numa);
+
+	Vmp = vmem_create_with_attr(dir, POOL_SIZE, &attr);
+	if (Vmp == NULL)
+		UT_FATAL("!vmem_create_with_attr");
+
+	size_t tcache_max;
+	size_t len = sizeof(tcache_max);
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.max", &tcache_max, &len, NULL, 0),
+			0);
+	UT_ASSERTne(tcache_max, 0);
+
+	/* the limit cannot exceed the allocator-wide one */
+	size_t too_big = tcache_max + 1;
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.max", NULL, NULL,
+			&too_big, sizeof(too_big)), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	/* cache small size classes only */
+	size_t small = 4096;
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.max", NULL, NULL,
+			&small, sizeof(small)), 0);
+	len = sizeof(tcache_max);
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.max", &tcache_max, &len, NULL, 0),
+			0);
+	UT_ASSERTeq(tcache_max, small);
+
+	run_workers();
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.flush", NULL, NULL, NULL, 0), 0);
+
+	/* disabling thread caches at runtime */
+	bool tcache = false;
+	UT_ASSERTeq(vmem_ctl(Vmp, "tcache.enabled", NULL, NULL,
+			&tcache, sizeof(tcache)), 0);
+	run_workers();
+
+	UT_ASSERTeq(vmem_ctl(Vmp, "no.such.entry", NULL, NULL, NULL, 0), -1);
+	UT_ASSERTeq(errno, ENOENT);
+
+	UT_ASSERTeq(vmem_check(Vmp), 1);
+	vmem_delete(Vmp);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmem_ctl");
+
+	if (argc < 3 || strchr("ad", argv[1][0]) == NULL)
+		UT_FATAL("usage: %s [a|d] directory", argv[0]);
+
+	if (argv[1][0] == 'a')
+		test_tuned(argv[2]);
+	else
+		test_defaults(argv[2]);
+
+	DONE(NULL);
+}
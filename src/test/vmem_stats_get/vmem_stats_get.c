@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * vmem_stats_get.c -- unit test for the vmem_stats_* functions
+ *
+ * usage: vmem_stats_get directory
+ */
+
+#include "unittest.h"
+
+#define POOL_SIZE (32 * 1024 * 1024)
+#define NTHREADS 4
+#define NALLOCS 1000
+#define ALLOC_SIZE 128
+
+static VMEM *Vmp;
+
+/*
+ * find_class -- return the index of the size class of the given size
+ */
+static unsigned
+find_class(unsigned nclasses, size_t size)
+{
+	struct vmem_stats_class cstats;
+
+	for (unsigned i = 0; i < nclasses; ++i) {
+		UT_ASSERTeq(vmem_stats_class_get(Vmp, i, &cstats), 0);
+		if (cstats.size == size)
+			return i;
+	}
+
+	UT_FATAL("no size class for %zu", size);
+}
+
+/*
+ * worker -- allocate and free from many threads at once
+ */
+static void *
+worker(void *arg)
+{
+	void *ptrs[NALLOCS];
+
+	for (int i = 0; i < NALLOCS; ++i) {
+		ptrs[i] = vmem_malloc(Vmp, ALLOC_SIZE);
+		UT_ASSERTne(ptrs[i], NULL);
+	}
+
+	for (int i = 0; i < NALLOCS; ++i)
+		vmem_free(Vmp, ptrs[i]);
+
+	return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmem_stats_get");
+
+	if (argc < 2)
+		UT_FATAL("usage: %s directory", argv[0]);
+
+	/* no thread caches, so that every allocation hits the arenas */
+	struct vmem_attr attr;
+	vmem_attr_init(&attr);
+	attr.narenas = 2;
+	attr.tcache = 0;
+
+	Vmp = vmem_create_with_attr(argv[1], POOL_SIZE, &attr);
+	if (Vmp == NULL)
+		UT_FATAL("!vmem_create_with_attr");
+
+	struct vmem_stats stats;
+	UT_ASSERTeq(vmem_stats_refresh(Vmp), 0);
+	UT_ASSERTeq(vmem_stats_get(Vmp, &stats), 0);
+	UT_ASSERTeq(stats.narenas, 2);
+	UT_ASSERTne(stats.nclasses, 0);
+	unsigned idx = find_class(stats.nclasses, ALLOC_SIZE);
+
+	void *ptrs[NALLOCS];
+	for (int i = 0; i < NALLOCS; ++i) {
+		ptrs[i] = vmem_malloc(Vmp, ALLOC_SIZE);
+		UT_ASSERTne(ptrs[i], NULL);
+	}
+
+	UT_ASSERTeq(vmem_stats_refresh(Vmp), 0);
+	UT_ASSERTeq(vmem_stats_get(Vmp, &stats), 0);
+	UT_ASSERT(stats.allocated >= NALLOCS * ALLOC_SIZE);
+	UT_ASSERT(stats.active >= stats.allocated);
+	UT_ASSERT(stats.resident >= stats.active);
+	UT_ASSERT(stats.mapped >= stats.active);
+
+	struct vmem_stats_class cstats;
+	UT_ASSERTeq(vmem_stats_class_get(Vmp, idx, &cstats), 0);
+	UT_OUT("class %zu allocated %zu nmalloc %ju ndalloc %ju",
+			cstats.size, cstats.allocated,
+			(uintmax_t)cstats.nmalloc, (uintmax_t)cstats.ndalloc);
+
+	/* the arenas add up to the pool wide values */
+	size_t active = 0;
+	uint64_t ncontended = 0;
+	for (unsigned i = 0; i < stats.narenas; ++i) {
+		struct vmem_stats_arena astats;
+		UT_ASSERTeq(vmem_stats_arena_get(Vmp, i, &astats), 0);
+		active += astats.active;
+		ncontended += astats.ncontended;
+	}
+	UT_ASSERTeq(active, stats.active);
+	UT_ASSERT(ncontended <= stats.ncontended);
+
+	for (int i = 0; i < NALLOCS; ++i)
+		vmem_free(Vmp, ptrs[i]);
+
+	/* the values do not change until the next refresh */
+	struct vmem_stats snapshot;
+	UT_ASSERTeq(vmem_stats_get(Vmp, &snapshot), 0);
+	UT_ASSERTeq(snapshot.allocated, stats.allocated);
+
+	UT_ASSERTeq(vmem_stats_refresh(Vmp), 0);
+	UT_ASSERTeq(vmem_stats_class_get(Vmp, idx, &cstats), 0);
+	UT_OUT("class %zu allocated %zu nmalloc %ju ndalloc %ju",
+			cstats.size, cstats.allocated,
+			(uintmax_t)cstats.nmalloc, (uintmax_t)cstats.ndalloc);
+
+	/* contention counters only grow */
+	pthread_t threads[NTHREADS];
+	for (int t = 0; t < NTHREADS; ++t)
+		PTHREAD_CREATE(&threads[t], NULL, worker, NULL);
+	for (int t = 0; t < NTHREADS; ++t)
+		PTHREAD_JOIN(threads[t], NULL);
+
+	UT_ASSERTeq(vmem_stats_refresh(Vmp), 0);
+	UT_ASSERTeq(vmem_stats_get(Vmp, &snapshot), 0);
+	UT_ASSERT(snapshot.ncontended >= stats.ncontended);
+	UT_ASSERTeq(vmem_stats_class_get(Vmp, idx, &cstats), 0);
+	UT_ASSERTeq(cstats.nmalloc, (NTHREADS + 1) * NALLOCS);
+	UT_ASSERTeq(cstats.allocated, 0);
+
+	/* out of range indexes */
+	UT_ASSERTeq(vmem_stats_class_get(Vmp, stats.nclasses, &cstats), -1);
+	UT_ASSERTeq(errno, EINVAL);
+	struct vmem_stats_arena astats;
+	UT_ASSERTeq(vmem_stats_arena_get(Vmp, stats.narenas, &astats), -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	vmem_delete(Vmp);
+
+	DONE(NULL);
+}
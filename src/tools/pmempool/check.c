@@ -64,6 +64,8 @@ struct pmempool_check {
 	char *backup_fname;	/* backup file name */
 	bool exec;		/* do execute */
 	char ans;		/* default answer on all questions or '?' */
+	unsigned jobs;		/* number of threads, 0 means one per CPU */
+	char *checkpoint_fname;	/* check progress file name */
 };
 
 /*
@@ -78,6 +80,8 @@ static const struct pmempool_check pmempool_check_default = {
 	.advanced	= false,
 	.exec		= true,
 	.ans		= '?',
+	.jobs		= 0,
+	.checkpoint_fname = NULL,
 };
 
 /*
@@ -92,6 +96,9 @@ static const char *help_str =
 "  -N, --no-exec        don't execute, just show what would be done\n"
 "  -b, --backup <file>  create backup of a pool file before executing\n"
 "  -a, --advanced       perform advanced repairs\n"
+"  -j, --jobs <num>     number of threads checking the pool\n"
+"  -c, --checkpoint <file>\n"
+"                       save progress to and resume the check from file\n"
 "  -q, --quiet          be quiet and don't print any messages\n"
 "  -v, --verbose        increase verbosity level\n"
 "  -h, --help           display this help and exit\n"
@@ -108,6 +115,8 @@ static const struct option long_options[] = {
 	{"no-exec",	no_argument,		0,	'N'},
 	{"backup",	required_argument,	0,	'b'},
 	{"advanced",	no_argument,		0,	'a'},
+	{"jobs",	required_argument,	0,	'j'},
+	{"checkpoint",	required_argument,	0,	'c'},
 	{"quiet",	no_argument,		0,	'q'},
 	{"verbose",	no_argument,		0,	'v'},
 	{"help",	no_argument,		0,	'h'},
@@ -151,7 +160,8 @@ pmempool_check_parse_args(struct pmempool_check *pcp, char *appname,
 		int argc, char *argv[])
 {
 	int opt;
-	while ((opt = getopt_long(argc, argv, "ahvrNb:qy",
+	char c;
+	while ((opt = getopt_long(argc, argv, "ahvrNb:qyj:c:",
 			long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'r':
@@ -170,6 +180,17 @@ pmempool_check_parse_args(struct pmempool_check *pcp, char *appname,
 		case 'a':
 			pcp->advanced = true;
 			break;
+		case 'j':
+			if (sscanf(optarg, "%u%c", &pcp->jobs, &c) != 1 ||
+					pcp->jobs == 0) {
+				outv_err("invalid number of jobs -- '%s'\n",
+					optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'c':
+			pcp->checkpoint_fname = optarg;
+			break;
 		case 'q':
 			pcp->verbose = 0;
 			break;
@@ -255,6 +276,13 @@ pmempool_check_perform(struct pmempool_check *pc)
 	if (ppc == NULL)
 		return CHECK_RESULT_ERROR;
 
+	if (pmempool_check_set_threads(ppc, pc->jobs) ||
+			pmempool_check_set_checkpoint(ppc,
+			pc->checkpoint_fname)) {
+		pmempool_check_end(ppc);
+		return CHECK_RESULT_ERROR;
+	}
+
 	struct pmempool_check_status *status = NULL;
 	while ((status = pmempool_check(ppc)) != NULL) {
 		switch (status->type) {
@@ -35,17 +35,38 @@
  */
 
 #include <stdio.h>
-#include <libgen.h>
 #include <string.h>
-#include <unistd.h>
+#include <inttypes.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <getopt.h>
-#include <stdbool.h>
-#include <sys/mman.h>
+
 #include "common.h"
+#include "output.h"
 #include "convert.h"
-
-static const char *help_str = "";
+#include "libpmempool.h"
+
+/* verbosity level */
+static int vlevel = 1;
+
+/* help message */
+static const char *help_str =
+"Convert a pool to the latest available layout version\n"
+"\n"
+"Available options:\n"
+"  -v, --verbose      Be verbose.\n"
+"  -h, --help         Print this help message.\n"
+"\n"
+"For complete documentation see %s-convert(1) manual page.\n";
+
+/* short options string */
+static const char *optstr = "vh";
+/* long options */
+static const struct option long_options[] = {
+	{"verbose",	no_argument,		0, 'v'},
+	{"help",	no_argument,		0, 'h'},
+	{NULL,		0,			0,  0 },
+};
 
 /*
  * print_usage -- print application usage short description
@@ -53,7 +74,7 @@ static const char *help_str = "";
 static void
 print_usage(char *appname)
 {
-	printf("Usage: %s convert <file>\n", appname);
+	printf("Usage: %s convert [<args>] <file>\n", appname);
 }
 
 /*
@@ -76,80 +97,64 @@ pmempool_convert_help(char *appname)
 	printf(help_str, appname);
 }
 
-typedef int (*convert_func)(void *addr);
-
-/*
- * Collection of pool converting functions. Each array index is used as a
- * source version.
- */
-static convert_func version_convert[] = {
-	NULL, /* from version 0 to version 1 - does not exist */
-	convert_v1_v2, /* from v1 to v2 */
-};
-
 /*
  * pmempool_convert_func -- main function for convert command
  */
 int
 pmempool_convert_func(char *appname, int argc, char *argv[])
 {
-	if (argc != 2) {
-		print_usage(appname);
+	int opt;
+	while ((opt = getopt_long(argc, argv, optstr,
+			long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'v':
+			vlevel++;
+			break;
+		case 'h':
+			pmempool_convert_help(appname);
+			return 0;
+		default:
+			print_usage(appname);
+			return -1;
+		}
+	}
+
+	out_set_vlevel(vlevel);
 
+	if (optind + 1 != argc) {
+		print_usage(appname);
 		return -1;
 	}
 
-	int ret = 0;
-	const char *f = argv[1];
+	const char *f = argv[optind];
 
 	printf("This tool will update the pool to the latest available "
-		"layout version.\nThis process is NOT fail-safe.\n"
-		"Proceed only if the pool has been backed up or\n"
-		"the risks are fully understood and acceptable.\n");
+		"layout version.\nThe conversion interrupted for any reason "
+		"is resumed by running\nthe tool again, but the pool cannot "
+		"be used until the conversion completes.\n");
 	if (ask_Yn('?', "convert the pool '%s' ?", f) != 'y') {
 		return 0;
 	}
 
-	struct pool_set_file *psf = pool_set_file_open(f, 0, 0);
-
-	if (psf == NULL) {
-		perror(f);
-
+	struct pmempool_convert_stats stats;
+	if (pmempool_convert(f, &stats)) {
+		outv_err("cannot convert '%s': %s\n", f, strerror(errno));
 		return -1;
 	}
-	void *addr = pool_set_file_map(psf, 0);
-	if (addr == NULL) {
-		perror(f);
-		ret = -1;
-		goto out;
-	}
-
-	struct pool_hdr *phdr = addr;
-	if (memcmp(phdr->signature, OBJ_HDR_SIG, POOL_HDR_SIG_LEN) != 0) {
-		fprintf(stderr, "Conversion is currently supported only for"
-				"pmemobj pools\n");
-		ret = -1;
-		goto out;
-	}
-
-	uint32_t m = le32toh(phdr->major);
-	if (m >= COUNT_OF(version_convert) || !version_convert[m]) {
-		fprintf(stderr, "There's no conversion method for the pool.\n"
-				"Please make sure the pmempool utility"
-				"is up-to-date.\n");
-		ret = -1;
-		goto out;
-	}
-
-	PMEMobjpool *pop = addr;
-
-	if (version_convert[m](pop) != 0)
-		fprintf(stderr, "Failed to convert the pool\n");
-
-	msync(pop, psf->size, 0);
-
-out:
-	pool_set_file_close(psf);
 
-	return ret;
+	if (stats.nrolled_back)
+		outv(2, "interrupted conversion resumed, %u step(s) rolled "
+			"back\n", stats.nrolled_back);
+
+	double secs = (double)stats.nsecs / 1e9;
+	outv(2, "converted '%s' from version %u to %u: %u step(s), %" PRIu64
+		" bytes rewritten, %" PRIu64 " bytes journaled in %.3f s",
+		f, stats.from_major, stats.to_major, stats.nsteps,
+		stats.bytes, stats.journal_bytes, secs);
+	if (secs > 0)
+		outv(2, " (%.1f MB/s)", (double)stats.bytes / secs /
+			(1 << 20));
+	outv(2, "\n");
+
+	return 0;
 }
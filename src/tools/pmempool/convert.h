@@ -36,4 +36,3 @@
 
 int pmempool_convert_func(char *appname, int argc, char *argv[]);
 void pmempool_convert_help(char *appname);
-int convert_v1_v2(void *addr);
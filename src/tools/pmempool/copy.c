@@ -0,0 +1,156 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * copy.c -- pmempool copy command main source file
+ */
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "common.h"
+#include "output.h"
+#include "copy.h"
+#include "libpmempool.h"
+
+/* verbosity level */
+static int vlevel = 1;
+/* number of threads, 0 means one per online CPU */
+static unsigned jobs;
+/* copy whole pool */
+static int full;
+
+/* help message */
+static const char *help_str =
+"Copy a pool to a new file\n"
+"\n"
+"Available options:\n"
+"  -j, --jobs <num>   Number of threads copying the pool.\n"
+"  -f, --full         Copy regions not holding any data as well.\n"
+"  -q, --quiet        Be quiet and don't print any messages.\n"
+"  -v, --verbose      Be verbose.\n"
+"  -h, --help         Print this help message.\n"
+"\n"
+"For complete documentation see %s-copy(1) manual page.\n";
+
+/* short options string */
+static const char *optstr = "j:fqvh";
+/* long options */
+static const struct option long_options[] = {
+	{"jobs",	required_argument,	0, 'j'},
+	{"full",	no_argument,		0, 'f'},
+	{"quiet",	no_argument,		0, 'q'},
+	{"verbose",	no_argument,		0, 'v'},
+	{"help",	no_argument,		0, 'h'},
+	{NULL,		0,			0,  0 },
+};
+
+/*
+ * print_usage -- print usage message
+ */
+static void
+print_usage(const char *appname)
+{
+	printf("Usage: %s copy [<args>] <file> <dest>\n", appname);
+}
+
+/*
+ * pmempool_copy_help -- print help message
+ */
+void
+pmempool_copy_help(char *appname)
+{
+	print_usage(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * pmempool_copy_func -- main function for copy command
+ */
+int
+pmempool_copy_func(char *appname, int argc, char *argv[])
+{
+	int opt;
+	char c;
+	while ((opt = getopt_long(argc, argv, optstr,
+			long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'j':
+			if (sscanf(optarg, "%u%c", &jobs, &c) != 1 ||
+					jobs == 0) {
+				outv_err("invalid number of jobs -- '%s'\n",
+					optarg);
+				return -1;
+			}
+			break;
+		case 'f':
+			full = 1;
+			break;
+		case 'q':
+			vlevel = 0;
+			break;
+		case 'v':
+			vlevel++;
+			break;
+		case 'h':
+			pmempool_copy_help(appname);
+			return 0;
+		default:
+			print_usage(appname);
+			return -1;
+		}
+	}
+
+	out_set_vlevel(vlevel);
+
+	if (optind + 2 != argc) {
+		print_usage(appname);
+		return -1;
+	}
+
+	const char *src = argv[optind];
+	const char *dst = argv[optind + 1];
+	unsigned flags = full ? 0 : PMEMPOOL_COPY_SPARSE;
+
+	if (pmempool_copy(src, dst, jobs, flags)) {
+		outv_err("cannot copy '%s' to '%s': %s\n", src, dst,
+			strerror(errno));
+		return -1;
+	}
+
+	outv(2, "copied '%s' to '%s'\n", src, dst);
+
+	return 0;
+}
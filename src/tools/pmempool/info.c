@@ -108,6 +108,8 @@ static const struct pmempool_info_args pmempool_info_args_default = {
 		.ignore_empty_obj = false,
 		.chunk_types	= DEFAULT_CHUNK_TYPES,
 		.replica	= 0,
+		.jobs		= 0,
+		.sample		= 100,
 	},
 };
 
@@ -146,6 +148,8 @@ static const struct option long_options[] = {
 	{"chunk-type",	required_argument,	0, 'T' | OPT_OBJ},
 	{"bitmap",	no_argument,		0, 'b' | OPT_OBJ},
 	{"replica",	required_argument,	0, 'p' | OPT_OBJ},
+	{"jobs",	required_argument,	0, 'j' | OPT_OBJ},
+	{"sample",	required_argument,	0, 'P' | OPT_OBJ},
 	{NULL,		0,			0,  0 },
 };
 
@@ -241,6 +245,11 @@ static const struct option_requirement option_requirements[] = {
 		.type	= PMEM_POOL_TYPE_OBJ,
 		.req	= OPT_REQ0('O') | OPT_REQ1('o'),
 	},
+	{
+		.opt	= 'P',
+		.type	= PMEM_POOL_TYPE_OBJ,
+		.req	= OPT_REQ0('s'),
+	},
 	{ 0,  0, 0}
 };
 
@@ -296,6 +305,11 @@ static const char *help_str =
 "  -b, --bitmap                    Print chunk run's bitmap in graphical\n"
 "                                  format. [requires --chunks|-C]\n"
 "  -p, --replica <num>             Print info from specified replica\n"
+"  -j, --jobs <num>                Number of threads walking the heap\n"
+"                                  for statistics.\n"
+"  -P, --sample <percent>          Estimate objects' and allocation classes'\n"
+"                                  statistics from given percentage of\n"
+"                                  chunks. [requires --stats|-s]\n"
 "For complete documentation see %s-info(1) manual page.\n"
 ;
 
@@ -341,6 +355,7 @@ parse_args(char *appname, int argc, char *argv[],
 		struct options *opts)
 {
 	int opt;
+	char c;
 	if (argc == 1) {
 		print_usage(appname);
 
@@ -349,7 +364,7 @@ parse_args(char *appname, int argc, char *argv[],
 
 	struct ranges *rangesp = &argsp->ranges;
 	while ((opt = util_options_getopt(argc, argv,
-			"vhnf:ezuF:L:c:dmxVw:gBsr:lRS:OECZHT:bot:aAp:",
+			"vhnf:ezuF:L:c:dmxVw:gBsr:lRS:OECZHT:bot:aAp:j:P:",
 			opts)) != -1) {
 
 		switch (opt) {
@@ -495,6 +510,23 @@ parse_args(char *appname, int argc, char *argv[],
 			argsp->obj.replica = (size_t)ll;
 			break;
 		}
+		case 'j':
+			if (sscanf(optarg, "%u%c", &argsp->obj.jobs, &c) != 1 ||
+					argsp->obj.jobs == 0) {
+				outv_err("'%s' -- invalid number of jobs\n",
+						optarg);
+				return -1;
+			}
+			break;
+		case 'P':
+			if (sscanf(optarg, "%u%c", &argsp->obj.sample,
+					&c) != 1 || argsp->obj.sample == 0 ||
+					argsp->obj.sample > 100) {
+				outv_err("'%s' -- invalid percentage\n",
+						optarg);
+				return -1;
+			}
+			break;
 		default:
 			print_usage(appname);
 			return -1;
@@ -508,6 +540,12 @@ parse_args(char *appname, int argc, char *argv[],
 		return -1;
 	}
 
+	if (argsp->obj.sample < 100 &&
+			(argsp->obj.vobjects || argsp->obj.vheap)) {
+		outv_err("'-P' option cannot be used with '-O' nor '-H'\n");
+		return -1;
+	}
+
 	if (!argsp->use_range)
 		util_ranges_add(&argsp->ranges, ENTIRE_UINT64);
 
@@ -587,6 +625,9 @@ pmempool_info_pool_hdr(struct pmem_info *pip, int v)
 			" [part file]" : "");
 	outv_field(v, "Major", "%d", hdr->major);
 	outv_field(v, "Mandatory features", "0x%x", hdr->incompat_features);
+	if (hdr->incompat_features & POOL_FEAT_ALIGNMENT)
+		outv_field(v, "Alignment", "%s",
+			out_get_size_str(hdr->alignment, pip->args.human));
 	outv_field(v, "Not mandatory features", "0x%x", hdr->compat_features);
 	outv_field(v, "Forced RO", "0x%x", hdr->ro_compat_features);
 	outv_field(v, "Pool set UUID", "%s",
@@ -105,6 +105,8 @@ struct pmempool_info_args {
 		bool ignore_empty_obj;
 		uint64_t chunk_types;
 		size_t replica;
+		unsigned jobs;		/* threads walking the heap */
+		unsigned sample;	/* percentage of chunks inspected */
 		struct ranges lane_ranges;
 		struct ranges type_ranges;
 		struct ranges zone_ranges;
@@ -133,6 +135,8 @@ struct pmem_obj_zone_stats {
 	uint64_t size_chunks;
 	uint64_t size_chunks_type[MAX_CHUNK_TYPE];
 	struct pmem_obj_class_stats class_stats[MAX_CLASS_STATS];
+	uint64_t n_runs;
+	uint64_t n_runs_sampled;
 };
 
 struct pmem_obj_type_stats {
@@ -147,6 +151,8 @@ struct pmem_obj_stats {
 	uint64_t n_total_bytes;
 	uint64_t n_zones;
 	uint64_t n_zones_used;
+	uint64_t n_obj_chunks;
+	uint64_t n_obj_chunks_sampled;
 	struct pmem_obj_zone_stats *zone_stats;
 	TAILQ_HEAD(obj_type_stats_head, pmem_obj_type_stats) type_stats;
 };
@@ -42,8 +42,30 @@
 #include "output.h"
 #include "info.h"
 
+/*
+ * info_log_circular -- return true if the data area of a log wraps around
+ */
+static int
+info_log_circular(struct pmemlog *plp)
+{
+	return (le32toh(plp->hdr.incompat_features) &
+			LOG_FORMAT_INCOMPAT_CIRCULAR) != 0;
+}
+
+/*
+ * info_log_head -- return the offset of the oldest data in a log
+ */
+static uint64_t
+info_log_head(struct pmemlog *plp)
+{
+	return info_log_circular(plp) ? plp->head_offset : plp->start_offset;
+}
+
 /*
  * info_log_data -- print used data from log pool
+ *
+ * The data of a circular log wrapping around the end of the data area is
+ * gathered into a temporary buffer, so it can be printed as a whole.
  */
 static int
 info_log_data(struct pmem_info *pip, int v, struct pmemlog *plp)
@@ -51,18 +73,34 @@ info_log_data(struct pmem_info *pip, int v, struct pmemlog *plp)
 	if (!outv_check(v))
 		return 0;
 
-	uint64_t size_used = plp->write_offset - plp->start_offset;
+	uint64_t head_offset = info_log_head(plp);
+	uint64_t size_used = plp->write_offset - head_offset;
 
 	if (size_used == 0)
 		return 0;
 
-	uint8_t *addr = pool_set_file_map(pip->pfile, plp->start_offset);
-	if (addr == MAP_FAILED) {
+	uint8_t *data = pool_set_file_map(pip->pfile, plp->start_offset);
+	if (data == MAP_FAILED) {
 		warn("%s", pip->file_name);
 		outv_err("cannot read pmem log data\n");
 		return -1;
 	}
 
+	uint64_t size_data = plp->end_offset - plp->start_offset;
+	uint64_t first = (head_offset - plp->start_offset) % size_data;
+	uint8_t *addr = data + first;
+	uint8_t *buff = NULL;
+
+	if (size_used > size_data - first) {
+		buff = malloc(size_used);
+		if (!buff)
+			err(1, "Cannot allocate memory for pmemlog data");
+		memcpy(buff, addr, size_data - first);
+		memcpy(buff + size_data - first, data,
+				size_used - (size_data - first));
+		addr = buff;
+	}
+
 	if (pip->args.log.walk == 0) {
 		outv_title(v, "PMEMLOG data");
 		struct range *curp = NULL;
@@ -72,7 +110,7 @@ info_log_data(struct pmem_info *pip, int v, struct pmemlog *plp)
 				curp->last = size_used - 1;
 			uint64_t count = curp->last - curp->first + 1;
 			outv_hexdump(v, ptr, count, curp->first +
-					plp->start_offset, 1);
+					head_offset, 1);
 			size_used -= count;
 			if (!size_used)
 				break;
@@ -96,13 +134,15 @@ info_log_data(struct pmem_info *pip, int v, struct pmemlog *plp)
 				outv(v, "Chunk %10u:\n", i);
 				outv_hexdump(v, addr + i * pip->args.log.walk,
 					pip->args.log.walk,
-					plp->start_offset +
+					head_offset +
 					i * pip->args.log.walk,
 					1);
 			}
 		}
 	}
 
+	free(buff);
+
 	return 0;
 }
 
@@ -113,7 +153,7 @@ static void
 info_log_stats(struct pmem_info *pip, int v, struct pmemlog *plp)
 {
 	uint64_t size_total = plp->end_offset - plp->start_offset;
-	uint64_t size_used = plp->write_offset - plp->start_offset;
+	uint64_t size_used = plp->write_offset - info_log_head(plp);
 	uint64_t size_avail = size_total - size_used;
 
 	if (size_total == 0)
@@ -150,9 +190,20 @@ info_log_descriptor(struct pmem_info *pip, int v, struct pmemlog *plp)
 
 	pmemlog_convert2h(plp);
 
-	int write_offset_valid = plp->write_offset >= plp->start_offset &&
+	int write_offset_valid;
+	if (info_log_circular(plp)) {
+		write_offset_valid = plp->head_offset >= plp->start_offset &&
+				plp->write_offset >= plp->head_offset &&
+				plp->write_offset - plp->head_offset <=
+				plp->end_offset - plp->start_offset;
+	} else {
+		write_offset_valid = plp->write_offset >= plp->start_offset &&
 				plp->write_offset <= plp->end_offset;
+	}
+
 	outv_field(v, "Start offset", "0x%lx", plp->start_offset);
+	if (info_log_circular(plp))
+		outv_field(v, "Head offset", "0x%lx", plp->head_offset);
 	outv_field(v, "Write offset", "0x%lx [%s]", plp->write_offset,
 			write_offset_valid ? "OK":"ERROR");
 	outv_field(v, "End offset", "0x%lx", plp->end_offset);
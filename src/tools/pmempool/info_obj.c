@@ -37,6 +37,8 @@
 #include <stdbool.h>
 #include <err.h>
 #include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <assert.h>
@@ -759,13 +761,66 @@ info_obj_chunk(struct pmem_info *pip, uint64_t c,
 	}
 }
 
+/*
+ * info_obj_rand -- xorshift64* pseudo-random number generator
+ */
+static uint64_t
+info_obj_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+
+	return x * 2685821657736338717ULL;
+}
+
+/*
+ * info_obj_chunk_sample -- check if chunk should be inspected
+ *
+ * Only a part of chunks holding objects is inspected in sampling mode. The
+ * skipped huge chunks are still accounted for from their headers. The chunks
+ * are picked by generator seeded with zone id, so the results do not depend
+ * on the number of threads.
+ */
+static int
+info_obj_chunk_sample(struct pmem_info *pip, struct chunk_header *chdr,
+	uint64_t *rng, struct pmem_obj_zone_stats *stats)
+{
+	if (chdr->type != CHUNK_TYPE_USED && chdr->type != CHUNK_TYPE_RUN)
+		return 1;
+
+	pip->obj.stats.n_obj_chunks++;
+	if (chdr->type == CHUNK_TYPE_RUN)
+		stats->n_runs++;
+
+	if (pip->args.obj.sample < 100 &&
+			info_obj_rand(rng) % 100 >= pip->args.obj.sample) {
+		if (chdr->type == CHUNK_TYPE_USED) {
+			stats->class_stats[DEFAULT_BUCKET].n_units +=
+				chdr->size_idx;
+			stats->class_stats[DEFAULT_BUCKET].n_used +=
+				chdr->size_idx;
+		}
+		return 0;
+	}
+
+	pip->obj.stats.n_obj_chunks_sampled++;
+	if (chdr->type == CHUNK_TYPE_RUN)
+		stats->n_runs_sampled++;
+
+	return 1;
+}
+
 /*
  * info_obj_zone_chunks -- print chunk headers from specified zone
  */
 static void
-info_obj_zone_chunks(struct pmem_info *pip, struct zone *zone,
+info_obj_zone_chunks(struct pmem_info *pip, size_t zid, struct zone *zone,
 	struct pmem_obj_zone_stats *stats)
 {
+	uint64_t rng = (zid + 1) * 0x9E3779B97F4A7C15ULL;
 	uint64_t c = 0;
 	while (c < zone->header.size_idx) {
 		enum chunk_type type = zone->chunk_headers[c].type;
@@ -778,7 +833,11 @@ info_obj_zone_chunks(struct pmem_info *pip, struct zone *zone,
 				stats->size_chunks += size_idx;
 				stats->size_chunks_type[type] += size_idx;
 
-				info_obj_chunk(pip, c, &zone->chunk_headers[c],
+				if (info_obj_chunk_sample(pip,
+						&zone->chunk_headers[c], &rng,
+						stats))
+					info_obj_chunk(pip, c,
+						&zone->chunk_headers[c],
 						&zone->chunks[c], stats);
 
 			}
@@ -823,6 +882,198 @@ info_obj_root_obj(struct pmem_info *pip)
 	info_obj_object_hdr(pip, v, VERBOSE_SILENT, OBJH_TO_PTR(objh), 0);
 }
 
+/*
+ * info_obj_zone -- print zone and its chunks
+ */
+static void
+info_obj_zone(struct pmem_info *pip, struct heap_layout *layout, size_t i)
+{
+	struct zone *zone = ZID_TO_ZONE(layout, i);
+
+	if (!util_ranges_contain(&pip->args.obj.zone_ranges, i))
+		return;
+
+	int vvv = pip->args.obj.vheap &&
+		(pip->args.obj.vzonehdr ||
+		pip->args.obj.vchunkhdr);
+
+	outv_title(vvv, "Zone", "%lu", i);
+
+	if (zone->header.magic == ZONE_HEADER_MAGIC)
+		pip->obj.stats.n_zones_used++;
+
+	info_obj_zone_hdr(pip, pip->args.obj.vheap &&
+			pip->args.obj.vzonehdr,
+			&zone->header);
+
+	outv_indent(vvv, 1);
+	info_obj_zone_chunks(pip, i, zone, &pip->obj.stats.zone_stats[i]);
+	outv_indent(vvv, -1);
+}
+
+/*
+ * info_obj_zones_worker -- context of thread walking the heap
+ */
+struct info_obj_zones_worker {
+	pthread_t thread;
+	struct pmem_info pip;	/* copy with thread's own objects' stats */
+	struct heap_layout *layout;
+	size_t maxzone;
+	size_t *next;		/* next zone to walk */
+};
+
+/*
+ * info_obj_zones_thread -- walk zones until there are no more left
+ */
+static void *
+info_obj_zones_thread(void *arg)
+{
+	struct info_obj_zones_worker *w = arg;
+	size_t i;
+
+	while ((i = __sync_fetch_and_add(w->next, 1)) < w->maxzone)
+		info_obj_zone(&w->pip, w->layout, i);
+
+	return NULL;
+}
+
+/*
+ * info_obj_merge_stats -- move objects' stats gathered by thread to total
+ */
+static void
+info_obj_merge_stats(struct pmem_obj_stats *total,
+	struct pmem_obj_stats *stats)
+{
+	total->n_total_objects += stats->n_total_objects;
+	total->n_total_bytes += stats->n_total_bytes;
+	total->n_zones_used += stats->n_zones_used;
+	total->n_obj_chunks += stats->n_obj_chunks;
+	total->n_obj_chunks_sampled += stats->n_obj_chunks_sampled;
+
+	while (!TAILQ_EMPTY(&stats->type_stats)) {
+		struct pmem_obj_type_stats *type =
+			TAILQ_FIRST(&stats->type_stats);
+		TAILQ_REMOVE(&stats->type_stats, type, next);
+
+		struct pmem_obj_type_stats *ttype =
+			pmem_obj_stats_get_type(total, type->type_num);
+		ttype->n_objects += type->n_objects;
+		ttype->n_bytes += type->n_bytes;
+
+		free(type);
+	}
+}
+
+/*
+ * info_obj_zones_mt -- walk zones using multiple threads
+ *
+ * Used only if nothing but statistics is printed. Each zone is walked by
+ * a single thread which fills in the zone's stats, objects' stats are
+ * gathered per thread and merged at the end. Returns -1 if the threads
+ * cannot be started, in which case the heap is walked serially.
+ */
+static int
+info_obj_zones_mt(struct pmem_info *pip, struct heap_layout *layout,
+	size_t maxzone)
+{
+	unsigned nthreads = pip->args.obj.jobs;
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
+	}
+	nthreads = (unsigned)min(nthreads, maxzone);
+	if (nthreads < 2)
+		return -1;
+
+	struct info_obj_zones_worker *workers =
+		calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		return -1;
+
+	size_t next = 0;
+	unsigned started = 0;
+	for (; started < nthreads; started++) {
+		struct info_obj_zones_worker *w = &workers[started];
+		w->pip = *pip;
+		memset(&w->pip.obj.stats, 0, sizeof(w->pip.obj.stats));
+		w->pip.obj.stats.zone_stats = pip->obj.stats.zone_stats;
+		TAILQ_INIT(&w->pip.obj.stats.type_stats);
+		w->layout = layout;
+		w->maxzone = maxzone;
+		w->next = &next;
+
+		if (pthread_create(&w->thread, NULL, info_obj_zones_thread, w))
+			break;
+	}
+
+	if (started == 0) {
+		free(workers);
+		return -1;
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+		info_obj_merge_stats(&pip->obj.stats,
+				&workers[i].pip.obj.stats);
+	}
+
+	free(workers);
+
+	return 0;
+}
+
+/*
+ * info_obj_sample_scale -- scale value by number of inspected items
+ */
+static uint64_t
+info_obj_sample_scale(uint64_t val, uint64_t n, uint64_t n_sampled)
+{
+	if (!n_sampled)
+		return val;
+
+	return (uint64_t)((double)val * (double)n / (double)n_sampled + 0.5);
+}
+
+/*
+ * info_obj_sample_estimate -- estimate stats of chunks skipped by sampling
+ */
+static void
+info_obj_sample_estimate(struct pmem_info *pip)
+{
+	struct pmem_obj_stats *stats = &pip->obj.stats;
+	uint64_t n = stats->n_obj_chunks;
+	uint64_t n_sampled = stats->n_obj_chunks_sampled;
+
+	stats->n_total_objects = info_obj_sample_scale(stats->n_total_objects,
+			n, n_sampled);
+	stats->n_total_bytes = info_obj_sample_scale(stats->n_total_bytes,
+			n, n_sampled);
+
+	struct pmem_obj_type_stats *type;
+	TAILQ_FOREACH(type, &stats->type_stats, next) {
+		type->n_objects = info_obj_sample_scale(type->n_objects,
+				n, n_sampled);
+		type->n_bytes = info_obj_sample_scale(type->n_bytes,
+				n, n_sampled);
+	}
+
+	/* huge chunks are accounted for from headers, runs are sampled */
+	for (uint64_t i = 0; i < stats->n_zones; i++) {
+		struct pmem_obj_zone_stats *zstats = &stats->zone_stats[i];
+		for (int class = 0; class < MAX_CLASS_STATS; class++) {
+			if (class == DEFAULT_BUCKET)
+				continue;
+
+			struct pmem_obj_class_stats *cstats =
+				&zstats->class_stats[class];
+			cstats->n_units = info_obj_sample_scale(cstats->n_units,
+					zstats->n_runs, zstats->n_runs_sampled);
+			cstats->n_used = info_obj_sample_scale(cstats->n_used,
+					zstats->n_runs, zstats->n_runs_sampled);
+		}
+	}
+}
+
 /*
  * info_obj_zones -- print zones and chunks
  */
@@ -843,29 +1094,18 @@ info_obj_zones_chunks(struct pmem_info *pip)
 	if (!pip->obj.stats.zone_stats)
 		err(1, "Cannot allocate memory for zone stats");
 
-	for (size_t i = 0; i < maxzone; i++) {
-		struct zone *zone = ZID_TO_ZONE(layout, i);
-
-		if (util_ranges_contain(&pip->args.obj.zone_ranges, i)) {
-			int vvv = pip->args.obj.vheap &&
-				(pip->args.obj.vzonehdr ||
-				pip->args.obj.vchunkhdr);
-
-			outv_title(vvv, "Zone", "%lu", i);
+	/* objects are numbered in order, so they must be walked serially */
+	int serial = outv_check(pip->args.obj.vheap) ||
+		outv_check(pip->args.obj.vobjects) ||
+		pip->args.use_range;
 
-			if (zone->header.magic == ZONE_HEADER_MAGIC)
-				pip->obj.stats.n_zones_used++;
-
-			info_obj_zone_hdr(pip, pip->args.obj.vheap &&
-					pip->args.obj.vzonehdr,
-					&zone->header);
-
-			outv_indent(vvv, 1);
-			info_obj_zone_chunks(pip, zone,
-					&pip->obj.stats.zone_stats[i]);
-			outv_indent(vvv, -1);
-		}
+	if (serial || info_obj_zones_mt(pip, layout, maxzone)) {
+		for (size_t i = 0; i < maxzone; i++)
+			info_obj_zone(pip, layout, i);
 	}
+
+	if (pip->args.obj.sample < 100)
+		info_obj_sample_estimate(pip);
 }
 
 /*
@@ -1122,6 +1362,15 @@ info_obj_stats(struct pmem_info *pip)
 
 	outv_title(v, "Statistics");
 
+	if (pip->args.obj.sample < 100) {
+		uint64_t n = stats->n_obj_chunks;
+		uint64_t n_sampled = stats->n_obj_chunks_sampled;
+		double sampled_perc = n ? 100.0 * (double)n_sampled /
+			(double)n : 0.0;
+		outv_field(v, "Sampled chunks", "%lu / %lu [%s]", n_sampled, n,
+				out_get_percentage(sampled_perc));
+	}
+
 	outv_title(v, "Objects");
 	info_obj_stats_objects(pip, v, stats);
 
@@ -121,6 +121,7 @@ out_set_stream(FILE *stream)
 	out_fh = stream;
 
 	memset(out_indent_str, INDENT_CHAR, MAX_INDENT);
+	out_indent_str[out_indent_level] = '\0';
 }
 
 /*
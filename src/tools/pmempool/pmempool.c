@@ -48,6 +48,8 @@
 #include "dump.h"
 #include "check.h"
 #include "rm.h"
+#include "copy.h"
+#include "snapshot.h"
 #include "convert.h"
 
 #define APPNAME	"pmempool"
@@ -140,6 +142,18 @@ static struct command commands[] = {
 		.func = pmempool_rm_func,
 		.help = pmempool_rm_help,
 	},
+	{
+		.name = "copy",
+		.brief = "copy a pool skipping unused regions",
+		.func = pmempool_copy_func,
+		.help = pmempool_copy_help,
+	},
+	{
+		.name = "snapshot",
+		.brief = "export or apply incremental snapshot of a pool",
+		.func = pmempool_snapshot_func,
+		.help = pmempool_snapshot_help,
+	},
 	{
 		.name = "convert",
 		.brief = "perform pool layout conversion",
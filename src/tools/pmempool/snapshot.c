@@ -0,0 +1,983 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * snapshot.c -- pmempool snapshot command source file
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "output.h"
+#include "snapshot.h"
+#include "util_pmemobj.h"
+#include "libpmem.h"
+
+#define SNAPSHOT_SIG_LEN	16
+#define SNAPSHOT_SIG		"PMEMSNAPSHOT\0\0\0\0"
+#define SNAPSHOT_MAP_SIG	"PMEMSNAPMAP\0\0\0\0\0"
+#define SNAPSHOT_MAJOR		1
+
+/* pool is tracked in units of the heap chunk size */
+#define SNAPSHOT_UNIT_SIZE	CHUNKSIZE
+
+/* hash of a unit which does not hold any data */
+#define SNAPSHOT_UNUSED		0
+
+#define SNAPSHOT_PRIME1		11400714785074694791ULL
+#define SNAPSHOT_PRIME2		14029467366897019727ULL
+#define SNAPSHOT_PRIME3		1609587929392839161ULL
+
+#define DEFAULT_MODE	0664
+
+/*
+ * snapshot_hdr -- header of the snapshot stream
+ *
+ * The header is followed by records of changed units, each one being
+ * struct snapshot_rec followed by len bytes of data. The stream is
+ * terminated by a record with zero length and offset equal to the number
+ * of preceding records. All fields are stored in little-endian byte order.
+ */
+struct snapshot_hdr {
+	char signature[SNAPSHOT_SIG_LEN];
+	uint64_t major;
+	unsigned char uuid[POOL_HDR_UUID_LEN];	/* pool set uuid */
+	uint64_t pool_size;
+	uint64_t unit_size;
+	uint64_t base_gen;	/* generation the delta applies to, 0 if full */
+	uint64_t gen;		/* generation of the snapshot */
+	uint64_t checksum;
+};
+
+/*
+ * snapshot_rec -- header of a single record of the snapshot stream
+ */
+struct snapshot_rec {
+	uint64_t off;
+	uint64_t len;
+	uint64_t hash;
+};
+
+/*
+ * snapshot_map_hdr -- header of the map file
+ *
+ * The map of an exported pool is followed by nunits entries. The map of a
+ * pool the snapshots are applied to holds only the generation.
+ */
+struct snapshot_map_hdr {
+	char signature[SNAPSHOT_SIG_LEN];
+	uint64_t major;
+	unsigned char uuid[POOL_HDR_UUID_LEN];
+	uint64_t pool_size;
+	uint64_t unit_size;
+	uint64_t gen;
+	uint64_t nunits;
+	uint64_t entries_hash;
+	uint64_t checksum;
+};
+
+/*
+ * snapshot_map_entry -- state of a single unit of the pool
+ */
+struct snapshot_map_entry {
+	uint64_t hash;	/* hash of the contents or SNAPSHOT_UNUSED */
+	uint64_t gen;	/* generation of the last change */
+};
+
+struct snapshot_map {
+	struct snapshot_map_hdr hdr;
+	struct snapshot_map_entry *entries;
+};
+
+/*
+ * snapshot_ctx -- context of threads hashing the pool
+ */
+struct snapshot_ctx {
+	const char *addr;
+	uint64_t size;
+	uint64_t nunits;
+	uint64_t next;		/* next unit to hash */
+	const uint8_t *used;	/* units holding data */
+	uint64_t *hashes;
+};
+
+/* verbosity level */
+static int vlevel = 1;
+/* number of threads, 0 means one per online CPU */
+static unsigned jobs;
+/* export all units regardless of the map */
+static int full;
+/* apply snapshot to the pool instead of exporting it */
+static int apply;
+/* path to the map file */
+static const char *map_path;
+
+/* help message */
+static const char *help_str =
+"Export incremental snapshot of a pool or apply it to a pool\n"
+"\n"
+"Available options:\n"
+"  -m, --map <file>   Map file with the state of the previous snapshot.\n"
+"  -a, --apply        Apply the snapshot to the pool.\n"
+"  -f, --full         Export all units holding data.\n"
+"  -j, --jobs <num>   Number of threads hashing the pool.\n"
+"  -q, --quiet        Be quiet and don't print any messages.\n"
+"  -v, --verbose      Be verbose.\n"
+"  -h, --help         Print this help message.\n"
+"\n"
+"For complete documentation see %s-snapshot(1) manual page.\n";
+
+/* short options string */
+static const char *optstr = "m:afj:qvh";
+/* long options */
+static const struct option long_options[] = {
+	{"map",		required_argument,	0, 'm'},
+	{"apply",	no_argument,		0, 'a'},
+	{"full",	no_argument,		0, 'f'},
+	{"jobs",	required_argument,	0, 'j'},
+	{"quiet",	no_argument,		0, 'q'},
+	{"verbose",	no_argument,		0, 'v'},
+	{"help",	no_argument,		0, 'h'},
+	{NULL,		0,			0,  0 },
+};
+
+/*
+ * print_usage -- print usage message
+ */
+static void
+print_usage(const char *appname)
+{
+	printf("Usage: %s snapshot [<args>] <file> <snapshot>\n", appname);
+}
+
+/*
+ * pmempool_snapshot_help -- print help message
+ */
+void
+pmempool_snapshot_help(char *appname)
+{
+	print_usage(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * rotl64 -- rotate 64-bit value left
+ */
+static inline uint64_t
+rotl64(uint64_t val, unsigned bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+/*
+ * snapshot_round -- mix a single word into the accumulator
+ */
+static inline uint64_t
+snapshot_round(uint64_t acc, uint64_t val)
+{
+	acc += val * SNAPSHOT_PRIME2;
+	acc = rotl64(acc, 31);
+	return acc * SNAPSHOT_PRIME1;
+}
+
+/*
+ * snapshot_hash -- calculate hash of the unit contents
+ *
+ * Unlike the Fletcher checksum used for headers, the hash detects changes
+ * which preserve the sum of words, like moving data within the unit. Four
+ * independent accumulators keep the multiplications pipelined.
+ */
+static uint64_t
+snapshot_hash(const void *buff, size_t len)
+{
+	const char *p = buff;
+	uint64_t v[4] = {
+		SNAPSHOT_PRIME1 + SNAPSHOT_PRIME2,
+		SNAPSHOT_PRIME2,
+		0,
+		-SNAPSHOT_PRIME1,
+	};
+	uint64_t w;
+
+	size_t i = 0;
+	for (; i + 4 * sizeof(w) <= len; i += 4 * sizeof(w)) {
+		for (unsigned j = 0; j < 4; ++j) {
+			memcpy(&w, p + i + j * sizeof(w), sizeof(w));
+			v[j] = snapshot_round(v[j], le64toh(w));
+		}
+	}
+
+	for (; i < len; i += sizeof(w)) {
+		w = 0;
+		memcpy(&w, p + i, min(sizeof(w), len - i));
+		v[0] = snapshot_round(v[0], le64toh(w));
+	}
+
+	uint64_t h = rotl64(v[0], 1) + rotl64(v[1], 7) +
+		rotl64(v[2], 12) + rotl64(v[3], 18);
+	h ^= len;
+	h ^= h >> 33;
+	h *= SNAPSHOT_PRIME2;
+	h ^= h >> 29;
+	h *= SNAPSHOT_PRIME3;
+	h ^= h >> 32;
+
+	return h == SNAPSHOT_UNUSED ? 1 : h;
+}
+
+/*
+ * snapshot_map_hdr_convert -- convert map header between host and
+ *	little-endian byte order
+ */
+static void
+snapshot_map_hdr_convert(struct snapshot_map_hdr *hdr)
+{
+	hdr->major = htole64(hdr->major);
+	hdr->pool_size = htole64(hdr->pool_size);
+	hdr->unit_size = htole64(hdr->unit_size);
+	hdr->gen = htole64(hdr->gen);
+	hdr->nunits = htole64(hdr->nunits);
+	hdr->entries_hash = htole64(hdr->entries_hash);
+}
+
+/*
+ * snapshot_map_entries_convert -- convert map entries between host and
+ *	little-endian byte order
+ */
+static void
+snapshot_map_entries_convert(struct snapshot_map_entry *entries,
+	uint64_t nunits)
+{
+	for (uint64_t i = 0; i < nunits; ++i) {
+		entries[i].hash = htole64(entries[i].hash);
+		entries[i].gen = htole64(entries[i].gen);
+	}
+}
+
+/*
+ * snapshot_map_read -- read map file
+ *
+ * Returns 1 if the map file does not exist.
+ */
+static int
+snapshot_map_read(const char *path, struct snapshot_map *map)
+{
+	FILE *fh = fopen(path, "r");
+	if (fh == NULL) {
+		if (errno == ENOENT)
+			return 1;
+		outv_err("%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct snapshot_map_hdr *hdr = &map->hdr;
+	map->entries = NULL;
+
+	if (fread(hdr, sizeof(*hdr), 1, fh) != 1)
+		goto err_invalid;
+
+	if (memcmp(hdr->signature, SNAPSHOT_MAP_SIG, SNAPSHOT_SIG_LEN) ||
+			!util_checksum(hdr, sizeof(*hdr), &hdr->checksum, 0))
+		goto err_invalid;
+
+	snapshot_map_hdr_convert(hdr);
+
+	if (hdr->major != SNAPSHOT_MAJOR) {
+		outv_err("%s: unsupported map version %lu\n", path,
+			hdr->major);
+		goto err;
+	}
+
+	if (hdr->unit_size == 0 || hdr->nunits > (hdr->pool_size - 1) /
+			hdr->unit_size + 1)
+		goto err_invalid;
+
+	if (hdr->nunits) {
+		size_t esize = hdr->nunits * sizeof(*map->entries);
+		map->entries = malloc(esize);
+		if (map->entries == NULL) {
+			outv_err("%s\n", strerror(errno));
+			goto err;
+		}
+
+		if (fread(map->entries, esize, 1, fh) != 1 ||
+				snapshot_hash(map->entries, esize) !=
+				hdr->entries_hash)
+			goto err_invalid;
+
+		snapshot_map_entries_convert(map->entries, hdr->nunits);
+	}
+
+	fclose(fh);
+	return 0;
+
+err_invalid:
+	outv_err("%s: invalid map file\n", path);
+err:
+	free(map->entries);
+	map->entries = NULL;
+	fclose(fh);
+	return -1;
+}
+
+/*
+ * snapshot_map_write -- atomically replace map file
+ *
+ * The entries are converted to little-endian byte order in place.
+ */
+static int
+snapshot_map_write(const char *path, struct snapshot_map *map)
+{
+	struct snapshot_map_hdr hdr = map->hdr;
+	memcpy(hdr.signature, SNAPSHOT_MAP_SIG, SNAPSHOT_SIG_LEN);
+	hdr.major = SNAPSHOT_MAJOR;
+
+	size_t esize = hdr.nunits * sizeof(*map->entries);
+	snapshot_map_entries_convert(map->entries, hdr.nunits);
+	hdr.entries_hash = esize ? snapshot_hash(map->entries, esize) : 0;
+
+	snapshot_map_hdr_convert(&hdr);
+	util_checksum(&hdr, sizeof(hdr), &hdr.checksum, 1);
+
+	char *tmp = malloc(strlen(path) + sizeof(".tmp"));
+	if (tmp == NULL) {
+		outv_err("%s\n", strerror(errno));
+		return -1;
+	}
+	sprintf(tmp, "%s.tmp", path);
+
+	FILE *fh = fopen(tmp, "w");
+	if (fh == NULL) {
+		outv_err("%s: %s\n", tmp, strerror(errno));
+		free(tmp);
+		return -1;
+	}
+
+	int ret = -1;
+	if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1 ||
+			(esize && fwrite(map->entries, esize, 1, fh) != 1) ||
+			fflush(fh) || fsync(fileno(fh))) {
+		outv_err("%s: %s\n", tmp, strerror(errno));
+		fclose(fh);
+		goto out;
+	}
+
+	if (fclose(fh) || rename(tmp, path)) {
+		outv_err("%s: %s\n", path, strerror(errno));
+		goto out;
+	}
+
+	ret = 0;
+out:
+	if (ret)
+		unlink(tmp);
+	free(tmp);
+	return ret;
+}
+
+/*
+ * snapshot_skip -- mark units fully covered by the range as not holding data
+ */
+static void
+snapshot_skip(uint8_t *used, uint64_t size, uint64_t off, uint64_t len)
+{
+	if (off >= size)
+		return;
+
+	uint64_t end = off + min(len, size - off);
+	for (uint64_t u = (off + SNAPSHOT_UNIT_SIZE - 1) / SNAPSHOT_UNIT_SIZE;
+			u < end / SNAPSHOT_UNIT_SIZE; ++u)
+		used[u] = 0;
+}
+
+/*
+ * snapshot_skip_arg -- units of the pool tracked by snapshot_skip_range()
+ */
+struct snapshot_skip_arg {
+	uint8_t *used;
+	uint64_t size;
+};
+
+/*
+ * snapshot_skip_range -- mark units of the range reported by the heap walk
+ */
+static int
+snapshot_skip_range(uint64_t off, uint64_t len, void *arg)
+{
+	struct snapshot_skip_arg *skip = arg;
+	snapshot_skip(skip->used, skip->size, off, len);
+	return 0;
+}
+
+/*
+ * snapshot_obj_skip -- mark units of free chunks and of zones not initialized
+ *	yet as not holding data
+ *
+ * The heap is trusted only if it passes basic validation, otherwise all
+ * units are considered used.
+ */
+static void
+snapshot_obj_skip(void *addr, uint64_t size, uint8_t *used, uint64_t nunits)
+{
+	struct snapshot_skip_arg skip = {
+		.used = used,
+		.size = size,
+	};
+
+	if (util_pmemobj_unused(addr, size, snapshot_skip_range, &skip))
+		memset(used, 1, nunits);
+}
+
+/*
+ * snapshot_worker -- hash units of the pool
+ */
+static void *
+snapshot_worker(void *arg)
+{
+	struct snapshot_ctx *ctx = arg;
+	uint64_t u;
+
+	while ((u = __sync_fetch_and_add(&ctx->next, 1)) < ctx->nunits) {
+		if (!ctx->used[u]) {
+			ctx->hashes[u] = SNAPSHOT_UNUSED;
+			continue;
+		}
+
+		uint64_t off = u * SNAPSHOT_UNIT_SIZE;
+		ctx->hashes[u] = snapshot_hash(ctx->addr + off,
+			min(SNAPSHOT_UNIT_SIZE, ctx->size - off));
+	}
+
+	return NULL;
+}
+
+/*
+ * snapshot_hash_units -- hash all units of the pool using multiple threads
+ */
+static int
+snapshot_hash_units(struct snapshot_ctx *ctx)
+{
+	unsigned nthreads = jobs;
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
+	}
+	nthreads = (unsigned)min(nthreads, ctx->nunits);
+
+	pthread_t *threads = NULL;
+	if (nthreads > 1) {
+		threads = calloc(nthreads - 1, sizeof(*threads));
+		if (threads == NULL) {
+			outv_err("%s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	/* the calling thread hashes units as well */
+	unsigned started = 0;
+	for (; started + 1 < nthreads; ++started) {
+		if (pthread_create(&threads[started], NULL, snapshot_worker,
+				ctx))
+			break;
+	}
+
+	snapshot_worker(ctx);
+
+	for (unsigned i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	return 0;
+}
+
+/*
+ * snapshot_export -- export snapshot of the pool to the file
+ */
+static int
+snapshot_export(const char *fname, const char *out)
+{
+	struct pmem_pool_params params;
+	if (pmem_pool_parse_params(fname, &params, 1)) {
+		outv_err("%s: cannot determine type of pool\n", fname);
+		return -1;
+	}
+
+	if (params.type != PMEM_POOL_TYPE_LOG &&
+			params.type != PMEM_POOL_TYPE_BLK &&
+			params.type != PMEM_POOL_TYPE_OBJ) {
+		outv_err("%s: unsupported pool type\n", fname);
+		return -1;
+	}
+
+	struct pool_set_file *file = pool_set_file_open(fname, 1, 1);
+	if (file == NULL) {
+		outv_err("%s: cannot open pool\n", fname);
+		return -1;
+	}
+
+	int ret = -1;
+	FILE *fh = NULL;
+	uint8_t *used = NULL;
+	uint64_t *hashes = NULL;
+	struct snapshot_map map;
+	memset(&map, 0, sizeof(map));
+
+	struct pool_hdr *phdr = file->addr;
+	uint64_t size = file->size;
+	uint64_t nunits = (size - 1) / SNAPSHOT_UNIT_SIZE + 1;
+
+	int nomap = 1;
+	if (map_path) {
+		nomap = snapshot_map_read(map_path, &map);
+		if (nomap < 0)
+			goto out;
+	}
+
+	if (!nomap && (memcmp(map.hdr.uuid, phdr->poolset_uuid,
+			POOL_HDR_UUID_LEN) || map.hdr.pool_size != size ||
+			map.hdr.unit_size != SNAPSHOT_UNIT_SIZE ||
+			map.hdr.nunits != nunits)) {
+		outv_err("%s: map does not match the pool\n", map_path);
+		goto out;
+	}
+
+	uint64_t base_gen = nomap || full ? 0 : map.hdr.gen;
+	uint64_t gen = nomap ? 1 : map.hdr.gen + 1;
+
+	used = malloc(nunits);
+	hashes = malloc(nunits * sizeof(*hashes));
+	if (used == NULL || hashes == NULL) {
+		outv_err("%s\n", strerror(errno));
+		goto out;
+	}
+
+	memset(used, 1, nunits);
+	if (params.type == PMEM_POOL_TYPE_OBJ)
+		snapshot_obj_skip(file->addr, size, used, nunits);
+
+	struct snapshot_ctx ctx = {
+		.addr = file->addr,
+		.size = size,
+		.nunits = nunits,
+		.next = 0,
+		.used = used,
+		.hashes = hashes,
+	};
+	if (snapshot_hash_units(&ctx))
+		goto out;
+
+	int to_stdout = strcmp(out, "-") == 0;
+	fh = to_stdout ? stdout : fopen(out, "wx");
+	if (fh == NULL) {
+		outv_err("%s: %s\n", out, strerror(errno));
+		goto out;
+	}
+
+	struct snapshot_hdr hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.signature, SNAPSHOT_SIG, SNAPSHOT_SIG_LEN);
+	memcpy(hdr.uuid, phdr->poolset_uuid, POOL_HDR_UUID_LEN);
+	hdr.major = htole64(SNAPSHOT_MAJOR);
+	hdr.pool_size = htole64(size);
+	hdr.unit_size = htole64(SNAPSHOT_UNIT_SIZE);
+	hdr.base_gen = htole64(base_gen);
+	hdr.gen = htole64(gen);
+	util_checksum(&hdr, sizeof(hdr), &hdr.checksum, 1);
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1)
+		goto err_write;
+
+	uint64_t nrecs = 0;
+	uint64_t nused = 0;
+	for (uint64_t u = 0; u < nunits; ++u) {
+		if (hashes[u] == SNAPSHOT_UNUSED)
+			continue;
+		nused++;
+
+		if (base_gen && hashes[u] == map.entries[u].hash)
+			continue;
+
+		uint64_t off = u * SNAPSHOT_UNIT_SIZE;
+		uint64_t len = min(SNAPSHOT_UNIT_SIZE, size - off);
+		struct snapshot_rec rec = {
+			.off = htole64(off),
+			.len = htole64(len),
+			.hash = htole64(hashes[u]),
+		};
+		if (fwrite(&rec, sizeof(rec), 1, fh) != 1 ||
+				fwrite((char *)file->addr + off, len, 1, fh)
+				!= 1)
+			goto err_write;
+		nrecs++;
+	}
+
+	struct snapshot_rec end = { htole64(nrecs), 0, 0 };
+	if (fwrite(&end, sizeof(end), 1, fh) != 1 || fflush(fh))
+		goto err_write;
+
+	/* the map may be updated only once the snapshot is stored */
+	if (!to_stdout && fsync(fileno(fh)))
+		goto err_write;
+
+	if (map_path) {
+		if (nomap) {
+			map.entries = calloc(nunits, sizeof(*map.entries));
+			if (map.entries == NULL) {
+				outv_err("%s\n", strerror(errno));
+				goto out;
+			}
+		}
+
+		memcpy(map.hdr.uuid, phdr->poolset_uuid, POOL_HDR_UUID_LEN);
+		map.hdr.pool_size = size;
+		map.hdr.unit_size = SNAPSHOT_UNIT_SIZE;
+		map.hdr.gen = gen;
+		map.hdr.nunits = nunits;
+		for (uint64_t u = 0; u < nunits; ++u) {
+			if (map.entries[u].hash != hashes[u]) {
+				map.entries[u].hash = hashes[u];
+				map.entries[u].gen = gen;
+			}
+		}
+
+		if (snapshot_map_write(map_path, &map))
+			goto out;
+	}
+
+	outv(2, "generation %lu: exported %lu of %lu used units\n", gen,
+		nrecs, nused);
+
+	ret = 0;
+	goto out;
+
+err_write:
+	outv_err("%s: %s\n", out, strerror(errno));
+out:
+	if (fh && fh != stdout) {
+		if (fclose(fh) && ret == 0) {
+			outv_err("%s: %s\n", out, strerror(errno));
+			ret = -1;
+		}
+		if (ret)
+			unlink(out);
+	}
+	free(map.entries);
+	free(hashes);
+	free(used);
+	pool_set_file_close(file);
+	return ret;
+}
+
+/*
+ * snapshot_read -- read exactly len bytes from the snapshot stream
+ */
+static int
+snapshot_read(FILE *fh, void *buff, size_t len)
+{
+	if (fread(buff, len, 1, fh) == 1)
+		return 0;
+
+	if (!ferror(fh))
+		errno = EINVAL;
+	return -1;
+}
+
+/*
+ * snapshot_apply -- apply snapshot from the file to the pool
+ */
+static int
+snapshot_apply(const char *fname, const char *in)
+{
+	int from_stdin = strcmp(in, "-") == 0;
+	FILE *fh = from_stdin ? stdin : fopen(in, "r");
+	if (fh == NULL) {
+		outv_err("%s: %s\n", in, strerror(errno));
+		return -1;
+	}
+
+	int ret = -1;
+	int created = 0;
+	char *buff = NULL;
+	struct pool_set_file *file = NULL;
+	struct snapshot_map map;
+	memset(&map, 0, sizeof(map));
+
+	struct snapshot_hdr hdr;
+	if (snapshot_read(fh, &hdr, sizeof(hdr)))
+		goto err_read;
+
+	if (memcmp(hdr.signature, SNAPSHOT_SIG, SNAPSHOT_SIG_LEN) ||
+			!util_checksum(&hdr, sizeof(hdr), &hdr.checksum, 0)) {
+		outv_err("%s: invalid snapshot\n", in);
+		goto out;
+	}
+
+	hdr.major = le64toh(hdr.major);
+	hdr.pool_size = le64toh(hdr.pool_size);
+	hdr.unit_size = le64toh(hdr.unit_size);
+	hdr.base_gen = le64toh(hdr.base_gen);
+	hdr.gen = le64toh(hdr.gen);
+
+	if (hdr.major != SNAPSHOT_MAJOR) {
+		outv_err("%s: unsupported snapshot version %lu\n", in,
+			hdr.major);
+		goto out;
+	}
+
+	if (map_path) {
+		int nomap = snapshot_map_read(map_path, &map);
+		if (nomap < 0)
+			goto out;
+
+		if (hdr.base_gen && nomap) {
+			outv_err("%s: snapshot of generation %lu applies to "
+				"generation %lu, no generation recorded\n",
+				in, hdr.gen, hdr.base_gen);
+			goto out;
+		}
+
+		if (hdr.base_gen && (memcmp(map.hdr.uuid, hdr.uuid,
+				POOL_HDR_UUID_LEN) || map.hdr.gen !=
+				hdr.base_gen)) {
+			outv_err("%s: snapshot of generation %lu applies to "
+				"generation %lu, pool is at generation %lu\n",
+				in, hdr.gen, hdr.base_gen, map.hdr.gen);
+			goto out;
+		}
+	}
+
+	if (access(fname, F_OK) && errno == ENOENT) {
+		if (hdr.base_gen) {
+			outv_err("%s: snapshot of generation %lu requires "
+				"existing pool\n", in, hdr.gen);
+			goto out;
+		}
+
+		int fd = open(fname, O_RDWR|O_CREAT|O_EXCL, DEFAULT_MODE);
+		if (fd < 0) {
+			outv_err("%s: %s\n", fname, strerror(errno));
+			goto out;
+		}
+		created = 1;
+
+		if (ftruncate(fd, (off_t)hdr.pool_size)) {
+			outv_err("%s: %s\n", fname, strerror(errno));
+			close(fd);
+			goto out;
+		}
+		close(fd);
+	}
+
+	/* without the map the generation of the pool is unknown */
+	if (hdr.base_gen && !map_path) {
+		outv_err("%s: snapshot of generation %lu applies to "
+			"generation %lu, no map file given\n",
+			in, hdr.gen, hdr.base_gen);
+		goto out;
+	}
+
+	file = pool_set_file_open(fname, 0, 0);
+	if (file == NULL) {
+		outv_err("%s: cannot open pool\n", fname);
+		goto out;
+	}
+
+	if (file->fileio || file->size != hdr.pool_size) {
+		outv_err("%s: pool size does not match the snapshot\n", fname);
+		goto out;
+	}
+
+	struct pool_hdr *phdr = file->addr;
+	if (hdr.base_gen && memcmp(phdr->poolset_uuid, hdr.uuid,
+			POOL_HDR_UUID_LEN)) {
+		outv_err("%s: pool does not match the snapshot\n", fname);
+		goto out;
+	}
+
+	buff = malloc(hdr.unit_size);
+	if (buff == NULL) {
+		outv_err("%s\n", strerror(errno));
+		goto out;
+	}
+
+	int is_pmem = pmem_is_pmem(file->addr, file->size);
+	uint64_t nrecs = 0;
+	struct snapshot_rec rec;
+	while (1) {
+		if (snapshot_read(fh, &rec, sizeof(rec)))
+			goto err_read;
+
+		rec.off = le64toh(rec.off);
+		rec.len = le64toh(rec.len);
+		rec.hash = le64toh(rec.hash);
+
+		if (rec.len == 0)
+			break;
+
+		if (rec.len > hdr.unit_size || rec.off > hdr.pool_size ||
+				rec.len > hdr.pool_size - rec.off) {
+			outv_err("%s: invalid record %lu\n", in, nrecs);
+			goto out;
+		}
+
+		if (snapshot_read(fh, buff, rec.len))
+			goto err_read;
+
+		if (snapshot_hash(buff, rec.len) != rec.hash) {
+			outv_err("%s: invalid record %lu\n", in, nrecs);
+			goto out;
+		}
+
+		void *dst = pool_set_file_map(file, rec.off);
+		if (is_pmem) {
+			pmem_memcpy_persist(dst, buff, rec.len);
+		} else {
+			memcpy(dst, buff, rec.len);
+			if (pmem_msync(dst, rec.len)) {
+				outv_err("%s: %s\n", fname, strerror(errno));
+				goto out;
+			}
+		}
+		nrecs++;
+	}
+
+	if (rec.off != nrecs) {
+		outv_err("%s: invalid end of snapshot\n", in);
+		goto out;
+	}
+
+	if (map_path) {
+		free(map.entries);
+		map.entries = NULL;
+		memcpy(map.hdr.uuid, hdr.uuid, POOL_HDR_UUID_LEN);
+		map.hdr.pool_size = hdr.pool_size;
+		map.hdr.unit_size = hdr.unit_size;
+		map.hdr.gen = hdr.gen;
+		map.hdr.nunits = 0;
+		if (snapshot_map_write(map_path, &map))
+			goto out;
+	}
+
+	outv(2, "generation %lu: applied %lu units\n", hdr.gen, nrecs);
+
+	ret = 0;
+	goto out;
+
+err_read:
+	outv_err("%s: %s\n", in, errno == EINVAL ?
+		"unexpected end of snapshot" : strerror(errno));
+out:
+	if (file)
+		pool_set_file_close(file);
+	if (ret && created)
+		unlink(fname);
+	free(map.entries);
+	free(buff);
+	if (!from_stdin)
+		fclose(fh);
+	return ret;
+}
+
+/*
+ * pmempool_snapshot_func -- main function for snapshot command
+ */
+int
+pmempool_snapshot_func(char *appname, int argc, char *argv[])
+{
+	int opt;
+	char c;
+	while ((opt = getopt_long(argc, argv, optstr,
+			long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'm':
+			map_path = optarg;
+			break;
+		case 'a':
+			apply = 1;
+			break;
+		case 'f':
+			full = 1;
+			break;
+		case 'j':
+			if (sscanf(optarg, "%u%c", &jobs, &c) != 1 ||
+					jobs == 0) {
+				outv_err("invalid number of jobs -- '%s'\n",
+					optarg);
+				return -1;
+			}
+			break;
+		case 'q':
+			vlevel = 0;
+			break;
+		case 'v':
+			vlevel++;
+			break;
+		case 'h':
+			pmempool_snapshot_help(appname);
+			return 0;
+		default:
+			print_usage(appname);
+			return -1;
+		}
+	}
+
+	out_set_vlevel(vlevel);
+
+	if (optind + 2 != argc) {
+		print_usage(appname);
+		return -1;
+	}
+
+	if (apply && full) {
+		outv_err("'-f' option cannot be used with '-a'\n");
+		return -1;
+	}
+
+	const char *fname = argv[optind];
+	const char *snapshot = argv[optind + 1];
+
+	/* keep messages out of the snapshot stream */
+	if (!apply && strcmp(snapshot, "-") == 0)
+		out_set_stream(stderr);
+
+	return apply ? snapshot_apply(fname, snapshot) :
+		snapshot_export(fname, snapshot);
+}
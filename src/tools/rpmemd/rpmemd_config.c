@@ -71,6 +71,9 @@ enum rpmemd_option {
 	RPD_OPT_PORT,
 	RPD_OPT_MAX_LANES,
 	RPD_OPT_LOG_LEVEL,
+	RPD_OPT_BUSY_POLL,
+	RPD_OPT_POLL_CPUS,
+	RPD_OPT_STATS_INTERVAL,
 
 	RPD_OPT_MAX_VALUE,
 	RPD_OPT_INVALID			= UINT64_MAX,
@@ -100,6 +103,9 @@ static const struct option options[] = {
 {"port",		required_argument,	0, RPD_OPT_PORT},
 {"max-lanes",		required_argument,	0, RPD_OPT_MAX_LANES},
 {"log-level",		required_argument,	0, RPD_OPT_LOG_LEVEL},
+{"busy-poll",		no_argument,		0, RPD_OPT_BUSY_POLL},
+{"poll-cpus",		required_argument,	0, RPD_OPT_POLL_CPUS},
+{"stats-interval",	required_argument,	0, RPD_OPT_STATS_INTERVAL},
 {0,			0,			0, 0},
 };
 
@@ -131,6 +137,9 @@ VALUE_INDENT "warn    warning conditions\n"
 VALUE_INDENT "notice  normal, but significant, condition\n"
 VALUE_INDENT "info    informational message\n"
 VALUE_INDENT "debug   debug-level message\n"
+"      --busy-poll               busy poll for completions\n"
+"      --poll-cpus <list>        pin busy-polling threads to CPUs, e.g. 0,2-3\n"
+"      --stats-interval <sec>    log persist latency statistics periodically\n"
 "\n"
 "For complete documentation see %s(1) manual page.";
 
@@ -278,6 +287,17 @@ set_option(uint64_t key, const char *value, struct rpmemd_config *config)
 		if (config->log_level == MAX_RPD_LOG)
 			errno = EINVAL;
 		break;
+	case RPD_OPT_BUSY_POLL:
+		parse_config_bool(&config->busy_poll, value);
+		break;
+	case RPD_OPT_POLL_CPUS:
+		free(config->poll_cpus);
+		config->poll_cpus = parse_config_string(value);
+		break;
+	case RPD_OPT_STATS_INTERVAL:
+		config->stats_interval =
+			(uint32_t)parse_config_integer(value, UINT32_MAX);
+		break;
 	default:
 		errno = EINVAL;
 	}
@@ -558,6 +578,9 @@ rpmemd_config_set_default(struct rpmemd_config *config)
 	config->port			= RPMEM_DEFAULT_PORT;
 	config->max_lanes		= RPMEM_DEFAULT_MAX_LANES;
 	config->log_level		= RPD_LOG_ERR;
+	config->busy_poll		= false;
+	config->poll_cpus		= NULL;
+	config->stats_interval		= 0;
 }
 
 /*
@@ -583,4 +606,5 @@ rpmemd_config_free(struct rpmemd_config *config)
 	free(config->pid_file);
 	free(config->log_file);
 	free(config->poolset_dir);
+	free(config->poll_cpus);
 }
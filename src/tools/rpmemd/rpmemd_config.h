@@ -71,6 +71,9 @@ struct rpmemd_config {
 	bool use_syslog;
 	bool verify_pool_sets;
 	bool verify_pool_sets_auto;
+	bool busy_poll;
+	char *poll_cpus;
+	uint64_t stats_interval;
 	unsigned short port;
 	uint64_t max_lanes;
 	enum rpmemd_log_level log_level;
@@ -32,6 +32,18 @@
 
 /*
  * rpmemd_db.c -- rpmemd database of pool set files
+ *
+ * The database keeps a resident catalog of the pool set files found in the
+ * root directory.  The catalog is built once by rpmemd_db_check_dir() and
+ * then kept up to date incrementally using inotify, so neither opening
+ * a pool set nor checking it for duplicated part files requires walking
+ * the whole directory tree.  Pool set descriptors and part file paths are
+ * indexed by hash tables.
+ *
+ * The database lock protects the catalog only, it is not held while a pool
+ * set is being created or opened, so many sessions may create and open
+ * different pool sets concurrently.  A pool set may be used by a single
+ * session at a time.
  */
 
 #include <stdio.h>
@@ -41,7 +53,10 @@
 #include <sys/queue.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <sys/file.h>
+#include <sys/inotify.h>
 
 #include "util.h"
 #include "out.h"
@@ -51,6 +66,13 @@
 #include "rpmemd_db.h"
 #include "rpmemd_log.h"
 
+#define RPMEMD_DB_NBUCKETS	1024	/* number of hash table buckets */
+
+/* events which change the contents of the catalog */
+#define RPMEMD_DB_WATCH_MASK\
+	(IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |\
+	IN_DELETE_SELF | IN_ONLYDIR)
+
 /*
  * struct rpmemd_db_pool -- remote pool context
  */
@@ -58,110 +80,787 @@ struct rpmemd_db_pool {
 	void *pool_addr;
 	size_t pool_size;
 	struct pool_set *set;
+	char *pool_desc;
+};
+
+/*
+ * struct rpmemd_db_entry -- catalog entry of a pool set file
+ *
+ * An entry without the parsed pool set exists only while the pool set
+ * is used by a session, either because the catalog has not been built
+ * or because the pool set file has been removed meanwhile.
+ */
+struct rpmemd_db_entry {
+	LIST_ENTRY(rpmemd_db_entry) next;
+	char *pool_desc;
+	struct pool_set *set;	/* parsed pool set file */
+	int opened;		/* pool set used by a session */
+};
+
+/*
+ * struct rpmemd_db_part -- index entry of a part file
+ */
+struct rpmemd_db_part {
+	LIST_ENTRY(rpmemd_db_part) next;
+	const char *path;	/* owned by the pool set */
+	struct rpmemd_db_entry *edb;
 };
 
 /*
- * struct rpmemd_db -- pool set database structure
+ * struct rpmemd_db_watch -- watched directory
+ */
+struct rpmemd_db_watch {
+	LIST_ENTRY(rpmemd_db_watch) next;
+	int wd;			/* inotify watch descriptor */
+	char *dir_desc;		/* path relative to the root directory */
+};
+
+/*
+ * declaration of the list types
+ */
+LIST_HEAD(list_head, rpmemd_db_entry);
+LIST_HEAD(part_head, rpmemd_db_part);
+LIST_HEAD(watch_head, rpmemd_db_watch);
+
+/*
+ * struct rpmemd_db -- pool set database structure
+ */
+struct rpmemd_db {
+	pthread_mutex_t lock;
+	char *root_dir;
+	mode_t mode;
+
+	int indexed;		/* catalog built by rpmemd_db_check_dir() */
+	int inotify_fd;
+	struct watch_head watches;
+	struct list_head pools[RPMEMD_DB_NBUCKETS];
+	struct part_head parts[RPMEMD_DB_NBUCKETS];
+};
+
+/*
+ * rpmemd_db_hash -- (internal) FNV-1a hash of a string
+ */
+static inline unsigned
+rpmemd_db_hash(const char *str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (; *str; str++) {
+		hash ^= (unsigned char)*str;
+		hash *= 1099511628211ULL;
+	}
+
+	return (unsigned)(hash % RPMEMD_DB_NBUCKETS);
+}
+
+/*
+ * rpmemd_db_init -- initialize the rpmem database of pool set files
+ */
+struct rpmemd_db *
+rpmemd_db_init(const char *root_dir, mode_t mode)
+{
+	if (root_dir[0] != '/') {
+		RPMEMD_LOG(ERR, "root directory is not an absolute path"
+				" -- '%s'", root_dir);
+		errno = EINVAL;
+		return NULL;
+	}
+	struct rpmemd_db *db = calloc(1, sizeof(*db));
+	if (!db) {
+		RPMEMD_LOG(ERR, "!allocating the rpmem database structure");
+		return NULL;
+	}
+
+	db->root_dir = strdup(root_dir);
+	if (!db->root_dir) {
+		RPMEMD_LOG(ERR, "!allocating the root dir path");
+		free(db);
+		return NULL;
+	}
+
+	db->mode = mode;
+	db->inotify_fd = -1;
+	LIST_INIT(&db->watches);
+	for (unsigned i = 0; i < RPMEMD_DB_NBUCKETS; i++) {
+		LIST_INIT(&db->pools[i]);
+		LIST_INIT(&db->parts[i]);
+	}
+
+	util_mutex_init(&db->lock, NULL);
+
+	return db;
+}
+
+/*
+ * rpmemd_db_concat -- (internal) concatenate two paths
+ */
+static char *
+rpmemd_db_concat(const char *path1, const char *path2)
+{
+	size_t len1 = strlen(path1);
+	size_t len2 = strlen(path2);
+	size_t new_len = len1 + len2 + 2; /* +1 for '/' in snprintf() */
+
+	if (path1[0] != '/') {
+		RPMEMD_LOG(ERR, "the first path is not an absolute one -- '%s'",
+				path1);
+		errno = EINVAL;
+		return NULL;
+	}
+	if (path2[0] == '/') {
+		RPMEMD_LOG(ERR, "the second path is not a relative one -- '%s'",
+				path2);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	char *new_str = malloc(new_len);
+	if (new_str == NULL) {
+		RPMEMD_LOG(ERR, "!allocating path buffer");
+		return NULL;
+	}
+
+	int ret = snprintf(new_str, new_len, "%s/%s", path1, path2);
+	if (ret < 0 || (size_t)ret != new_len - 1) {
+		RPMEMD_LOG(ERR, "snprintf error");
+		free(new_str);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return new_str;
+}
+
+/*
+ * rpmemd_db_get_path -- (internal) get the full path of the pool set file
+ */
+static char *
+rpmemd_db_get_path(struct rpmemd_db *db, const char *pool_desc)
+{
+	return rpmemd_db_concat(db->root_dir, pool_desc);
+}
+
+/*
+ * rpmemd_db_new_desc -- (internal) create descriptor of a directory entry
+ */
+static char *
+rpmemd_db_new_desc(const char *dir_desc, const char *name)
+{
+	size_t len = strlen(dir_desc) + strlen(name) + 2;
+	char *desc = malloc(len);
+	if (!desc) {
+		RPMEMD_LOG(ERR, "!allocating new descriptor");
+		return NULL;
+	}
+
+	if (dir_desc[0] != '\0')
+		snprintf(desc, len, "%s/%s", dir_desc, name);
+	else
+		snprintf(desc, len, "%s", name);
+
+	return desc;
+}
+
+/*
+ * rpmemd_db_lookup -- (internal) find the catalog entry of a pool set
+ */
+static struct rpmemd_db_entry *
+rpmemd_db_lookup(struct rpmemd_db *db, const char *pool_desc)
+{
+	struct rpmemd_db_entry *edb;
+	LIST_FOREACH(edb, &db->pools[rpmemd_db_hash(pool_desc)], next) {
+		if (strcmp(edb->pool_desc, pool_desc) == 0)
+			return edb;
+	}
+
+	return NULL;
+}
+
+/*
+ * rpmemd_db_parts_unindex -- (internal) remove part files of an entry
+ * from the index
+ */
+static void
+rpmemd_db_parts_unindex(struct rpmemd_db *db, struct rpmemd_db_entry *edb)
+{
+	struct pool_set *set = edb->set;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		if (rep->remote)
+			continue;
+
+		for (unsigned p = 0; p < rep->nparts; p++) {
+			struct part_head *head =
+				&db->parts[rpmemd_db_hash(rep->part[p].path)];
+			struct rpmemd_db_part *part;
+			LIST_FOREACH(part, head, next) {
+				if (part->edb == edb &&
+					part->path == rep->part[p].path) {
+					LIST_REMOVE(part, next);
+					free(part);
+					break;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * rpmemd_db_parts_index -- (internal) check the part files of the pool set
+ * are not used by any other pool set and add them to the index
+ */
+static int
+rpmemd_db_parts_index(struct rpmemd_db *db, struct rpmemd_db_entry *edb)
+{
+	struct pool_set *set = edb->set;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		if (rep->remote)
+			continue;
+
+		for (unsigned p = 0; p < rep->nparts; p++) {
+			const char *path = rep->part[p].path;
+			struct part_head *head =
+				&db->parts[rpmemd_db_hash(path)];
+			struct rpmemd_db_part *part;
+			LIST_FOREACH(part, head, next) {
+				if (strcmp(part->path, path) != 0)
+					continue;
+
+				RPMEMD_LOG(ERR, "part file '%s' from "
+					"pool set '%s' duplicated in "
+					"pool set '%s'", path,
+					edb->pool_desc,
+					part->edb->pool_desc);
+				errno = EEXIST;
+				goto err;
+			}
+
+			part = malloc(sizeof(*part));
+			if (!part) {
+				RPMEMD_LOG(ERR, "!allocating part index entry");
+				goto err;
+			}
+
+			part->path = path;
+			part->edb = edb;
+			LIST_INSERT_HEAD(head, part, next);
+		}
+	}
+
+	return 0;
+err:
+	rpmemd_db_parts_unindex(db, edb);
+	return -1;
+}
+
+/*
+ * rpmemd_db_entry_new -- (internal) add a new entry to the catalog
+ */
+static struct rpmemd_db_entry *
+rpmemd_db_entry_new(struct rpmemd_db *db, const char *pool_desc)
+{
+	struct rpmemd_db_entry *edb = calloc(1, sizeof(*edb));
+	if (!edb) {
+		RPMEMD_LOG(ERR, "!allocating database entry");
+		return NULL;
+	}
+
+	edb->pool_desc = strdup(pool_desc);
+	if (!edb->pool_desc) {
+		RPMEMD_LOG(ERR, "!allocating path for database entry");
+		free(edb);
+		return NULL;
+	}
+
+	LIST_INSERT_HEAD(&db->pools[rpmemd_db_hash(pool_desc)], edb, next);
+
+	return edb;
+}
+
+/*
+ * rpmemd_db_entry_drop_set -- (internal) forget the parsed pool set file
+ * of the entry and remove the entry unless it is used by a session
+ */
+static void
+rpmemd_db_entry_drop_set(struct rpmemd_db *db, struct rpmemd_db_entry *edb)
+{
+	if (edb->set) {
+		rpmemd_db_parts_unindex(db, edb);
+		util_poolset_free(edb->set);
+		edb->set = NULL;
+	}
+
+	if (edb->opened)
+		return;
+
+	LIST_REMOVE(edb, next);
+	free(edb->pool_desc);
+	free(edb);
+}
+
+/*
+ * rpmemd_db_index_file -- (internal) parse the pool set file and add it
+ * to the catalog, replacing the previous contents of its entry if any
+ */
+static int
+rpmemd_db_index_file(struct rpmemd_db *db, const char *pool_desc)
+{
+	struct pool_set *set;
+
+	char *path = rpmemd_db_get_path(db, pool_desc);
+	if (!path)
+		return -1;
+
+	if (util_poolset_read(&set, path)) {
+		RPMEMD_LOG(ERR, "!error reading pool set file -- %s", path);
+		goto err_free_path;
+	}
+
+	struct rpmemd_db_entry *edb = rpmemd_db_lookup(db, pool_desc);
+	if (edb) {
+		if (edb->set) {
+			rpmemd_db_parts_unindex(db, edb);
+			util_poolset_free(edb->set);
+		}
+	} else {
+		edb = rpmemd_db_entry_new(db, pool_desc);
+		if (!edb)
+			goto err_free_set;
+	}
+
+	edb->set = set;
+	if (rpmemd_db_parts_index(db, edb)) {
+		RPMEMD_LOG(ERR, "!duplicate found in pool set file -- %s",
+				path);
+		edb->set = NULL;
+		rpmemd_db_entry_drop_set(db, edb);
+		goto err_free_set;
+	}
+
+	free(path);
+	return 0;
+
+err_free_set:
+	util_poolset_free(set);
+err_free_path:
+	free(path);
+	return -1;
+}
+
+/*
+ * rpmemd_db_watch_add -- (internal) start watching the directory
+ */
+static int
+rpmemd_db_watch_add(struct rpmemd_db *db, const char *dir,
+	const char *dir_desc)
+{
+	struct rpmemd_db_watch *w = malloc(sizeof(*w));
+	if (!w) {
+		RPMEMD_LOG(ERR, "!allocating directory watch");
+		return -1;
+	}
+
+	w->dir_desc = strdup(dir_desc);
+	if (!w->dir_desc) {
+		RPMEMD_LOG(ERR, "!allocating directory watch");
+		goto err_strdup;
+	}
+
+	w->wd = inotify_add_watch(db->inotify_fd, dir, RPMEMD_DB_WATCH_MASK);
+	if (w->wd < 0) {
+		RPMEMD_LOG(ERR, "!watching directory -- %s", dir);
+		goto err_watch;
+	}
+
+	LIST_INSERT_HEAD(&db->watches, w, next);
+
+	return 0;
+err_watch:
+	free(w->dir_desc);
+err_strdup:
+	free(w);
+	return -1;
+}
+
+/*
+ * rpmemd_db_watch_free -- (internal) forget the directory watch
+ */
+static void
+rpmemd_db_watch_free(struct rpmemd_db_watch *w)
+{
+	LIST_REMOVE(w, next);
+	free(w->dir_desc);
+	free(w);
+}
+
+/*
+ * rpmemd_db_index_dir_r -- (internal) recursively add the pool set files
+ * from given directory to the catalog and start watching the directories
+ */
+static int
+rpmemd_db_index_dir_r(struct rpmemd_db *db, const char *dir,
+	const char *dir_desc)
+{
+	struct dirent *dentry;
+	DIR *dirp;
+	int ret = 0;
+
+	dirp = opendir(dir);
+	if (dirp == NULL) {
+		RPMEMD_LOG(ERR, "cannot open the directory -- %s", dir);
+		return -1;
+	}
+
+	if (db->inotify_fd >= 0 && rpmemd_db_watch_add(db, dir, dir_desc))
+		goto err_closedir;
+
+	while ((dentry = readdir(dirp)) != NULL) {
+		if (strcmp(dentry->d_name, ".") == 0 ||
+		    strcmp(dentry->d_name, "..") == 0)
+			continue;
+
+		char *new_desc = rpmemd_db_new_desc(dir_desc, dentry->d_name);
+		if (!new_desc)
+			goto err_closedir;
+
+		if (dentry->d_type == DT_DIR) { /* directory */
+			char *new_dir = rpmemd_db_concat(dir, dentry->d_name);
+			if (!new_dir) {
+				free(new_desc);
+				goto err_closedir;
+			}
+
+			/* call recursively for a new directory */
+			ret = rpmemd_db_index_dir_r(db, new_dir, new_desc);
+			free(new_dir);
+		} else {
+			ret = rpmemd_db_index_file(db, new_desc);
+		}
+
+		free(new_desc);
+		if (ret)
+			goto err_closedir;
+	}
+
+	closedir(dirp);
+	return 0;
+
+err_closedir:
+	closedir(dirp);
+	return -1;
+}
+
+/*
+ * rpmemd_db_is_under -- (internal) check the descriptor is the directory
+ * itself or lies within it
+ */
+static int
+rpmemd_db_is_under(const char *desc, const char *dir_desc)
+{
+	size_t len = strlen(dir_desc);
+	return strncmp(desc, dir_desc, len) == 0 &&
+		(desc[len] == '\0' || desc[len] == '/');
+}
+
+/*
+ * rpmemd_db_unindex_dir -- (internal) remove the pool set files from given
+ * directory and its subdirectories from the catalog
+ */
+static void
+rpmemd_db_unindex_dir(struct rpmemd_db *db, const char *dir_desc)
+{
+	for (unsigned i = 0; i < RPMEMD_DB_NBUCKETS; i++) {
+		struct rpmemd_db_entry *edb = LIST_FIRST(&db->pools[i]);
+		while (edb) {
+			struct rpmemd_db_entry *nedb = LIST_NEXT(edb, next);
+			if (rpmemd_db_is_under(edb->pool_desc, dir_desc))
+				rpmemd_db_entry_drop_set(db, edb);
+			edb = nedb;
+		}
+	}
+
+	struct rpmemd_db_watch *w = LIST_FIRST(&db->watches);
+	while (w) {
+		struct rpmemd_db_watch *nw = LIST_NEXT(w, next);
+		if (rpmemd_db_is_under(w->dir_desc, dir_desc)) {
+			/* the watch may be gone already */
+			inotify_rm_watch(db->inotify_fd, w->wd);
+			rpmemd_db_watch_free(w);
+		}
+		w = nw;
+	}
+}
+
+/*
+ * rpmemd_db_catalog_clear -- (internal) remove all the entries which are
+ * not used by any session and stop watching the directories
+ */
+static void
+rpmemd_db_catalog_clear(struct rpmemd_db *db)
+{
+	for (unsigned i = 0; i < RPMEMD_DB_NBUCKETS; i++) {
+		struct rpmemd_db_entry *edb = LIST_FIRST(&db->pools[i]);
+		while (edb) {
+			struct rpmemd_db_entry *nedb = LIST_NEXT(edb, next);
+			rpmemd_db_entry_drop_set(db, edb);
+			edb = nedb;
+		}
+	}
+
+	while (!LIST_EMPTY(&db->watches))
+		rpmemd_db_watch_free(LIST_FIRST(&db->watches));
+
+	if (db->inotify_fd >= 0) {
+		(void) close(db->inotify_fd);
+		db->inotify_fd = -1;
+	}
+
+	db->indexed = 0;
+}
+
+/*
+ * rpmemd_db_catalog_build -- (internal) build the catalog from scratch
+ */
+static int
+rpmemd_db_catalog_build(struct rpmemd_db *db)
+{
+	rpmemd_db_catalog_clear(db);
+
+	db->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (db->inotify_fd < 0) {
+		/* the catalog still works, but it is not updated */
+		RPMEMD_LOG(WARN, "!inotify_init1");
+	}
+
+	if (rpmemd_db_index_dir_r(db, db->root_dir, "")) {
+		rpmemd_db_catalog_clear(db);
+		return -1;
+	}
+
+	db->indexed = 1;
+	return 0;
+}
+
+/*
+ * rpmemd_db_watch_find -- (internal) find the watched directory
+ */
+static struct rpmemd_db_watch *
+rpmemd_db_watch_find(struct rpmemd_db *db, int wd)
+{
+	struct rpmemd_db_watch *w;
+	LIST_FOREACH(w, &db->watches, next) {
+		if (w->wd == wd)
+			return w;
+	}
+
+	return NULL;
+}
+
+/*
+ * rpmemd_db_handle_event -- (internal) update the catalog according to
+ * a single inotify event
+ */
+static int
+rpmemd_db_handle_event(struct rpmemd_db *db, const struct inotify_event *ev)
+{
+	if (ev->mask & IN_Q_OVERFLOW) {
+		RPMEMD_LOG(NOTICE, "pool set catalog out of sync, rebuilding");
+		return rpmemd_db_catalog_build(db);
+	}
+
+	struct rpmemd_db_watch *w = rpmemd_db_watch_find(db, ev->wd);
+	if (!w)
+		return 0;
+
+	if (ev->mask & (IN_IGNORED | IN_DELETE_SELF)) {
+		rpmemd_db_watch_free(w);
+		return 0;
+	}
+
+	if (!ev->len)
+		return 0;
+
+	char *desc = rpmemd_db_new_desc(w->dir_desc, ev->name);
+	if (!desc)
+		return -1;
+
+	int ret = 0;
+	if (ev->mask & IN_ISDIR) {
+		if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+			rpmemd_db_unindex_dir(db, desc);
+		} else if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+			char *dir = rpmemd_db_get_path(db, desc);
+			if (dir) {
+				ret = rpmemd_db_index_dir_r(db, dir, desc);
+				free(dir);
+			} else {
+				ret = -1;
+			}
+		}
+	} else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+		struct rpmemd_db_entry *edb = rpmemd_db_lookup(db, desc);
+		if (edb)
+			rpmemd_db_entry_drop_set(db, edb);
+	} else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+		ret = rpmemd_db_index_file(db, desc);
+	}
+
+	free(desc);
+	return ret;
+}
+
+/*
+ * rpmemd_db_update_locked -- (internal) apply the pending changes of the
+ * root directory to the catalog
+ *
+ * Invalid pool set files are logged and left out of the catalog.
+ */
+static void
+rpmemd_db_update_locked(struct rpmemd_db *db)
+{
+	char buff[sizeof(struct inotify_event) + NAME_MAX + 1]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+
+	while (db->indexed && db->inotify_fd >= 0) {
+		ssize_t len = read(db->inotify_fd, buff, sizeof(buff));
+		if (len <= 0) {
+			if (len < 0 && errno != EAGAIN)
+				RPMEMD_LOG(ERR, "!reading inotify events");
+			break;
+		}
+
+		for (char *ptr = buff; ptr < buff + len; ) {
+			const struct inotify_event *ev = (void *)ptr;
+			(void) rpmemd_db_handle_event(db, ev);
+			ptr += sizeof(*ev) + ev->len;
+		}
+	}
+}
+
+/*
+ * rpmemd_db_update -- apply the pending changes of the root directory to
+ * the catalog
+ *
+ * It is called on demand when a pool set is not found in the catalog, but
+ * it may be also called whenever the file descriptor returned by
+ * rpmemd_db_watch_fd() becomes readable.
  */
-struct rpmemd_db {
-	pthread_mutex_t lock;
-	char *root_dir;
-	mode_t mode;
-};
+void
+rpmemd_db_update(struct rpmemd_db *db)
+{
+	RPMEMD_ASSERT(db != NULL);
 
-/*
- * declaration of the 'struct list_head' type
- */
-LIST_HEAD(list_head, rpmemd_db_entry);
+	util_mutex_lock(&db->lock);
+	rpmemd_db_update_locked(db);
+	util_mutex_unlock(&db->lock);
+}
 
 /*
- * struct rpmemd_db_entry -- entry in the pool set list
+ * rpmemd_db_watch_fd -- file descriptor which becomes readable when the
+ * catalog should be updated, -1 if the catalog is not maintained
  */
-struct rpmemd_db_entry {
-	LIST_ENTRY(rpmemd_db_entry) next;
-	char *pool_desc;
-	struct pool_set *set;
-};
+int
+rpmemd_db_watch_fd(struct rpmemd_db *db)
+{
+	RPMEMD_ASSERT(db != NULL);
+
+	return db->indexed ? db->inotify_fd : -1;
+}
 
 /*
- * rpmemd_db_init -- initialize the rpmem database of pool set files
+ * rpmemd_db_pool_get -- (internal) mark the pool set as used by a session
+ *
+ * If the catalog has been built, the pool set must be found in it.
  */
-struct rpmemd_db *
-rpmemd_db_init(const char *root_dir, mode_t mode)
+static int
+rpmemd_db_pool_get(struct rpmemd_db *db, const char *pool_desc)
 {
-	if (root_dir[0] != '/') {
-		RPMEMD_LOG(ERR, "root directory is not an absolute path"
-				" -- '%s'", root_dir);
-		errno = EINVAL;
-		return NULL;
+	util_mutex_lock(&db->lock);
+
+	struct rpmemd_db_entry *edb = rpmemd_db_lookup(db, pool_desc);
+	if (!edb && db->indexed) {
+		rpmemd_db_update_locked(db);
+		edb = rpmemd_db_lookup(db, pool_desc);
 	}
-	struct rpmemd_db *db = calloc(1, sizeof(*db));
-	if (!db) {
-		RPMEMD_LOG(ERR, "!allocating the rpmem database structure");
-		return NULL;
+
+	if (!edb || (db->indexed && !edb->set)) {
+		if (db->indexed) {
+			RPMEMD_LOG(ERR, "pool set not found -- '%s'",
+					pool_desc);
+			errno = ENOENT;
+			goto err_unlock;
+		}
+
+		edb = rpmemd_db_entry_new(db, pool_desc);
+		if (!edb)
+			goto err_unlock;
 	}
 
-	db->root_dir = strdup(root_dir);
-	if (!db->root_dir) {
-		RPMEMD_LOG(ERR, "!allocating the root dir path");
-		free(db);
-		return NULL;
+	if (edb->opened) {
+		RPMEMD_LOG(ERR, "pool set already in use -- '%s'", pool_desc);
+		errno = EBUSY;
+		goto err_unlock;
 	}
 
-	db->mode = mode;
+	edb->opened = 1;
 
-	util_mutex_init(&db->lock, NULL);
+	util_mutex_unlock(&db->lock);
+	return 0;
 
-	return db;
+err_unlock:
+	util_mutex_unlock(&db->lock);
+	return -1;
 }
 
 /*
- * rpmemd_db_concat -- (internal) concatenate two paths
+ * rpmemd_db_pool_put -- (internal) mark the pool set as not used
  */
-static char *
-rpmemd_db_concat(const char *path1, const char *path2)
+static void
+rpmemd_db_pool_put(struct rpmemd_db *db, const char *pool_desc)
 {
-	size_t len1 = strlen(path1);
-	size_t len2 = strlen(path2);
-	size_t new_len = len1 + len2 + 2; /* +1 for '/' in snprintf() */
+	util_mutex_lock(&db->lock);
 
-	if (path1[0] != '/') {
-		RPMEMD_LOG(ERR, "the first path is not an absolute one -- '%s'",
-				path1);
-		errno = EINVAL;
-		return NULL;
-	}
-	if (path2[0] == '/') {
-		RPMEMD_LOG(ERR, "the second path is not a relative one -- '%s'",
-				path2);
-		errno = EINVAL;
-		return NULL;
-	}
+	struct rpmemd_db_entry *edb = rpmemd_db_lookup(db, pool_desc);
+	RPMEMD_ASSERT(edb != NULL);
+	RPMEMD_ASSERT(edb->opened);
 
-	char *new_str = malloc(new_len);
-	if (new_str == NULL) {
-		RPMEMD_LOG(ERR, "!allocating path buffer");
+	edb->opened = 0;
+	if (!edb->set)
+		rpmemd_db_entry_drop_set(db, edb);
+
+	util_mutex_unlock(&db->lock);
+}
+
+/*
+ * rpmemd_db_pool_new -- (internal) allocate a remote pool context
+ */
+static struct rpmemd_db_pool *
+rpmemd_db_pool_new(const char *pool_desc)
+{
+	struct rpmemd_db_pool *prp = malloc(sizeof(struct rpmemd_db_pool));
+	if (!prp) {
+		RPMEMD_LOG(ERR, "!allocating pool set db entry");
 		return NULL;
 	}
 
-	int ret = snprintf(new_str, new_len, "%s/%s", path1, path2);
-	if (ret < 0 || (size_t)ret != new_len - 1) {
-		RPMEMD_LOG(ERR, "snprintf error");
-		free(new_str);
-		errno = EINVAL;
+	prp->pool_desc = strdup(pool_desc);
+	if (!prp->pool_desc) {
+		RPMEMD_LOG(ERR, "!allocating pool set descriptor");
+		free(prp);
 		return NULL;
 	}
 
-	return new_str;
+	return prp;
 }
 
 /*
- * rpmemd_db_get_path -- (internal) get the full path of the pool set file
+ * rpmemd_db_pool_free -- (internal) free a remote pool context
  */
-static char *
-rpmemd_db_get_path(struct rpmemd_db *db, const char *pool_desc)
+static void
+rpmemd_db_pool_free(struct rpmemd_db_pool *prp)
 {
-	return rpmemd_db_concat(db->root_dir, pool_desc);
+	free(prp->pool_desc);
+	free(prp);
 }
 
 /*
@@ -174,22 +873,21 @@ rpmemd_db_pool_create(struct rpmemd_db *db, const char *pool_desc,
 	RPMEMD_ASSERT(db != NULL);
 	RPMEMD_ASSERT(attr != NULL);
 
-	util_mutex_lock(&db->lock);
-
 	struct rpmemd_db_pool *prp = NULL;
 	struct pool_set *set;
 	char *path;
 	int ret;
 
-	prp = malloc(sizeof(struct rpmemd_db_pool));
-	if (!prp) {
-		RPMEMD_LOG(ERR, "!allocating pool set db entry");
-		goto err_unlock;
-	}
+	prp = rpmemd_db_pool_new(pool_desc);
+	if (!prp)
+		return NULL;
+
+	if (rpmemd_db_pool_get(db, pool_desc))
+		goto err_free_prp;
 
 	path = rpmemd_db_get_path(db, pool_desc);
 	if (!path) {
-		goto err_free_prp;
+		goto err_put;
 	}
 
 	ret = util_pool_create_uuids(&set, path,
@@ -221,16 +919,15 @@ rpmemd_db_pool_create(struct rpmemd_db *db, const char *pool_desc,
 	prp->set = set;
 
 	free(path);
-	util_mutex_unlock(&db->lock);
 
 	return prp;
 
 err_free_path:
 	free(path);
+err_put:
+	rpmemd_db_pool_put(db, pool_desc);
 err_free_prp:
-	free(prp);
-err_unlock:
-	util_mutex_unlock(&db->lock);
+	rpmemd_db_pool_free(prp);
 	return NULL;
 }
 
@@ -244,22 +941,21 @@ rpmemd_db_pool_open(struct rpmemd_db *db, const char *pool_desc,
 	RPMEMD_ASSERT(db != NULL);
 	RPMEMD_ASSERT(attr != NULL);
 
-	util_mutex_lock(&db->lock);
-
 	struct rpmemd_db_pool *prp = NULL;
 	struct pool_set *set;
 	char *path;
 	int ret;
 
-	prp = malloc(sizeof(struct rpmemd_db_pool));
-	if (!prp) {
-		RPMEMD_LOG(ERR, "!allocating pool set db entry");
-		goto err_unlock;
-	}
+	prp = rpmemd_db_pool_new(pool_desc);
+	if (!prp)
+		return NULL;
+
+	if (rpmemd_db_pool_get(db, pool_desc))
+		goto err_free_prp;
 
 	path = rpmemd_db_get_path(db, pool_desc);
 	if (!path) {
-		goto err_free_prp;
+		goto err_put;
 	}
 
 	ret = util_pool_open_remote(&set, path, 0, pool_size,
@@ -284,16 +980,15 @@ rpmemd_db_pool_open(struct rpmemd_db *db, const char *pool_desc,
 	prp->set = set;
 
 	free(path);
-	util_mutex_unlock(&db->lock);
 
 	return prp;
 
 err_free_path:
 	free(path);
+err_put:
+	rpmemd_db_pool_put(db, pool_desc);
 err_free_prp:
-	free(prp);
-err_unlock:
-	util_mutex_unlock(&db->lock);
+	rpmemd_db_pool_free(prp);
 	return NULL;
 }
 
@@ -305,12 +1000,9 @@ rpmemd_db_pool_close(struct rpmemd_db *db, struct rpmemd_db_pool *prp)
 {
 	RPMEMD_ASSERT(db != NULL);
 
-	util_mutex_lock(&db->lock);
-
 	util_poolset_close(prp->set, 0);
-	free(prp);
-
-	util_mutex_unlock(&db->lock);
+	rpmemd_db_pool_put(db, prp->pool_desc);
+	rpmemd_db_pool_free(prp);
 }
 
 /*
@@ -322,16 +1014,17 @@ rpmemd_db_pool_remove(struct rpmemd_db *db, const char *pool_desc)
 	RPMEMD_ASSERT(db != NULL);
 	RPMEMD_ASSERT(pool_desc != NULL);
 
-	util_mutex_lock(&db->lock);
-
 	struct pool_set *set;
 	char *path;
 	int ret = 0;
 
+	if (rpmemd_db_pool_get(db, pool_desc))
+		return -1;
+
 	path = rpmemd_db_get_path(db, pool_desc);
 	if (!path) {
 		ret = -1;
-		goto err_unlock;
+		goto err_put;
 	}
 
 	ret = util_pool_open_nocheck(&set, path, 0);
@@ -354,8 +1047,8 @@ rpmemd_db_pool_remove(struct rpmemd_db *db, const char *pool_desc)
 
 err_free_path:
 	free(path);
-err_unlock:
-	util_mutex_unlock(&db->lock);
+err_put:
+	rpmemd_db_pool_put(db, pool_desc);
 	return ret;
 }
 
@@ -367,195 +1060,18 @@ rpmemd_db_fini(struct rpmemd_db *db)
 {
 	RPMEMD_ASSERT(db != NULL);
 
+	rpmemd_db_catalog_clear(db);
 	util_mutex_destroy(&db->lock);
 	free(db->root_dir);
 	free(db);
 }
 
 /*
- * rpmemd_db_check_dups_set -- (internal) check for duplicates in the database
- */
-static inline int
-rpmemd_db_check_dups_set(struct pool_set *set, const char *path)
-{
-	for (unsigned r = 0; r < set->nreplicas; r++) {
-		struct pool_replica *rep = set->replica[r];
-		for (unsigned p = 0; p < rep->nparts; p++) {
-			if (strcmp(path, rep->part[p].path) == 0)
-				return -1;
-		}
-	}
-	return 0;
-}
-
-/*
- * rpmemd_db_check_dups -- (internal) check for duplicates in the database
- */
-static int
-rpmemd_db_check_dups(struct list_head *head, struct rpmemd_db *db,
-			const char *pool_desc, struct pool_set *set)
-{
-	struct rpmemd_db_entry *edb;
-
-	LIST_FOREACH(edb, head, next) {
-		for (unsigned r = 0; r < edb->set->nreplicas; r++) {
-			struct pool_replica *rep = edb->set->replica[r];
-			for (unsigned p = 0; p < rep->nparts; p++) {
-				if (rpmemd_db_check_dups_set(set,
-							rep->part[p].path)) {
-					RPMEMD_LOG(ERR, "part file '%s' from "
-						"pool set '%s' duplicated in "
-						"pool set '%s'",
-						rep->part[p].path,
-						pool_desc,
-						edb->pool_desc);
-					errno = EEXIST;
-					return -1;
-				}
-
-			}
-		}
-	}
-	return 0;
-}
-
-/*
- * rpmemd_db_add -- (internal) add an entry for a given set to the database
- */
-static struct rpmemd_db_entry *
-rpmemd_db_add(struct list_head *head, struct rpmemd_db *db,
-			const char *pool_desc, struct pool_set *set)
-{
-	struct rpmemd_db_entry *edb;
-
-	edb = calloc(1, sizeof(*edb));
-	if (!edb) {
-		RPMEMD_LOG(ERR, "!allocating database entry");
-		goto err_calloc;
-	}
-
-	edb->set = set;
-	edb->pool_desc = strdup(pool_desc);
-	if (!edb->pool_desc) {
-		RPMEMD_LOG(ERR, "!allocating path for database entry");
-		goto err_strdup;
-	}
-
-	LIST_INSERT_HEAD(head, edb, next);
-
-	return edb;
-
-err_strdup:
-	free(edb);
-err_calloc:
-	return NULL;
-}
-
-/*
- * new_paths -- (internal) create two new paths
- */
-static int
-new_paths(const char *dir, const char *name, const char *old_desc,
-		char **path, char **new_desc)
-{
-	*path = rpmemd_db_concat(dir, name);
-	if (!(*path))
-		return -1;
-
-	if (old_desc[0] != 0)
-		*new_desc = rpmemd_db_concat(old_desc, name);
-	else {
-		*new_desc = strdup(name);
-		if (!(*new_desc)) {
-			RPMEMD_LOG(ERR, "!allocating new descriptor");
-		}
-	}
-	if (!(*new_desc)) {
-		free(*path);
-		return -1;
-	}
-	return 0;
-}
-
-/*
- * rpmemd_db_check_dir_r -- (internal) recursively check given directory
- *                          for duplicates
- */
-static int
-rpmemd_db_check_dir_r(struct list_head *head, struct rpmemd_db *db,
-			const char *dir, char *pool_desc)
-{
-	char *new_dir, *new_desc, *full_path;
-	struct dirent dentry;
-	struct dirent *result;
-	struct pool_set *set = NULL;
-	DIR *dirp;
-	int ret = 0;
-
-	dirp = opendir(dir);
-	if (dirp == NULL) {
-		RPMEMD_LOG(ERR, "cannot open the directory -- %s", dir);
-		return -1;
-	}
-
-	while (readdir_r(dirp, &dentry, &result) == 0 && result != NULL) {
-		if (strcmp(dentry.d_name, ".") == 0 ||
-		    strcmp(dentry.d_name, "..") == 0)
-			continue;
-
-		if (dentry.d_type == DT_DIR) { /* directory */
-			if (new_paths(dir, dentry.d_name, pool_desc,
-					&new_dir, &new_desc))
-				goto err_closedir;
-
-			/* call recursively for a new directory */
-			ret = rpmemd_db_check_dir_r(head, db, new_dir,
-							new_desc);
-			free(new_dir);
-			free(new_desc);
-			if (ret)
-				goto err_closedir;
-			continue;
-
-		}
-
-		if (new_paths(dir, dentry.d_name, pool_desc,
-				&full_path, &new_desc)) {
-			goto err_closedir;
-		}
-		if (util_poolset_read(&set, full_path)) {
-			RPMEMD_LOG(ERR, "!error reading pool set file -- %s",
-					full_path);
-			goto err_free_paths;
-		}
-		if (rpmemd_db_check_dups(head, db, new_desc, set)) {
-			RPMEMD_LOG(ERR, "!duplicate found in pool set file"
-					" -- %s", full_path);
-			goto err_free_set;
-		}
-		if (rpmemd_db_add(head, db, new_desc, set) == NULL) {
-			goto err_free_set;
-		}
-
-		free(new_desc);
-		free(full_path);
-	}
-
-	closedir(dirp);
-	return 0;
-
-err_free_set:
-	free(set);
-err_free_paths:
-	free(new_desc);
-	free(full_path);
-err_closedir:
-	closedir(dirp);
-	return -1;
-}
-
-/*
- * rpmemd_db_check_dir -- check given directory for duplicates
+ * rpmemd_db_check_dir -- check given directory for duplicates and build
+ * the catalog of pool set files
+ *
+ * The directory tree is walked only once, afterwards the catalog is
+ * updated incrementally.
  */
 int
 rpmemd_db_check_dir(struct rpmemd_db *db)
@@ -564,17 +1080,7 @@ rpmemd_db_check_dir(struct rpmemd_db *db)
 
 	util_mutex_lock(&db->lock);
 
-	struct list_head head;
-	LIST_INIT(&head);
-
-	int ret = rpmemd_db_check_dir_r(&head, db, db->root_dir, "");
-
-	while (!LIST_EMPTY(&head)) {
-		struct rpmemd_db_entry *edb = LIST_FIRST(&head);
-		LIST_REMOVE(edb, next);
-		free(edb->pool_desc);
-		free(edb);
-	}
+	int ret = rpmemd_db_catalog_build(db);
 
 	util_mutex_unlock(&db->lock);
 
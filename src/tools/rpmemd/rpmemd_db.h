@@ -47,3 +47,5 @@ int rpmemd_db_pool_remove(struct rpmemd_db *db, const char *pool_desc);
 void rpmemd_db_pool_close(struct rpmemd_db *db, struct rpmemd_db_pool *prp);
 void rpmemd_db_fini(struct rpmemd_db *db);
 int rpmemd_db_check_dir(struct rpmemd_db *db);
+void rpmemd_db_update(struct rpmemd_db *db);
+int rpmemd_db_watch_fd(struct rpmemd_db *db);
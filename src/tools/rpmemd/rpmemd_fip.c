@@ -34,15 +34,19 @@
  * rpmemd_fip.c -- rpmemd libfabric provider module source file
  */
 
+#define _GNU_SOURCE
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include <rdma/fabric.h>
 #include <rdma/fi_domain.h>
@@ -55,6 +59,7 @@
 #include "rpmem_fip_msg.h"
 #include "rpmem_fip_common.h"
 #include "rpmem_fip_lane.h"
+#include "rpmem_hist.h"
 #include "rpmemd_fip_worker.h"
 #include "rpmemd_fip.h"
 #include "rpmemd_log.h"
@@ -75,8 +80,12 @@
 	ret;\
 })
 
+struct rpmemd_fip_conn;
+
 typedef int (*rpmemd_fip_init_fn)(struct rpmemd_fip *fip);
 typedef int (*rpmemd_fip_fini_fn)(struct rpmemd_fip *fip);
+typedef int (*rpmemd_fip_post_fn)(struct rpmemd_fip *fip,
+		struct rpmemd_fip_conn *conn);
 typedef int (*rpmemd_fip_process_fn)(struct rpmemd_fip *fip);
 
 /*
@@ -85,7 +94,7 @@ typedef int (*rpmemd_fip_process_fn)(struct rpmemd_fip *fip);
 struct rpmemd_fip_ops {
 	rpmemd_fip_init_fn init;
 	rpmemd_fip_fini_fn fini;
-	rpmemd_fip_init_fn post;
+	rpmemd_fip_post_fn post;
 	rpmemd_fip_process_fn process_start;
 	rpmemd_fip_process_fn process_stop;
 };
@@ -97,7 +106,49 @@ struct rpmemd_fip_lane {
 	struct rpmem_fip_lane lane;	/* lane base structure */
 	struct rpmem_fip_msg recv;	/* RECV message */
 	struct rpmem_fip_msg send;	/* SEND message */
+	struct rpmemd_fip_conn *conn;	/* lane's connection */
 	struct rpmemd_fip_worker *worker; /* lane's worker */
+	uint64_t recv_ts;		/* persist message receive time */
+	struct rpmemd_fip_stats stats;	/* lane's latency statistics */
+};
+
+/*
+ * rpmemd_fip_poller -- busy-polling thread for GPSPM
+ *
+ * The lanes which received a persist message while the poller was reading
+ * the completion queue are collected in the pending array and processed
+ * by the poller itself as a batch.
+ */
+struct rpmemd_fip_poller {
+	struct rpmemd_fip *fip;
+	struct rpmemd_fip_conn *conn;	/* connection to poll */
+	pthread_t thread;
+	int cpu;			/* CPU to run on or -1 */
+	void **batch;			/* lanes being processed */
+	void **pending;			/* lanes to process next */
+	size_t npending;		/* number of pending lanes */
+};
+
+/*
+ * rpmemd_fip_conn -- single connection of rpmemd_fip
+ *
+ * The n-th lane is served by the connection n % nconns, the same way the
+ * client stripes its lanes.  Each connection has its own event queue,
+ * completion queue and processing threads.
+ */
+struct rpmemd_fip_conn {
+	struct rpmemd_fip *fip;
+	struct fid_eq *eq;		/* event queue */
+	struct fid_ep *ep;		/* active endpoint - connection */
+	struct fid_cq *cq;		/* completion queue */
+	unsigned nlanes;		/* number of connection's lanes */
+
+	pthread_t cq_thread;		/* completion queue thread */
+	struct fi_cq_msg_entry *cq_entries;	/* completion queue entries */
+	struct rpmemd_fip_worker **workers;	/* process workers */
+
+	volatile int cq_polling;	/* completion queue is being read */
+	struct rpmemd_fip_poller *pollers; /* busy-polling threads */
 };
 
 /*
@@ -109,20 +160,24 @@ struct rpmemd_fip {
 	struct fid_domain *domain;	/* fabric protection domain */
 	struct fid_eq *eq;		/* event queue */
 	struct fid_pep *pep;		/* passive endpoint - listener */
-	struct fid_ep *ep;		/* active endpoint - connection */
 	struct fid_mr *mr;		/* memory region for pool */
-	struct fid_cq *cq;		/* completion queue */
 	struct rpmemd_fip_ops *ops;	/* ops specific for persist method */
 
+	unsigned nconns;		/* number of connections */
+	unsigned nconnected;		/* number of accepted connections */
+	struct rpmemd_fip_conn *conns;	/* connections */
+
 	void (*persist)(const void *addr, size_t len);	/* persist function */
+	void (*flush)(const void *addr, size_t len);	/* flush function */
+	void (*drain)(void);				/* drain function */
 	void *addr;			/* pool's address */
 	size_t size;			/* size of the pool */
 	enum rpmem_persist_method persist_method;
 
 	volatile int closing;	/* flag for closing background threads */
 	unsigned nlanes;	/* number of lanes */
-	size_t nthreads;	/* number of threads for processing */
-	size_t cq_size;		/* size of completion queue */
+	size_t nthreads;	/* number of threads per connection */
+	size_t cq_size;		/* size of connection's completion queue */
 
 	/* the following fields are used only for GPSPM */
 	struct rpmemd_fip_lane *lanes;
@@ -135,9 +190,15 @@ struct rpmemd_fip {
 	struct fid_mr *pres_mr;		/* persist response memory region */
 	void *pres_mr_desc;		/* persist response local descriptor */
 
-	pthread_t cq_thread;		/* completion queue thread */
-	struct fi_cq_msg_entry *cq_entries;	/* completion queue entries */
-	struct rpmemd_fip_worker **workers;	/* process workers */
+	int busy_poll;			/* busy-poll mode */
+	const char *poll_cpus;		/* CPUs for the busy-polling threads */
+
+	int stats;			/* collect latency statistics */
+	unsigned stats_interval;	/* statistics logging interval [s] */
+	pthread_t stats_thread;		/* statistics logging thread */
+	pthread_mutex_t stats_lock;
+	pthread_cond_t stats_cond;	/* signals stopping the thread */
+	int stats_stop;			/* stop statistics logging thread */
 };
 
 /*
@@ -147,10 +208,15 @@ struct rpmemd_fip {
 static void
 rpmemd_fip_set_nlanes(struct rpmemd_fip *fip, unsigned nlanes)
 {
+	/* the limit applies to each connection separately */
 	size_t max_nlanes = rpmem_fip_max_nlanes(fip->fi,
-			fip->persist_method, RPMEM_FIP_NODE_SERVER);
+			fip->persist_method, RPMEM_FIP_NODE_SERVER) *
+			fip->nconns;
 
 	fip->nlanes = max_nlanes < nlanes ? (unsigned)max_nlanes : nlanes;
+
+	if (fip->nconns > fip->nlanes)
+		fip->nconns = fip->nlanes;
 }
 
 /*
@@ -218,6 +284,7 @@ rpmemd_fip_set_resp(struct rpmemd_fip *fip, struct rpmem_resp_attr *resp)
 	resp->persist_method = fip->persist_method;
 	resp->raddr = (uint64_t)fip->addr;
 	resp->nlanes = fip->nlanes;
+	resp->nconns = fip->nconns;
 
 	return 0;
 err_port:
@@ -331,24 +398,39 @@ rpmemd_fip_fini_memory(struct rpmemd_fip *fip)
 }
 
 /*
- * rpmemd_fip_init_cq -- initialize completion queue
+ * rpmemd_fip_init_cq -- initialize connection's event and completion queues
  */
 static int
-rpmemd_fip_init_cq(struct rpmemd_fip *fip)
+rpmemd_fip_init_cq(struct rpmemd_fip *fip, struct rpmemd_fip_conn *conn)
 {
 	int ret = 0;
 
+	struct fi_eq_attr eq_attr = {
+		.size = 0,	/* use default */
+		.flags = 0,
+		.wait_obj = FI_WAIT_UNSPEC,
+		.signaling_vector = 0,
+		.wait_set = NULL,
+	};
+
+	ret = fi_eq_open(fip->fabric, &eq_attr, &conn->eq, NULL);
+	if (ret) {
+		RPMEMD_FI_ERR(ret, "opening event queue");
+		goto err_eq_open;
+	}
+
 	struct fi_cq_attr cq_attr = {
 		.size = fip->cq_size,
 		.flags = 0,
 		.format = FI_CQ_FORMAT_MSG, /* need context and flags */
-		.wait_obj = FI_WAIT_UNSPEC,
+		/* nobody blocks on the completion queue when busy polling */
+		.wait_obj = fip->busy_poll ? FI_WAIT_NONE : FI_WAIT_UNSPEC,
 		.signaling_vector = 0,
 		.wait_cond = FI_CQ_COND_NONE,
 		.wait_set = NULL,
 	};
 
-	ret = fi_cq_open(fip->domain, &cq_attr, &fip->cq, NULL);
+	ret = fi_cq_open(fip->domain, &cq_attr, &conn->cq, NULL);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "opening completion queue");
 		goto err_cq_open;
@@ -356,19 +438,25 @@ rpmemd_fip_init_cq(struct rpmemd_fip *fip)
 
 	return 0;
 err_cq_open:
+	RPMEMD_FI_CLOSE(conn->eq, "closing event queue");
+err_eq_open:
 	return ret;
 }
 
 /*
- * rpmemd_fip_fini_cq -- deinitialize completion queue
+ * rpmemd_fip_fini_cq -- deinitialize connection's event and completion queues
  */
 static int
-rpmemd_fip_fini_cq(struct rpmemd_fip *fip)
+rpmemd_fip_fini_cq(struct rpmemd_fip_conn *conn)
 {
 	int lret = 0;
 	int ret;
 
-	ret = RPMEMD_FI_CLOSE(fip->cq, "closing completion queue");
+	ret = RPMEMD_FI_CLOSE(conn->cq, "closing completion queue");
+	if (ret)
+		lret = ret;
+
+	ret = RPMEMD_FI_CLOSE(conn->eq, "closing event queue");
 	if (ret)
 		lret = ret;
 
@@ -379,19 +467,20 @@ rpmemd_fip_fini_cq(struct rpmemd_fip *fip)
  * rpmemd_fip_init_ep -- initialize active endpoint
  */
 static int
-rpmemd_fip_init_ep(struct rpmemd_fip *fip, struct fi_info *info)
+rpmemd_fip_init_ep(struct rpmemd_fip *fip, struct rpmemd_fip_conn *conn,
+	struct fi_info *info)
 {
 	int ret;
 
 	/* create an endpoint from fabric interface info */
-	ret = fi_endpoint(fip->domain, info, &fip->ep, NULL);
+	ret = fi_endpoint(fip->domain, info, &conn->ep, NULL);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "allocating endpoint");
 		goto err_endpoint;
 	}
 
 	/* bind event queue to the endpoint */
-	ret = fi_ep_bind(fip->ep, &fip->eq->fid, 0);
+	ret = fi_ep_bind(conn->ep, &conn->eq->fid, 0);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "binding event queue to endpoint");
 		goto err_bind_eq;
@@ -403,7 +492,7 @@ rpmemd_fip_init_ep(struct rpmemd_fip *fip, struct fi_info *info)
 	 * requests. Use selective completion implies adding FI_COMPLETE
 	 * flag to each WR which needs a completion.
 	 */
-	ret = fi_ep_bind(fip->ep, &fip->cq->fid,
+	ret = fi_ep_bind(conn->ep, &conn->cq->fid,
 			FI_RECV | FI_TRANSMIT | FI_SELECTIVE_COMPLETION);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "binding completion queue to endpoint");
@@ -411,7 +500,7 @@ rpmemd_fip_init_ep(struct rpmemd_fip *fip, struct fi_info *info)
 	}
 
 	/* enable the endpoint */
-	ret = fi_enable(fip->ep);
+	ret = fi_enable(conn->ep);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "enabling endpoint");
 		goto err_enable;
@@ -421,7 +510,7 @@ rpmemd_fip_init_ep(struct rpmemd_fip *fip, struct fi_info *info)
 err_enable:
 err_bind_cq:
 err_bind_eq:
-	RPMEMD_FI_CLOSE(fip->ep, "closing endpoint");
+	RPMEMD_FI_CLOSE(conn->ep, "closing endpoint");
 err_endpoint:
 	return -1;
 }
@@ -430,12 +519,12 @@ err_endpoint:
  * rpmemd_fip_fini_ep -- deinitialize active endpoint and return last error
  */
 static int
-rpmemd_fip_fini_ep(struct rpmemd_fip *fip)
+rpmemd_fip_fini_ep(struct rpmemd_fip_conn *conn)
 {
 	int lret = 0;
 	int ret;
 
-	ret = RPMEMD_FI_CLOSE(fip->ep, "closing endpoint");
+	ret = RPMEMD_FI_CLOSE(conn->ep, "closing endpoint");
 	if (ret)
 		lret = ret;
 
@@ -466,7 +555,7 @@ rpmemd_fip_fini_apm(struct rpmemd_fip *fip)
  * rpmemd_fip_fini_apm -- post work requests for APM
  */
 static int
-rpmemd_fip_post_apm(struct rpmemd_fip *fip)
+rpmemd_fip_post_apm(struct rpmemd_fip *fip, struct rpmemd_fip_conn *conn)
 {
 	/* nothing to do */
 	return 0;
@@ -496,10 +585,10 @@ rpmemd_fip_process_stop_apm(struct rpmemd_fip *fip)
  * rpmemd_fip_gpspm_post_msg -- post RECV buffer for GPSPM
  */
 static inline int
-rpmemd_fip_gpspm_post_msg(struct rpmemd_fip *fip,
+rpmemd_fip_gpspm_post_msg(struct rpmemd_fip_conn *conn,
 	struct rpmem_fip_msg *msg)
 {
-	int ret = rpmem_fip_recvmsg(fip->ep, msg);
+	int ret = rpmem_fip_recvmsg(conn->ep, msg);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "posting GPSPM recv buffer");
 		return ret;
@@ -512,10 +601,10 @@ rpmemd_fip_gpspm_post_msg(struct rpmemd_fip *fip,
  * rpmemd_fip_gpspm_post_resp -- post SEND buffer for GPSPM
  */
 static inline int
-rpmemd_fip_gpspm_post_resp(struct rpmemd_fip *fip,
+rpmemd_fip_gpspm_post_resp(struct rpmemd_fip_conn *conn,
 	struct rpmem_fip_msg *resp)
 {
-	int ret = rpmem_fip_sendmsg(fip->ep, resp);
+	int ret = rpmem_fip_sendmsg(conn->ep, resp);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "posting GPSPM send buffer");
 		return ret;
@@ -525,16 +614,17 @@ rpmemd_fip_gpspm_post_resp(struct rpmemd_fip *fip,
 }
 
 /*
- * rpmemd_fip_post_gpspm -- post all RECV messages
+ * rpmemd_fip_post_gpspm -- post all RECV messages of the connection's lanes
  */
 static int
-rpmemd_fip_post_gpspm(struct rpmemd_fip *fip)
+rpmemd_fip_post_gpspm(struct rpmemd_fip *fip, struct rpmemd_fip_conn *conn)
 {
 	int ret;
+	unsigned first = (unsigned)(conn - fip->conns);
 
-	for (unsigned i = 0; i < fip->nlanes; i++) {
+	for (unsigned i = first; i < fip->nlanes; i += fip->nconns) {
 		struct rpmemd_fip_lane *lanep = &fip->lanes[i];
-		ret = rpmemd_fip_gpspm_post_msg(fip, &lanep->recv);
+		ret = rpmemd_fip_gpspm_post_msg(conn, &lanep->recv);
 		if (ret)
 			goto err_post_resp;
 	}
@@ -611,6 +701,9 @@ rpmemd_fip_init_gpspm(struct rpmemd_fip *fip)
 			goto err_lane_init;
 		}
 
+		lanep->conn = &fip->conns[i % fip->nconns];
+		lanep->conn->nlanes++;
+
 		/* initialize RECV message */
 		rpmem_fip_msg_init(&lanep->recv,
 				fip->pmsg_mr_desc, 0,
@@ -683,92 +776,193 @@ rpmemd_fip_check_pmsg(struct rpmemd_fip *fip, struct rpmem_msg_persist *pmsg)
 		return -1;
 	}
 
-	uintptr_t raddr = pmsg->addr;
+	if (pmsg->nranges == 0 || pmsg->nranges > RPMEM_PERSIST_MAX_RANGES) {
+		RPMEMD_LOG(ERR, "invalid number of ranges -- %lu",
+				pmsg->nranges);
+		return -1;
+	}
+
 	uintptr_t laddr = (uintptr_t)fip->addr;
 
-	if (raddr < laddr || raddr + pmsg->size > laddr + fip->size) {
-		RPMEMD_LOG(ERR, "invalid address or size requested "
-			"for persist operation (0x%lx, %lu)",
-			raddr, pmsg->size);
-		return -1;
+	for (uint64_t i = 0; i < pmsg->nranges; i++) {
+		uintptr_t raddr = pmsg->ranges[i].addr;
+		uint64_t size = pmsg->ranges[i].size;
+
+		if (raddr < laddr || raddr + size > laddr + fip->size) {
+			RPMEMD_LOG(ERR, "invalid address or size requested "
+				"for persist operation (0x%lx, %lu)",
+				raddr, size);
+			return -1;
+		}
 	}
 
 	return 0;
 }
 
+static int rpmemd_fip_poll_cq(struct rpmemd_fip_poller *poller);
+
 /*
- * rpmemd_fip_worker -- worker callback which processes persist
- * operation in GPSPM
+ * rpmemd_fip_wait_send -- wait until last SEND message of the lane has
+ * been processed
+ *
+ * A busy-polling thread may be the only one which could read the SEND
+ * completion, so it keeps polling the completion queue meanwhile.
  */
 static int
-rpmemd_fip_worker(void *arg, void *data)
+rpmemd_fip_wait_send(struct rpmemd_fip *fip, struct rpmemd_fip_poller *poller,
+	struct rpmemd_fip_lane *lanep)
 {
-	struct rpmemd_fip *fip = arg;
-	struct rpmemd_fip_lane *lanep = data;
+	if (!poller)
+		return rpmem_fip_lane_wait(&lanep->lane, FI_SEND);
 
+	while (!fip->closing && (lanep->lane.sync & FI_SEND)) {
+		int ret = rpmemd_fip_poll_cq(poller);
+		if (unlikely(ret))
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmemd_fip_process_lanes -- process persist operations in GPSPM
+ *
+ * The lanes passed at once are processed in three passes: all the ranges
+ * are persisted (or only flushed, if the flush and drain functions are
+ * available), then a single drain is issued and only then the responses
+ * are sent back, so none of them is sent before the data is durable.
+ */
+static int
+rpmemd_fip_process_lanes(struct rpmemd_fip *fip,
+	struct rpmemd_fip_poller *poller, void **data, size_t count)
+{
 	int ret = 0;
+	uint64_t start = fip->stats ? rpmem_hist_now() : 0;
+
+	for (size_t l = 0; l < count; l++) {
+		struct rpmemd_fip_lane *lanep = data[l];
+
+		if (fip->stats)
+			rpmem_hist_add(&lanep->stats.queue,
+					start - lanep->recv_ts);
+
+		/*
+		 * Get persist message from the lane's RECV buffer.
+		 */
+		struct rpmem_msg_persist *pmsg =
+			rpmem_fip_msg_get_pmsg(&lanep->recv);
+
+		/* verify persist message */
+		ret = rpmemd_fip_check_pmsg(fip, pmsg);
+		if (unlikely(ret))
+			goto err;
+
+		for (uint64_t i = 0; i < pmsg->nranges; i++) {
+			void *addr = (void *)pmsg->ranges[i].addr;
+			size_t size = pmsg->ranges[i].size;
+
+			if (fip->drain)
+				fip->flush(addr, size);
+			else
+				fip->persist(addr, size);
+		}
+	}
 
-	/* wait until last SEND message has been processed */
-	rpmem_fip_lane_wait(&lanep->lane, FI_SEND);
+	/* a single drain for all the messages */
+	if (fip->drain)
+		fip->drain();
 
-	/*
-	 * Get persist message and persist message response from appropriate
-	 * buffers. The persist message is in lane's RECV buffer and the
-	 * persist response message in lane's SEND buffer.
-	 */
-	struct rpmem_msg_persist *pmsg = rpmem_fip_msg_get_pmsg(&lanep->recv);
-	struct rpmem_msg_persist_resp *pres =
-		rpmem_fip_msg_get_pres(&lanep->send);
+	uint64_t persisted = fip->stats ? rpmem_hist_now() : 0;
 
-	/* verify persist message */
-	ret = rpmemd_fip_check_pmsg(fip, pmsg);
-	if (unlikely(ret))
-		goto err;
+	for (size_t l = 0; l < count; l++) {
+		struct rpmemd_fip_lane *lanep = data[l];
 
-	/* return back the lane id */
-	pres->lane = pmsg->lane;
+		if (fip->stats)
+			rpmem_hist_add(&lanep->stats.persist,
+					persisted - start);
 
-	/*
-	 * Perform the persist operation.
-	 *
-	 * XXX
-	 *
-	 * Maybe the persist could be divided into flush + drain.
-	 * We could issue flush operation, do some other work like
-	 * posting RECV buffer and then call drain. Need to consider this.
-	 */
-	fip->persist((void *)pmsg->addr, pmsg->size);
+		/* wait until last SEND message has been processed */
+		ret = rpmemd_fip_wait_send(fip, poller, lanep);
+		if (unlikely(ret))
+			goto err;
+
+		/*
+		 * The persist message is in lane's RECV buffer and the
+		 * persist response message in lane's SEND buffer.
+		 */
+		struct rpmem_msg_persist *pmsg =
+			rpmem_fip_msg_get_pmsg(&lanep->recv);
+		struct rpmem_msg_persist_resp *pres =
+			rpmem_fip_msg_get_pres(&lanep->send);
+
+		/* return back the lane id */
+		pres->lane = pmsg->lane;
+
+		/* post lane's RECV buffer */
+		ret = rpmemd_fip_gpspm_post_msg(lanep->conn, &lanep->recv);
+		if (unlikely(ret))
+			goto err;
 
-	/* post lane's RECV buffer */
-	ret = rpmemd_fip_gpspm_post_msg(fip, &lanep->recv);
-	if (unlikely(ret))
-		goto err;
+		/* initialize lane for waiting for SEND completion */
+		rpmem_fip_lane_begin(&lanep->lane, FI_SEND);
 
-	/* initialize lane for waiting for SEND completion */
-	rpmem_fip_lane_begin(&lanep->lane, FI_SEND);
+		/* post lane's SEND buffer */
+		ret = rpmemd_fip_gpspm_post_resp(lanep->conn, &lanep->send);
+		if (unlikely(ret))
+			goto err;
 
-	/* post lane's SEND buffer */
-	ret = rpmemd_fip_gpspm_post_resp(fip, &lanep->send);
-	if (unlikely(ret))
-		goto err;
+		if (fip->stats)
+			rpmem_hist_add(&lanep->stats.total,
+					rpmem_hist_now() - lanep->recv_ts);
+	}
 err:
 	return ret;
 }
 
 /*
- * rpmemd_fip_cq_thread -- completion queue worker thread
+ * rpmemd_fip_worker -- worker callback which processes persist
+ * operations in GPSPM
  */
-static void *
-rpmemd_fip_cq_thread(void *arg)
+static int
+rpmemd_fip_worker(void *arg, void **data, size_t count)
+{
+	return rpmemd_fip_process_lanes(arg, NULL, data, count);
+}
+
+/*
+ * rpmemd_fip_cq_error -- log the error read from completion queue
+ */
+static void
+rpmemd_fip_cq_error(struct rpmemd_fip_conn *conn)
 {
-	struct rpmemd_fip *fip = arg;
 	struct fi_cq_err_entry err;
 	const char *str_err;
 	ssize_t sret;
+
+	sret = fi_cq_readerr(conn->cq, &err, 0);
+	if (sret < 0) {
+		RPMEMD_FI_ERR((int)sret, "error reading from completion queue: "
+			"cannot read error from completion queue");
+		return;
+	}
+
+	str_err = fi_cq_strerror(conn->cq, err.prov_errno, NULL, NULL, 0);
+	RPMEMD_LOG(ERR, "error reading from completion queue: %s", str_err);
+}
+
+/*
+ * rpmemd_fip_cq_thread -- connection's completion queue worker thread
+ */
+static void *
+rpmemd_fip_cq_thread(void *arg)
+{
+	struct rpmemd_fip_conn *conn = arg;
+	struct rpmemd_fip *fip = conn->fip;
+	ssize_t sret;
 	int ret;
 
 	while (!fip->closing) {
-		sret = fi_cq_sread(fip->cq, fip->cq_entries,
+		sret = fi_cq_sread(conn->cq, conn->cq_entries,
 				fip->cq_size, NULL,
 				RPMEM_FIP_CQ_WAIT_MS);
 		if (unlikely(fip->closing))
@@ -783,7 +977,7 @@ rpmemd_fip_cq_thread(void *arg)
 		}
 
 		for (ssize_t i = 0; i < sret; i++) {
-			struct fi_cq_msg_entry *entry = &fip->cq_entries[i];
+			struct fi_cq_msg_entry *entry = &conn->cq_entries[i];
 			RPMEMD_ASSERT(entry->op_context);
 
 			struct rpmemd_fip_lane *lanep = entry->op_context;
@@ -794,6 +988,9 @@ rpmemd_fip_cq_thread(void *arg)
 
 			/* add lane to worker's ring buffer */
 			if (entry->flags & FI_RECV) {
+				if (fip->stats)
+					lanep->recv_ts = rpmem_hist_now();
+
 				ret = rpmemd_fip_worker_push(lanep->worker,
 						lanep);
 			}
@@ -806,24 +1003,254 @@ rpmemd_fip_cq_thread(void *arg)
 
 	return 0;
 err_cq_read:
-	sret = fi_cq_readerr(fip->cq, &err, 0);
-	if (sret < 0) {
-		RPMEMD_FI_ERR((int)sret, "error reading from completion queue: "
-			"cannot read error from completion queue");
-		goto err;
+	rpmemd_fip_cq_error(conn);
+err:
+	return (void *)(uintptr_t)ret;
+}
+
+/*
+ * rpmemd_fip_poll_cq -- read and process available completion events
+ * in the busy-poll mode
+ *
+ * Only one thread at a time reads the connection's completion queue.  The
+ * lanes which received a persist message are added to the pending lanes of
+ * the poller which has read the completion.
+ */
+static int
+rpmemd_fip_poll_cq(struct rpmemd_fip_poller *poller)
+{
+	struct rpmemd_fip_conn *conn = poller->conn;
+
+	if (!__sync_bool_compare_and_swap(&conn->cq_polling, 0, 1))
+		return 0;
+
+	int ret = 0;
+	ssize_t sret = fi_cq_read(conn->cq, conn->cq_entries,
+			conn->fip->cq_size);
+	if (unlikely(sret < 0)) {
+		if (sret != -FI_EAGAIN) {
+			ret = (int)sret;
+			rpmemd_fip_cq_error(conn);
+		}
+		goto out;
+	}
+
+	for (ssize_t i = 0; i < sret; i++) {
+		struct fi_cq_msg_entry *entry = &conn->cq_entries[i];
+		RPMEMD_ASSERT(entry->op_context);
+
+		struct rpmemd_fip_lane *lanep = entry->op_context;
+
+		/* signal lane about SEND completion */
+		if (entry->flags & FI_SEND)
+			rpmem_fip_lane_signal(&lanep->lane, FI_SEND);
+
+		/* there is at most one RECV message posted per lane */
+		if (entry->flags & FI_RECV) {
+			if (conn->fip->stats)
+				lanep->recv_ts = rpmem_hist_now();
+
+			RPMEMD_ASSERT(poller->npending < conn->nlanes);
+			poller->pending[poller->npending++] = lanep;
+		}
+	}
+
+out:
+	__sync_synchronize();
+	conn->cq_polling = 0;
+
+	return ret;
+}
+
+/*
+ * rpmemd_fip_poll_thread -- busy-polling thread
+ */
+static void *
+rpmemd_fip_poll_thread(void *arg)
+{
+	struct rpmemd_fip_poller *poller = arg;
+	struct rpmemd_fip *fip = poller->fip;
+	int ret = 0;
+
+	if (poller->cpu >= 0) {
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET((size_t)poller->cpu, &cpuset);
+
+		errno = pthread_setaffinity_np(pthread_self(),
+				sizeof(cpuset), &cpuset);
+		if (errno) {
+			RPMEMD_LOG(ERR, "!setting affinity to CPU %d",
+					poller->cpu);
+			ret = -1;
+			goto err;
+		}
+	}
+
+	while (!fip->closing) {
+		ret = rpmemd_fip_poll_cq(poller);
+		if (unlikely(ret))
+			break;
+
+		if (!poller->npending)
+			continue;
+
+		/*
+		 * New pending lanes may show up while processing the current
+		 * ones, so the buffers are swapped.
+		 */
+		void **batch = poller->pending;
+		size_t count = poller->npending;
+		poller->pending = poller->batch;
+		poller->batch = batch;
+		poller->npending = 0;
+
+		ret = rpmemd_fip_process_lanes(fip, poller, batch, count);
+		if (unlikely(ret))
+			break;
 	}
 
-	str_err = fi_cq_strerror(fip->cq, err.prov_errno, NULL, NULL, 0);
-	RPMEMD_LOG(ERR, "error reading from completion queue: %s", str_err);
 err:
 	return (void *)(uintptr_t)ret;
 }
 
 /*
- * rpmemd_fip_process_start_gpspm -- start processing GPSPM messages
+ * rpmemd_fip_parse_cpus -- parse list of CPUs, e.g. "0,2-3"
+ *
+ * Returns number of CPUs stored in the array or -1 if the list is invalid.
+ */
+static ssize_t
+rpmemd_fip_parse_cpus(const char *str, int *cpus, size_t max)
+{
+	size_t n = 0;
+	const char *ptr = str;
+	char *end;
+
+	while (*ptr) {
+		errno = 0;
+		unsigned long first = strtoul(ptr, &end, 10);
+		if (errno || end == ptr)
+			return -1;
+
+		unsigned long last = first;
+		if (*end == '-') {
+			ptr = end + 1;
+			last = strtoul(ptr, &end, 10);
+			if (errno || end == ptr || last < first)
+				return -1;
+		}
+
+		if (last >= CPU_SETSIZE || last - first >= max - n)
+			return -1;
+
+		for (unsigned long cpu = first; cpu <= last; cpu++)
+			cpus[n++] = (int)cpu;
+
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return -1;
+
+		ptr = end;
+	}
+
+	return (ssize_t)n;
+}
+
+/*
+ * rpmemd_fip_process_start_busy -- start busy-polling threads of a connection
  */
 static int
-rpmemd_fip_process_start_gpspm(struct rpmemd_fip *fip)
+rpmemd_fip_process_start_busy(struct rpmemd_fip *fip,
+	struct rpmemd_fip_conn *conn, const int *cpus, size_t ncpus,
+	size_t *cpu_next)
+{
+	conn->pollers = calloc(fip->nthreads, sizeof(*conn->pollers));
+	if (!conn->pollers) {
+		RPMEMD_LOG(ERR, "!allocating pollers");
+		goto err_alloc_pollers;
+	}
+
+	size_t pi;
+	for (pi = 0; pi < fip->nthreads; pi++) {
+		struct rpmemd_fip_poller *poller = &conn->pollers[pi];
+
+		poller->fip = fip;
+		poller->conn = conn;
+		poller->cpu = ncpus ? cpus[(*cpu_next)++ % ncpus] : -1;
+		poller->batch = malloc(conn->nlanes * sizeof(*poller->batch));
+		poller->pending = malloc(conn->nlanes *
+				sizeof(*poller->pending));
+		if (!poller->batch || !poller->pending) {
+			RPMEMD_LOG(ERR, "!allocating poller's lanes");
+			goto err_poller;
+		}
+
+		errno = pthread_create(&poller->thread, NULL,
+				rpmemd_fip_poll_thread, poller);
+		if (errno) {
+			RPMEMD_LOG(ERR, "!creating poller's thread");
+			goto err_poller;
+		}
+	}
+
+	return 0;
+err_poller:
+	fip->closing = 1;
+	free(conn->pollers[pi].batch);
+	free(conn->pollers[pi].pending);
+	for (size_t i = 0; i < pi; i++) {
+		pthread_join(conn->pollers[i].thread, NULL);
+		free(conn->pollers[i].batch);
+		free(conn->pollers[i].pending);
+	}
+	free(conn->pollers);
+err_alloc_pollers:
+	return -1;
+}
+
+/*
+ * rpmemd_fip_process_stop_busy -- stop busy-polling threads of a connection
+ */
+static int
+rpmemd_fip_process_stop_busy(struct rpmemd_fip *fip,
+	struct rpmemd_fip_conn *conn)
+{
+	int lret = 0;
+
+	for (size_t i = 0; i < fip->nthreads; i++) {
+		struct rpmemd_fip_poller *poller = &conn->pollers[i];
+
+		void *tret;
+		errno = pthread_join(poller->thread, &tret);
+		if (errno) {
+			RPMEMD_LOG(ERR, "!joining poller's thread");
+			lret = -1;
+		} else {
+			int ret = (int)(uintptr_t)tret;
+			if (ret) {
+				RPMEMD_LOG(ERR, "poller failed with "
+					"code -- %d", ret);
+				lret = ret;
+			}
+		}
+
+		free(poller->batch);
+		free(poller->pending);
+	}
+
+	free(conn->pollers);
+
+	return lret;
+}
+
+/*
+ * rpmemd_fip_process_start_workers -- start completion queue thread and
+ * workers of a connection
+ */
+static int
+rpmemd_fip_process_start_workers(struct rpmemd_fip *fip,
+	struct rpmemd_fip_conn *conn)
 {
 	int ret = 0;
 
@@ -831,11 +1258,11 @@ rpmemd_fip_process_start_gpspm(struct rpmemd_fip *fip)
 	 * Ring buffer size so all lanes will have
 	 * free slot in worker's ring buffer.
 	 */
-	size_t ring_size = fip->nlanes / fip->nthreads + 1;
+	size_t ring_size = conn->nlanes / fip->nthreads + 1;
 
 	/* allocate workers */
-	fip->workers = malloc(fip->nthreads * sizeof(*fip->workers));
-	if (!fip->workers) {
+	conn->workers = malloc(fip->nthreads * sizeof(*conn->workers));
+	if (!conn->workers) {
 		RPMEMD_LOG(ERR, "!allocating workers");
 		ret = -1;
 		goto err_alloc_workers;
@@ -847,32 +1274,25 @@ rpmemd_fip_process_start_gpspm(struct rpmemd_fip *fip)
 	 */
 	size_t wi;
 	for (wi = 0; wi < fip->nthreads; wi++) {
-		fip->workers[wi] = rpmemd_fip_worker_init(fip,
+		conn->workers[wi] = rpmemd_fip_worker_init(fip,
 				&fip->closing, ring_size, rpmemd_fip_worker);
-		if (!fip->workers[wi]) {
+		if (!conn->workers[wi]) {
 			RPMEMD_LOG(ERR, "!initializing worker");
 			ret = -1;
 			goto err_worker;
 		}
 	}
 
-	/* assign a worker for each lane */
-	for (unsigned i = 0; i < fip->nlanes; i++) {
-		size_t wi = i % fip->nthreads;
-		fip->lanes[i].worker = fip->workers[wi];
-	}
-
-	/* allocate buffer for completion queue entries */
-	fip->cq_entries = malloc(fip->cq_size * sizeof(*fip->cq_entries));
-	if (!fip->cq_entries) {
-		RPMEMD_LOG(ERR, "!allocating completion events buffer");
-		ret = -1;
-		goto err_cq_entries;
+	/* assign a worker for each lane of the connection */
+	unsigned first = (unsigned)(conn - fip->conns);
+	for (unsigned i = first; i < fip->nlanes; i += fip->nconns) {
+		size_t wi = (i / fip->nconns) % fip->nthreads;
+		fip->lanes[i].worker = conn->workers[wi];
 	}
 
 	/* create completion queue worker thread */
-	errno = pthread_create(&fip->cq_thread, NULL,
-			rpmemd_fip_cq_thread, fip);
+	errno = pthread_create(&conn->cq_thread, NULL,
+			rpmemd_fip_cq_thread, conn);
 	if (errno) {
 		RPMEMD_LOG(ERR, "!starting cq thread");
 		ret = -1;
@@ -881,36 +1301,27 @@ rpmemd_fip_process_start_gpspm(struct rpmemd_fip *fip)
 
 	return 0;
 err_cq_thread:
-	free(fip->cq_entries);
-err_cq_entries:
 err_worker:
 	for (size_t i = 0; i < wi; i++)
-		rpmemd_fip_worker_fini(fip->workers[i]);
+		rpmemd_fip_worker_fini(conn->workers[i]);
+	free(conn->workers);
 err_alloc_workers:
 	return ret;
 }
 
 /*
- * rpmemd_fip_process_stop_gpspm -- stop processing GPSPM messages
+ * rpmemd_fip_process_stop_workers -- stop completion queue thread and
+ * workers of a connection
  */
 static int
-rpmemd_fip_process_stop_gpspm(struct rpmemd_fip *fip)
+rpmemd_fip_process_stop_workers(struct rpmemd_fip *fip,
+	struct rpmemd_fip_conn *conn)
 {
 	int lret = 0;
 
-	/* this stops all worker threads */
-	fip->closing = 1;
-
-	/*
-	 * Signal all lanes that SEND has been completed.
-	 * Some workers may still be waiting for this completion.
-	 */
-	for (unsigned i = 0; i < fip->nlanes; i++)
-		rpmem_fip_lane_signal(&fip->lanes[i].lane, FI_SEND);
-
 	void *tret;
 	int ret;
-	errno = pthread_join(fip->cq_thread, &tret);
+	errno = pthread_join(conn->cq_thread, &tret);
 	if (errno) {
 		RPMEMD_LOG(ERR, "!joining cq thread");
 		lret = -1;
@@ -923,17 +1334,126 @@ rpmemd_fip_process_stop_gpspm(struct rpmemd_fip *fip)
 		}
 	}
 
-	free(fip->cq_entries);
-
 	for (size_t i = 0; i < fip->nthreads; i++) {
-		ret = rpmemd_fip_worker_fini(fip->workers[i]);
+		ret = rpmemd_fip_worker_fini(conn->workers[i]);
 		if (ret) {
 			RPMEMD_LOG(ERR, "worker failed with code -- %d", ret);
 			lret = ret;
 		}
 	}
 
-	free(fip->workers);
+	free(conn->workers);
+
+	return lret;
+}
+
+/*
+ * rpmemd_fip_process_start_gpspm -- start processing GPSPM messages
+ *
+ * Each connection gets its own completion queue thread and workers or,
+ * in the busy-poll mode, its own busy-polling threads.
+ */
+static int
+rpmemd_fip_process_start_gpspm(struct rpmemd_fip *fip)
+{
+	int ret = -1;
+	int *cpus = NULL;
+	ssize_t ncpus = 0;
+	size_t cpu_next = 0;
+
+	if (fip->busy_poll && fip->poll_cpus) {
+		cpus = malloc(CPU_SETSIZE * sizeof(*cpus));
+		if (!cpus) {
+			RPMEMD_LOG(ERR, "!allocating CPUs list");
+			goto err_cpus;
+		}
+
+		ncpus = rpmemd_fip_parse_cpus(fip->poll_cpus, cpus,
+				CPU_SETSIZE);
+		if (ncpus <= 0) {
+			RPMEMD_LOG(ERR, "invalid list of CPUs -- '%s'",
+					fip->poll_cpus);
+			goto err_parse;
+		}
+	}
+
+	unsigned c;
+	for (c = 0; c < fip->nconns; c++) {
+		struct rpmemd_fip_conn *conn = &fip->conns[c];
+
+		/* allocate buffer for completion queue entries */
+		conn->cq_entries = malloc(fip->cq_size *
+				sizeof(*conn->cq_entries));
+		if (!conn->cq_entries) {
+			RPMEMD_LOG(ERR, "!allocating completion events buffer");
+			goto err_conn;
+		}
+
+		if (fip->busy_poll)
+			ret = rpmemd_fip_process_start_busy(fip, conn, cpus,
+					(size_t)ncpus, &cpu_next);
+		else
+			ret = rpmemd_fip_process_start_workers(fip, conn);
+
+		if (ret) {
+			free(conn->cq_entries);
+			goto err_conn;
+		}
+	}
+
+	free(cpus);
+
+	return 0;
+err_conn:
+	fip->closing = 1;
+	for (unsigned i = 0; i < fip->nlanes; i++)
+		rpmem_fip_lane_signal(&fip->lanes[i].lane, FI_SEND);
+	while (c--) {
+		struct rpmemd_fip_conn *conn = &fip->conns[c];
+		if (fip->busy_poll)
+			rpmemd_fip_process_stop_busy(fip, conn);
+		else
+			rpmemd_fip_process_stop_workers(fip, conn);
+		free(conn->cq_entries);
+	}
+	ret = -1;
+err_parse:
+	free(cpus);
+err_cpus:
+	return ret;
+}
+
+/*
+ * rpmemd_fip_process_stop_gpspm -- stop processing GPSPM messages
+ */
+static int
+rpmemd_fip_process_stop_gpspm(struct rpmemd_fip *fip)
+{
+	int lret = 0;
+	int ret;
+
+	/* this stops all worker threads */
+	fip->closing = 1;
+
+	/*
+	 * Signal all lanes that SEND has been completed.
+	 * Some workers may still be waiting for this completion.
+	 */
+	for (unsigned i = 0; i < fip->nlanes; i++)
+		rpmem_fip_lane_signal(&fip->lanes[i].lane, FI_SEND);
+
+	for (unsigned c = 0; c < fip->nconns; c++) {
+		struct rpmemd_fip_conn *conn = &fip->conns[c];
+
+		if (fip->busy_poll)
+			ret = rpmemd_fip_process_stop_busy(fip, conn);
+		else
+			ret = rpmemd_fip_process_stop_workers(fip, conn);
+		if (ret)
+			lret = ret;
+
+		free(conn->cq_entries);
+	}
 
 	return lret;
 }
@@ -967,9 +1487,26 @@ rpmemd_fip_set_attr(struct rpmemd_fip *fip, struct rpmemd_fip_attr *attr)
 	fip->persist_method = attr->persist_method;
 	fip->persist = attr->persist;
 
+	if (attr->flush && attr->drain) {
+		fip->flush = attr->flush;
+		fip->drain = attr->drain;
+	}
+
+	fip->busy_poll = attr->busy_poll;
+	fip->poll_cpus = attr->poll_cpus;
+
+	fip->stats = attr->stats || attr->stats_interval;
+	fip->stats_interval = attr->stats_interval;
+
+	fip->nconns = attr->nconns ? attr->nconns : 1;
+	if (fip->nconns > RPMEM_MAX_NCONNS)
+		fip->nconns = RPMEM_MAX_NCONNS;
+
 	rpmemd_fip_set_nlanes(fip, attr->nlanes);
 
-	fip->cq_size = rpmem_fip_cq_size(fip->nlanes,
+	/* lanes of a single connection */
+	size_t nlanes = (fip->nlanes + fip->nconns - 1) / fip->nconns;
+	fip->cq_size = rpmem_fip_cq_size(nlanes,
 			fip->persist_method,
 			RPMEM_FIP_NODE_SERVER);
 
@@ -1008,6 +1545,16 @@ rpmemd_fip_init(const char *node, const char *service,
 
 	rpmemd_fip_set_attr(fip, attr);
 
+	fip->conns = calloc(fip->nconns, sizeof(*fip->conns));
+	if (!fip->conns) {
+		RPMEMD_LOG(ERR, "!allocating connections");
+		*err = RPMEM_ERR_FATAL;
+		goto err_alloc_conns;
+	}
+
+	for (unsigned i = 0; i < fip->nconns; i++)
+		fip->conns[i].fip = fip;
+
 	ret = rpmemd_fip_init_fabric_res(fip);
 	if (ret) {
 		*err = RPMEM_ERR_FATAL;
@@ -1048,6 +1595,8 @@ err_init:
 err_init_memory:
 	rpmemd_fip_fini_fabric_res(fip);
 err_init_fabric_res:
+	free(fip->conns);
+err_alloc_conns:
 	fi_freeinfo(fip->fi);
 err_getinfo:
 	free(fip);
@@ -1063,18 +1612,19 @@ rpmemd_fip_fini(struct rpmemd_fip *fip)
 	fip->ops->fini(fip);
 	rpmemd_fip_fini_memory(fip);
 	rpmemd_fip_fini_fabric_res(fip);
+	free(fip->conns);
 	fi_freeinfo(fip->fi);
 }
 
 /*
- * rpmemd_fip_accept -- accept a single connection request
+ * rpmemd_fip_accept_conn -- accept a single connection request
  *
  * XXX
  *
  * We probably need some timeouts for connection related events.
  */
-int
-rpmemd_fip_accept(struct rpmemd_fip *fip)
+static int
+rpmemd_fip_accept_conn(struct rpmemd_fip *fip, struct rpmemd_fip_conn *conn)
 {
 	int ret;
 	struct fi_eq_cm_entry entry;
@@ -1084,26 +1634,26 @@ rpmemd_fip_accept(struct rpmemd_fip *fip)
 	if (ret)
 		goto err_event_connreq;
 
-	ret = rpmemd_fip_init_cq(fip);
+	ret = rpmemd_fip_init_cq(fip, conn);
 	if (ret)
 		goto err_init_cq;
 
-	ret = rpmemd_fip_init_ep(fip, entry.info);
+	ret = rpmemd_fip_init_ep(fip, conn, entry.info);
 	if (ret)
 		goto err_init_ep;
 
-	ret = fip->ops->post(fip);
+	ret = fip->ops->post(fip, conn);
 	if (ret)
 		goto err_post;
 
-	ret = fi_accept(fip->ep, NULL, 0);
+	ret = fi_accept(conn->ep, NULL, 0);
 	if (ret) {
 		RPMEMD_FI_ERR(ret, "accepting connection request");
 		goto err_accept;
 	}
 
-	ret = rpmem_fip_read_eq(fip->eq, &entry,
-			FI_CONNECTED, &fip->ep->fid, -1);
+	ret = rpmem_fip_read_eq(conn->eq, &entry,
+			FI_CONNECTED, &conn->ep->fid, -1);
 	if (ret)
 		goto err_event_connected;
 
@@ -1111,28 +1661,63 @@ rpmemd_fip_accept(struct rpmemd_fip *fip)
 err_event_connected:
 err_accept:
 err_post:
-	rpmemd_fip_fini_ep(fip);
+	rpmemd_fip_fini_ep(conn);
 err_init_ep:
-	rpmemd_fip_fini_cq(fip);
+	rpmemd_fip_fini_cq(conn);
 err_init_cq:
 err_event_connreq:
 	return -1;
 }
 
+/*
+ * rpmemd_fip_accept -- accept connection requests
+ *
+ * The client establishes its connections one by one, so the n-th accepted
+ * connection serves the lanes of the client's n-th connection.
+ */
+int
+rpmemd_fip_accept(struct rpmemd_fip *fip)
+{
+	int ret;
+
+	for (fip->nconnected = 0; fip->nconnected < fip->nconns;
+			fip->nconnected++) {
+		ret = rpmemd_fip_accept_conn(fip,
+				&fip->conns[fip->nconnected]);
+		if (ret)
+			goto err_accept;
+	}
+
+	return 0;
+err_accept:
+	rpmemd_fip_close(fip);
+	return -1;
+}
+
 /*
  * rpmemd_fip_wait_close -- wait specified time for connection closed event
+ * on each of the connections
  */
 int
 rpmemd_fip_wait_close(struct rpmemd_fip *fip, int timeout)
 {
 	struct fi_eq_cm_entry entry;
+	int ret;
 
-	return rpmem_fip_read_eq(fip->eq, &entry, FI_SHUTDOWN,
-			&fip->ep->fid, timeout);
+	for (unsigned i = 0; i < fip->nconnected; i++) {
+		struct rpmemd_fip_conn *conn = &fip->conns[i];
+
+		ret = rpmem_fip_read_eq(conn->eq, &entry, FI_SHUTDOWN,
+				&conn->ep->fid, timeout);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
 }
 
 /*
- * rpmemd_fip_close -- close the connection
+ * rpmemd_fip_close -- close the connections
  */
 int
 rpmemd_fip_close(struct rpmemd_fip *fip)
@@ -1140,24 +1725,167 @@ rpmemd_fip_close(struct rpmemd_fip *fip)
 	int ret;
 	int lret = 0;
 
-	ret = rpmemd_fip_fini_ep(fip);
-	if (ret)
-		lret = ret;
+	for (unsigned i = 0; i < fip->nconnected; i++) {
+		ret = rpmemd_fip_fini_ep(&fip->conns[i]);
+		if (ret)
+			lret = ret;
 
-	ret = rpmemd_fip_fini_cq(fip);
-	if (ret)
-		lret = ret;
+		ret = rpmemd_fip_fini_cq(&fip->conns[i]);
+		if (ret)
+			lret = ret;
+	}
+
+	fip->nconnected = 0;
 
 	return lret;
 }
 
+/*
+ * rpmemd_fip_stats_log_hist -- (internal) log summary and non-empty
+ * buckets of a latency histogram
+ */
+static void
+rpmemd_fip_stats_log_hist(const char *name, const struct rpmem_hist *hist)
+{
+	RPMEMD_LOG(NOTICE, "%s latency [ns]: count %" PRIu64
+			" mean %" PRIu64 " p50 %" PRIu64 " p99 %" PRIu64
+			" p99.9 %" PRIu64 " max %" PRIu64, name, hist->count,
+			rpmem_hist_mean(hist),
+			rpmem_hist_quantile(hist, 50, 100),
+			rpmem_hist_quantile(hist, 99, 100),
+			rpmem_hist_quantile(hist, 999, 1000),
+			hist->max);
+
+	for (unsigned b = 0; b < RPMEM_HIST_NBUCKETS; b++) {
+		if (!hist->buckets[b])
+			continue;
+
+		RPMEMD_LOG(INFO, "%s latency [ns]: < %" PRIu64 ": %" PRIu64,
+				name, (uint64_t)2 << b, hist->buckets[b]);
+	}
+}
+
+/*
+ * rpmemd_fip_stats_log -- (internal) log latency statistics
+ */
+static void
+rpmemd_fip_stats_log(struct rpmemd_fip *fip)
+{
+	struct rpmemd_fip_stats stats;
+	rpmemd_fip_stats(fip, &stats);
+
+	rpmemd_fip_stats_log_hist("queue", &stats.queue);
+	rpmemd_fip_stats_log_hist("persist", &stats.persist);
+	rpmemd_fip_stats_log_hist("total", &stats.total);
+}
+
+/*
+ * rpmemd_fip_stats_thread -- (internal) log latency statistics periodically
+ */
+static void *
+rpmemd_fip_stats_thread(void *arg)
+{
+	struct rpmemd_fip *fip = arg;
+
+	util_mutex_lock(&fip->stats_lock);
+	while (!fip->stats_stop) {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += fip->stats_interval;
+
+		int ret;
+		do {
+			ret = pthread_cond_timedwait(&fip->stats_cond,
+					&fip->stats_lock, &ts);
+		} while (!fip->stats_stop && ret != ETIMEDOUT);
+
+		if (fip->stats_stop)
+			break;
+
+		rpmemd_fip_stats_log(fip);
+	}
+	util_mutex_unlock(&fip->stats_lock);
+
+	return NULL;
+}
+
+/*
+ * rpmemd_fip_stats_start -- (internal) start statistics logging thread
+ */
+static int
+rpmemd_fip_stats_start(struct rpmemd_fip *fip)
+{
+	fip->stats_stop = 0;
+
+	errno = pthread_mutex_init(&fip->stats_lock, NULL);
+	if (errno) {
+		RPMEMD_LOG(ERR, "!initializing statistics lock");
+		goto err_lock;
+	}
+
+	errno = pthread_cond_init(&fip->stats_cond, NULL);
+	if (errno) {
+		RPMEMD_LOG(ERR, "!initializing statistics condition");
+		goto err_cond;
+	}
+
+	errno = pthread_create(&fip->stats_thread, NULL,
+			rpmemd_fip_stats_thread, fip);
+	if (errno) {
+		RPMEMD_LOG(ERR, "!creating statistics thread");
+		goto err_thread;
+	}
+
+	return 0;
+err_thread:
+	pthread_cond_destroy(&fip->stats_cond);
+err_cond:
+	pthread_mutex_destroy(&fip->stats_lock);
+err_lock:
+	return -1;
+}
+
+/*
+ * rpmemd_fip_stats_stop -- (internal) stop statistics logging thread
+ */
+static int
+rpmemd_fip_stats_stop(struct rpmemd_fip *fip)
+{
+	util_mutex_lock(&fip->stats_lock);
+	fip->stats_stop = 1;
+	pthread_cond_signal(&fip->stats_cond);
+	util_mutex_unlock(&fip->stats_lock);
+
+	errno = pthread_join(fip->stats_thread, NULL);
+	if (errno) {
+		RPMEMD_LOG(ERR, "!waiting for statistics thread");
+		return -1;
+	}
+
+	pthread_cond_destroy(&fip->stats_cond);
+	pthread_mutex_destroy(&fip->stats_lock);
+
+	/* the statistics of the whole processing */
+	rpmemd_fip_stats_log(fip);
+
+	return 0;
+}
+
 /*
  * rpmemd_fip_process_start -- start processing
  */
 int
 rpmemd_fip_process_start(struct rpmemd_fip *fip)
 {
-	return fip->ops->process_start(fip);
+	int ret = fip->ops->process_start(fip);
+	if (ret || !fip->stats_interval)
+		return ret;
+
+	ret = rpmemd_fip_stats_start(fip);
+	if (ret)
+		fip->ops->process_stop(fip);
+
+	return ret;
 }
 
 /*
@@ -1166,5 +1894,35 @@ rpmemd_fip_process_start(struct rpmemd_fip *fip)
 int
 rpmemd_fip_process_stop(struct rpmemd_fip *fip)
 {
-	return fip->ops->process_stop(fip);
+	int lret = 0;
+	if (fip->stats_interval)
+		lret = rpmemd_fip_stats_stop(fip);
+
+	int ret = fip->ops->process_stop(fip);
+
+	return ret ? ret : lret;
+}
+
+/*
+ * rpmemd_fip_stats -- collect latency statistics of all the lanes
+ *
+ * Only the persist messages of GPSPM are processed by the daemon, so
+ * in APM all the histograms are empty.  The statistics are collected
+ * only if enabled by the stats or stats_interval attribute.
+ */
+void
+rpmemd_fip_stats(struct rpmemd_fip *fip, struct rpmemd_fip_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!fip->stats || fip->persist_method != RPMEM_PM_GPSPM)
+		return;
+
+	for (unsigned l = 0; l < fip->nlanes; l++) {
+		struct rpmemd_fip_stats *lstats = &fip->lanes[l].stats;
+
+		rpmem_hist_merge(&stats->queue, &lstats->queue);
+		rpmem_hist_merge(&stats->persist, &lstats->persist);
+		rpmem_hist_merge(&stats->total, &lstats->total);
+	}
 }
@@ -42,10 +42,46 @@ struct rpmemd_fip_attr {
 	void *addr;
 	size_t size;
 	unsigned nlanes;
-	size_t nthreads;
+	unsigned nconns;	/* number of connections, 0 means 1 */
+	size_t nthreads;	/* number of threads per connection */
 	enum rpmem_provider provider;
 	enum rpmem_persist_method persist_method;
 	void (*persist)(const void *addr, size_t len);
+
+	/*
+	 * Optional, if both are set the persist operation is split into
+	 * flushing every message and a single drain for all the messages
+	 * processed by a worker at once.
+	 */
+	void (*flush)(const void *addr, size_t len);
+	void (*drain)(void);
+
+	/*
+	 * If set, the processing threads busy poll the completion queue
+	 * instead of waiting for completions, optionally pinned to the CPUs
+	 * from the list, e.g. "0,2-3", assigned to them in a round-robin way.
+	 * The list is parsed when the processing starts.
+	 */
+	int busy_poll;
+	const char *poll_cpus;
+
+	/*
+	 * If set, the latency of processing persist messages is measured,
+	 * see rpmemd_fip_stats().  If stats_interval is not zero the
+	 * statistics are also logged every stats_interval seconds and when
+	 * the processing stops.
+	 */
+	int stats;
+	unsigned stats_interval;
+};
+
+/*
+ * rpmemd_fip_stats -- persist message latency statistics, see rpmem_hist.h
+ */
+struct rpmemd_fip_stats {
+	struct rpmem_hist queue;	/* from receiving until processing */
+	struct rpmem_hist persist;	/* making the data durable */
+	struct rpmem_hist total;	/* from receiving until responding */
 };
 
 struct rpmemd_fip *rpmemd_fip_init(const char *node,
@@ -60,3 +96,4 @@ int rpmemd_fip_process_start(struct rpmemd_fip *fip);
 int rpmemd_fip_process_stop(struct rpmemd_fip *fip);
 int rpmemd_fip_wait_close(struct rpmemd_fip *fip, int timeout);
 int rpmemd_fip_close(struct rpmemd_fip *fip);
+void rpmemd_fip_stats(struct rpmemd_fip *fip, struct rpmemd_fip_stats *stats);
@@ -122,3 +122,19 @@ rpmemd_fip_ring_pop(struct rpmemd_fip_ring *ring)
 
 	return ret;
 }
+
+/*
+ * rpmemd_fip_ring_pop_batch -- pop up to max elements from the ring buffer
+ * and return the number of elements popped
+ */
+static inline size_t
+rpmemd_fip_ring_pop_batch(struct rpmemd_fip_ring *ring, void **data,
+	size_t max)
+{
+	size_t count = 0;
+	while (count < max &&
+		(data[count] = rpmemd_fip_ring_pop(ring)) != NULL)
+		count++;
+
+	return count;
+}
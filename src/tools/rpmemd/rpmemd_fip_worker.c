@@ -49,6 +49,8 @@ struct rpmemd_fip_worker {
 	volatile int *stop;
 	struct rpmemd_fip *arg;
 	struct rpmemd_fip_ring *ring;
+	void **batch;		/* entries popped from the ring at once */
+	size_t size;		/* size of the ring buffer */
 	pthread_t thread;
 	pthread_cond_t cond;
 	pthread_mutex_t lock;
@@ -75,7 +77,8 @@ rpmemd_fip_worker_thread_func(void *arg)
 			pthread_cond_wait(&worker->cond, &worker->lock);
 		}
 
-		void *data = rpmemd_fip_ring_pop(worker->ring);
+		size_t count = rpmemd_fip_ring_pop_batch(worker->ring,
+				worker->batch, worker->size);
 
 		util_mutex_unlock(&worker->lock);
 
@@ -87,7 +90,7 @@ rpmemd_fip_worker_thread_func(void *arg)
 			break;
 
 		/* process the data */
-		ret = worker->func(worker->arg, data);
+		ret = worker->func(worker->arg, worker->batch, count);
 		if (ret)
 			break;
 	}
@@ -111,6 +114,7 @@ rpmemd_fip_worker_init(void *arg, volatile int *stop,
 	worker->stop = stop;
 	worker->arg = arg;
 	worker->func = func;
+	worker->size = size;
 
 	/* allocate a ring buffer */
 	worker->ring = rpmemd_fip_ring_alloc(size);
@@ -119,6 +123,13 @@ rpmemd_fip_worker_init(void *arg, volatile int *stop,
 		goto err_ring;
 	}
 
+	/* allocate a buffer for entries processed at once */
+	worker->batch = malloc(size * sizeof(*worker->batch));
+	if (!worker->batch) {
+		RPMEMD_LOG(ERR, "!allocating batch buffer");
+		goto err_batch;
+	}
+
 	errno = pthread_mutex_init(&worker->lock, NULL);
 	if (errno) {
 		RPMEMD_LOG(ERR, "!creating worker's lock");
@@ -144,6 +155,8 @@ err_thread:
 err_cond:
 	pthread_mutex_destroy(&worker->lock);
 err_lock:
+	free(worker->batch);
+err_batch:
 	rpmemd_fip_ring_free(worker->ring);
 err_ring:
 	free(worker);
@@ -191,6 +204,7 @@ rpmemd_fip_worker_fini(struct rpmemd_fip_worker *worker)
 		ret = -1;
 	}
 
+	free(worker->batch);
 	rpmemd_fip_ring_free(worker->ring);
 
 	free(worker);
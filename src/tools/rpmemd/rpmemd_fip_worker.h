@@ -36,7 +36,11 @@
 
 struct rpmemd_fip_worker;
 
-typedef int (*rpmemd_fip_worker_fn)(void *arg, void *data);
+/*
+ * The worker function is called with all the entries found in the ring
+ * buffer at once, so it can process them as a batch.
+ */
+typedef int (*rpmemd_fip_worker_fn)(void *arg, void **data, size_t count);
 
 struct rpmemd_fip_worker *rpmemd_fip_worker_init(void *arg,
 	volatile int *stop, size_t size, rpmemd_fip_worker_fn func);
@@ -88,6 +88,7 @@ rpmemd_obc_check_msg_hdr(struct rpmem_msg_hdr *hdrp)
 	case RPMEM_MSG_TYPE_CREATE:
 	case RPMEM_MSG_TYPE_REMOVE:
 	case RPMEM_MSG_TYPE_CLOSE:
+	case RPMEM_MSG_TYPE_CHECKSUM:
 		/* all messages from client to server are fine */
 		break;
 	default:
@@ -242,6 +243,41 @@ rpmemd_obc_ntoh_check_msg_close(struct rpmem_msg_hdr *hdrp)
 	return 0;
 }
 
+/*
+ * rpmemd_obc_ntoh_check_msg_checksum -- convert and check checksum request
+ * message
+ */
+static int
+rpmemd_obc_ntoh_check_msg_checksum(struct rpmem_msg_hdr *hdrp)
+{
+	struct rpmem_msg_checksum *msg = (struct rpmem_msg_checksum *)hdrp;
+
+	/* the header is still in network byte order */
+	if (be64toh(hdrp->size) != sizeof(*msg)) {
+		RPMEMD_LOG(ERR, "invalid checksum message size -- %lu",
+				be64toh(hdrp->size));
+		return -1;
+	}
+
+	rpmem_ntoh_msg_checksum(msg);
+
+	if (!msg->len || !msg->blk_size || msg->offset % 4 ||
+			msg->len % 4 || msg->blk_size % 4 ||
+			msg->offset + msg->len < msg->offset) {
+		RPMEMD_LOG(ERR, "invalid checksum request range "
+			"(%lu, %lu, %lu)", msg->offset, msg->len,
+			msg->blk_size);
+		return -1;
+	}
+
+	if ((msg->len - 1) / msg->blk_size >= RPMEM_CHECKSUM_MAX_BLOCKS) {
+		RPMEMD_LOG(ERR, "too many blocks in checksum request");
+		return -1;
+	}
+
+	return 0;
+}
+
 typedef int (*rpmemd_obc_ntoh_check_msg_fn)(struct rpmem_msg_hdr *hdrp);
 
 static rpmemd_obc_ntoh_check_msg_fn rpmemd_obc_ntoh_check_msg[] = {
@@ -249,6 +285,7 @@ static rpmemd_obc_ntoh_check_msg_fn rpmemd_obc_ntoh_check_msg[] = {
 	[RPMEM_MSG_TYPE_OPEN]	= rpmemd_obc_ntoh_check_msg_open,
 	[RPMEM_MSG_TYPE_REMOVE]	= rpmemd_obc_ntoh_check_msg_remove,
 	[RPMEM_MSG_TYPE_CLOSE]	= rpmemd_obc_ntoh_check_msg_close,
+	[RPMEM_MSG_TYPE_CHECKSUM] = rpmemd_obc_ntoh_check_msg_checksum,
 };
 
 /*
@@ -265,6 +302,7 @@ rpmemd_obc_process_create(struct rpmemd_obc_client *client,
 		.nlanes = (unsigned)msg->nlanes,
 		.pool_desc = (char *)msg->pool_desc.desc,
 		.provider = (enum rpmem_provider)msg->provider,
+		.nconns = (unsigned)msg->nconns,
 	};
 
 	return req_cb->create(client, arg, &req, &msg->pool_attr);
@@ -284,6 +322,7 @@ rpmemd_obc_process_open(struct rpmemd_obc_client *client,
 		.nlanes = (unsigned)msg->nlanes,
 		.pool_desc = (const char *)msg->pool_desc.desc,
 		.provider = (enum rpmem_provider)msg->provider,
+		.nconns = (unsigned)msg->nconns,
 	};
 
 	return req_cb->open(client, arg, &req);
@@ -313,6 +352,20 @@ rpmemd_obc_process_close(struct rpmemd_obc_client *client,
 	return req_cb->close(client, arg);
 }
 
+/*
+ * rpmemd_obc_process_checksum -- process checksum request
+ */
+static int
+rpmemd_obc_process_checksum(struct rpmemd_obc_client *client,
+	struct rpmemd_obc_client_requests *req_cb, void *arg,
+	struct rpmem_msg_hdr *hdrp)
+{
+	struct rpmem_msg_checksum *msg = (struct rpmem_msg_checksum *)hdrp;
+
+	return req_cb->checksum(client, arg, msg->offset, msg->len,
+			msg->blk_size);
+}
+
 typedef int (*rpmemd_obc_process_fn)(struct rpmemd_obc_client *client,
 		struct rpmemd_obc_client_requests *req_cb, void *arg,
 		struct rpmem_msg_hdr *hdrp);
@@ -322,6 +375,7 @@ static rpmemd_obc_process_fn rpmemd_obc_process[] = {
 	[RPMEM_MSG_TYPE_OPEN]	= rpmemd_obc_process_open,
 	[RPMEM_MSG_TYPE_REMOVE]	= rpmemd_obc_process_remove,
 	[RPMEM_MSG_TYPE_CLOSE]	= rpmemd_obc_process_close,
+	[RPMEM_MSG_TYPE_CHECKSUM] = rpmemd_obc_process_checksum,
 };
 
 /*
@@ -681,6 +735,7 @@ rpmemd_obc_client_process(struct rpmemd_obc_client *client,
 	RPMEMD_ASSERT(req_cb->open != NULL);
 	RPMEMD_ASSERT(req_cb->remove != NULL);
 	RPMEMD_ASSERT(req_cb->close != NULL);
+	RPMEMD_ASSERT(req_cb->checksum != NULL);
 
 	if (!rpmemd_obc_client_is_connected(client))
 		RPMEMD_FATAL("client not connected");
@@ -720,6 +775,7 @@ rpmemd_obc_client_create_resp(struct rpmemd_obc_client *client,
 			.raddr	= res->raddr,
 			.persist_method = res->persist_method,
 			.nlanes = res->nlanes,
+			.nconns = res->nconns,
 		},
 	};
 
@@ -748,6 +804,7 @@ rpmemd_obc_client_open_resp(struct rpmemd_obc_client *client,
 			.raddr	= res->raddr,
 			.persist_method = res->persist_method,
 			.nlanes = res->nlanes,
+			.nconns = res->nconns,
 		},
 		.pool_attr = *pool_attr,
 	};
@@ -796,3 +853,48 @@ rpmemd_obc_client_remove_resp(struct rpmemd_obc_client *client,
 
 	return rpmem_obc_send(client->sockfd, &resp, sizeof(resp));
 }
+
+/*
+ * rpmemd_obc_client_checksum_resp -- send checksum request response message
+ *
+ * The checksums are sent only if the status is zero.
+ */
+int
+rpmemd_obc_client_checksum_resp(struct rpmemd_obc_client *client,
+	int status, const uint64_t *sums, size_t nsums)
+{
+	if (status)
+		nsums = 0;
+
+	size_t sums_size = nsums * sizeof(*sums);
+	struct rpmem_msg_checksum_resp resp = {
+		.hdr = {
+			.type	= RPMEM_MSG_TYPE_CHECKSUM_RESP,
+			.size	= sizeof(struct rpmem_msg_checksum_resp) +
+					sums_size,
+			.status	= (uint32_t)status,
+		},
+		.nsums = nsums,
+	};
+
+	rpmem_hton_msg_checksum_resp(&resp);
+
+	int ret = rpmem_obc_send(client->sockfd, &resp, sizeof(resp));
+	if (ret || !nsums)
+		return ret;
+
+	uint64_t *nsumsp = malloc(sums_size);
+	if (!nsumsp) {
+		RPMEMD_LOG(ERR, "!allocating checksums buffer");
+		return -1;
+	}
+
+	for (size_t i = 0; i < nsums; i++)
+		nsumsp[i] = htobe64(sums[i]);
+
+	ret = rpmem_obc_send(client->sockfd, nsumsp, sums_size);
+
+	free(nsumsp);
+
+	return ret;
+}
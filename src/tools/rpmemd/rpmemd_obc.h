@@ -34,6 +34,7 @@
  * rpmemd_obc.h -- rpmemd out-of-band connection declarations
  */
 
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -49,6 +50,8 @@ struct rpmemd_obc_client_requests {
 	int (*close)(struct rpmemd_obc_client *client, void *arg);
 	int (*remove)(struct rpmemd_obc_client *client, void *arg,
 			const char *pool_desc);
+	int (*checksum)(struct rpmemd_obc_client *client, void *arg,
+			size_t offset, size_t len, size_t blk_size);
 };
 
 struct rpmemd_obc *rpmemd_obc_init(void);
@@ -79,3 +82,5 @@ int rpmemd_obc_client_close_resp(struct rpmemd_obc_client *client,
 		int status);
 int rpmemd_obc_client_remove_resp(struct rpmemd_obc_client *client,
 		int status);
+int rpmemd_obc_client_checksum_resp(struct rpmemd_obc_client *client,
+		int status, const uint64_t *sums, size_t nsums);
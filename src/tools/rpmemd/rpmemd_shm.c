@@ -0,0 +1,501 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmemd_shm.c -- rpmemd shared memory transport module source file
+ */
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "rpmem_common.h"
+#include "rpmem_shm_common.h"
+#include "rpmemd_shm.h"
+#include "rpmemd_log.h"
+
+/* number of idle polls after which the processing thread starts to nap */
+#define RPMEMD_SHM_IDLE_NAP	(RPMEM_SHM_SPIN * 64)
+#define RPMEMD_SHM_NAP_US	50
+
+/*
+ * rpmemd_shm_thread -- processing thread context
+ */
+struct rpmemd_shm_thread {
+	struct rpmemd_shm *shm;
+	pthread_t thread;
+	unsigned idx;		/* first lane processed by the thread */
+};
+
+/*
+ * rpmemd_shm -- shared memory transport context
+ */
+struct rpmemd_shm {
+	void *addr;		/* pool address */
+	size_t size;		/* pool size */
+	int pool_fd;		/* pool file */
+	size_t pool_off;	/* offset of the pool within the file */
+	unsigned nlanes;
+	size_t nthreads;
+	void (*persist)(const void *addr, size_t len);
+	void (*flush)(const void *addr, size_t len);
+	void (*drain)(void);
+
+	int sockfd;		/* listening socket */
+	int connfd;		/* connected client */
+	int ctrl_fd;		/* control region file */
+	size_t ctrl_size;
+	struct rpmem_shm_ctrl *ctrl;
+
+	struct rpmemd_shm_thread *threads;
+	volatile int closing;	/* processing threads should exit */
+};
+
+/*
+ * rpmemd_shm_process_ring -- (internal) process persist requests found in
+ * lane's ring and return the number of requests processed
+ */
+static unsigned
+rpmemd_shm_process_ring(struct rpmemd_shm *shm, struct rpmem_shm_ring *ring)
+{
+	const struct rpmem_shm_msg *msg;
+	unsigned n = 0;
+
+	while (n < RPMEM_SHM_NSLOTS &&
+		(msg = rpmem_shm_ring_peek(ring, n)) != NULL) {
+		uint64_t offset = msg->offset;
+		uint64_t len = msg->len;
+		n++;
+
+		if (offset > shm->size || len > shm->size - offset) {
+			RPMEMD_LOG(ERR, "invalid persist request -- "
+				"offset %zu length %zu", (size_t)offset,
+				(size_t)len);
+			continue;
+		}
+
+		void *addr = (char *)shm->addr + offset;
+		if (shm->drain)
+			shm->flush(addr, len);
+		else
+			shm->persist(addr, len);
+	}
+
+	if (!n)
+		return 0;
+
+	if (shm->drain)
+		shm->drain();
+
+	rpmem_shm_ring_complete(ring, n);
+
+	return n;
+}
+
+/*
+ * rpmemd_shm_thread -- (internal) processing thread, polls the rings of
+ * every nthreads-th lane
+ */
+static void *
+rpmemd_shm_thread(void *arg)
+{
+	struct rpmemd_shm_thread *thr = arg;
+	struct rpmemd_shm *shm = thr->shm;
+	unsigned idle = 0;
+
+	while (!shm->closing) {
+		unsigned processed = 0;
+		for (size_t lane = thr->idx; lane < shm->nlanes;
+				lane += shm->nthreads) {
+			processed += rpmemd_shm_process_ring(shm,
+					&shm->ctrl->rings[lane]);
+		}
+
+		if (processed) {
+			idle = 0;
+		} else if (idle < RPMEMD_SHM_IDLE_NAP) {
+			if (++idle > RPMEM_SHM_SPIN)
+				sched_yield();
+		} else {
+			usleep(RPMEMD_SHM_NAP_US);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * rpmemd_shm_init_ctrl -- (internal) create and map control region
+ */
+static int
+rpmemd_shm_init_ctrl(struct rpmemd_shm *shm)
+{
+	shm->ctrl_size = rpmem_shm_ctrl_size(shm->nlanes);
+
+	shm->ctrl_fd = rpmem_shm_memfd("rpmemd-shm");
+	if (shm->ctrl_fd < 0)
+		goto err_memfd;
+
+	if (ftruncate(shm->ctrl_fd, (off_t)shm->ctrl_size)) {
+		RPMEMD_LOG(ERR, "!ftruncate");
+		goto err_ftruncate;
+	}
+
+	shm->ctrl = mmap(NULL, shm->ctrl_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, shm->ctrl_fd, 0);
+	if (shm->ctrl == MAP_FAILED) {
+		RPMEMD_LOG(ERR, "!mmap");
+		goto err_mmap;
+	}
+
+	shm->ctrl->magic = RPMEM_SHM_MAGIC;
+	shm->ctrl->nlanes = shm->nlanes;
+
+	return 0;
+err_mmap:
+err_ftruncate:
+	(void) close(shm->ctrl_fd);
+err_memfd:
+	return -1;
+}
+
+/*
+ * rpmemd_shm_listen -- (internal) bind the listening socket to the first
+ * free channel starting from a pid based one
+ */
+static int
+rpmemd_shm_listen(struct rpmemd_shm *shm, unsigned short *port)
+{
+	shm->sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (shm->sockfd < 0) {
+		RPMEMD_LOG(ERR, "!socket");
+		return -1;
+	}
+
+	unsigned start = (unsigned)getpid();
+	for (unsigned i = 0; i <= USHRT_MAX; i++) {
+		unsigned p = (start + i) % (USHRT_MAX + 1);
+		if (!p)
+			continue;
+
+		struct sockaddr_un addr;
+		socklen_t addrlen;
+		if (rpmem_shm_sockaddr(&addr, p, &addrlen))
+			goto err;
+
+		if (bind(shm->sockfd, (struct sockaddr *)&addr, addrlen)) {
+			if (errno == EADDRINUSE)
+				continue;
+
+			RPMEMD_LOG(ERR, "!bind");
+			goto err;
+		}
+
+		if (listen(shm->sockfd, 1)) {
+			RPMEMD_LOG(ERR, "!listen");
+			goto err;
+		}
+
+		*port = (unsigned short)p;
+		return 0;
+	}
+
+	RPMEMD_LOG(ERR, "no free shared memory channel");
+err:
+	(void) close(shm->sockfd);
+	return -1;
+}
+
+/*
+ * rpmemd_shm_init -- initialize shared memory transport and start
+ * listening for the client
+ */
+struct rpmemd_shm *
+rpmemd_shm_init(struct rpmemd_shm_attr *attr, struct rpmem_resp_attr *resp,
+	enum rpmem_err *err)
+{
+	RPMEMD_ASSERT(resp);
+	RPMEMD_ASSERT(err);
+	RPMEMD_ASSERT(attr);
+	RPMEMD_ASSERT(attr->persist);
+	RPMEMD_ASSERT(attr->nthreads);
+
+	if (!attr->nlanes) {
+		RPMEMD_LOG(ERR, "invalid number of lanes");
+		*err = RPMEM_ERR_BADNLANES;
+		return NULL;
+	}
+
+	struct rpmemd_shm *shm = calloc(1, sizeof(*shm));
+	if (!shm) {
+		RPMEMD_LOG(ERR, "!allocating shared memory transport handle");
+		*err = RPMEM_ERR_FATAL;
+		return NULL;
+	}
+
+	shm->addr = attr->addr;
+	shm->size = attr->size;
+	shm->pool_fd = attr->fd;
+	shm->pool_off = attr->fd_off;
+	shm->nlanes = attr->nlanes;
+	shm->nthreads = attr->nthreads;
+	shm->persist = attr->persist;
+	if (attr->flush && attr->drain) {
+		shm->flush = attr->flush;
+		shm->drain = attr->drain;
+	}
+	shm->connfd = -1;
+
+	if (rpmemd_shm_init_ctrl(shm)) {
+		*err = RPMEM_ERR_FATAL;
+		goto err_init_ctrl;
+	}
+
+	unsigned short port;
+	if (rpmemd_shm_listen(shm, &port)) {
+		*err = RPMEM_ERR_FATAL_CONN;
+		goto err_listen;
+	}
+
+	resp->port = port;
+	resp->rkey = 0;
+	resp->raddr = 0;
+	resp->nlanes = shm->nlanes;
+	resp->persist_method = RPMEM_PM_GPSPM;
+	resp->nconns = 1;
+
+	return shm;
+err_listen:
+	munmap(shm->ctrl, shm->ctrl_size);
+	(void) close(shm->ctrl_fd);
+err_init_ctrl:
+	free(shm);
+	return NULL;
+}
+
+/*
+ * rpmemd_shm_fini -- deinitialize shared memory transport
+ */
+void
+rpmemd_shm_fini(struct rpmemd_shm *shm)
+{
+	if (shm->sockfd >= 0)
+		(void) close(shm->sockfd);
+	munmap(shm->ctrl, shm->ctrl_size);
+	(void) close(shm->ctrl_fd);
+	free(shm);
+}
+
+/*
+ * rpmemd_shm_accept -- accept the client and pass it the pool file and
+ * the control region
+ *
+ * Only a process of the same user is accepted, since it gets full access
+ * to the pool file.
+ */
+int
+rpmemd_shm_accept(struct rpmemd_shm *shm)
+{
+	shm->connfd = accept4(shm->sockfd, NULL, NULL, SOCK_CLOEXEC);
+	if (shm->connfd < 0) {
+		RPMEMD_LOG(ERR, "!accept");
+		return -1;
+	}
+
+	/* single client per channel */
+	(void) close(shm->sockfd);
+	shm->sockfd = -1;
+
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (getsockopt(shm->connfd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+		RPMEMD_LOG(ERR, "!getting peer credentials");
+		goto err;
+	}
+
+	if (cred.uid != geteuid()) {
+		RPMEMD_LOG(ERR, "client of other user rejected -- uid %u",
+				(unsigned)cred.uid);
+		errno = EACCES;
+		goto err;
+	}
+
+	struct rpmem_shm_conn_msg msg = {
+		.pool_off = shm->pool_off,
+		.pool_size = shm->size,
+		.ctrl_size = shm->ctrl_size,
+	};
+
+	int fds[RPMEM_SHM_CONN_NFDS] = { shm->pool_fd, shm->ctrl_fd };
+
+	if (rpmem_shm_send_fds(shm->connfd, &msg, sizeof(msg),
+			fds, RPMEM_SHM_CONN_NFDS))
+		goto err;
+
+	return 0;
+err:
+	(void) close(shm->connfd);
+	shm->connfd = -1;
+	return -1;
+}
+
+/*
+ * rpmemd_shm_process_start -- start processing persist requests
+ */
+int
+rpmemd_shm_process_start(struct rpmemd_shm *shm)
+{
+	if (shm->nthreads > shm->nlanes)
+		shm->nthreads = shm->nlanes;
+
+	shm->threads = calloc(shm->nthreads, sizeof(*shm->threads));
+	if (!shm->threads) {
+		RPMEMD_LOG(ERR, "!allocating processing threads");
+		return -1;
+	}
+
+	shm->closing = 0;
+	shm->ctrl->closed = 0;
+
+	size_t i;
+	for (i = 0; i < shm->nthreads; i++) {
+		shm->threads[i].shm = shm;
+		shm->threads[i].idx = (unsigned)i;
+
+		errno = pthread_create(&shm->threads[i].thread, NULL,
+				rpmemd_shm_thread, &shm->threads[i]);
+		if (errno) {
+			RPMEMD_LOG(ERR, "!creating processing thread");
+			goto err_thread_create;
+		}
+	}
+
+	return 0;
+err_thread_create:
+	shm->closing = 1;
+	while (i--)
+		pthread_join(shm->threads[i].thread, NULL);
+	free(shm->threads);
+	shm->threads = NULL;
+	return -1;
+}
+
+/*
+ * rpmemd_shm_process_stop -- stop processing persist requests, the client
+ * waiting for a request gets an error
+ */
+int
+rpmemd_shm_process_stop(struct rpmemd_shm *shm)
+{
+	int ret = 0;
+
+	shm->closing = 1;
+	for (size_t i = 0; i < shm->nthreads; i++) {
+		errno = pthread_join(shm->threads[i].thread, NULL);
+		if (errno) {
+			RPMEMD_LOG(ERR, "!joining processing thread");
+			ret = -1;
+		}
+	}
+
+	free(shm->threads);
+	shm->threads = NULL;
+
+	shm->ctrl->closed = 1;
+	__sync_synchronize();
+
+	return ret;
+}
+
+/*
+ * rpmemd_shm_wait_close -- wait for the client to close the connection
+ *
+ * The timeout is in milliseconds, a negative one means infinity.
+ */
+int
+rpmemd_shm_wait_close(struct rpmemd_shm *shm, int timeout)
+{
+	struct pollfd pfd = {
+		.fd = shm->connfd,
+		.events = POLLIN | POLLRDHUP,
+	};
+
+	int ret = poll(&pfd, 1, timeout);
+	if (ret < 0) {
+		RPMEMD_LOG(ERR, "!poll");
+		return -1;
+	}
+
+	if (ret == 0) {
+		errno = ETIMEDOUT;
+		RPMEMD_LOG(ERR, "!waiting for the client to close");
+		return -1;
+	}
+
+	/* the client sends nothing, so anything but hang up is an error */
+	char c;
+	if (recv(shm->connfd, &c, sizeof(c), MSG_DONTWAIT) != 0) {
+		RPMEMD_LOG(ERR, "unexpected data from the client");
+		errno = EPROTO;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * rpmemd_shm_close -- close the connection
+ */
+int
+rpmemd_shm_close(struct rpmemd_shm *shm)
+{
+	if (shm->connfd < 0)
+		return 0;
+
+	int ret = close(shm->connfd);
+	if (ret)
+		RPMEMD_LOG(ERR, "!close");
+	shm->connfd = -1;
+
+	return ret;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *	* Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *	* Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *	* Neither the name of the copyright holder nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * rpmemd_shm.h -- rpmemd shared memory transport module header file
+ */
+
+#include <stddef.h>
+
+/*
+ * rpmemd_shm_attr -- shared memory transport attributes
+ *
+ * Unlike the fabric the client maps the pool itself, so the file
+ * descriptor of the pool file and the offset of the pool within it
+ * are required in addition to the pool address.
+ */
+struct rpmemd_shm_attr {
+	void *addr;
+	size_t size;
+	int fd;			/* pool file */
+	size_t fd_off;		/* offset of the pool within the file */
+	unsigned nlanes;
+	size_t nthreads;	/* number of processing threads */
+	void (*persist)(const void *addr, size_t len);
+
+	/*
+	 * Optional, if both are set the persist operation is split into
+	 * flushing every request and a single drain for all the requests
+	 * found in a lane's ring at once.
+	 */
+	void (*flush)(const void *addr, size_t len);
+	void (*drain)(void);
+};
+
+struct rpmemd_shm *rpmemd_shm_init(struct rpmemd_shm_attr *attr,
+		struct rpmem_resp_attr *resp, enum rpmem_err *err);
+void rpmemd_shm_fini(struct rpmemd_shm *shm);
+
+int rpmemd_shm_accept(struct rpmemd_shm *shm);
+int rpmemd_shm_process_start(struct rpmemd_shm *shm);
+int rpmemd_shm_process_stop(struct rpmemd_shm *shm);
+int rpmemd_shm_wait_close(struct rpmemd_shm *shm, int timeout);
+int rpmemd_shm_close(struct rpmemd_shm *shm);
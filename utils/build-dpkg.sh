@@ -584,6 +584,8 @@ usr/share/man/man1/pmempool-info.1.gz
 usr/share/man/man1/pmempool-dump.1.gz
 usr/share/man/man1/pmempool-check.1.gz
 usr/share/man/man1/pmempool-rm.1.gz
+usr/share/man/man1/pmempool-copy.1.gz
+usr/share/man/man1/pmempool-snapshot.1.gz
 usr/share/man/man1/pmempool-convert.1.gz
 etc/bash_completion.d/pmempool.sh
 EOF
@@ -390,6 +390,8 @@ Usefull applications for administration and diagnostic purposes.
 %{_mandir}/man1/pmempool-dump.1.gz
 %{_mandir}/man1/pmempool-check.1.gz
 %{_mandir}/man1/pmempool-rm.1.gz
+%{_mandir}/man1/pmempool-copy.1.gz
+%{_mandir}/man1/pmempool-snapshot.1.gz
 %{_mandir}/man1/pmempool-convert.1.gz
 %{_sysconfdir}/bash_completion.d/pmempool.sh
 